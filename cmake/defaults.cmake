@@ -54,6 +54,9 @@ set(WITH_TCMALLOC FALSE CACHE BOOL "Use tcmalloc as the memory allocator")
 # Use jemalloc as the memory allocator
 set(WITH_JEMALLOC FALSE CACHE BOOL "Use jemalloc as the memory allocator")
 
+# Build the io_uring poll engine if the kernel headers support it
+set(WITH_IO_URING TRUE CACHE BOOL "Build the io_uring poll engine")
+
 # Install experimental modules
 set(INSTALL_EXPERIMENTAL TRUE CACHE BOOL "Install experimental modules")
 
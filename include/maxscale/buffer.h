@@ -85,7 +85,10 @@ typedef enum
  */
 typedef enum
 {
-    GWBUF_PARSING_INFO
+    GWBUF_PARSING_INFO,
+    GWBUF_QC_CACHE_INFO,
+    GWBUF_PS_INFO,
+    GWBUF_DIGEST_INFO
 } bufobj_id_t;
 
 typedef struct buffer_object_st buffer_object_t;
@@ -105,10 +108,11 @@ struct buffer_object_st
  */
 typedef struct
 {
-    unsigned char   *data;     /*< Physical memory that was allocated */
-    int              refcount; /*< Reference count on the buffer */
-    buffer_object_t *bufobj;   /*< List of objects referred to by GWBUF */
-    gwbuf_info_t     info;     /*< Info bits */
+    unsigned char   *data;       /*< Physical memory that was allocated */
+    int              refcount;   /*< Reference count on the buffer */
+    buffer_object_t *bufobj;     /*< List of objects referred to by GWBUF */
+    gwbuf_info_t     info;       /*< Info bits */
+    int              size_class; /*< Buffer pool size class, -1 if not pooled */
 } SHARED_BUF;
 
 /**
@@ -118,6 +122,10 @@ typedef struct
  * or written to a descriptor. The use of linked lists of buffers with
  * flexible data pointers is designed to minimise the need for data to
  * be copied within the gateway.
+ *
+ * A buffer allocated with gwbuf_alloc is a single block of memory that holds
+ * the GWBUF, the SHARED_BUF and the data. Clones of a buffer only allocate a
+ * new GWBUF and the block is released when the last reference to it is freed.
  */
 typedef struct gwbuf
 {
@@ -176,6 +184,9 @@ typedef struct gwbuf
 /**
  * Allocate a new gateway buffer of specified size.
  *
+ * Buffers of up to MXS_MAX_NW_READ_BUFFER_SIZE bytes are recycled through
+ * per-thread pools of power of two size classes.
+ *
  * @param size  The size in bytes of the data area required
  *
  * @return Pointer to the buffer structure or NULL if memory could not
@@ -282,6 +293,17 @@ extern GWBUF *gwbuf_rtrim(GWBUF *head, unsigned int length);
  */
 extern unsigned int gwbuf_length(const GWBUF *head);
 
+/**
+ * Return the number of bytes that can be appended in place to the end of
+ * a buffer. Only a buffer whose data is not shared with any other buffer
+ * can be extended.
+ *
+ * @param buf  The buffer to inspect
+ *
+ * @return The number of free bytes after the end of the buffer's data
+ */
+extern size_t gwbuf_tailroom(const GWBUF *buf);
+
 /**
  * Return the number of individual buffers in the linked list.
  *
@@ -395,6 +417,14 @@ void gwbuf_add_buffer_object(GWBUF* buf,
  * @return Searched buffer object or NULL if not found
  */
 void *gwbuf_get_buffer_object_data(GWBUF* buf, bufobj_id_t id);
+
+/**
+ * Print the buffer allocation and pooling statistics of all threads
+ *
+ * @param pdcb  DCB to print to
+ */
+extern void dprintBufferStats(void *pdcb);
+
 #if defined(BUFFER_TRACE)
 extern void dprintAllBuffers(void *pdcb);
 #endif
@@ -52,6 +52,25 @@ typedef struct config_context
     struct config_context *next;       /**< Next pointer in the linked list */
 } CONFIG_CONTEXT;
 
+/**
+ * How new DCBs are assigned to the worker threads
+ */
+typedef enum
+{
+    THREAD_ASSIGN_ROUND_ROBIN, /**< Assign DCBs to the threads in turn */
+    THREAD_ASSIGN_LEAST_DCBS,  /**< Assign to the thread with the fewest DCBs */
+    THREAD_ASSIGN_LEAST_LOAD   /**< Assign to the thread with the lowest recent load */
+} MXS_THREAD_ASSIGNMENT;
+
+/**
+ * The mechanism the worker threads use to wait for network events
+ */
+typedef enum
+{
+    POLL_ENGINE_EPOLL,   /**< Use epoll */
+    POLL_ENGINE_IO_URING /**< Use io_uring, falls back to epoll if it is not supported */
+} MXS_POLL_ENGINE;
+
 /**
  * The gateway global configuration data
  */
@@ -75,8 +94,15 @@ typedef struct
     bool          skip_permission_checks;              /**< Skip service and monitor permission checks */
     char          qc_name[PATH_MAX];                   /**< The name of the query classifier to load */
     char*         qc_args;                             /**< Arguments for the query classifier */
+    int64_t       qc_cache_size;                       /**< Maximum number of cached classifications,
+                                                        *   0 disables the cache */
+    bool          qc_preclassify;                      /**< Classify simple statements without parsing them */
     int           query_retries;                       /**< Number of times a interrupted query is retried */
     time_t        query_retry_timeout;                 /**< Timeout for query retries */
+    MXS_THREAD_ASSIGNMENT thread_assignment;           /**< How DCBs are assigned to threads */
+    int           rebalance_threshold;                 /**< Busy time difference in percent that
+                                                        *   moves sessions between threads, 0 disables */
+    MXS_POLL_ENGINE poll_engine;                       /**< How the threads wait for network events */
 } MXS_CONFIG;
 
 /**
@@ -251,6 +277,28 @@ int config_threadcount(void);
  */
 unsigned int config_nbpolls(void);
 
+/**
+ * @brief Get the thread assignment policy
+ *
+ * @return How new DCBs are assigned to the worker threads
+ */
+MXS_THREAD_ASSIGNMENT config_thread_assignment(void);
+
+/**
+ * @brief Get the thread rebalancing threshold
+ *
+ * @return Difference in the busy time percentages of two threads that causes
+ *         sessions to be moved between them, 0 if rebalancing is disabled
+ */
+int config_rebalance_threshold(void);
+
+/**
+ * @brief Get the configured poll engine
+ *
+ * @return How the worker threads wait for network events
+ */
+MXS_POLL_ENGINE config_poll_engine(void);
+
 /**
  * @brief Get poll sleep interval
  *
@@ -76,6 +76,11 @@ typedef struct dcbstats
     int     n_buffered;     /*< Number of buffered writes */
     int     n_high_water;   /*< Number of crosses of high water mark */
     int     n_low_water;    /*< Number of crosses of low water mark */
+    int     n_write_calls;  /*< Number of write system calls */
+    int     n_write_iovecs; /*< Number of buffers submitted in write system calls */
+    int     n_read_buffers; /*< Number of buffers allocated for reads */
+    int     n_reads_inplace; /*< Number of reads appended to an earlier buffer */
+    int     n_migrations;   /*< Number of times moved to another thread */
 } DCBSTATS;
 
 #define DCBSTATS_INIT {0}
@@ -223,6 +228,8 @@ typedef struct dcb
     long            last_read;      /*< Last time the DCB received data */
     int             high_water;     /**< High water mark */
     int             low_water;      /**< Low water mark */
+    int             read_size_hint; /**< Expected read size, based on earlier reads */
+    int             *reuseport_fds; /**< Per-thread sockets of a SO_REUSEPORT listener */
     struct server   *server;        /**< The associated backend server */
     SSL*            ssl;            /*< SSL struct for connection */
     bool            ssl_read_want_read;    /*< Flag */
@@ -235,6 +242,7 @@ typedef struct dcb
         int id; /**< The owning thread's ID */
         struct dcb *next; /**< Next DCB in owning thread's list */
         struct dcb *tail; /**< Last DCB in owning thread's list */
+        bool migrating; /**< The DCB is being moved to another thread */
     } thread;
     skygw_chk_t     dcb_chk_tail;
 } DCB;
@@ -306,6 +314,27 @@ void dcb_process_zombies(int threadid);
  */
 void dcb_add_to_list(DCB *dcb);
 
+/**
+ * Remove a DCB from the owner's list
+ *
+ * @param dcb DCB to remove
+ */
+void dcb_remove_from_list(DCB *dcb);
+
+/**
+ * Move the DCBs of idle sessions from one thread to another
+ *
+ * A session is idle when none of its DCBs have any queued data. The client
+ * DCB and the backend DCBs of a session are always moved together. This
+ * must be called by the thread that owns the DCBs.
+ *
+ * @param thread_id The calling thread
+ * @param target    The thread to move the sessions to
+ * @param max_dcbs  Stop after moving at least this many DCBs
+ * @return Number of DCBs moved
+ */
+int dcb_migrate_idle_sessions(int thread_id, int target, int max_dcbs);
+
 void printAllDCBs();                         /* Debug to print all DCB in the system */
 void printDCB(DCB *);                        /* Debug print routine */
 void dprintDCBList(DCB *);                 /* Debug print DCB list statistics */
@@ -42,6 +42,7 @@ typedef struct servlistener
     char *auth_options;         /**< Authenticator options */
     void *auth_instance;        /**< Authenticator instance created in MXS_AUTHENTICATOR::initialize() */
     SSL_LISTENER *ssl;          /**< Structure of SSL data or NULL */
+    bool reuseport;             /**< Open one SO_REUSEPORT socket per thread */
     struct dcb *listener;       /**< The DCB for the listener */
     struct users *users;        /**< The user data for this listener */
     struct service* service;    /**< The service which used by this listener */
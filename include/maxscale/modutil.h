@@ -21,6 +21,7 @@
 #include <maxscale/dcb.h>
 #include <string.h>
 #include <maxscale/pcre2.h>
+#include <maxscale/utils.h>
 
 MXS_BEGIN_DECLS
 
@@ -43,11 +44,38 @@ extern char*    modutil_get_query(GWBUF* buf);
 extern int      modutil_send_mysql_err_packet(DCB *, int, int, int, const char *, const char *);
 GWBUF*          modutil_get_next_MySQL_packet(GWBUF** p_readbuf);
 GWBUF*          modutil_get_complete_packets(GWBUF** p_readbuf);
+
+/** A MySQL packet in a chain of buffers */
+typedef struct modutil_packet
+{
+    size_t   offset; /*< Offset of the packet from the start of the chain */
+    uint32_t len;    /*< Length of the packet, header included */
+    uint8_t  cmd;    /*< First byte of the payload, 0 if the payload is empty */
+} MODUTIL_PACKET;
+
+/**
+ * Find the complete MySQL packets in a chain of buffers
+ *
+ * The chain is scanned once. The headers of packets that are within one
+ * buffer are read directly, only packets that span buffers are copied.
+ *
+ * @param buffer   Chain of buffers that starts at a packet boundary
+ * @param packets  Array where the found packets are stored, or NULL if
+ *                 only the total length is needed
+ * @param n_max    Maximum number of packets to find
+ * @param n_bytes  If not NULL, the total length of the found packets
+ *
+ * @return The number of complete packets found. It is less than @c n_max
+ *         only if the chain ends.
+ */
+size_t modutil_index_packets(const GWBUF* buffer, MODUTIL_PACKET* packets,
+                             size_t n_max, size_t* n_bytes);
 int             modutil_MySQL_query_len(GWBUF* buf, int* nbytes_missing);
 void            modutil_reply_parse_error(DCB* backend_dcb, char* errstr, uint32_t flags);
 void            modutil_reply_auth_error(DCB* backend_dcb, char* errstr, uint32_t flags);
 int             modutil_count_statements(GWBUF* buffer);
 GWBUF*          modutil_create_query(const char* query);
+GWBUF*          modutil_create_query_len(const char* query, size_t len);
 GWBUF*          modutil_create_mysql_err_msg(int             packet_number,
                                              int             affected_rows,
                                              int             merrno,
@@ -55,6 +83,51 @@ GWBUF*          modutil_create_mysql_err_msg(int             packet_number,
                                              const char      *msg);
 
 int modutil_count_signal_packets(GWBUF*, int, int, int*);
+
+/**
+ * Find the new value of a tracked system variable in an OK packet
+ *
+ * The server only reports the changes of the variables listed in
+ * session_track_system_variables and only if the connection has negotiated
+ * the CLIENT_SESSION_TRACK capability.
+ *
+ * @param packet Start of a complete MySQL packet
+ * @param name   Name of the variable
+ * @param dest   Where the null-terminated value is copied
+ * @param size   Size of @c dest
+ *
+ * @return True if @c packet is an OK packet which reports a new value for
+ *         @c name and the value fits into @c dest
+ */
+bool modutil_get_tracked_variable(const uint8_t* packet, const char* name,
+                                  char* dest, size_t size);
+
+/**
+ * Add the tracked system variables of an OK packet as buffer properties
+ *
+ * @param buf    Buffer where the properties are added
+ * @param packet Start of a complete MySQL packet
+ *
+ * @return Number of properties added
+ */
+int modutil_add_tracked_variables(GWBUF* buf, const uint8_t* packet);
+
+/**
+ * Remove the session state changes from an OK packet
+ *
+ * Rewrites an OK packet in the CLIENT_SESSION_TRACK format into the format
+ * of a client that did not negotiate the capability: the state changes are
+ * removed, the SERVER_SESSION_STATE_CHANGED flag is cleared and the
+ * length-encoded info string becomes a plain string. Other packets are
+ * not modified. The packet must come from a connection that negotiated
+ * CLIENT_SESSION_TRACK as the info string of other OK packets is not
+ * length-encoded.
+ *
+ * @param packet Start of a complete MySQL packet, modified in place
+ *
+ * @return The new length of the packet including the header
+ */
+size_t modutil_strip_session_track(uint8_t* packet);
 mxs_pcre2_result_t modutil_mysql_wildcard_match(const char* pattern, const char* string);
 
 /**
@@ -81,8 +154,92 @@ char* strnchr_esc(char* ptr, char c, int len);
 char* strnchr_esc_mysql(char* ptr, char c, int len);
 bool is_mysql_statement_end(const char* start, int len);
 bool is_mysql_sp_end(const char* start, int len);
+
+/**
+ * Find the next statement of a multi-statement query
+ *
+ * The statement is not copied, the returned pointer points into @c sql.
+ * Whitespace, comments and delimiters between statements are skipped but
+ * executable comments are treated as statements. The contents of executable
+ * comments are treated as code, so a delimiter inside one ends the statement.
+ * A delimiter followed by the END of a BEGIN ... END block does not end the
+ * statement.
+ *
+ * @param sql  Start of the unprocessed part of the query
+ * @param end  End of the query
+ * @param len  The length of the statement is stored here
+ *
+ * @return The start of the statement or NULL if there are no more statements.
+ *         The next statement is found by passing the returned pointer plus
+ *         @c len as @c sql.
+ */
+const char* modutil_get_next_statement(const char* sql, const char* end, int* len);
 char* modutil_get_canonical(GWBUF* querybuf);
 
+/** The size of the buffer that modutil_canonicalize needs for a statement of @c len bytes */
+#define MODUTIL_CANONICAL_SIZE(len) ((len) + (len) / 2 + 1)
+
+/**
+ * Create the canonical form of a statement
+ *
+ * Strings and numbers are replaced with question marks, comments are removed
+ * and whitespace is squeezed. The result is the same as what
+ * modutil_get_canonical returns but no memory is allocated and the statement
+ * is read only once.
+ *
+ * @param sql    The statement, it ends at @c len or at the first NUL character
+ * @param len    Length of the statement
+ * @param dest   Buffer of at least MODUTIL_CANONICAL_SIZE(len) bytes where the
+ *               null-terminated canonical form is stored
+ * @param digest If not NULL, a 64-bit FNV-1a hash of the canonical form is
+ *               stored here
+ *
+ * @return Length of the canonical form
+ */
+size_t modutil_canonicalize(const char* sql, size_t len, char* dest, uint64_t* digest);
+
+/** The digest of a statement */
+typedef struct modutil_digest
+{
+    MXS_HASH128 hash;          /*< 128-bit hash of the SQL of the statement */
+    bool        has_canonical; /*< Whether the canonical form has been hashed */
+    uint64_t    canonical;     /*< 64-bit FNV-1a hash of the canonical form, use
+                                *  modutil_get_canonical_digest to get it */
+} MODUTIL_DIGEST;
+
+/**
+ * Get the digest of a statement
+ *
+ * The digest is calculated when it is first asked for and stored in the
+ * buffer as a GWBUF_DIGEST_INFO object, so the SQL is scanned only once
+ * however many filters and routers look at the digest. Clones of the
+ * buffer share the digest. Only the hash of the SQL is calculated, the
+ * statement is not canonicalized.
+ *
+ * @param buf  A COM_QUERY or COM_STMT_PREPARE packet whose SQL is in
+ *             the first buffer
+ *
+ * @return The digest, or NULL if the buffer does not contain a complete
+ *         statement or memory could not be allocated
+ */
+const MODUTIL_DIGEST* modutil_get_digest(GWBUF* buf);
+
+/**
+ * Get the hash of the canonical form of a statement
+ *
+ * Statements that differ only in their literals have the same hash. The
+ * statement is canonicalized when the hash is first asked for and the hash
+ * is stored in the digest of the buffer.
+ *
+ * @param buf       A COM_QUERY or COM_STMT_PREPARE packet whose SQL is in
+ *                  the first buffer
+ * @param canonical The hash is stored here
+ *
+ * @return True if the hash was calculated, false if the buffer does not
+ *         contain a complete statement or memory could not be allocated
+ */
+bool modutil_get_canonical_digest(GWBUF* buf, uint64_t* canonical);
+
 // TODO: Move modutil out of the core
 const char* STRPACKETTYPE(int p);
 
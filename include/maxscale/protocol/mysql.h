@@ -61,6 +61,7 @@
 #include <maxscale/version.h>
 #include <maxscale/housekeeper.h>
 #include <maxscale/utils.h>
+#include <maxscale/query_classifier.h>
 #include <mysql.h>
 
 MXS_BEGIN_DECLS
@@ -75,6 +76,7 @@ MXS_BEGIN_DECLS
 #define MYSQL_EOF_PACKET_LEN 9
 #define MYSQL_OK_PACKET_MIN_LEN 11
 #define MYSQL_ERR_PACKET_MIN_LEN 9
+#define MYSQL_PS_OK_PACKET_LEN 16
 
 /**
  * Offsets and sizes of various parts of the client packet. If the offset is
@@ -282,6 +284,34 @@ typedef struct server_command_st
     struct server_command_st* scom_next;
 } server_command_t;
 
+/**
+ * The classification of a prepared statement. The client protocol stores it
+ * when the statement is prepared and attaches it to every COM_STMT_EXECUTE
+ * of the statement as a GWBUF_PS_INFO buffer object.
+ */
+typedef struct mysql_ps_info
+{
+    uint32_t              id;        /*< Statement id assigned by the server */
+    uint32_t              type_mask; /*< Type mask of the prepared statement */
+    qc_query_op_t         operation; /*< Operation of the prepared statement */
+    bool                  long_data; /*< COM_STMT_SEND_LONG_DATA was sent for it */
+    int                   refcount;  /*< The registry and each execute hold one */
+    struct mysql_ps_info* next;      /*< Next statement waiting for its id */
+} MYSQL_PS_INFO;
+
+/**
+ * The state of the reply to the oldest command sent to a backend that
+ * negotiated CLIENT_SESSION_TRACK.
+ */
+typedef enum
+{
+    MYSQL_TRACK_START,   /*< Waiting for the first packet of a reply */
+    MYSQL_TRACK_COLUMNS, /*< Reading the column definitions of a result set */
+    MYSQL_TRACK_ROWS,    /*< Reading the rows of a result set */
+    MYSQL_TRACK_SKIP,    /*< Skipping the definitions of a prepared statement */
+    MYSQL_TRACK_DISABLED /*< The replies can no longer be followed */
+} mysql_track_state_t;
+
 /**
  * MySQL Protocol specific state data.
  *
@@ -308,6 +338,18 @@ typedef struct
     unsigned int           charset;                      /*< MySQL character set at connect time */
     bool                   ignore_reply;                 /*< If the reply should be discarded */
     GWBUF*                 stored_query;                 /*< Temporarily stored queries */
+    MYSQL_PS_INFO**        ps_infos;                     /*< Prepared statements, sorted by id */
+    size_t                 n_ps_infos;                   /*< Number of prepared statements */
+    size_t                 ps_infos_capacity;            /*< Capacity of ps_infos */
+    MYSQL_PS_INFO*         pending_ps_infos;             /*< Prepared statements waiting for an id */
+    uint32_t               last_ps_id;                   /*< Last id the server assigned */
+    bool                   session_track;                /*< CLIENT_SESSION_TRACK was negotiated */
+    uint8_t*               track_cmds;                   /*< Commands waiting for a reply, oldest first */
+    size_t                 n_track_cmds;                 /*< Number of commands waiting for a reply */
+    size_t                 track_cmds_capacity;          /*< Capacity of track_cmds */
+    mysql_track_state_t    track_state;                  /*< State of the reply being read */
+    uint32_t               track_skip;                   /*< Packets left to skip */
+    bool                   track_continued;              /*< The next packet continues a large one */
 #if defined(SS_DEBUG)
     skygw_chk_t            protocol_chk_tail;
 #endif
@@ -366,6 +408,20 @@ static inline bool MYSQL_IS_CHANGE_USER(const uint8_t* header)
     return MYSQL_GET_COMMAND(header) == MYSQL_COM_CHANGE_USER;
 }
 
+/**
+ * Get the classification of the prepared statement a COM_STMT_EXECUTE executes.
+ *
+ * @param buffer  A COM_STMT_EXECUTE packet.
+ *
+ * @return The classification stored when the statement was prepared, or NULL
+ *         if the statement was not prepared through this session or the router
+ *         does not require contiguous input.
+ */
+static inline const MYSQL_PS_INFO* mysql_get_ps_info(GWBUF* buffer)
+{
+    return (const MYSQL_PS_INFO*)gwbuf_get_buffer_object_data(buffer, GWBUF_PS_INFO);
+}
+
 /* The following can be compared using memcmp to detect a null password */
 extern uint8_t null_client_sha1[MYSQL_SCRAMBLE_LEN];
 
@@ -405,6 +461,7 @@ int mysql_send_auth_error (
 
 GWBUF* gw_MySQL_get_next_packet(GWBUF** p_readbuf);
 GWBUF* gw_MySQL_get_packets(GWBUF** p_readbuf, int* npackets);
+GWBUF* mysql_take_packet(GWBUF** p_readbuf, size_t packetlen);
 void   protocol_add_srv_command(MySQLProtocol* p, mysql_server_cmd_t cmd);
 void   protocol_remove_srv_command(MySQLProtocol* p);
 bool   protocol_waits_response(MySQLProtocol* p);
@@ -436,6 +493,70 @@ int send_mysql_native_password_response(DCB* dcb);
 /** Write an OK packet to a DCB */
 int mxs_mysql_send_ok(DCB *dcb, int sequence, uint8_t affected_rows, const char* message);
 
+/**
+ * Update the prepared statement registry of a client connection with a
+ * command the client sent.
+ *
+ * COM_STMT_PREPARE is classified and waits for its id, COM_STMT_EXECUTE gets
+ * the classification of the statement as a GWBUF_PS_INFO buffer object and
+ * COM_STMT_CLOSE removes the statement. Any command that has a response of its
+ * own drops the statements that are still waiting for an id, as their
+ * responses can no longer be told apart from it.
+ *
+ * @param proto  The client protocol.
+ * @param packet A contiguous packet sent by the client.
+ */
+void mysql_ps_registry_command(MySQLProtocol* proto, GWBUF* packet);
+
+/**
+ * Pick the statement ids of pending prepared statements from a reply that is
+ * written to the client.
+ *
+ * @param proto  The client protocol.
+ * @param reply  The reply, starting at a packet boundary.
+ */
+void mysql_ps_registry_reply(MySQLProtocol* proto, GWBUF* reply);
+
+/**
+ * Free the prepared statement registry of a client connection. Executes
+ * that are still in flight keep their classification alive.
+ *
+ * @param proto  The client protocol.
+ */
+void mysql_ps_registry_free(MySQLProtocol* proto);
+
+/**
+ * Record the commands written to a backend that negotiated CLIENT_SESSION_TRACK
+ * so that the OK packets of their replies can be told apart from other packets.
+ *
+ * @param proto  The backend protocol.
+ * @param buffer Packets written to the backend.
+ */
+void mysql_track_command(MySQLProtocol* proto, GWBUF* buffer);
+
+/**
+ * Rewrite the OK packets of a reply from a backend that negotiated
+ * CLIENT_SESSION_TRACK into the format of a client that did not.
+ *
+ * The tracked system variables of each OK packet are added to the reply as
+ * buffer properties before the session state changes are removed.
+ *
+ * @param proto The backend protocol.
+ * @param reply Complete packets read from the backend.
+ *
+ * @return The rewritten reply or NULL if memory allocation failed, in which
+ *         case @c reply is freed.
+ */
+GWBUF* mysql_track_reply(MySQLProtocol* proto, GWBUF* reply);
+
+/**
+ * Forget the commands whose replies have not been read. Used when a pooled
+ * connection is taken into use.
+ *
+ * @param proto The backend protocol.
+ */
+void mysql_track_reset(MySQLProtocol* proto);
+
 /** Check for OK packet */
 bool mxs_mysql_is_ok_packet(GWBUF *buffer);
 
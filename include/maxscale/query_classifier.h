@@ -151,6 +151,19 @@ typedef struct qc_function_info
     uint32_t usage; /** Bitfield denoting where the column appears. */
 } QC_FUNCTION_INFO;
 
+/**
+ * QC_CACHE_STATS contains the statistics of the classification cache.
+ */
+typedef struct qc_cache_stats
+{
+    int64_t size;      /** Number of cached statements. */
+    int64_t max_size;  /** Maximum number of cached statements, 0 if the cache is disabled. */
+    int64_t hits;      /** Number of statements classified using the cache. */
+    int64_t misses;    /** Number of cacheable statements that were not found. */
+    int64_t inserts;   /** Number of statements added to the cache. */
+    int64_t evictions; /** Number of statements removed to make room for new ones. */
+} QC_CACHE_STATS;
+
 /**
  * Each API function returns @c QC_RESULT_OK if the actual parsing process
  * succeeded, and some error code otherwise.
@@ -554,6 +567,18 @@ void qc_get_field_info(GWBUF* stmt, const QC_FIELD_INFO** infos, size_t* n_infos
  */
 void qc_get_function_info(GWBUF* stmt, const QC_FUNCTION_INFO** infos, size_t* n_infos);
 
+/**
+ * Returns the statistics of the classification cache.
+ *
+ * Statements that differ only in their literals are classified identically,
+ * so the result of classifying a COM_QUERY is cached using the canonical form
+ * of the statement as the key. The size of the cache is controlled with the
+ * @c query_classifier_cache_size parameter.
+ *
+ * @param stats  Pointer to the structure where the statistics are stored.
+ */
+void qc_get_cache_stats(QC_CACHE_STATS* stats);
+
 /**
  * Returns the statement, with literals replaced with question marks.
  *
@@ -668,6 +693,19 @@ char** qc_get_table_names(GWBUF* stmt, int* size, bool fullnames);
  */
 uint32_t qc_get_type_mask(GWBUF* stmt);
 
+/**
+ * Returns the combined type bitmask of all statements of a multi-statement
+ * query. Each statement is classified separately and the result is the
+ * bitwise OR of their type masks. A statement that can't be fully parsed
+ * or classified adds QUERY_TYPE_WRITE. For a query with only one statement
+ * the result is the same as what qc_get_type_mask() returns.
+ *
+ * @param stmt  A buffer containing a COM_QUERY packet.
+ *
+ * @return A bitmask with the type(s) of all the statements of the query.
+ */
+uint32_t qc_get_multi_type_mask(GWBUF* stmt);
+
 /**
  * Returns the type bitmask of transaction related statements.
  *
@@ -51,6 +51,10 @@ typedef struct
     int n_persistent;     /**< Current persistent pool */
     uint64_t n_new_conn;  /**< Times the current pool was empty */
     uint64_t n_from_pool; /**< Times when a connection was available from the pool */
+    uint64_t response_time; /**< Decaying average of the query response time in
+                             *   microseconds, zero if nothing has been measured */
+    uint64_t response_time_sampled; /**< When response_time was last updated, in
+                                     *   microseconds of the monotonic clock */
 } SERVER_STATS;
 
 /**
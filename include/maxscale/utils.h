@@ -136,4 +136,26 @@ bool mxs_mkdir_all(const char *path, int mask);
 
 long get_processor_count();
 
+/** A 128-bit hash value */
+typedef struct mxs_hash128
+{
+    uint64_t lo;
+    uint64_t hi;
+} MXS_HASH128;
+
+/**
+ * Calculate a fast 128-bit non-cryptographic hash (MurmurHash3, x64 variant)
+ *
+ * @param data  The data to hash
+ * @param len   Length of the data
+ * @param seed  The seed, different seeds give independent hashes
+ * @param hash  The hash is stored here
+ */
+void mxs_hash128(const void* data, size_t len, uint32_t seed, MXS_HASH128* hash);
+
+static inline bool mxs_hash128_equal(const MXS_HASH128* lhs, const MXS_HASH128* rhs)
+{
+    return lhs->lo == rhs->lo && lhs->hi == rhs->hi;
+}
+
 MXS_END_DECLS
@@ -49,6 +49,31 @@ static inline bool qc_info_was_parsed(qc_parse_result_t status)
     return status == QC_QUERY_PARSED;
 }
 
+/**
+ * A block of memory from which the strings of a particular query are
+ * allocated. The blocks of a query are freed together with the query
+ * information, so individual strings need not be freed.
+ */
+typedef struct qc_sqlite_arena
+{
+    struct qc_sqlite_arena* next;    // The block that was used before this one.
+    size_t size;                     // The size of data.
+    size_t used;                     // The number of used bytes in data.
+    char data[];
+} QC_SQLITE_ARENA;
+
+enum
+{
+    QC_SQLITE_ARENA_SIZE = 1024,     // The default size of the data of a block.
+    QC_SQLITE_ARENA_MAX_FREE = 32,   // The maximum number of free blocks per thread.
+};
+
+enum
+{
+    QC_SQLITE_INFO_MAX_FREE = 32,     // The maximum number of free infos per thread.
+    QC_SQLITE_INFO_MAX_CAPACITY = 64, // The largest array capacity of a reused info.
+};
+
 /**
  * Contains information about a particular query.
  */
@@ -85,6 +110,8 @@ typedef struct qc_sqlite_info
     size_t function_infos_len;       // The used entries in function_infos.
     size_t function_infos_capacity;  // The capacity of the function_infos array.
     bool initializing;               // Whether we are initializing sqlite3.
+    QC_SQLITE_ARENA* arena;          // The memory of the strings of the query.
+    struct qc_sqlite_info* next;     // The next free info, when on a free list.
 } QC_SQLITE_INFO;
 
 typedef enum qc_log_level
@@ -114,6 +141,10 @@ static thread_local struct
     bool initialized;
     sqlite3* db;      // Thread specific database handle.
     QC_SQLITE_INFO* info;
+    QC_SQLITE_ARENA* free_arenas; // Blocks that can be reused.
+    int n_free_arenas;            // The number of blocks in free_arenas.
+    QC_SQLITE_INFO* free_infos;   // Infos that can be reused.
+    int n_free_infos;             // The number of infos in free_infos.
 } this_thread;
 
 /**
@@ -127,17 +158,20 @@ typedef enum qc_token_position
     QC_TOKEN_RIGHT,  // To the right, e.g: "b" in "a = b".
 } qc_token_position_t;
 
+static void arena_free(QC_SQLITE_ARENA* arena);
 static void buffer_object_free(void* data);
 static char** copy_string_array(char** strings, int* pn);
 static void enlarge_string_array(size_t n, size_t len, char*** ppzStrings, size_t* pCapacity);
 static bool ensure_query_is_parsed(GWBUF* query, uint32_t collect);
-static void free_field_infos(QC_FIELD_INFO* infos, size_t n_infos);
-static void free_string_array(char** sa);
 static QC_SQLITE_INFO* get_query_info(GWBUF* query, uint32_t collect);
 static QC_SQLITE_INFO* info_alloc(uint32_t collect);
 static void info_finish(QC_SQLITE_INFO* info);
 static void info_free(QC_SQLITE_INFO* info);
 static QC_SQLITE_INFO* info_init(QC_SQLITE_INFO* info, uint32_t collect);
+static bool info_is_reusable(const QC_SQLITE_INFO* info);
+static char* info_alloc_string(QC_SQLITE_INFO* info, size_t n);
+static char* info_strdup(QC_SQLITE_INFO* info, const char* s);
+static char* info_strndup(QC_SQLITE_INFO* info, const char* s, size_t n);
 static void log_invalid_data(GWBUF* query, const char* message);
 static bool parse_query(GWBUF* query, uint32_t collect);
 static void parse_query_string(const char* query, size_t len);
@@ -220,6 +254,35 @@ extern void maxscaleCollectInfoFromSelect(Parse*, Select*, int);
 
 extern void maxscale_update_function_info(const char* name, uint32_t usage);
 
+/**
+ * Free the blocks of an arena. Blocks of the default size are kept for
+ * reuse by the current thread.
+ *
+ * @param arena The most recently used block of an arena.
+ */
+static void arena_free(QC_SQLITE_ARENA* arena)
+{
+    while (arena)
+    {
+        QC_SQLITE_ARENA* next = arena->next;
+
+        if (this_thread.initialized &&
+            (arena->size == QC_SQLITE_ARENA_SIZE) &&
+            (this_thread.n_free_arenas < QC_SQLITE_ARENA_MAX_FREE))
+        {
+            arena->next = this_thread.free_arenas;
+            this_thread.free_arenas = arena;
+            ++this_thread.n_free_arenas;
+        }
+        else
+        {
+            MXS_FREE(arena);
+        }
+
+        arena = next;
+    }
+}
+
 /**
  * Used for freeing a QC_SQLITE_INFO object added to a GWBUF.
  *
@@ -281,50 +344,6 @@ static bool ensure_query_is_parsed(GWBUF* query, uint32_t collect)
     return parsed;
 }
 
-static void free_field_infos(QC_FIELD_INFO* infos, size_t n_infos)
-{
-    if (infos)
-    {
-        for (int i = 0; i < n_infos; ++i)
-        {
-            MXS_FREE(infos[i].database);
-            MXS_FREE(infos[i].table);
-            MXS_FREE(infos[i].column);
-        }
-
-        MXS_FREE(infos);
-    }
-}
-
-static void free_function_infos(QC_FUNCTION_INFO* infos, size_t n_infos)
-{
-    if (infos)
-    {
-        for (int i = 0; i < n_infos; ++i)
-        {
-            MXS_FREE(infos[i].name);
-        }
-
-        MXS_FREE(infos);
-    }
-}
-
-static void free_string_array(char** sa)
-{
-    if (sa)
-    {
-        char** s = sa;
-
-        while (*s)
-        {
-            free(*s);
-            ++s;
-        }
-
-        free(sa);
-    }
-}
-
 static QC_SQLITE_INFO* get_query_info(GWBUF* query, uint32_t collect)
 {
     QC_SQLITE_INFO* info = NULL;
@@ -338,10 +357,28 @@ static QC_SQLITE_INFO* get_query_info(GWBUF* query, uint32_t collect)
     return info;
 }
 
+/**
+ * Allocate an info. An info freed earlier by the current thread is reused
+ * if there is one, otherwise a new one is allocated.
+ *
+ * @param collect What information should be collected.
+ *
+ * @return An initialized info.
+ */
 static QC_SQLITE_INFO* info_alloc(uint32_t collect)
 {
-    QC_SQLITE_INFO* info = MXS_MALLOC(sizeof(*info));
-    MXS_ABORT_IF_NULL(info);
+    QC_SQLITE_INFO* info = this_thread.free_infos;
+
+    if (info)
+    {
+        this_thread.free_infos = info->next;
+        --this_thread.n_free_infos;
+    }
+    else
+    {
+        info = MXS_CALLOC(1, sizeof(*info));
+        MXS_ABORT_IF_NULL(info);
+    }
 
     info_init(info, collect);
 
@@ -350,62 +387,159 @@ static QC_SQLITE_INFO* info_alloc(uint32_t collect)
 
 static void info_finish(QC_SQLITE_INFO* info)
 {
-    free_string_array(info->table_names);
-    free_string_array(info->table_fullnames);
-    free(info->created_table_name);
-    free_string_array(info->database_names);
-    free(info->prepare_name);
+    // The strings themselves are in the arena.
+    MXS_FREE(info->table_names);
+    MXS_FREE(info->table_fullnames);
+    MXS_FREE(info->database_names);
     gwbuf_free(info->preparable_stmt);
-    free_field_infos(info->field_infos, info->field_infos_len);
-    free_function_infos(info->function_infos, info->function_infos_len);
+    MXS_FREE(info->field_infos);
+    MXS_FREE(info->function_infos);
+    arena_free(info->arena);
 }
 
+/**
+ * Free an info. If possible, the info is kept for reuse by the current
+ * thread. Its arrays are then kept as well, so that they need not be
+ * allocated again.
+ *
+ * @param info The info to free.
+ */
 static void info_free(QC_SQLITE_INFO* info)
 {
     if (info)
     {
-        info_finish(info);
-        free(info);
+        if (this_thread.initialized &&
+            (this_thread.n_free_infos < QC_SQLITE_INFO_MAX_FREE) &&
+            info_is_reusable(info))
+        {
+            gwbuf_free(info->preparable_stmt);
+            info->preparable_stmt = NULL;
+            arena_free(info->arena);
+            info->arena = NULL;
+
+            info->next = this_thread.free_infos;
+            this_thread.free_infos = info;
+            ++this_thread.n_free_infos;
+        }
+        else
+        {
+            info_finish(info);
+            free(info);
+        }
     }
 }
 
+/**
+ * Initialize an info. The arrays of a reused info are kept, only the number
+ * of their entries is reset.
+ *
+ * @param info     A new, zeroed info or a reused one.
+ * @param collect  What information should be collected.
+ *
+ * @return The info.
+ */
 static QC_SQLITE_INFO* info_init(QC_SQLITE_INFO* info, uint32_t collect)
 {
-    memset(info, 0, sizeof(*info));
-
     info->status = QC_QUERY_INVALID;
     info->collect = collect;
     info->collected = 0;
+    info->query = NULL;
+    info->query_len = 0;
 
     info->type_mask = QUERY_TYPE_UNKNOWN;
     info->operation = QUERY_OP_UNDEFINED;
     info->has_clause = false;
-    info->table_names = NULL;
     info->table_names_len = 0;
-    info->table_names_capacity = 0;
-    info->table_fullnames = NULL;
     info->table_fullnames_len = 0;
-    info->table_fullnames_capacity = 0;
     info->created_table_name = NULL;
     info->is_drop_table = false;
-    info->database_names = NULL;
     info->database_names_len = 0;
-    info->database_names_capacity = 0;
     info->keyword_1 = 0; // Sqlite3 starts numbering tokens from 1, so 0 means
     info->keyword_2 = 0; // that we have not seen a keyword.
     info->prepare_name = NULL;
     info->preparable_stmt = NULL;
-    info->field_infos = NULL;
     info->field_infos_len = 0;
-    info->field_infos_capacity = 0;
-    info->function_infos = NULL;
     info->function_infos_len = 0;
-    info->function_infos_capacity = 0;
     info->initializing = false;
+    info->arena = NULL;
+    info->next = NULL;
 
     return info;
 }
 
+/**
+ * Check whether an info should be kept for reuse. An info whose arrays have
+ * grown large is not, so that a few unusual queries do not tie up memory.
+ *
+ * @param info The info to check.
+ *
+ * @return True, if the info can be reused.
+ */
+static bool info_is_reusable(const QC_SQLITE_INFO* info)
+{
+    return (info->table_names_capacity <= QC_SQLITE_INFO_MAX_CAPACITY) &&
+           (info->table_fullnames_capacity <= QC_SQLITE_INFO_MAX_CAPACITY) &&
+           (info->database_names_capacity <= QC_SQLITE_INFO_MAX_CAPACITY) &&
+           (info->field_infos_capacity <= QC_SQLITE_INFO_MAX_CAPACITY) &&
+           (info->function_infos_capacity <= QC_SQLITE_INFO_MAX_CAPACITY);
+}
+
+/**
+ * Allocate room for a string from the arena of a query.
+ *
+ * @param info  The query information.
+ * @param n     The length of the string, excluding the terminating null.
+ *
+ * @return Room for n + 1 characters. The memory is valid as long as the
+ *         query information is.
+ */
+static char* info_alloc_string(QC_SQLITE_INFO* info, size_t n)
+{
+    QC_SQLITE_ARENA* arena = info->arena;
+
+    if (!arena || (arena->size - arena->used < n + 1))
+    {
+        if ((n + 1 <= QC_SQLITE_ARENA_SIZE) && this_thread.free_arenas)
+        {
+            arena = this_thread.free_arenas;
+            this_thread.free_arenas = arena->next;
+            --this_thread.n_free_arenas;
+        }
+        else
+        {
+            size_t size = (n + 1 <= QC_SQLITE_ARENA_SIZE) ? QC_SQLITE_ARENA_SIZE : n + 1;
+
+            arena = (QC_SQLITE_ARENA*) MXS_MALLOC(sizeof(QC_SQLITE_ARENA) + size);
+            MXS_ABORT_IF_NULL(arena);
+            arena->size = size;
+        }
+
+        arena->used = 0;
+        arena->next = info->arena;
+        info->arena = arena;
+    }
+
+    char* s = arena->data + arena->used;
+    arena->used += n + 1;
+
+    return s;
+}
+
+static char* info_strndup(QC_SQLITE_INFO* info, const char* s, size_t n)
+{
+    char* copy = info_alloc_string(info, n);
+
+    memcpy(copy, s, n);
+    copy[n] = 0;
+
+    return copy;
+}
+
+static char* info_strdup(QC_SQLITE_INFO* info, const char* s)
+{
+    return info_strndup(info, s, strlen(s));
+}
+
 static void parse_query_string(const char* query, size_t len)
 {
     sqlite3_stmt* stmt = NULL;
@@ -771,17 +905,12 @@ static void update_field_info(QC_SQLITE_INFO* info,
     // If field_infos is NULL, then the field was found and has already been noted.
     if (field_infos)
     {
-        item.database = item.database ? MXS_STRDUP(item.database) : NULL;
-        item.table = item.table ? MXS_STRDUP(item.table) : NULL;
+        item.database = item.database ? info_strdup(info, item.database) : NULL;
+        item.table = item.table ? info_strdup(info, item.table) : NULL;
         ss_dassert(item.column);
-        item.column = MXS_STRDUP(item.column);
+        item.column = info_strdup(info, item.column);
 
-        // We are happy if we at least could dup the column.
-
-        if (item.column)
-        {
-            field_infos[info->field_infos_len++] = item;
-        }
+        field_infos[info->field_infos_len++] = item;
     }
 }
 
@@ -840,12 +969,9 @@ static void update_function_info(QC_SQLITE_INFO* info,
     if (function_infos)
     {
         ss_dassert(item.name);
-        item.name = MXS_STRDUP(item.name);
+        item.name = info_strdup(info, item.name);
 
-        if (item.name)
-        {
-            function_infos[info->function_infos_len++] = item;
-        }
+        function_infos[info->function_infos_len++] = item;
     }
 }
 
@@ -861,6 +987,12 @@ static void update_field_infos_from_expr(QC_SQLITE_INFO* info,
                                          uint32_t usage,
                                          const ExprList* pExclude)
 {
+    if (!(info->collect & QC_COLLECT_FIELDS) || (info->collected & QC_COLLECT_FIELDS))
+    {
+        // Nothing below affects anything but the field information.
+        return;
+    }
+
     QC_FIELD_INFO item = {};
 
     if (pExpr->op == TK_ASTERISK)
@@ -1285,8 +1417,7 @@ static void update_field_infos_from_select_compound(QC_SQLITE_INFO* info,
 
 static void update_database_names(QC_SQLITE_INFO* info, const char* zDatabase)
 {
-    char* zCopy = MXS_STRDUP(zDatabase);
-    MXS_ABORT_IF_NULL(zCopy);
+    char* zCopy = info_strdup(info, zDatabase);
     exposed_sqlite3Dequote(zCopy);
 
     enlarge_string_array(1, info->database_names_len,
@@ -1299,8 +1430,7 @@ static void update_names(QC_SQLITE_INFO* info, const char* zDatabase, const char
 {
     if ((info->collect & QC_COLLECT_TABLES) && !(info->collected & QC_COLLECT_TABLES))
     {
-        char* zCopy = MXS_STRDUP(zTable);
-        MXS_ABORT_IF_NULL(zCopy);
+        char* zCopy = info_strdup(info, zTable);
         // TODO: Is this call really needed. Check also sqlite3Dequote.
         exposed_sqlite3Dequote(zCopy);
 
@@ -1308,21 +1438,18 @@ static void update_names(QC_SQLITE_INFO* info, const char* zDatabase, const char
         info->table_names[info->table_names_len++] = zCopy;
         info->table_names[info->table_names_len] = NULL;
 
+        // Without a database, the full name is the name.
         if (zDatabase)
         {
-            zCopy = MXS_MALLOC(strlen(zDatabase) + 1 + strlen(zTable) + 1);
-            MXS_ABORT_IF_NULL(zCopy);
+            size_t database_len = strlen(zDatabase);
+            size_t table_len = strlen(zTable);
 
-            strcpy(zCopy, zDatabase);
-            strcat(zCopy, ".");
-            strcat(zCopy, zTable);
+            zCopy = info_alloc_string(info, database_len + 1 + table_len);
+            memcpy(zCopy, zDatabase, database_len);
+            zCopy[database_len] = '.';
+            memcpy(zCopy + database_len + 1, zTable, table_len + 1);
             exposed_sqlite3Dequote(zCopy);
         }
-        else
-        {
-            zCopy = MXS_STRDUP(zCopy);
-            MXS_ABORT_IF_NULL(zCopy);
-        }
 
         enlarge_string_array(1, info->table_fullnames_len,
                              &info->table_fullnames, &info->table_fullnames_capacity);
@@ -1828,8 +1955,7 @@ void mxs_sqlite3StartTable(Parse *pParse,   /* Parser context */
             // this information already.
             if (!info->created_table_name)
             {
-                info->created_table_name = MXS_STRDUP(info->table_names[0]);
-                MXS_ABORT_IF_NULL(info->created_table_name);
+                info->created_table_name = info_strdup(info, info->table_names[0]);
             }
             else
             {
@@ -2009,12 +2135,7 @@ void maxscaleDeallocate(Parse* pParse, Token* pName)
     // this information already.
     if (!info->prepare_name)
     {
-        info->prepare_name = MXS_MALLOC(pName->n + 1);
-        if (info->prepare_name)
-        {
-            memcpy(info->prepare_name, pName->z, pName->n);
-            info->prepare_name[pName->n] = 0;
-        }
+        info->prepare_name = info_strndup(info, pName->z, pName->n);
     }
     else
     {
@@ -2062,12 +2183,7 @@ void maxscaleExecute(Parse* pParse, Token* pName)
     // this information already.
     if (!info->prepare_name)
     {
-        info->prepare_name = MXS_MALLOC(pName->n + 1);
-        if (info->prepare_name)
-        {
-            memcpy(info->prepare_name, pName->z, pName->n);
-            info->prepare_name[pName->n] = 0;
-        }
+        info->prepare_name = info_strndup(info, pName->z, pName->n);
     }
     else
     {
@@ -2442,12 +2558,7 @@ void maxscalePrepare(Parse* pParse, Token* pName, Token* pStmt)
     // this information already.
     if (!info->prepare_name)
     {
-        info->prepare_name = MXS_MALLOC(pName->n + 1);
-        if (info->prepare_name)
-        {
-            memcpy(info->prepare_name, pName->z, pName->n);
-            info->prepare_name[pName->n] = 0;
-        }
+        info->prepare_name = info_strndup(info, pName->z, pName->n);
 
         size_t preparable_stmt_len = pStmt->n - 2;
         size_t payload_len = 1 + preparable_stmt_len;
@@ -3144,6 +3255,25 @@ static void qc_sqlite_thread_end(void)
 
     this_thread.db = NULL;
     this_thread.initialized = false;
+
+    while (this_thread.free_arenas)
+    {
+        QC_SQLITE_ARENA* arena = this_thread.free_arenas;
+        this_thread.free_arenas = arena->next;
+        MXS_FREE(arena);
+    }
+
+    this_thread.n_free_arenas = 0;
+
+    while (this_thread.free_infos)
+    {
+        QC_SQLITE_INFO* info = this_thread.free_infos;
+        this_thread.free_infos = info->next;
+        info_finish(info);
+        free(info);
+    }
+
+    this_thread.n_free_infos = 0;
 }
 
 static int32_t qc_sqlite_parse(GWBUF* query, uint32_t collect, int32_t* result)
@@ -3310,11 +3440,11 @@ static int32_t qc_sqlite_get_table_names(GWBUF* query,
         {
             if (fullnames)
             {
-                *table_names = info->table_fullnames;
+                *table_names = info->table_fullnames_len ? info->table_fullnames : NULL;
             }
             else
             {
-                *table_names = info->table_names;
+                *table_names = info->table_names_len ? info->table_names : NULL;
             }
 
             if (*table_names)
@@ -3400,7 +3530,7 @@ static int32_t qc_sqlite_get_database_names(GWBUF* query, char*** database_names
     {
         if (qc_info_is_valid(info->status))
         {
-            if (info->database_names)
+            if (info->database_names_len)
             {
                 *database_names = copy_string_array(info->database_names, sizep);
             }
@@ -307,7 +307,21 @@ explain ::= EXPLAIN.              { pParse->explain = 1; }
 explain ::= EXPLAIN QUERY PLAN.   { pParse->explain = 2; }
 %endif
 %endif  SQLITE_OMIT_EXPLAIN
+%ifdef MAXSCALE
+// The statements are only classified, so code is generated only for the
+// statements sqlite3 itself executes when it reads the schema. SQLITE_DONE
+// stops the parsing after the first statement, as sqlite3FinishCoding does.
+cmdx ::= cmd.           {
+  if( pParse->db->init.busy ){
+    sqlite3FinishCoding(pParse);
+  }else if( pParse->rc==SQLITE_OK ){
+    pParse->rc = SQLITE_DONE;
+  }
+}
+%endif
+%ifndef MAXSCALE
 cmdx ::= cmd.           { sqlite3FinishCoding(pParse); }
+%endif
 
 ///////////////////// Begin and end transactions. ////////////////////////////
 //
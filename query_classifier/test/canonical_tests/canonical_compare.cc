@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Compare the single pass canonicalizer with the regular expression based
+ * canonicalization that it replaced. Files that end in .test are read with
+ * the test reader, other files are read one statement per line.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <maxscale/alloc.h>
+#include <maxscale/modutil.h>
+#include <maxscale/utils.h>
+#include "../testreader.hh"
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::string;
+using std::vector;
+
+namespace
+{
+
+/** The canonicalization as it was done with regular expressions */
+string regex_canonical(const string& stmt)
+{
+    string rval;
+    char* src = const_cast<char*>(stmt.c_str());
+    size_t srcsize = stmt.size();
+    char* dest = NULL;
+    size_t destsize = 0;
+
+    if (replace_quoted((const char**)&src, &srcsize, &dest, &destsize))
+    {
+        src = dest;
+        srcsize = destsize;
+        dest = NULL;
+        destsize = 0;
+
+        if (remove_mysql_comments((const char**)&src, &srcsize, &dest, &destsize) &&
+            replace_values((const char**)&dest, &destsize, &src, &srcsize))
+        {
+            rval = squeeze_whitespace(src);
+        }
+
+        MXS_FREE(dest);
+    }
+
+    MXS_FREE(src);
+    return rval;
+}
+
+/** Check whether a string only consists of comments and whitespace */
+bool is_comment_only(const string& s)
+{
+    size_t i = 0;
+
+    while (i < s.size())
+    {
+        if (isspace((unsigned char)s[i]))
+        {
+            i++;
+        }
+        else if (s[i] == '#' ||
+                 (s.compare(i, 2, "--") == 0 && (i + 2 == s.size() || isspace((unsigned char)s[i + 2]))))
+        {
+            i = s.find('\n', i);
+
+            if (i == string::npos)
+            {
+                i = s.size();
+            }
+        }
+        else if (s.compare(i, 2, "/*") == 0)
+        {
+            i = s.find("*/", i + 2);
+
+            if (i == string::npos)
+            {
+                return false;
+            }
+
+            i += 2;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t fnv1a(const string& s)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        h = (h ^ (unsigned char)s[i]) * UINT64_C(0x100000001b3);
+    }
+
+    return h;
+}
+
+int compare(const string& stmt)
+{
+    int rv = 0;
+    vector<char> buf(MODUTIL_CANONICAL_SIZE(stmt.size()));
+    uint64_t digest;
+    size_t len = modutil_canonicalize(stmt.data(), stmt.size(), &buf[0], &digest);
+    string canonical(&buf[0], len);
+    string expected = regex_canonical(stmt);
+
+    // A statement that only contains a comment was left as is by the
+    // regular expressions, the canonicalizer returns an empty string.
+    if (!canonical.empty() || !is_comment_only(expected))
+    {
+        if (canonical != expected)
+        {
+            cerr << "error: Canonical forms differ" << endl
+                 << "statement: " << stmt << endl
+                 << "expected : " << expected << endl
+                 << "got      : " << canonical << endl;
+            rv = 1;
+        }
+        else if (digest != fnv1a(canonical))
+        {
+            cerr << "error: Wrong digest for: " << stmt << endl;
+            rv = 1;
+        }
+    }
+
+    return rv;
+}
+
+int compare_file(const char* path)
+{
+    int errors = 0;
+    string name(path);
+    ifstream in(path);
+    string stmt;
+
+    if (!in)
+    {
+        cerr << "error: Could not open " << name << endl;
+        return 1;
+    }
+
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".test") == 0)
+    {
+        maxscale::TestReader reader(in);
+
+        while (reader.get_statement(stmt) == maxscale::TestReader::RESULT_STMT)
+        {
+            errors += compare(stmt);
+        }
+    }
+    else
+    {
+        while (std::getline(in, stmt))
+        {
+            errors += compare(stmt);
+        }
+    }
+
+    return errors;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cout << "usage: canonical_compare file..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!utils_init())
+    {
+        cerr << "error: Utils library init failed." << endl;
+        return EXIT_FAILURE;
+    }
+
+    int errors = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        errors += compare_file(argv[i]);
+    }
+
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
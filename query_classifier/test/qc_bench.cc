@@ -0,0 +1,869 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Measure the throughput of query classifiers.
+ *
+ * The statements of the given files and a number of generated statements
+ * are classified by several threads in parallel. Each statement is parsed
+ * and all information about it is asked for. For each classifier, the
+ * number of statements classified per second, the 99th percentile of the
+ * time it takes to classify a statement and the number of memory allocations
+ * per statement are reported.
+ *
+ * If a baseline file is given, the throughput is compared with the one
+ * stored in the file, and the program fails if the throughput of some
+ * classifier has decreased by more than the allowed percentage.
+ *
+ * The generated statements can also be written to a file, so that they
+ * can be used with compare for comparing classifiers.
+ */
+
+#include <pthread.h>
+#include <sys/cdefs.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <maxscale/paths.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
+#include "testreader.hh"
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::map;
+using std::ofstream;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+#if defined(QC_BENCH_COUNT_ALLOCATIONS)
+/**
+ * The allocations are counted by replacing the allocation functions of the
+ * C library for the whole process, including the loaded classifiers. That
+ * cannot be done if another allocator is used.
+ */
+extern "C"
+{
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+static __thread uint64_t n_allocations;
+
+void* malloc(size_t size) __THROW
+{
+    ++n_allocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) __THROW
+{
+    ++n_allocations;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) __THROW
+{
+    ++n_allocations;
+    return __libc_realloc(ptr, size);
+}
+
+}
+#else
+static __thread uint64_t n_allocations;
+#endif
+
+namespace
+{
+
+// The number of times the throughputs are measured for the -p check.
+const int SCALING_RUNS = 3;
+
+char USAGE[] =
+    "usage: qc_bench [-c classifier] [-A args] [-t threads] [-r rounds] [-g count] "
+        "[-s seed] [-o file] [-b file [-w] [-m percent]] [-p percent] [file...]\n\n"
+    "-c    a classifier to measure, can be given several times, default qc_sqlite\n"
+    "-A    arguments for the classifiers\n"
+    "-t    the number of threads, default 4\n"
+    "-r    the number of times each thread classifies the statements, default 1\n"
+    "-g    the number of statements to generate, default 10000\n"
+    "-s    the seed used when generating statements, default 1\n"
+    "-o    write the generated statements to a file and exit\n"
+    "-b    a file containing the baseline statements per second of each classifier\n"
+    "-w    write the results to the baseline file instead of comparing with it\n"
+    "-m    the maximum allowed decrease in percent of the throughput, default 10\n"
+    "-p    the minimum throughput of all threads in percent of the throughput of one thread\n";
+
+GWBUF* create_gwbuf(const string& s)
+{
+    size_t len = s.length();
+    size_t payload_len = len + 1;
+    size_t gwbuf_len = MYSQL_HEADER_LEN + payload_len;
+
+    GWBUF* gwbuf = gwbuf_alloc(gwbuf_len);
+
+    *((unsigned char*)((char*)GWBUF_DATA(gwbuf))) = payload_len;
+    *((unsigned char*)((char*)GWBUF_DATA(gwbuf) + 1)) = (payload_len >> 8);
+    *((unsigned char*)((char*)GWBUF_DATA(gwbuf) + 2)) = (payload_len >> 16);
+    *((unsigned char*)((char*)GWBUF_DATA(gwbuf) + 3)) = 0x00;
+    *((unsigned char*)((char*)GWBUF_DATA(gwbuf) + 4)) = 0x03;
+    memcpy((char*)GWBUF_DATA(gwbuf) + 5, s.c_str(), len);
+
+    return gwbuf;
+}
+
+const char* DATABASES[] = { "db1", "db2", "shop" };
+const char* TABLES[] = { "t1", "t2", "t3", "orders", "users", "items" };
+const char* COLUMNS[] = { "id", "a", "b", "c", "name", "price", "amount", "created" };
+const char* FUNCTIONS[] = { "MAX", "MIN", "SUM", "AVG", "UPPER", "LENGTH" };
+const char* OPERATORS[] = { "=", "<", ">", "<=", ">=", "!=" };
+const char* TRANSACTIONS[] =
+{
+    "BEGIN", "COMMIT", "ROLLBACK", "START TRANSACTION", "START TRANSACTION READ ONLY"
+};
+const char* READS[] =
+{
+    "1", "@@version", "@@session.tx_isolation", "LAST_INSERT_ID()", "NOW()", "DATABASE()"
+};
+
+/**
+ * Generates random statements of the kind a typical application sends.
+ */
+class Generator
+{
+public:
+    Generator(unsigned int seed)
+        : m_seed(seed)
+    {
+    }
+
+    string next()
+    {
+        stringstream ss;
+
+        switch (random(12))
+        {
+        case 0:
+            ss << "SELECT " << columns() << " FROM " << table() << " WHERE " << condition();
+
+            if (random(2))
+            {
+                ss << " ORDER BY " << column();
+            }
+
+            if (random(2))
+            {
+                ss << " LIMIT " << random(100);
+            }
+            break;
+
+        case 1:
+            ss << "SELECT COUNT(*) FROM " << table() << " WHERE " << column() << " IN ("
+               << literal() << ", " << literal() << ", " << literal() << ")";
+            break;
+
+        case 2:
+            ss << "SELECT " << pick(FUNCTIONS) << "(" << column() << ") FROM " << table()
+               << " GROUP BY " << column();
+            break;
+
+        case 3:
+            ss << "SELECT a." << column() << ", b." << column() << " FROM " << table() << " a JOIN "
+               << table() << " b ON a.id = b.id WHERE a." << column() << " > " << literal();
+            break;
+
+        case 4:
+            ss << "SELECT " << column() << " FROM " << table() << " WHERE " << column()
+               << " = (SELECT MAX(" << column() << ") FROM " << table() << ")";
+            break;
+
+        case 5:
+            ss << "INSERT INTO " << table() << " (" << column() << ", " << column() << ") VALUES ("
+               << literal() << ", " << literal() << ")";
+            break;
+
+        case 6:
+            ss << "UPDATE " << table() << " SET " << column() << " = " << literal()
+               << " WHERE " << condition();
+            break;
+
+        case 7:
+            ss << "DELETE FROM " << table() << " WHERE " << condition();
+            break;
+
+        case 8:
+            ss << pick(TRANSACTIONS);
+            break;
+
+        case 9:
+            switch (random(3))
+            {
+            case 0:
+                ss << "SET autocommit=" << random(2);
+                break;
+
+            case 1:
+                ss << "SET @" << column() << " = " << literal();
+                break;
+
+            default:
+                ss << "SET NAMES utf8";
+            }
+            break;
+
+        case 10:
+            ss << "USE " << pick(DATABASES);
+            break;
+
+        default:
+            ss << "SELECT " << pick(READS);
+        }
+
+        return ss.str();
+    }
+
+private:
+    int random(int n)
+    {
+        return rand_r(&m_seed) % n;
+    }
+
+    template<size_t N>
+    const char* pick(const char* (&words)[N])
+    {
+        return words[random(N)];
+    }
+
+    string table()
+    {
+        string s;
+
+        if (random(4) == 0)
+        {
+            s = pick(DATABASES);
+            s += ".";
+        }
+
+        return s + pick(TABLES);
+    }
+
+    string column()
+    {
+        return pick(COLUMNS);
+    }
+
+    string columns()
+    {
+        string s = random(8) ? column() : "*";
+
+        for (int i = random(4); i > 0; --i)
+        {
+            s += ", ";
+            s += column();
+        }
+
+        return s;
+    }
+
+    string literal()
+    {
+        stringstream ss;
+
+        switch (random(4))
+        {
+        case 0:
+            ss << random(100000);
+            break;
+
+        case 1:
+            ss << random(1000) << "." << random(100);
+            break;
+
+        case 2:
+            ss << "'" << pick(COLUMNS) << random(1000) << "'";
+            break;
+
+        default:
+            ss << "NULL";
+        }
+
+        return ss.str();
+    }
+
+    string condition()
+    {
+        string s = column() + " " + pick(OPERATORS) + " " + literal();
+
+        for (int i = random(3); i > 0; --i)
+        {
+            s += random(2) ? " AND " : " OR ";
+            s += column() + " " + pick(OPERATORS) + " " + literal();
+        }
+
+        return s;
+    }
+
+    unsigned int m_seed;
+};
+
+void free_strings(char** strings, int n)
+{
+    if (strings)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            free(strings[i]);
+        }
+
+        free(strings);
+    }
+}
+
+/**
+ * Parse a statement and ask for all information about it.
+ */
+void classify(QUERY_CLASSIFIER* pClassifier, GWBUF* pStmt)
+{
+    int32_t result;
+    pClassifier->qc_parse(pStmt, QC_COLLECT_ALL, &result);
+
+    uint32_t type_mask;
+    pClassifier->qc_get_type_mask(pStmt, &type_mask);
+
+    int32_t op;
+    pClassifier->qc_get_operation(pStmt, &op);
+
+    int32_t has_clause;
+    pClassifier->qc_query_has_clause(pStmt, &has_clause);
+
+    int32_t is_drop_table;
+    pClassifier->qc_is_drop_table_query(pStmt, &is_drop_table);
+
+    char* zName = NULL;
+    pClassifier->qc_get_created_table_name(pStmt, &zName);
+    free(zName);
+
+    zName = NULL;
+    pClassifier->qc_get_prepare_name(pStmt, &zName);
+    free(zName);
+
+    char** pzNames = NULL;
+    int32_t n_names = 0;
+    pClassifier->qc_get_table_names(pStmt, false, &pzNames, &n_names);
+    free_strings(pzNames, n_names);
+
+    pzNames = NULL;
+    n_names = 0;
+    pClassifier->qc_get_table_names(pStmt, true, &pzNames, &n_names);
+    free_strings(pzNames, n_names);
+
+    pzNames = NULL;
+    n_names = 0;
+    pClassifier->qc_get_database_names(pStmt, &pzNames, &n_names);
+    free_strings(pzNames, n_names);
+
+    const QC_FIELD_INFO* pFields;
+    uint32_t n_fields;
+    pClassifier->qc_get_field_info(pStmt, &pFields, &n_fields);
+
+    const QC_FUNCTION_INFO* pFunctions;
+    uint32_t n_functions;
+    pClassifier->qc_get_function_info(pStmt, &pFunctions, &n_functions);
+}
+
+struct Worker
+{
+    QUERY_CLASSIFIER*     pClassifier;
+    const vector<string>* pStmts;
+    size_t                first;         // The index of the first statement to classify.
+    size_t                rounds;
+    bool                  ok;
+    uint64_t              n_allocations;
+    vector<uint32_t>      latencies;     // Nanoseconds.
+    pthread_t             thread;
+};
+
+void* run_worker(void* pData)
+{
+    Worker* pWorker = static_cast<Worker*>(pData);
+    QUERY_CLASSIFIER* pClassifier = pWorker->pClassifier;
+    const vector<string>& stmts = *pWorker->pStmts;
+
+    pWorker->ok = (pClassifier->qc_thread_init() == QC_RESULT_OK);
+
+    if (pWorker->ok)
+    {
+        // Reserved before the allocations are counted.
+        pWorker->latencies.reserve(pWorker->rounds * stmts.size());
+
+        uint64_t n_allocations_before = n_allocations;
+
+        for (size_t round = 0; round < pWorker->rounds; ++round)
+        {
+            for (size_t i = 0; i < stmts.size(); ++i)
+            {
+                const string& stmt = stmts[(pWorker->first + i) % stmts.size()];
+
+                timespec start;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+
+                GWBUF* pStmt = create_gwbuf(stmt);
+                classify(pClassifier, pStmt);
+                gwbuf_free(pStmt);
+
+                timespec finish;
+                clock_gettime(CLOCK_MONOTONIC, &finish);
+
+                pWorker->latencies.push_back((finish.tv_sec - start.tv_sec) * 1000000000 +
+                                             (finish.tv_nsec - start.tv_nsec));
+            }
+        }
+
+        pWorker->n_allocations = n_allocations - n_allocations_before;
+
+        pClassifier->qc_thread_end();
+    }
+    else
+    {
+        cerr << "error: Could not initialize classifier thread." << endl;
+    }
+
+    return NULL;
+}
+
+struct Result
+{
+    double   statements_per_second;
+    double   p99_microseconds;
+    double   allocations_per_statement;
+};
+
+bool run(QUERY_CLASSIFIER* pClassifier, const vector<string>& stmts,
+         size_t n_threads, size_t rounds, Result* pResult)
+{
+    vector<Worker> workers(n_threads);
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < n_threads; ++i)
+    {
+        Worker& worker = workers[i];
+
+        worker.pClassifier = pClassifier;
+        worker.pStmts = &stmts;
+        // The threads start at different statements, so that they do not
+        // classify the same statement at the same time.
+        worker.first = i * stmts.size() / n_threads;
+        worker.rounds = rounds;
+        worker.ok = false;
+        worker.n_allocations = 0;
+
+        if (pthread_create(&worker.thread, NULL, run_worker, &worker) != 0)
+        {
+            cerr << "error: Could not create thread." << endl;
+            n_threads = i;
+        }
+    }
+
+    vector<uint32_t> latencies;
+    uint64_t n_allocations = 0;
+    bool ok = (n_threads == workers.size());
+
+    for (size_t i = 0; i < n_threads; ++i)
+    {
+        Worker& worker = workers[i];
+
+        pthread_join(worker.thread, NULL);
+
+        ok = ok && worker.ok;
+        latencies.insert(latencies.end(), worker.latencies.begin(), worker.latencies.end());
+        n_allocations += worker.n_allocations;
+    }
+
+    timespec finish;
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+
+    if (ok && !latencies.empty())
+    {
+        double seconds = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+        size_t p99 = latencies.size() * 99 / 100;
+
+        std::nth_element(latencies.begin(), latencies.begin() + p99, latencies.end());
+
+        pResult->statements_per_second = latencies.size() / seconds;
+        pResult->p99_microseconds = latencies[p99] / 1000.0;
+        pResult->allocations_per_statement = (double)n_allocations / latencies.size();
+    }
+
+    return ok;
+}
+
+/**
+ * Measure the best throughput of one thread and of all threads. The runs
+ * alternate and are repeated, so that a short disturbance on the machine
+ * does not affect only one of the results.
+ *
+ * @param pSingle  The throughput of one thread
+ * @param pAll     The throughput of all threads, a value measured earlier
+ */
+bool measure_scaling(QUERY_CLASSIFIER* pClassifier, const vector<string>& stmts,
+                     size_t n_threads, size_t rounds, double* pSingle, double* pAll)
+{
+    *pSingle = 0;
+
+    for (int i = 0; i < SCALING_RUNS; ++i)
+    {
+        Result single;
+        Result all;
+
+        if (!run(pClassifier, stmts, 1, rounds, &single) ||
+            !run(pClassifier, stmts, n_threads, rounds, &all))
+        {
+            return false;
+        }
+
+        *pSingle = std::max(*pSingle, single.statements_per_second);
+        *pAll = std::max(*pAll, all.statements_per_second);
+    }
+
+    return true;
+}
+
+QUERY_CLASSIFIER* get_classifier(const char* zName, const char* zArgs)
+{
+    size_t len = strlen(zName);
+    char libdir[len + 4];
+
+    sprintf(libdir, "../%s", zName);
+
+    set_libdir(strdup(libdir));
+
+    QUERY_CLASSIFIER* pClassifier = qc_load(zName);
+
+    if (pClassifier)
+    {
+        if ((pClassifier->qc_setup(zArgs) != QC_RESULT_OK) ||
+            ((pClassifier->qc_process_init() != QC_RESULT_OK)))
+        {
+            cerr << "error: Could not setup or init classifier " << zName << "." << endl;
+            qc_unload(pClassifier);
+            pClassifier = NULL;
+        }
+    }
+    else
+    {
+        cerr << "error: Could not load classifier " << zName << "." << endl;
+    }
+
+    return pClassifier;
+}
+
+void put_classifier(QUERY_CLASSIFIER* pClassifier)
+{
+    pClassifier->qc_process_end();
+    qc_unload(pClassifier);
+}
+
+/**
+ * Read a baseline file, where each line contains the name of a classifier
+ * and the number of statements per second it classified.
+ */
+map<string, double> read_baseline(const char* zFile)
+{
+    map<string, double> baseline;
+    ifstream in(zFile);
+    string name;
+    double statements_per_second;
+
+    while (in >> name >> statements_per_second)
+    {
+        baseline[name] = statements_per_second;
+    }
+
+    return baseline;
+}
+
+bool write_baseline(const char* zFile, const map<string, double>& baseline)
+{
+    ofstream out(zFile);
+
+    for (map<string, double>::const_iterator it = baseline.begin(); it != baseline.end(); ++it)
+    {
+        out << it->first << " " << std::fixed << std::setprecision(0) << it->second << endl;
+    }
+
+    return out.good();
+}
+
+bool read_statements(const char* zFile, vector<string>* pStmts)
+{
+    ifstream in(zFile);
+
+    if (in)
+    {
+        maxscale::TestReader reader(in);
+        string stmt;
+
+        while (reader.get_statement(stmt) == maxscale::TestReader::RESULT_STMT)
+        {
+            pStmts->push_back(stmt);
+        }
+    }
+    else
+    {
+        cerr << "error: Could not open " << zFile << "." << endl;
+    }
+
+    return in.eof();
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+
+    vector<const char*> classifiers;
+    const char* zArgs = NULL;
+    size_t n_threads = 4;
+    size_t rounds = 1;
+    size_t n_generated = 10000;
+    unsigned int seed = 1;
+    const char* zOutput = NULL;
+    const char* zBaseline = NULL;
+    bool write = false;
+    double max_decrease = 10;
+    double min_scaling = 0;
+
+    int c;
+    while ((c = getopt(argc, argv, "c:A:t:r:g:s:o:b:wm:p:")) != -1)
+    {
+        switch (c)
+        {
+        case 'c':
+            classifiers.push_back(optarg);
+            break;
+
+        case 'A':
+            zArgs = optarg;
+            break;
+
+        case 't':
+            n_threads = atoi(optarg);
+            break;
+
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+
+        case 'g':
+            n_generated = atoi(optarg);
+            break;
+
+        case 's':
+            seed = atoi(optarg);
+            break;
+
+        case 'o':
+            zOutput = optarg;
+            break;
+
+        case 'b':
+            zBaseline = optarg;
+            break;
+
+        case 'w':
+            write = true;
+            break;
+
+        case 'm':
+            max_decrease = atof(optarg);
+            break;
+
+        case 'p':
+            min_scaling = atof(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc != EXIT_SUCCESS) || (n_threads == 0) || (rounds == 0) || (write && !zBaseline))
+    {
+        cout << USAGE << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<string> stmts;
+    Generator generator(seed);
+
+    for (size_t i = 0; i < n_generated; ++i)
+    {
+        stmts.push_back(generator.next());
+    }
+
+    if (zOutput)
+    {
+        ofstream out(zOutput);
+
+        for (vector<string>::iterator it = stmts.begin(); it != stmts.end(); ++it)
+        {
+            out << *it << ";" << endl;
+        }
+
+        return out.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int i = optind; i < argc; ++i)
+    {
+        if (!read_statements(argv[i], &stmts))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (stmts.empty())
+    {
+        cout << USAGE << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (classifiers.empty())
+    {
+        classifiers.push_back("qc_sqlite");
+    }
+
+    set_datadir(strdup("/tmp"));
+    set_langdir(strdup("."));
+    set_process_datadir(strdup("/tmp"));
+
+    if (!mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        cerr << "error: Could not initialize log." << endl;
+        return EXIT_FAILURE;
+    }
+
+    map<string, double> baseline;
+
+    if (zBaseline)
+    {
+        baseline = read_baseline(zBaseline);
+    }
+
+    cout << "Statements: " << stmts.size() << ", threads: " << n_threads
+         << ", rounds: " << rounds << endl;
+
+    for (vector<const char*>::iterator it = classifiers.begin(); it != classifiers.end(); ++it)
+    {
+        const char* zName = *it;
+        QUERY_CLASSIFIER* pClassifier = get_classifier(zName, zArgs);
+        Result result;
+
+        if (pClassifier && run(pClassifier, stmts, n_threads, rounds, &result))
+        {
+            cout << zName << ": "
+                 << std::fixed << std::setprecision(0) << result.statements_per_second
+                 << " statements/s, p99 " << std::setprecision(1) << result.p99_microseconds
+                 << " us, ";
+
+#if defined(QC_BENCH_COUNT_ALLOCATIONS)
+            cout << result.allocations_per_statement << " allocations/statement" << endl;
+#else
+            cout << "allocations not counted" << endl;
+#endif
+
+            // Both throughputs are measured on the same machine, so unlike the
+            // baseline, this check does not depend on where it is run.
+            if (min_scaling > 0 && n_threads > 1)
+            {
+                double single;
+                double all = result.statements_per_second;
+
+                if (measure_scaling(pClassifier, stmts, n_threads, rounds, &single, &all))
+                {
+                    double limit = single * min_scaling / 100;
+
+                    cout << zName << ": "
+                         << std::fixed << std::setprecision(0) << single
+                         << " statements/s with one thread, " << all << " with "
+                         << n_threads << " threads" << endl;
+
+                    if (all < limit)
+                    {
+                        cerr << "error: " << zName << " classified "
+                             << std::fixed << std::setprecision(0) << all
+                             << " statements/s with " << n_threads << " threads and "
+                             << single << " with one thread, at least "
+                             << limit << " is required." << endl;
+                        rc = EXIT_FAILURE;
+                    }
+                }
+                else
+                {
+                    rc = EXIT_FAILURE;
+                }
+            }
+
+            if (write)
+            {
+                baseline[zName] = result.statements_per_second;
+            }
+            else if (baseline.find(zName) != baseline.end())
+            {
+                double limit = baseline[zName] * (100 - max_decrease) / 100;
+
+                if (result.statements_per_second < limit)
+                {
+                    cerr << "error: " << zName << " classified "
+                         << std::fixed << std::setprecision(0) << result.statements_per_second
+                         << " statements/s, the baseline is " << baseline[zName]
+                         << " and at least " << limit << " is required." << endl;
+                    rc = EXIT_FAILURE;
+                }
+            }
+        }
+        else
+        {
+            rc = EXIT_FAILURE;
+        }
+
+        if (pClassifier)
+        {
+            put_classifier(pClassifier);
+        }
+    }
+
+    if (write && (rc == EXIT_SUCCESS) && !write_baseline(zBaseline, baseline))
+    {
+        cerr << "error: Could not write " << zBaseline << "." << endl;
+        rc = EXIT_FAILURE;
+    }
+
+    mxs_log_finish();
+
+    return rc;
+}
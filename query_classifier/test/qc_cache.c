@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test that statements classified using the classification cache get the
+ * same results as statements that are parsed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/buffer.h>
+#include <maxscale/paths.h>
+#include <maxscale/query_classifier.h>
+#include "../../server/core/maxscale/query_classifier.h"
+
+#define MYSQL_HEADER_LEN 4
+
+/** Pairs of statements that have the same canonical form */
+static const char* cacheable[][2] =
+{
+    { "SELECT a, b FROM t1 WHERE c = 1", "SELECT a, b FROM t1 WHERE c = 2" },
+    { "SELECT COUNT(*) FROM db1.t1 WHERE name = 'x'", "SELECT COUNT(*) FROM db1.t1 WHERE name = 'y'" },
+    { "INSERT INTO t1 (a, b) VALUES (1, 'x')", "INSERT INTO t1 (a, b) VALUES (2, 'y')" },
+    { "UPDATE t1 SET a = 1 WHERE b = 2", "UPDATE t1 SET a = 3 WHERE b = 4" },
+    { "DELETE FROM t1 WHERE id = 10", "DELETE FROM t1 WHERE id = 20" },
+    { "SELECT t1.a, t2.b FROM t1 JOIN t2 ON t1.id = t2.id WHERE t1.c > 5",
+      "SELECT t1.a, t2.b FROM t1 JOIN t2 ON t1.id = t2.id WHERE t1.c > 6" },
+};
+
+/** Pairs of statements that must not be classified identically */
+static const char* uncacheable[][2] =
+{
+    { "SET autocommit=1", "SET autocommit=0" },
+    { "SELECT @@version FROM t1 WHERE b = 1", "SELECT @@last_insert_id FROM t1 WHERE b = 1" },
+};
+
+static GWBUF* create_gwbuf(const char* s)
+{
+    size_t len = strlen(s);
+    size_t payload_len = len + 1;
+    GWBUF* gwbuf = gwbuf_alloc(MYSQL_HEADER_LEN + payload_len);
+    unsigned char* data = GWBUF_DATA(gwbuf);
+
+    data[0] = payload_len;
+    data[1] = payload_len >> 8;
+    data[2] = payload_len >> 16;
+    data[3] = 0x00;
+    data[4] = 0x03;
+    memcpy(data + 5, s, len);
+
+    return gwbuf;
+}
+
+static void free_names(char** names, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        MXS_FREE(names[i]);
+    }
+
+    MXS_FREE(names);
+}
+
+static bool equal_names(GWBUF* a, GWBUF* b, bool fullnames)
+{
+    int n_a;
+    int n_b;
+    char** names_a = qc_get_table_names(a, &n_a, fullnames);
+    char** names_b = qc_get_table_names(b, &n_b, fullnames);
+    bool rval = n_a == n_b;
+
+    for (int i = 0; rval && i < n_a; i++)
+    {
+        rval = strcmp(names_a[i], names_b[i]) == 0;
+    }
+
+    free_names(names_a, n_a);
+    free_names(names_b, n_b);
+
+    return rval;
+}
+
+static bool equal_string(const char* a, const char* b)
+{
+    return (a == NULL && b == NULL) || (a && b && strcmp(a, b) == 0);
+}
+
+static bool equal_fields(GWBUF* a, GWBUF* b)
+{
+    const QC_FIELD_INFO* infos_a;
+    const QC_FIELD_INFO* infos_b;
+    size_t n_a;
+    size_t n_b;
+
+    qc_get_field_info(a, &infos_a, &n_a);
+    qc_get_field_info(b, &infos_b, &n_b);
+
+    bool rval = n_a == n_b;
+
+    for (size_t i = 0; rval && i < n_a; i++)
+    {
+        rval = equal_string(infos_a[i].database, infos_b[i].database) &&
+               equal_string(infos_a[i].table, infos_b[i].table) &&
+               equal_string(infos_a[i].column, infos_b[i].column) &&
+               infos_a[i].usage == infos_b[i].usage;
+    }
+
+    return rval;
+}
+
+static bool equal_functions(GWBUF* a, GWBUF* b)
+{
+    const QC_FUNCTION_INFO* infos_a;
+    const QC_FUNCTION_INFO* infos_b;
+    size_t n_a;
+    size_t n_b;
+
+    qc_get_function_info(a, &infos_a, &n_a);
+    qc_get_function_info(b, &infos_b, &n_b);
+
+    bool rval = n_a == n_b;
+
+    for (size_t i = 0; rval && i < n_a; i++)
+    {
+        rval = equal_string(infos_a[i].name, infos_b[i].name) &&
+               infos_a[i].usage == infos_b[i].usage;
+    }
+
+    return rval;
+}
+
+/**
+ * Compare the classification of a parsed and a cached statement
+ */
+static int compare(const char* s, GWBUF* parsed, GWBUF* cached)
+{
+    int rv = 0;
+
+    if (qc_get_type_mask(parsed) != qc_get_type_mask(cached) ||
+        qc_get_operation(parsed) != qc_get_operation(cached) ||
+        qc_query_has_clause(parsed) != qc_query_has_clause(cached) ||
+        !equal_names(parsed, cached, false) ||
+        !equal_names(parsed, cached, true) ||
+        !equal_fields(parsed, cached) ||
+        !equal_functions(parsed, cached))
+    {
+        fprintf(stderr, "error: Cached classification differs: %s\n", s);
+        rv = 1;
+    }
+
+    return rv;
+}
+
+static int test_cacheable()
+{
+    int rv = 0;
+    int n = sizeof(cacheable) / sizeof(cacheable[0]);
+
+    for (int i = 0; i < n; i++)
+    {
+        qc_set_cache_size(0);
+        GWBUF* parsed = create_gwbuf(cacheable[i][1]);
+        qc_parse(parsed, QC_COLLECT_ALL);
+
+        qc_set_cache_size(100);
+        GWBUF* first = create_gwbuf(cacheable[i][0]);
+        GWBUF* second = create_gwbuf(cacheable[i][1]);
+        qc_parse(first, QC_COLLECT_ALL);
+        qc_parse(second, QC_COLLECT_ALL);
+
+        rv += compare(cacheable[i][1], parsed, second);
+
+        gwbuf_free(parsed);
+        gwbuf_free(first);
+        gwbuf_free(second);
+    }
+
+    QC_CACHE_STATS stats;
+    qc_get_cache_stats(&stats);
+
+    if (stats.hits != n)
+    {
+        fprintf(stderr, "error: Expected %d cache hits, got %ld\n", n, (long)stats.hits);
+        rv += 1;
+    }
+
+    return rv;
+}
+
+/**
+ * Test that an entry created from a statement parsed with only the essentials
+ * is replaced when more information is needed
+ */
+static int test_collect()
+{
+    int rv = 0;
+    const char* s1 = "SELECT a FROM db1.t1 WHERE b = 1";
+    const char* s2 = "SELECT a FROM db1.t1 WHERE b = 2";
+
+    qc_set_cache_size(0);
+    GWBUF* parsed = create_gwbuf(s2);
+    qc_parse(parsed, QC_COLLECT_ALL);
+
+    /** The statement must not be pre-classified */
+    qc_set_preclassifier_enabled(false);
+    qc_set_cache_size(100);
+    GWBUF* first = create_gwbuf(s1);
+    qc_parse(first, QC_COLLECT_ESSENTIALS);
+
+    QC_CACHE_STATS before;
+    qc_get_cache_stats(&before);
+
+    GWBUF* second = create_gwbuf(s2);
+    rv += compare(s2, parsed, second);
+
+    QC_CACHE_STATS after;
+    qc_get_cache_stats(&after);
+
+    if (after.hits != before.hits + 1 || after.inserts != before.inserts + 1 || after.size != before.size)
+    {
+        fprintf(stderr, "error: Expected the entry to be looked up once and replaced once\n");
+        rv += 1;
+    }
+
+    GWBUF* third = create_gwbuf(s1);
+    rv += compare(s1, parsed, third);
+
+    QC_CACHE_STATS last;
+    qc_get_cache_stats(&last);
+
+    if (last.hits != after.hits + 1 || last.inserts != after.inserts)
+    {
+        fprintf(stderr, "error: Expected the replaced entry to contain everything\n");
+        rv += 1;
+    }
+
+    gwbuf_free(parsed);
+    gwbuf_free(first);
+    gwbuf_free(second);
+    gwbuf_free(third);
+
+    return rv;
+}
+
+static int test_uncacheable()
+{
+    int rv = 0;
+    int n = sizeof(uncacheable) / sizeof(uncacheable[0]);
+
+    for (int i = 0; i < n; i++)
+    {
+        qc_set_cache_size(0);
+        GWBUF* parsed = create_gwbuf(uncacheable[i][1]);
+        qc_parse(parsed, QC_COLLECT_ALL);
+
+        qc_set_cache_size(100);
+        GWBUF* first = create_gwbuf(uncacheable[i][0]);
+        GWBUF* second = create_gwbuf(uncacheable[i][1]);
+        qc_parse(first, QC_COLLECT_ALL);
+        qc_parse(second, QC_COLLECT_ALL);
+
+        if (qc_get_type_mask(parsed) != qc_get_type_mask(second))
+        {
+            fprintf(stderr, "error: Statement was classified from the cache: %s\n", uncacheable[i][1]);
+            rv += 1;
+        }
+
+        gwbuf_free(parsed);
+        gwbuf_free(first);
+        gwbuf_free(second);
+    }
+
+    return rv;
+}
+
+int main()
+{
+    int rv = EXIT_FAILURE;
+
+    set_libdir(MXS_STRDUP_A("../qc_sqlite"));
+
+    if (qc_setup("qc_sqlite", NULL) && qc_process_init(QC_INIT_BOTH))
+    {
+        int errors = test_cacheable() + test_collect() + test_uncacheable();
+
+        qc_process_end(QC_INIT_BOTH);
+
+        rv = errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else
+    {
+        fprintf(stderr, "error: Could not load query classifier.");
+    }
+
+    return rv;
+}
@@ -0,0 +1,15 @@
+#! /bin/sh
+# Compare how two classifiers classify generated statements.
+if [ $# -lt 4 ]
+then
+    echo "Usage: qc_fuzz.sh <qc_bench> <compare> <count> <seed>"
+    exit 1
+fi
+QC_BENCH=$1
+COMPARE=$2
+COUNT=$3
+SEED=$4
+STATEMENTS=generated-$SEED.test
+
+$QC_BENCH -g $COUNT -s $SEED -o $STATEMENTS || exit 1
+$COMPARE -v 1 $STATEMENTS
@@ -13,10 +13,15 @@
 
 #include <maxscale/buffer.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <maxscale/alloc.h>
 #include <maxscale/atomic.h>
+#include <maxscale/dcb.h>
 #include <maxscale/debug.h>
+#include <maxscale/limits.h>
+#include <maxscale/platform.h>
 #include <maxscale/spinlock.h>
 #include <maxscale/hint.h>
 #include <maxscale/log_manager.h>
@@ -28,6 +33,52 @@
 static HASHTABLE *buffer_hashtable = NULL;
 #endif
 
+/**
+ * Buffers are allocated in power of two size classes from 2^GWBUF_POOL_MIN_SHIFT
+ * up to MXS_MAX_NW_READ_BUFFER_SIZE bytes. Larger buffers are not pooled.
+ */
+#define GWBUF_POOL_MIN_SHIFT  6
+#define GWBUF_POOL_MAX_SHIFT  15
+#define GWBUF_POOL_N_CLASSES  (GWBUF_POOL_MAX_SHIFT - GWBUF_POOL_MIN_SHIFT + 1)
+#define GWBUF_POOL_CLASS_SIZE(c) ((size_t)1 << ((c) + GWBUF_POOL_MIN_SHIFT))
+#define GWBUF_NOT_POOLED      -1
+
+/** The maximum number of data bytes that a thread keeps in one size class */
+#define GWBUF_POOL_MAX_BYTES  (512 * 1024)
+
+#if (1 << GWBUF_POOL_MAX_SHIFT) != MXS_MAX_NW_READ_BUFFER_SIZE
+#error The largest buffer pool size class must match MXS_MAX_NW_READ_BUFFER_SIZE
+#endif
+
+/** The SHARED_BUF and the GWBUF that are a part of the same allocated block */
+#define GWBUF_BLOCK_SBUF(b)   ((SHARED_BUF*)((b) + 1))
+#define GWBUF_BLOCK_HEAD(s)   ((GWBUF*)(s) - 1)
+
+/**
+ * The free buffers and allocation statistics of one thread. The freelists
+ * are only accessed by the owning thread, the statistics are read without
+ * locking when they are displayed.
+ */
+typedef struct gwbuf_pool
+{
+    GWBUF             *freelist[GWBUF_POOL_N_CLASSES]; /*< Free blocks linked through next */
+    int                n_free[GWBUF_POOL_N_CLASSES];   /*< Number of blocks in each freelist */
+    bool               in_use;       /*< Whether a thread owns this pool */
+    unsigned long      owner;        /*< The owning thread */
+    uint64_t           n_allocs;     /*< Number of buffer allocations */
+    uint64_t           n_hits;       /*< Allocations served from the freelists */
+    uint64_t           n_frees;      /*< Number of blocks released */
+    uint64_t           n_copies;     /*< Buffer chains copied to make them contiguous */
+    int64_t            bytes_pooled; /*< Bytes currently held in the freelists */
+    struct gwbuf_pool *next;         /*< Next pool in the list of all pools */
+} GWBUF_POOL;
+
+static thread_local GWBUF_POOL *this_pool = NULL;
+static GWBUF_POOL *all_pools = NULL;
+static SPINLOCK all_pools_lock = SPINLOCK_INIT;
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
 static void gwbuf_free_one(GWBUF *buf);
 static buffer_object_t* gwbuf_remove_buffer_object(GWBUF*           buf,
                                                    buffer_object_t* bufobj);
@@ -39,12 +90,136 @@ static int bcmpfn (void *key1, void *key2);
 static void gwbuf_remove_from_hashtable(GWBUF *buf);
 #endif
 
+/**
+ * Return the buffers held by an exiting thread to the system and make its
+ * pool available to new threads.
+ *
+ * @param data The pool of the exiting thread
+ */
+static void gwbuf_pool_thread_exit(void *data)
+{
+    GWBUF_POOL *pool = (GWBUF_POOL*)data;
+
+    for (int i = 0; i < GWBUF_POOL_N_CLASSES; i++)
+    {
+        while (pool->freelist[i])
+        {
+            GWBUF *block = pool->freelist[i];
+            pool->freelist[i] = block->next;
+            MXS_FREE(block);
+        }
+        pool->n_free[i] = 0;
+    }
+
+    spinlock_acquire(&all_pools_lock);
+    pool->bytes_pooled = 0;
+    pool->in_use = false;
+    spinlock_release(&all_pools_lock);
+
+    this_pool = NULL;
+}
+
+static void gwbuf_pool_create_key()
+{
+    pthread_key_create(&pool_key, gwbuf_pool_thread_exit);
+}
+
+/**
+ * Get the buffer pool of the calling thread
+ *
+ * @return The pool of this thread or NULL if memory allocation failed
+ */
+static inline GWBUF_POOL* gwbuf_pool_get()
+{
+    if (this_pool == NULL)
+    {
+        pthread_once(&pool_key_once, gwbuf_pool_create_key);
+        spinlock_acquire(&all_pools_lock);
+
+        GWBUF_POOL *pool = all_pools;
+
+        while (pool && pool->in_use)
+        {
+            pool = pool->next;
+        }
+
+        if (pool == NULL && (pool = MXS_CALLOC(1, sizeof(GWBUF_POOL))))
+        {
+            pool->next = all_pools;
+            all_pools = pool;
+        }
+
+        if (pool)
+        {
+            pool->in_use = true;
+            pool->owner = (unsigned long)pthread_self();
+            pthread_setspecific(pool_key, pool);
+        }
+
+        this_pool = pool;
+        spinlock_release(&all_pools_lock);
+    }
+
+    return this_pool;
+}
+
+/**
+ * Return the size class of a buffer
+ *
+ * @param size Number of bytes of data
+ * @return The size class or GWBUF_NOT_POOLED if the buffer is too large to be pooled
+ */
+static inline int gwbuf_size_class(unsigned int size)
+{
+    if (size <= GWBUF_POOL_CLASS_SIZE(0))
+    {
+        return 0;
+    }
+    else if (size > GWBUF_POOL_CLASS_SIZE(GWBUF_POOL_N_CLASSES - 1))
+    {
+        return GWBUF_NOT_POOLED;
+    }
+
+    /** The number of bits needed to represent size - 1 is log2 of the class size */
+    int bits = sizeof(unsigned int) * 8 - __builtin_clz(size - 1);
+    return bits - GWBUF_POOL_MIN_SHIFT;
+}
+
+/**
+ * Release a buffer block, either back to the pool of this thread or to the system
+ *
+ * @param block The block to release
+ */
+static void gwbuf_release_block(GWBUF *block)
+{
+    GWBUF_POOL *pool = gwbuf_pool_get();
+    int size_class = GWBUF_BLOCK_SBUF(block)->size_class;
+
+    if (pool)
+    {
+        pool->n_frees++;
+    }
+
+    if (pool && size_class != GWBUF_NOT_POOLED &&
+        (pool->n_free[size_class] + 1) * GWBUF_POOL_CLASS_SIZE(size_class) <= GWBUF_POOL_MAX_BYTES)
+    {
+        block->next = pool->freelist[size_class];
+        pool->freelist[size_class] = block;
+        pool->n_free[size_class]++;
+        pool->bytes_pooled += GWBUF_POOL_CLASS_SIZE(size_class);
+    }
+    else
+    {
+        MXS_FREE(block);
+    }
+}
+
 /**
  * Allocate a new gateway buffer structure of size bytes.
  *
- * For now we allocate memory directly from malloc for buffer the management
- * structure and the actual data buffer itself. We may swap at a future date
- * to a more efficient mechanism.
+ * The buffer header, the shared buffer and the data area are allocated as
+ * one block. If the thread has a free block of the right size class, it
+ * is used instead of allocating new memory.
  *
  * @param       size The size in bytes of the data area required
  * @return      Pointer to the buffer structure or NULL if memory could not
@@ -53,36 +228,46 @@ static void gwbuf_remove_from_hashtable(GWBUF *buf);
 GWBUF *
 gwbuf_alloc(unsigned int size)
 {
-    GWBUF      *rval;
+    GWBUF      *rval = NULL;
     SHARED_BUF *sbuf;
+    GWBUF_POOL *pool = gwbuf_pool_get();
+    int         size_class = gwbuf_size_class(size);
 
-    /* Allocate the buffer header */
-    if ((rval = (GWBUF *)MXS_MALLOC(sizeof(GWBUF))) == NULL)
+    if (pool)
     {
-        goto retblock;
-    }
+        pool->n_allocs++;
 
-    /* Allocate the shared data buffer */
-    if ((sbuf = (SHARED_BUF *)MXS_MALLOC(sizeof(SHARED_BUF))) == NULL)
-    {
-        MXS_FREE(rval);
-        rval = NULL;
-        goto retblock;
+        if (size_class != GWBUF_NOT_POOLED && pool->freelist[size_class])
+        {
+            rval = pool->freelist[size_class];
+            pool->freelist[size_class] = rval->next;
+            pool->n_free[size_class]--;
+            pool->bytes_pooled -= GWBUF_POOL_CLASS_SIZE(size_class);
+            pool->n_hits++;
+        }
     }
 
-    /* Allocate the space for the actual data */
-    if ((sbuf->data = (unsigned char *)MXS_MALLOC(size)) == NULL)
+    if (rval == NULL)
     {
-        MXS_FREE(rval);
-        MXS_FREE(sbuf);
-        rval = NULL;
-        goto retblock;
+        size_t capacity = size_class == GWBUF_NOT_POOLED ? size : GWBUF_POOL_CLASS_SIZE(size_class);
+
+        /* Allocate the buffer header, the shared buffer and the data in one go */
+        if ((rval = (GWBUF *)MXS_MALLOC(sizeof(GWBUF) + sizeof(SHARED_BUF) + capacity)) == NULL)
+        {
+            goto retblock;
+        }
+
+        spinlock_init(&rval->gwbuf_lock);
+        sbuf = GWBUF_BLOCK_SBUF(rval);
+        sbuf->data = (unsigned char *)(sbuf + 1);
+        sbuf->size_class = size_class;
     }
+
+    sbuf = GWBUF_BLOCK_SBUF(rval);
     sbuf->refcount = 1;
     sbuf->info = GWBUF_INFO_NONE;
     sbuf->bufobj = NULL;
 
-    spinlock_init(&rval->gwbuf_lock);
     rval->start = sbuf->data;
     rval->end = (void *)((char *)rval->start + size);
     rval->sbuf = sbuf;
@@ -90,6 +275,7 @@ gwbuf_alloc(unsigned int size)
     rval->tail = rval;
     rval->hint = NULL;
     rval->properties = NULL;
+    rval->server = NULL;
     rval->gwbuf_type = GWBUF_TYPE_UNDEFINED;
     CHK_GWBUF(rval);
 retblock:
@@ -254,18 +440,22 @@ gwbuf_free_one(GWBUF *buf)
 {
     BUF_PROPERTY    *prop;
     buffer_object_t *bo;
+    SHARED_BUF      *sbuf = buf->sbuf;
+    /** Clones have a header of their own, the original one is a part of the block */
+    bool             is_clone = GWBUF_BLOCK_SBUF(buf) != sbuf;
+    bool             release_block = false;
 
-    if (atomic_add(&buf->sbuf->refcount, -1) == 1)
+    if (atomic_add(&sbuf->refcount, -1) == 1)
     {
-        bo = buf->sbuf->bufobj;
+        bo = sbuf->bufobj;
 
         while (bo != NULL)
         {
             bo = gwbuf_remove_buffer_object(buf, bo);
         }
 
-        MXS_FREE(buf->sbuf->data);
-        MXS_FREE(buf->sbuf);
+        sbuf->bufobj = NULL;
+        release_block = true;
     }
 
     while (buf->properties)
@@ -286,7 +476,20 @@ gwbuf_free_one(GWBUF *buf)
 #if defined(BUFFER_TRACE)
     gwbuf_remove_from_hashtable(buf);
 #endif
-    MXS_FREE(buf);
+
+    /**
+     * The header of the original buffer stays allocated until all clones
+     * have been freed as it is a part of the same block as the data.
+     */
+    if (is_clone)
+    {
+        MXS_FREE(buf);
+    }
+
+    if (release_block)
+    {
+        gwbuf_release_block(GWBUF_BLOCK_HEAD(sbuf));
+    }
 }
 
 /**
@@ -615,6 +818,19 @@ gwbuf_length(const GWBUF *head)
     return rval;
 }
 
+size_t gwbuf_tailroom(const GWBUF *buf)
+{
+    size_t room = 0;
+
+    if (buf && buf->sbuf->refcount == 1 && buf->sbuf->size_class != GWBUF_NOT_POOLED)
+    {
+        room = GWBUF_POOL_CLASS_SIZE(buf->sbuf->size_class) -
+               ((uint8_t*)buf->end - buf->sbuf->data);
+    }
+
+    return room;
+}
+
 int
 gwbuf_count(const GWBUF *head)
 {
@@ -679,8 +895,11 @@ void gwbuf_add_buffer_object(GWBUF* buf,
         p_b = &(*p_b)->bo_next;
     }
     *p_b = newb;
-    /** Set flag */
-    buf->sbuf->info |= GWBUF_INFO_PARSED;
+    /** Set flag, only the parsing information of the plugin means that the buffer is parsed */
+    if (id == GWBUF_PARSING_INFO)
+    {
+        buf->sbuf->info |= GWBUF_INFO_PARSED;
+    }
     /** Unlock */
     spinlock_release(&buf->gwbuf_lock);
 }
@@ -783,6 +1002,11 @@ gwbuf_make_contiguous(GWBUF *orig)
 
     if ((newbuf = gwbuf_alloc(gwbuf_length(orig))) != NULL)
     {
+        if (this_pool)
+        {
+            this_pool->n_copies++;
+        }
+
         newbuf->gwbuf_type = orig->gwbuf_type;
         newbuf->hint = hint_dup(orig->hint);
         ptr = GWBUF_DATA(newbuf);
@@ -867,3 +1091,42 @@ size_t gwbuf_copy_data(const GWBUF *buffer, size_t offset, size_t bytes, uint8_t
 
     return bytes_read;
 }
+
+void dprintBufferStats(void *pdcb)
+{
+    DCB *dcb = (DCB*)pdcb;
+    uint64_t n_allocs = 0;
+    uint64_t n_hits = 0;
+    uint64_t n_frees = 0;
+    uint64_t n_copies = 0;
+    int64_t bytes_pooled = 0;
+
+    dcb_printf(dcb, "\nBuffer statistics.\n\n");
+    dcb_printf(dcb, " Thread               | Allocations  | Pool hits    | Releases     | Copies       | Bytes pooled\n");
+    dcb_printf(dcb, "----------------------+--------------+--------------+--------------+--------------+-------------\n");
+
+    spinlock_acquire(&all_pools_lock);
+
+    for (GWBUF_POOL *pool = all_pools; pool; pool = pool->next)
+    {
+        if (pool->in_use)
+        {
+            dcb_printf(dcb, " %-20lu | %-12" PRIu64 " | %-12" PRIu64 " | %-12" PRIu64 " | %-12" PRIu64 " | %" PRId64 "\n",
+                       pool->owner, pool->n_allocs, pool->n_hits, pool->n_frees, pool->n_copies,
+                       pool->bytes_pooled);
+        }
+
+        n_allocs += pool->n_allocs;
+        n_hits += pool->n_hits;
+        n_frees += pool->n_frees;
+        n_copies += pool->n_copies;
+        bytes_pooled += pool->bytes_pooled;
+    }
+
+    spinlock_release(&all_pools_lock);
+
+    dcb_printf(dcb, "----------------------+--------------+--------------+--------------+--------------+-------------\n");
+    dcb_printf(dcb, " %-20s | %-12" PRIu64 " | %-12" PRIu64 " | %-12" PRIu64 " | %-12" PRIu64 " | %" PRId64 "\n",
+               "Total", n_allocs, n_hits, n_frees, n_copies, bytes_pooled);
+    dcb_printf(dcb, "\nPool hit ratio: %.2f%%\n", n_allocs ? 100.0 * n_hits / n_allocs : 0.0);
+}
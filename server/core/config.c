@@ -155,6 +155,7 @@ static const char *listener_params[] =
     "ssl_version",
     "ssl_cert_verify_depth",
     "ssl_verify_peer_certificate",
+    "reuseport",
     NULL
 };
 
@@ -1131,6 +1132,39 @@ config_threadcount()
     return gateway.n_threads;
 }
 
+/**
+ * Return the configured thread assignment policy
+ *
+ * @return How new DCBs are assigned to the worker threads
+ */
+MXS_THREAD_ASSIGNMENT
+config_thread_assignment()
+{
+    return gateway.thread_assignment;
+}
+
+/**
+ * Return the configured thread rebalancing threshold
+ *
+ * @return The threshold in percent, 0 if rebalancing is disabled
+ */
+int
+config_rebalance_threshold()
+{
+    return gateway.rebalance_threshold;
+}
+
+/**
+ * Return the configured poll engine
+ *
+ * @return How the worker threads wait for network events
+ */
+MXS_POLL_ENGINE
+config_poll_engine()
+{
+    return gateway.poll_engine;
+}
+
 /**
  * Return the number of non-blocking polls to be done before a blocking poll
  * is issued.
@@ -1307,6 +1341,24 @@ handle_global_item(const char *name, const char *value)
     {
         gateway.qc_args = MXS_STRDUP_A(value);
     }
+    else if (strcmp(name, "query_classifier_cache_size") == 0)
+    {
+        char* endptr;
+        long long intval = strtoll(value, &endptr, 0);
+        if (*endptr == '\0' && intval >= 0)
+        {
+            gateway.qc_cache_size = intval;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for 'query_classifier_cache_size': %s", value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, "query_classifier_preclassify") == 0)
+    {
+        gateway.qc_preclassify = config_truth_value((char*)value);
+    }
     else if (strcmp(name, "query_retries") == 0)
     {
         char* endptr;
@@ -1335,6 +1387,58 @@ handle_global_item(const char *name, const char *value)
             return 0;
         }
     }
+    else if (strcmp(name, "thread_assignment") == 0)
+    {
+        if (strcmp(value, "round_robin") == 0)
+        {
+            gateway.thread_assignment = THREAD_ASSIGN_ROUND_ROBIN;
+        }
+        else if (strcmp(value, "least_dcbs") == 0)
+        {
+            gateway.thread_assignment = THREAD_ASSIGN_LEAST_DCBS;
+        }
+        else if (strcmp(value, "least_load") == 0)
+        {
+            gateway.thread_assignment = THREAD_ASSIGN_LEAST_LOAD;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for 'thread_assignment': %s. Expected one of "
+                      "round_robin, least_dcbs or least_load.", value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, "rebalance_threshold") == 0)
+    {
+        char* endptr;
+        int intval = strtol(value, &endptr, 0);
+        if (*endptr == '\0' && intval >= 0 && intval <= 100)
+        {
+            gateway.rebalance_threshold = intval;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for 'rebalance_threshold': %s", value);
+            return 0;
+        }
+    }
+    else if (strcmp(name, "poll_engine") == 0)
+    {
+        if (strcmp(value, "epoll") == 0)
+        {
+            gateway.poll_engine = POLL_ENGINE_EPOLL;
+        }
+        else if (strcmp(value, "io_uring") == 0)
+        {
+            gateway.poll_engine = POLL_ENGINE_IO_URING;
+        }
+        else
+        {
+            MXS_ERROR("Invalid value for 'poll_engine': %s. Expected one of "
+                      "epoll or io_uring.", value);
+            return 0;
+        }
+    }
     else if (strcmp(name, "log_throttling") == 0)
     {
         if (*value == 0)
@@ -1634,6 +1738,11 @@ global_defaults()
     gateway.skip_permission_checks = false;
     gateway.query_retries = DEFAULT_QUERY_RETRIES;
     gateway.query_retry_timeout = DEFAULT_QUERY_RETRY_TIMEOUT;
+    gateway.qc_cache_size = 0;
+    gateway.qc_preclassify = false;
+    gateway.thread_assignment = THREAD_ASSIGN_ROUND_ROBIN;
+    gateway.rebalance_threshold = 0;
+    gateway.poll_engine = POLL_ENGINE_EPOLL;
 
     if (version_string != NULL)
     {
@@ -3104,6 +3213,7 @@ int create_new_listener(CONFIG_CONTEXT *obj)
     char *socket = config_get_value(obj->parameters, "socket");
     char *authenticator = config_get_value(obj->parameters, "authenticator");
     char *authenticator_options = config_get_value(obj->parameters, "authenticator_options");
+    char *reuseport = config_get_value(obj->parameters, "reuseport");
 
     if (service_name && protocol && (socket || port))
     {
@@ -3138,8 +3248,14 @@ int create_new_listener(CONFIG_CONTEXT *obj)
                 }
                 else
                 {
-                    serviceCreateListener(service, obj->object, protocol, address, atoi(port),
-                                          authenticator, authenticator_options, ssl_info);
+                    SERV_LISTENER *listener = serviceCreateListener(service, obj->object, protocol,
+                                                                    address, atoi(port), authenticator,
+                                                                    authenticator_options, ssl_info);
+
+                    if (listener && reuseport)
+                    {
+                        listener->reuseport = config_truth_value(reuseport);
+                    }
                 }
             }
 
@@ -66,6 +66,7 @@
 #include <maxscale/dcb.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -89,6 +90,7 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <maxscale/alloc.h>
 #include <maxscale/utils.h>
@@ -96,8 +98,25 @@
 
 #include "maxscale/session.h"
 #include "maxscale/modules.h"
+#include "maxscale/poll.h"
 #include "maxscale/queuemanager.h"
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/** The maximum number of buffers handed to the kernel in one vectored write */
+#define DCB_MAX_IOVEC IOV_MAX
+
+/** Size of the stack buffer for SSL reads when no data is known to be available */
+#define DCB_SSL_MIN_READ_SIZE 1024
+
+/** Maximum number of sessions inspected in one call to dcb_migrate_idle_sessions() */
+#define DCB_MIGRATE_MAX_SESSIONS 64
+
+/** Sessions with more DCBs than this are not moved between threads */
+#define DCB_MIGRATE_MAX_SESSION_DCBS 32
+
 /* A DCB with null values, used for initialization */
 static DCB dcb_initialized = DCB_INIT;
 
@@ -146,20 +165,22 @@ static int dcb_read_no_bytes_available(DCB *dcb, int nreadtotal);
 static int dcb_create_SSL(DCB* dcb, SSL_LISTENER *ssl);
 static int dcb_read_SSL(DCB *dcb, GWBUF **head);
 static GWBUF *dcb_basic_read(DCB *dcb, int bytesavailable, int maxbytes, int nreadtotal, int *nsingleread);
+static int dcb_read_inplace(DCB *dcb, GWBUF *tail, int bytesavailable, int maxbytes, int nreadtotal);
+static void dcb_update_read_size_hint(DCB *dcb, int nread);
 static GWBUF *dcb_basic_read_SSL(DCB *dcb, int *nsingleread);
 static void dcb_log_write_failure(DCB *dcb, GWBUF *queue, int eno);
 static inline void dcb_write_tidy_up(DCB *dcb, bool below_water);
-static int gw_write(DCB *dcb, GWBUF *writeq, bool *stop_writing);
+static int gw_writev(DCB *dcb, GWBUF *writeq, bool *stop_writing);
 static int gw_write_SSL(DCB *dcb, GWBUF *writeq, bool *stop_writing);
 static int dcb_log_errors_SSL (DCB *dcb, const char *called_by, int ret);
 static int dcb_accept_one_connection(DCB *listener, struct sockaddr *client_conn);
-static int dcb_listen_create_socket_inet(const char *host, uint16_t port);
+static int dcb_listen_create_socket_inet(const char *host, uint16_t port, bool reuseport);
+static int dcb_listen_create_reuseport_sockets(DCB *listener, const char *host, uint16_t port);
 static int dcb_listen_create_socket_unix(const char *path);
 static int dcb_set_socket_option(int sockfd, int level, int optname, void *optval, socklen_t optlen);
 static void dcb_add_to_all_list(DCB *dcb);
 static DCB *dcb_find_free();
 static GWBUF *dcb_grab_writeq(DCB *dcb, bool first_time);
-static void dcb_remove_from_list(DCB *dcb);
 
 size_t dcb_get_session_id(
     DCB *dcb)
@@ -476,7 +497,8 @@ dcb_process_victim_queue(int threadid)
             }
             else
             {
-                if (0 == dcb->persistentstart && dcb_maybe_add_persistent(dcb))
+                if (0 == dcb->persistentstart && !dcb->thread.migrating &&
+                    dcb_maybe_add_persistent(dcb))
                 {
                     /* Have taken DCB into persistent pool, no further killing */
                     dcblist = dcblist->memdata.next;
@@ -496,6 +518,17 @@ dcb_process_victim_queue(int threadid)
             }
         }
 
+        if (dcb->thread.migrating)
+        {
+            /** The adoption event queued by poll_move_dcb() still refers to
+             * the DCB. Free it once the event has been processed. */
+            DCB *newzombie = dcblist;
+            dcblist = dcblist->memdata.next;
+            newzombie->memdata.next = zombies[threadid];
+            zombies[threadid] = newzombie;
+            continue;
+        }
+
         nzombies[threadid]--;
 
         /*
@@ -531,6 +564,18 @@ dcb_process_victim_queue(int threadid)
             atomic_add(&dcb->server->stats.n_current, -1);
         }
 
+        if (dcb->reuseport_fds)
+        {
+            /** The socket of the first thread is closed below as dcb->fd */
+            for (int i = 1; i < config_threadcount(); i++)
+            {
+                close(dcb->reuseport_fds[i]);
+            }
+
+            MXS_FREE(dcb->reuseport_fds);
+            dcb->reuseport_fds = NULL;
+        }
+
         if (dcb->fd > 0)
         {
             /*<
@@ -816,6 +861,8 @@ int dcb_read(DCB   *dcb,
         return 0;
     }
 
+    int nreadstart = nreadtotal;
+
     while (0 == maxbytes || nreadtotal < maxbytes)
     {
         int bytes_available;
@@ -823,10 +870,29 @@ int dcb_read(DCB   *dcb,
         bytes_available = dcb_bytes_readable(dcb);
         if (bytes_available <= 0)
         {
+            dcb_update_read_size_hint(dcb, nreadtotal - nreadstart);
             return bytes_available < 0 ? -1 :
                    /** Handle closed client socket */
                    dcb_read_no_bytes_available(dcb, nreadtotal);
         }
+        else if (*head && gwbuf_tailroom((*head)->tail) > 0)
+        {
+            /**
+             * Append to the last buffer so that a packet which was split
+             * across reads stays contiguous and need not be copied later.
+             */
+            dcb->last_read = hkheartbeat;
+            nsingleread = dcb_read_inplace(dcb, (*head)->tail, bytes_available, maxbytes, nreadtotal);
+
+            if (nsingleread > 0)
+            {
+                nreadtotal += nsingleread;
+            }
+            else
+            {
+                break;
+            }
+        }
         else
         {
             GWBUF *buffer;
@@ -857,9 +923,79 @@ int dcb_read(DCB   *dcb,
         }
     } /*< while (0 == maxbytes || nreadtotal < maxbytes) */
 
+    dcb_update_read_size_hint(dcb, nreadtotal - nreadstart);
     return nreadtotal;
 }
 
+/**
+ * Update the expected read size of a DCB. The hint follows a moving average
+ * of the amount of data read per read event and converges to twice the
+ * average so that data arriving in the next event usually fits into the
+ * unused space at the end of the previous buffer.
+ *
+ * @param dcb   The DCB that was read from
+ * @param nread Number of bytes read from the socket in this event
+ */
+static void
+dcb_update_read_size_hint(DCB *dcb, int nread)
+{
+    if (nread > 0)
+    {
+        int hint = (3 * dcb->read_size_hint + 2 * nread) / 4;
+        dcb->read_size_hint = MXS_MIN(hint, MXS_MAX_NW_READ_BUFFER_SIZE);
+    }
+}
+
+/**
+ * Read data from the DCB socket into the unused space at the end of a buffer.
+ *
+ * @param dcb               The DCB to read from
+ * @param tail              The buffer to append the data to
+ * @param bytesavailable    Number of bytes available in the socket
+ * @param maxbytes          Maximum bytes to read (0 = no limit)
+ * @param nreadtotal        Total number of bytes already read
+ * @return                  Number of bytes read, 0 or -1 if nothing was read
+ */
+static int
+dcb_read_inplace(DCB *dcb, GWBUF *tail, int bytesavailable, int maxbytes, int nreadtotal)
+{
+    int bufsize = MXS_MIN(bytesavailable, gwbuf_tailroom(tail));
+    if (maxbytes)
+    {
+        bufsize = MXS_MIN(bufsize, maxbytes - nreadtotal);
+    }
+
+    int nread = read(dcb->fd, tail->end, bufsize);
+    dcb->stats.n_reads++;
+
+    if (nread > 0)
+    {
+        tail->end = (uint8_t*)tail->end + nread;
+        dcb->stats.n_reads_inplace++;
+        MXS_DEBUG("%lu [dcb_read] Appended %d bytes to the last buffer of dcb %p "
+                  "in state %s fd %d.",
+                  pthread_self(),
+                  nread,
+                  dcb,
+                  STRDCBSTATE(dcb->state),
+                  dcb->fd);
+    }
+    else if (errno != 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        char errbuf[MXS_STRERROR_BUFLEN];
+        MXS_ERROR("%lu [dcb_read] Error : Read failed, dcb %p in state "
+                  "%s fd %d, due %d, %s.",
+                  pthread_self(),
+                  dcb,
+                  STRDCBSTATE(dcb->state),
+                  dcb->fd,
+                  errno,
+                  strerror_r(errno, errbuf, sizeof(errbuf)));
+    }
+
+    return nread;
+}
+
 /**
  * Find the number of bytes available for the DCB's socket
  *
@@ -939,7 +1075,12 @@ dcb_basic_read(DCB *dcb, int bytesavailable, int maxbytes, int nreadtotal, int *
 {
     GWBUF *buffer;
 
-    int bufsize = MXS_MIN(bytesavailable, MXS_MAX_NW_READ_BUFFER_SIZE);
+    /**
+     * Allocate room for as much data as recent reads have returned so that
+     * data which arrives later can be appended to the same buffer.
+     */
+    int bufsize = MXS_MIN(MXS_MAX(bytesavailable, dcb->read_size_hint),
+                          MXS_MAX_NW_READ_BUFFER_SIZE);
     if (maxbytes)
     {
         bufsize = MXS_MIN(bufsize, maxbytes - nreadtotal);
@@ -967,8 +1108,14 @@ dcb_basic_read(DCB *dcb, int bytesavailable, int maxbytes, int nreadtotal, int *
     {
         *nsingleread = read(dcb->fd, GWBUF_DATA(buffer), bufsize);
         dcb->stats.n_reads++;
+        dcb->stats.n_read_buffers++;
 
-        if (*nsingleread <= 0)
+        if (*nsingleread > 0 && *nsingleread < bufsize)
+        {
+            /** The unused space stays available through gwbuf_tailroom() */
+            buffer = gwbuf_rtrim(buffer, bufsize - *nsingleread);
+        }
+        else if (*nsingleread <= 0)
         {
             if (errno != 0 && errno != EAGAIN && errno != EWOULDBLOCK)
             {
@@ -1047,9 +1194,41 @@ dcb_read_SSL(DCB *dcb, GWBUF **head)
     return nsingleread < 0 ? nsingleread : nreadtotal;
 }
 
+/**
+ * Estimate the size of the buffer needed for the next read from the DCB's
+ * SSL connection. The data that the SSL layer has already decrypted and the
+ * encrypted data waiting in the socket are together an upper bound for the
+ * amount of data that can be read without blocking.
+ *
+ * @param dcb   The DCB to read from
+ * @return      The number of bytes to allocate for the read, 0 if no data is
+ *              known to be available
+ */
+static int
+dcb_SSL_read_size(DCB *dcb)
+{
+    int pending = SSL_pending(dcb->ssl);
+    int readable = 0;
+
+    if (ioctl(dcb->fd, FIONREAD, &readable) == -1 || readable < 0)
+    {
+        readable = 0;
+    }
+
+    int size = MXS_MAX(pending, 0) + readable;
+
+    return MXS_MIN(size, MXS_MAX_NW_READ_BUFFER_SIZE);
+}
+
 /**
  * Basic read function to carry out a single read on the DCB's SSL connection
  *
+ * The data is decrypted directly into a buffer sized for the data that is
+ * available. The records that follow the first one are read into the same
+ * buffer until the buffer is full or no more data is available. If no data
+ * is known to be available, the read is done into a stack buffer and a
+ * buffer is only allocated if something was read.
+ *
  * @param dcb           The DCB to read from
  * @param nsingleread   To be set as the number of bytes read this time
  * @return              GWBUF* buffer containing the data, or null.
@@ -1057,15 +1236,67 @@ dcb_read_SSL(DCB *dcb, GWBUF **head)
 static GWBUF *
 dcb_basic_read_SSL(DCB *dcb, int *nsingleread)
 {
-    unsigned char temp_buffer[MXS_MAX_NW_READ_BUFFER_SIZE];
+    uint8_t probe[DCB_SSL_MIN_READ_SIZE];
+    uint8_t *data = probe;
+    int bufsize = dcb_SSL_read_size(dcb);
     GWBUF *buffer = NULL;
 
-    *nsingleread = SSL_read(dcb->ssl, (void *)temp_buffer, MXS_MAX_NW_READ_BUFFER_SIZE);
+    if (bufsize == 0)
+    {
+        bufsize = sizeof(probe);
+    }
+    else if ((buffer = gwbuf_alloc(bufsize)) != NULL)
+    {
+        data = GWBUF_DATA(buffer);
+    }
+    else
+    {
+        /*<
+         * This is a fatal error which should cause shutdown.
+         * Todo shutdown if memory allocation fails.
+         */
+        char errbuf[MXS_STRERROR_BUFLEN];
+        /* <editor-fold defaultstate="collapsed" desc=" Error Logging "> */
+        MXS_ERROR("%lu [dcb_read] Error : Failed to allocate read buffer "
+                  "for dcb %p fd %d, due %d, %s.",
+                  pthread_self(),
+                  dcb,
+                  dcb->fd,
+                  errno,
+                  strerror_r(errno, errbuf, sizeof(errbuf)));
+        /* </editor-fold> */
+        *nsingleread = -1;
+        return NULL;
+    }
+
+    *nsingleread = SSL_read(dcb->ssl, data, bufsize);
     dcb->stats.n_reads++;
 
     switch (SSL_get_error(dcb->ssl, *nsingleread))
     {
     case SSL_ERROR_NONE:
+        {
+            /*
+             * SSL_read returns at most one record, so the following records
+             * are read into the same buffer until it is full or no more
+             * data is available.
+             */
+            while (*nsingleread < bufsize)
+            {
+                int nread = SSL_read(dcb->ssl, data + *nsingleread,
+                                     bufsize - *nsingleread);
+                dcb->stats.n_reads++;
+
+                if (nread <= 0)
+                {
+                    /* Any error is handled by the next read */
+                    break;
+                }
+
+                *nsingleread += nread;
+            }
+        }
+
         /* Successful read */
         MXS_DEBUG("%lu [%s] Read %d bytes from dcb %p in state %s "
                   "fd %d.",
@@ -1075,24 +1306,20 @@ dcb_basic_read_SSL(DCB *dcb, int *nsingleread)
                   dcb,
                   STRDCBSTATE(dcb->state),
                   dcb->fd);
-        if (*nsingleread && (buffer = gwbuf_alloc_and_load(*nsingleread, (void *)temp_buffer)) == NULL)
+
+        if (buffer == NULL)
         {
-            /*<
-             * This is a fatal error which should cause shutdown.
-             * Todo shutdown if memory allocation fails.
-             */
-            char errbuf[MXS_STRERROR_BUFLEN];
-            /* <editor-fold defaultstate="collapsed" desc=" Error Logging "> */
-            MXS_ERROR("%lu [dcb_read] Error : Failed to allocate read buffer "
-                      "for dcb %p fd %d, due %d, %s.",
-                      pthread_self(),
-                      dcb,
-                      dcb->fd,
-                      errno,
-                      strerror_r(errno, errbuf, sizeof(errbuf)));
-            /* </editor-fold> */
-            *nsingleread = -1;
-            return NULL;
+            if (*nsingleread > 0 &&
+                (buffer = gwbuf_alloc_and_load(*nsingleread, probe)) == NULL)
+            {
+                MXS_ERROR("Failed to allocate read buffer for dcb %p fd %d.", dcb, dcb->fd);
+                *nsingleread = -1;
+            }
+        }
+        else if (*nsingleread < bufsize)
+        {
+            /* Releases the buffer if nothing was read */
+            buffer = gwbuf_rtrim(buffer, bufsize - *nsingleread);
         }
 
         /* If we were in a retry situation, need to clear flag and attempt write */
@@ -1144,6 +1371,14 @@ dcb_basic_read_SSL(DCB *dcb, int *nsingleread)
         *nsingleread = dcb_log_errors_SSL(dcb, __func__, *nsingleread);
         break;
     }
+
+    if (*nsingleread <= 0 && buffer)
+    {
+        /* Nothing was read */
+        gwbuf_free(buffer);
+        buffer = NULL;
+    }
+
     return buffer;
 }
 
@@ -1442,7 +1677,7 @@ dcb_drain_writeq(DCB *dcb)
             }
             else
             {
-                written = gw_write(dcb, local_writeq, &stop_writing);
+                written = gw_writev(dcb, local_writeq, &stop_writing);
             }
             /*
              * If the stop_writing boolean is set, writing has become blocked,
@@ -1456,6 +1691,9 @@ dcb_drain_writeq(DCB *dcb)
              */
             if (stop_writing)
             {
+                /* A partial write may still have sent some of the data */
+                local_writeq = gwbuf_consume(local_writeq, written);
+                total_written += written;
                 dcb->writeq = gwbuf_append(local_writeq, dcb->writeq);
 
                 if (dcb->drain_called_while_busy)
@@ -1783,6 +2021,14 @@ printDCB(DCB *dcb)
            dcb->stats.n_high_water);
     printf("\t\tNo. of Low Water Events:    %d\n",
            dcb->stats.n_low_water);
+    printf("\t\tNo. of Write Calls:                 %d\n",
+           dcb->stats.n_write_calls);
+    printf("\t\tNo. of Buffers Written:             %d\n",
+           dcb->stats.n_write_iovecs);
+    printf("\t\tNo. of Read Buffers:                %d\n",
+           dcb->stats.n_read_buffers);
+    printf("\t\tNo. of In-place Reads:              %d\n",
+           dcb->stats.n_reads_inplace);
 }
 /**
  * Display an entry from the spinlock statistics data
@@ -1881,6 +2127,13 @@ dprintOneDCB(DCB *pdcb, DCB *dcb)
     dcb_printf(pdcb, "\t\tNo. of Accepts:           %d\n", dcb->stats.n_accepts);
     dcb_printf(pdcb, "\t\tNo. of High Water Events: %d\n", dcb->stats.n_high_water);
     dcb_printf(pdcb, "\t\tNo. of Low Water Events:  %d\n", dcb->stats.n_low_water);
+    dcb_printf(pdcb, "\t\tNo. of Write Calls:       %d\n", dcb->stats.n_write_calls);
+    dcb_printf(pdcb, "\t\tBuffers per Write Call:   %.2f\n",
+               dcb->stats.n_write_calls ?
+               (double)dcb->stats.n_write_iovecs / dcb->stats.n_write_calls : 0.0);
+    dcb_printf(pdcb, "\t\tNo. of Read Buffers:      %d\n", dcb->stats.n_read_buffers);
+    dcb_printf(pdcb, "\t\tNo. of In-place Reads:    %d\n", dcb->stats.n_reads_inplace);
+    dcb_printf(pdcb, "\t\tNo. of Thread Migrations: %d\n", dcb->stats.n_migrations);
     if (dcb->flags & DCBF_CLONE)
     {
         dcb_printf(pdcb, "\t\tDCB is a clone.\n");
@@ -2041,6 +2294,19 @@ dprintDCB(DCB *pdcb, DCB *dcb)
                dcb->stats.n_high_water);
     dcb_printf(pdcb, "\t\tNo. of Low Water Events:  %d\n",
                dcb->stats.n_low_water);
+    dcb_printf(pdcb, "\t\tNo. of Write Calls:               %d\n",
+               dcb->stats.n_write_calls);
+    dcb_printf(pdcb, "\t\tBuffers per Write Call:           %.2f\n",
+               dcb->stats.n_write_calls ?
+               (double)dcb->stats.n_write_iovecs / dcb->stats.n_write_calls : 0.0);
+    dcb_printf(pdcb, "\t\tNo. of Read Buffers:              %d\n",
+               dcb->stats.n_read_buffers);
+    dcb_printf(pdcb, "\t\tNo. of In-place Reads:            %d\n",
+               dcb->stats.n_reads_inplace);
+    dcb_printf(pdcb, "\t\tRead Size Hint:                   %d\n",
+               dcb->read_size_hint);
+    dcb_printf(pdcb, "\t\tNo. of Thread Migrations:         %d\n",
+               dcb->stats.n_migrations);
     if (DCB_POLL_BUSY(dcb))
     {
         dcb_printf(pdcb, "\t\tPending events in the queue:      %x %s\n",
@@ -2219,25 +2485,44 @@ gw_write_SSL(DCB *dcb, GWBUF *writeq, bool *stop_writing)
 /**
  * Write data to a DCB. The data is taken from the DCB's write queue.
  *
+ * The buffers of the chain are handed to the kernel with a single vectored
+ * write, at most DCB_MAX_IOVEC buffers at a time. If the kernel accepts less
+ * than what was offered, the socket buffer is full and the caller should stop
+ * writing until the next EPOLLOUT event.
+ *
  * @param dcb           The DCB to write buffer
  * @param writeq        A buffer list containing the data to be written
  * @param stop_writing  Set to true if the caller should stop writing, false otherwise
  * @return              Number of written bytes
  */
 static int
-gw_write(DCB *dcb, GWBUF *writeq, bool *stop_writing)
+gw_writev(DCB *dcb, GWBUF *writeq, bool *stop_writing)
 {
-    int written = 0;
+    struct iovec iov[DCB_MAX_IOVEC];
+    int iovcnt = 0;
+    size_t nbytes = 0;
+    ssize_t written = 0;
     int fd = dcb->fd;
-    size_t nbytes = GWBUF_LENGTH(writeq);
-    void *buf = GWBUF_DATA(writeq);
     int saved_errno;
 
+    for (GWBUF *buf = writeq; buf && iovcnt < DCB_MAX_IOVEC; buf = buf->next)
+    {
+        if (GWBUF_LENGTH(buf) > 0)
+        {
+            iov[iovcnt].iov_base = GWBUF_DATA(buf);
+            iov[iovcnt].iov_len = GWBUF_LENGTH(buf);
+            nbytes += GWBUF_LENGTH(buf);
+            iovcnt++;
+        }
+    }
+
     errno = 0;
 
-    if (fd > 0)
+    if (fd > 0 && iovcnt > 0)
     {
-        written = write(fd, buf, nbytes);
+        written = writev(fd, iov, iovcnt);
+        dcb->stats.n_write_calls++;
+        dcb->stats.n_write_iovecs += iovcnt;
     }
 
     saved_errno = errno;
@@ -2267,7 +2552,12 @@ gw_write(DCB *dcb, GWBUF *writeq, bool *stop_writing)
     }
     else
     {
-        *stop_writing = false;
+        /**
+         * A short write means that the socket buffer is full. The socket
+         * becomes writable again only after the peer has read some data,
+         * at which point an EPOLLOUT event is triggered.
+         */
+        *stop_writing = (size_t)written < nbytes;
     }
 
     return written > 0 ? written : 0;
@@ -2840,6 +3130,7 @@ dcb_accept(DCB *listener)
     if ((c_sock = dcb_accept_one_connection(listener, (struct sockaddr *)&client_conn)) >= 0)
     {
         listener->stats.n_accepts++;
+        poll_connection_accepted();
         MXS_DEBUG("%lu [gw_MySQLAccept] Accepted fd %d.",
                   pthread_self(),
                   c_sock);
@@ -2980,7 +3271,8 @@ dcb_accept_one_connection(DCB *listener, struct sockaddr *client_conn)
         int eno = 0;
 
         /* new connection from client */
-        c_sock = accept(listener->fd,
+        c_sock = accept(listener->reuseport_fds ?
+                        listener->reuseport_fds[current_thread_id] : listener->fd,
                         client_conn,
                         &client_len);
         eno = errno;
@@ -3073,14 +3365,22 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
     }
 
     int listener_socket = -1;
+    bool reuseport = listener->listener && listener->listener->reuseport;
 
     if (strchr(host, '/'))
     {
+        if (reuseport)
+        {
+            MXS_WARNING("The reuseport parameter is ignored for UNIX domain "
+                        "socket '%s'.", host);
+            reuseport = false;
+        }
+
         listener_socket = dcb_listen_create_socket_unix(host);
     }
     else if (port > 0)
     {
-        listener_socket = dcb_listen_create_socket_inet(host, port);
+        listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
 
         if (listener_socket == -1 && strcmp(host, "::") == 0)
         {
@@ -3088,7 +3388,7 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
             MXS_WARNING("Failed to bind on default IPv6 host '::', attempting "
                         "to bind on IPv4 version '0.0.0.0'");
             strcpy(host, "0.0.0.0");
-            listener_socket = dcb_listen_create_socket_inet(host, port);
+            listener_socket = dcb_listen_create_socket_inet(host, port, reuseport);
         }
     }
     else
@@ -3118,11 +3418,19 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
         return -1;
     }
 
-    MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s", host, port, protocol_name);
-
     // assign listener_socket to dcb
     listener->fd = listener_socket;
 
+    if (reuseport && dcb_listen_create_reuseport_sockets(listener, host, port) != 0)
+    {
+        close(listener_socket);
+        listener->fd = DCBFD_CLOSED;
+        return -1;
+    }
+
+    MXS_NOTICE("Listening for connections at [%s]:%u with protocol %s%s", host, port,
+               protocol_name, reuseport ? ", one socket per thread" : "");
+
     // add listening socket to poll structure
     if (poll_add_dcb(listener) != 0)
     {
@@ -3133,21 +3441,81 @@ int dcb_listen(DCB *listener, const char *config, const char *protocol_name)
     return 0;
 }
 
+/**
+ * @brief Create the remaining sockets of a SO_REUSEPORT listener
+ *
+ * The kernel distributes the incoming connections between all sockets bound
+ * to the same port. Each worker thread polls only its own socket so a new
+ * connection wakes up one thread and stays in the thread that accepted it.
+ * The socket of the first thread must already be stored in the DCB.
+ *
+ * @param listener The listener DCB
+ * @param host     The network address to listen on
+ * @param port     The port to listen on
+ * @return         0 on success, -1 on error
+ */
+static int dcb_listen_create_reuseport_sockets(DCB *listener, const char *host, uint16_t port)
+{
+    int nthr = config_threadcount();
+    int *fds = (int*)MXS_MALLOC(nthr * sizeof(int));
+
+    if (fds == NULL)
+    {
+        return -1;
+    }
+
+    fds[0] = listener->fd;
+
+    for (int i = 1; i < nthr; i++)
+    {
+        if ((fds[i] = dcb_listen_create_socket_inet(host, port, true)) == -1 ||
+            listen(fds[i], INT_MAX) != 0)
+        {
+            if (fds[i] != -1)
+            {
+                MXS_ERROR("Failed to start listening on '[%s]:%u': %d, %s",
+                          host, port, errno, mxs_strerror(errno));
+                close(fds[i]);
+            }
+
+            for (int j = 1; j < i; j++)
+            {
+                close(fds[j]);
+            }
+
+            MXS_FREE(fds);
+            return -1;
+        }
+    }
+
+    listener->reuseport_fds = fds;
+    return 0;
+}
+
 /**
  * @brief Create a network listener socket
  *
- * @param host The network address to listen on
- * @param port The port to listen on
- * @return     The opened socket or -1 on error
+ * @param host      The network address to listen on
+ * @param port      The port to listen on
+ * @param reuseport Allow other sockets to bind to the same port with SO_REUSEPORT
+ * @return          The opened socket or -1 on error
  */
-static int dcb_listen_create_socket_inet(const char *host, uint16_t port)
+static int dcb_listen_create_socket_inet(const char *host, uint16_t port, bool reuseport)
 {
     struct sockaddr_storage server_address = {};
     int listener_socket = open_network_socket(MXS_SOCKET_LISTENER, &server_address, host, port);
 
     if (listener_socket != -1)
     {
-        if (bind(listener_socket, (struct sockaddr*)&server_address, sizeof(server_address)) < 0)
+        int one = 1;
+
+        if (reuseport &&
+            dcb_set_socket_option(listener_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
+        {
+            close(listener_socket);
+            listener_socket = -1;
+        }
+        else if (bind(listener_socket, (struct sockaddr*)&server_address, sizeof(server_address)) < 0)
         {
             MXS_ERROR("Failed to bind on '%s:%u': %d, %s",
                       host, port, errno, mxs_strerror(errno));
@@ -3337,11 +3705,96 @@ void dcb_add_to_list(DCB *dcb)
 }
 
 /**
- * Remove a DCB from the owner's list
+ * Check whether a DCB can be moved to another thread
+ *
+ * @param dcb DCB to check
+ * @return True if the DCB has no pending work
+ */
+static bool dcb_is_idle(const DCB *dcb)
+{
+    return dcb->state == DCB_STATE_POLLING &&
+           dcb->fd > 0 &&
+           !dcb->dcb_is_zombie &&
+           dcb->persistentstart == 0 &&
+           dcb->writeq == NULL &&
+           dcb->delayq == NULL &&
+           dcb->dcb_readqueue == NULL &&
+           dcb->dcb_fakequeue == NULL &&
+           !dcb->ssl_read_want_read &&
+           !dcb->ssl_read_want_write &&
+           !dcb->ssl_write_want_read &&
+           !dcb->ssl_write_want_write;
+}
+
+/**
+ * Collect the DCBs of an idle session
  *
- * @param dcb DCB to remove
+ * @param thread_id The thread that owns the session
+ * @param client    The client DCB of the session
+ * @param dcbs      Array where the DCBs are stored
+ * @return Number of DCBs stored or 0 if the session is not idle
  */
-static void dcb_remove_from_list(DCB *dcb)
+static int dcb_get_idle_session_dcbs(int thread_id, DCB *client, DCB **dcbs)
+{
+    int n = 0;
+    dcbs[n++] = client;
+
+    for (DCB *dcb = all_dcbs[thread_id]; dcb; dcb = dcb->thread.next)
+    {
+        if (dcb != client && dcb->session == client->session)
+        {
+            if (n == DCB_MIGRATE_MAX_SESSION_DCBS ||
+                dcb->dcb_role != DCB_ROLE_BACKEND_HANDLER ||
+                !dcb_is_idle(dcb))
+            {
+                return 0;
+            }
+
+            dcbs[n++] = dcb;
+        }
+    }
+
+    return n;
+}
+
+int dcb_migrate_idle_sessions(int thread_id, int target, int max_dcbs)
+{
+    DCB *clients[DCB_MIGRATE_MAX_SESSIONS];
+    int n_clients = 0;
+
+    /** The list can't be modified while it is iterated so the candidates are collected first */
+    for (DCB *dcb = all_dcbs[thread_id]; dcb && n_clients < DCB_MIGRATE_MAX_SESSIONS;
+         dcb = dcb->thread.next)
+    {
+        if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER &&
+            dcb->session && dcb->session->state == SESSION_STATE_ROUTER_READY &&
+            dcb_is_idle(dcb))
+        {
+            clients[n_clients++] = dcb;
+        }
+    }
+
+    int moved = 0;
+
+    for (int i = 0; i < n_clients && moved < max_dcbs; i++)
+    {
+        DCB *dcbs[DCB_MIGRATE_MAX_SESSION_DCBS];
+        int n = dcb_get_idle_session_dcbs(thread_id, clients[i], dcbs);
+
+        for (int j = 0; j < n; j++)
+        {
+            if (poll_move_dcb(dcbs[j], target))
+            {
+                dcbs[j]->stats.n_migrations++;
+                moved++;
+            }
+        }
+    }
+
+    return moved;
+}
+
+void dcb_remove_from_list(DCB *dcb)
 {
     spinlock_acquire(&all_dcbs_lock[dcb->thread.id]);
 
@@ -3355,8 +3808,10 @@ static void dcb_remove_from_list(DCB *dcb)
             all_dcbs[dcb->thread.id]->thread.tail = tail;
         }
     }
-    else
+    else if (all_dcbs[dcb->thread.id])
     {
+        /** The list is empty if the DCB was closed while it was being moved
+         * to this thread, see poll_move_dcb() */
         DCB *current = all_dcbs[dcb->thread.id]->thread.next;
         DCB *prev = all_dcbs[dcb->thread.id];
 
@@ -74,6 +74,7 @@
 #include "maxscale/modules.h"
 #include "maxscale/monitor.h"
 #include "maxscale/poll.h"
+#include "maxscale/query_classifier.h"
 #include "maxscale/service.h"
 #include "maxscale/statistics.h"
 
@@ -1908,6 +1909,9 @@ int main(int argc, char **argv)
         goto return_main;
     }
 
+    qc_set_cache_size(cnf->qc_cache_size);
+    qc_set_preclassifier_enabled(cnf->qc_preclassify);
+
     cnf->config_check = config_check;
 
     if (!config_check)
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file histogram.c - Log-linear histograms
+ *
+ * Values below 2 * MXS_HISTOGRAM_SUB_BUCKETS have a bucket of their own. For
+ * larger values, the bucket is selected by the position of the highest set bit
+ * and the MXS_HISTOGRAM_SUB_BITS bits below it.
+ */
+
+#include "maxscale/histogram.h"
+#include <string.h>
+
+/**
+ * Get the bucket of a value
+ *
+ * @param value The value, must not be larger than MXS_HISTOGRAM_MAX_VALUE
+ *
+ * @return Index of the bucket
+ */
+static inline int histogram_bucket(uint64_t value)
+{
+    if (value < 2 * MXS_HISTOGRAM_SUB_BUCKETS)
+    {
+        return value;
+    }
+
+    int shift = 63 - __builtin_clzll(value) - MXS_HISTOGRAM_SUB_BITS;
+    return shift * MXS_HISTOGRAM_SUB_BUCKETS + (int)(value >> shift);
+}
+
+/**
+ * Get the number of low bits that are ignored in a bucket
+ *
+ * @param bucket Index of the bucket
+ *
+ * @return Number of ignored bits
+ */
+static inline int histogram_shift(int bucket)
+{
+    return bucket < 2 * MXS_HISTOGRAM_SUB_BUCKETS ? 0 : bucket / MXS_HISTOGRAM_SUB_BUCKETS - 1;
+}
+
+/**
+ * Get the lowest value of a bucket
+ *
+ * @param bucket Index of the bucket
+ *
+ * @return The lowest value that is recorded into the bucket
+ */
+static inline uint64_t histogram_lowest(int bucket)
+{
+    int shift = histogram_shift(bucket);
+    return (uint64_t)(bucket - shift * MXS_HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+/**
+ * Get the highest value of a bucket
+ *
+ * @param bucket Index of the bucket
+ *
+ * @return The highest value that is recorded into the bucket
+ */
+static inline uint64_t histogram_highest(int bucket)
+{
+    return histogram_lowest(bucket) + (UINT64_C(1) << histogram_shift(bucket)) - 1;
+}
+
+void mxs_histogram_reset(MXS_HISTOGRAM *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+void mxs_histogram_record(MXS_HISTOGRAM *hist, uint64_t value)
+{
+    if (value > MXS_HISTOGRAM_MAX_VALUE)
+    {
+        value = MXS_HISTOGRAM_MAX_VALUE;
+    }
+
+    hist->counts[histogram_bucket(value)]++;
+    hist->total++;
+
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+}
+
+void mxs_histogram_merge(MXS_HISTOGRAM *dest, const MXS_HISTOGRAM *src)
+{
+    uint64_t total = 0;
+
+    /** The total is calculated from the buckets so that it matches them
+     * even if the source histogram is being written to */
+    for (int i = 0; i < MXS_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t count = src->counts[i];
+        dest->counts[i] += count;
+        total += count;
+    }
+
+    dest->total += total;
+
+    if (src->max > dest->max)
+    {
+        dest->max = src->max;
+    }
+}
+
+uint64_t mxs_histogram_percentile(const MXS_HISTOGRAM *hist, double percentile)
+{
+    if (hist->total == 0)
+    {
+        return 0;
+    }
+
+    if (percentile > 100.0)
+    {
+        percentile = 100.0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * hist->total + 0.5);
+    uint64_t seen = 0;
+
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    for (int i = 0; i < MXS_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += hist->counts[i];
+
+        if (seen >= rank)
+        {
+            uint64_t value = histogram_highest(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+uint64_t mxs_histogram_count(const MXS_HISTOGRAM *hist, uint64_t low, uint64_t high)
+{
+    uint64_t rval = 0;
+
+    for (int i = 0; i < MXS_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t value = histogram_lowest(i);
+
+        if (value >= high)
+        {
+            break;
+        }
+        else if (value >= low)
+        {
+            rval += hist->counts[i];
+        }
+    }
+
+    return rval;
+}
@@ -128,6 +128,7 @@ listener_alloc(struct service* service, const char* name, const char *protocol,
     proto->authenticator = my_authenticator;
     proto->auth_options = my_auth_options;
     proto->ssl = ssl;
+    proto->reuseport = false;
     proto->users = NULL;
     proto->next = NULL;
     proto->auth_instance = auth_instance;
@@ -428,6 +429,11 @@ static bool create_listener_config(const SERV_LISTENER *listener, const char *fi
         dprintf(file, "authenticator_options=%s\n", listener->auth_options);
     }
 
+    if (listener->reuseport)
+    {
+        dprintf(file, "reuseport=true\n");
+    }
+
     if (listener->ssl)
     {
         write_ssl_config(file, listener->ssl);
@@ -0,0 +1,98 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file core/maxscale/histogram.h - Log-linear histograms
+ *
+ * The histogram divides each power of two into MXS_HISTOGRAM_SUB_BUCKETS
+ * linear buckets, which keeps the relative error of a recorded value below
+ * 1 / MXS_HISTOGRAM_SUB_BUCKETS regardless of its magnitude. Values from one
+ * nanosecond up to several hours can be recorded into a fixed size array.
+ *
+ * A histogram has a single writer. Histograms of different threads are
+ * merged when the statistics are read.
+ */
+
+#include <maxscale/cdefs.h>
+#include <stdint.h>
+
+MXS_BEGIN_DECLS
+
+/** Number of bits in the linear part of a bucket */
+#define MXS_HISTOGRAM_SUB_BITS    5
+/** Number of linear buckets per power of two */
+#define MXS_HISTOGRAM_SUB_BUCKETS (1 << MXS_HISTOGRAM_SUB_BITS)
+/** Number of bits in the largest value that can be recorded */
+#define MXS_HISTOGRAM_MAX_BITS    44
+/** Total number of buckets */
+#define MXS_HISTOGRAM_BUCKETS     ((MXS_HISTOGRAM_MAX_BITS - MXS_HISTOGRAM_SUB_BITS + 1) * MXS_HISTOGRAM_SUB_BUCKETS)
+/** Largest value that can be recorded, larger values are recorded as this */
+#define MXS_HISTOGRAM_MAX_VALUE   ((UINT64_C(1) << MXS_HISTOGRAM_MAX_BITS) - 1)
+
+typedef struct mxs_histogram
+{
+    uint64_t total;                          /**< Number of recorded values */
+    uint64_t max;                            /**< Largest recorded value */
+    uint64_t counts[MXS_HISTOGRAM_BUCKETS];  /**< Number of values in each bucket */
+} MXS_HISTOGRAM;
+
+/**
+ * Reset a histogram
+ *
+ * @param hist Histogram to reset
+ */
+void mxs_histogram_reset(MXS_HISTOGRAM *hist);
+
+/**
+ * Record a value
+ *
+ * @param hist  Histogram to record into
+ * @param value The value
+ */
+void mxs_histogram_record(MXS_HISTOGRAM *hist, uint64_t value);
+
+/**
+ * Add the values of one histogram to another
+ *
+ * @param dest Histogram to add to
+ * @param src  Histogram to add, can be concurrently written to
+ */
+void mxs_histogram_merge(MXS_HISTOGRAM *dest, const MXS_HISTOGRAM *src);
+
+/**
+ * Get the value at a percentile
+ *
+ * @param hist       The histogram
+ * @param percentile Percentile between 0 and 100
+ *
+ * @return The largest value that is equivalent to the value at the percentile,
+ *         capped to the largest recorded value, or 0 if the histogram is empty
+ */
+uint64_t mxs_histogram_percentile(const MXS_HISTOGRAM *hist, double percentile);
+
+/**
+ * Count the recorded values in a range
+ *
+ * A value is counted if the lowest value of its bucket is in the range, which
+ * is exact as long as @c low and @c high are bucket boundaries.
+ *
+ * @param hist The histogram
+ * @param low  Start of the range, inclusive
+ * @param high End of the range, exclusive
+ *
+ * @return Number of values in the range
+ */
+uint64_t mxs_histogram_count(const MXS_HISTOGRAM *hist, uint64_t low, uint64_t high);
+
+MXS_END_DECLS
@@ -0,0 +1,101 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file core/maxscale/mpscq.h - A lock-free multiple producer, single consumer queue
+ *
+ * The queue is an intrusive list: the element that is queued must embed an
+ * MXS_MPSCQ_NODE. Producers push elements with a compare-and-swap and never
+ * block each other for longer than one retry. The consumer takes all queued
+ * elements at once with an atomic exchange, which means that the consumer
+ * never needs to retry and that there is no ABA problem.
+ */
+
+#include <maxscale/cdefs.h>
+
+MXS_BEGIN_DECLS
+
+typedef struct mxs_mpscq_node
+{
+    struct mxs_mpscq_node *next; /**< The next element in the queue */
+} MXS_MPSCQ_NODE;
+
+typedef struct mxs_mpscq
+{
+    MXS_MPSCQ_NODE *head;        /**< The most recently pushed element */
+} MXS_MPSCQ;
+
+#define MXS_MPSCQ_INIT {NULL}
+
+/**
+ * Push an element into the queue. Can be called by any thread.
+ *
+ * @param queue The queue
+ * @param node  The element to push
+ *
+ * @return True if the queue was empty before the element was pushed
+ */
+static inline bool mxs_mpscq_push(MXS_MPSCQ *queue, MXS_MPSCQ_NODE *node)
+{
+    MXS_MPSCQ_NODE *head;
+
+    do
+    {
+        head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        node->next = head;
+    }
+    while (!__sync_bool_compare_and_swap(&queue->head, head, node));
+
+    return head == NULL;
+}
+
+/**
+ * Check whether the queue is empty. The result is only a hint unless it is
+ * called by the consumer and the result is false.
+ *
+ * @param queue The queue
+ *
+ * @return True if the queue is empty
+ */
+static inline bool mxs_mpscq_is_empty(const MXS_MPSCQ *queue)
+{
+    return __atomic_load_n(&queue->head, __ATOMIC_RELAXED) == NULL;
+}
+
+/**
+ * Take all elements from the queue. Must only be called by the consumer.
+ *
+ * @param queue The queue
+ *
+ * @return The elements in the order they were pushed, linked with the
+ *         @c next pointers, or NULL if the queue was empty
+ */
+static inline MXS_MPSCQ_NODE* mxs_mpscq_take_all(MXS_MPSCQ *queue)
+{
+    MXS_MPSCQ_NODE *node = __atomic_exchange_n(&queue->head, NULL, __ATOMIC_SEQ_CST);
+    MXS_MPSCQ_NODE *rval = NULL;
+
+    /** The elements are stored in reverse order */
+    while (node)
+    {
+        MXS_MPSCQ_NODE *next = node->next;
+        node->next = rval;
+        rval = node;
+        node = next;
+    }
+
+    return rval;
+}
+
+MXS_END_DECLS
@@ -18,12 +18,16 @@
 
 #include <maxscale/poll.h>
 
+#include <maxscale/platform.h>
 #include <maxscale/resultset.h>
 
 MXS_BEGIN_DECLS
 
 #define MAX_EVENTS 1000
 
+/** The ID of the calling worker thread */
+extern thread_local int current_thread_id;
+
 /**
  * A statistic identifier that can be returned by poll_get_stat
  */
@@ -59,7 +63,33 @@ void            dShowEventStats(DCB *dcb);
 
 int64_t         poll_get_stat(POLL_STAT stat);
 RESULTSET       *eventTimesGetList();
+RESULTSET       *eventLatenciesGetList();
 
 void            poll_send_message(enum poll_message msg, void *data);
 
+/**
+ * Record a client connection that was accepted by the calling worker thread.
+ */
+void            poll_connection_accepted(void);
+
+/**
+ * Move a DCB to the epoll instance of another thread
+ *
+ * Must be called by the thread that owns the DCB. Events that were queued
+ * for the DCB on the old owner are forwarded to the new owner.
+ *
+ * @param dcb    DCB to move
+ * @param target The new owner
+ * @return True if the DCB was moved
+ */
+bool            poll_move_dcb(DCB *dcb, int target);
+
+/**
+ * Get the number of DCBs in the epoll instance of a thread
+ *
+ * @param thread_id The thread ID
+ * @return Number of DCBs polled by the thread
+ */
+int             poll_thread_dcb_count(int thread_id);
+
 MXS_END_DECLS
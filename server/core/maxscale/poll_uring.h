@@ -0,0 +1,76 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file core/maxscale/poll_uring.h - The io_uring poll engine
+ *
+ * Each worker thread has its own io_uring instance in which every polled
+ * descriptor has a multishot poll request. The functions have the same
+ * semantics as epoll_ctl and epoll_wait so that the rest of the poll
+ * subsystem does not need to know which engine is in use.
+ *
+ * Requests added by the thread that owns the instance are submitted together
+ * with its next wait, which removes the system call that epoll_ctl would need.
+ * Requests added by other threads are submitted by the owner after it has
+ * been woken up. All requests are submitted by the owning thread because
+ * io_uring completes poll requests in the context of the submitting thread.
+ *
+ * Only readiness notification is done with io_uring. Reads and writes are
+ * done by the protocol modules with the same system calls as with epoll.
+ */
+
+#include <maxscale/cdefs.h>
+#include <sys/epoll.h>
+
+MXS_BEGIN_DECLS
+
+/**
+ * Create an io_uring instance for each thread
+ *
+ * @param n_threads Number of threads
+ *
+ * @return True if io_uring is supported and the instances were created. On
+ *         failure errno describes the error.
+ */
+bool poll_uring_init(int n_threads);
+
+/**
+ * Add or remove a descriptor, only EPOLL_CTL_ADD and EPOLL_CTL_DEL are supported
+ *
+ * After EPOLL_CTL_DEL returns, no more events are returned for the descriptor.
+ * This function can be called by any thread.
+ *
+ * @param thread_id The thread whose instance is modified
+ * @param op        EPOLL_CTL_ADD or EPOLL_CTL_DEL
+ * @param fd        The descriptor
+ * @param event     The events to poll and the data returned with them
+ *
+ * @return 0 on success, -1 on error with errno set as epoll_ctl would set it
+ */
+int poll_uring_ctl(int thread_id, int op, int fd, struct epoll_event *event);
+
+/**
+ * Wait for events, must only be called by the thread that owns the instance
+ *
+ * @param thread_id The calling thread
+ * @param events    Array where events are stored
+ * @param maxevents Size of the array
+ * @param timeout   Timeout in milliseconds, 0 returns immediately and -1
+ *                  waits until an event arrives
+ *
+ * @return Number of events or -1 on error
+ */
+int poll_uring_wait(int thread_id, struct epoll_event *events, int maxevents, int timeout);
+
+MXS_END_DECLS
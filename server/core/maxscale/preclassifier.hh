@@ -0,0 +1,1012 @@
+#pragma once
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <ctype.h>
+#include <string.h>
+#include <maxscale/modutil.h>
+#include <maxscale/query_classifier.h>
+
+namespace maxscale
+{
+
+/**
+ * @class PreClassifier
+ *
+ * PreClassifier recognizes a small set of frequent and simple statements
+ * and returns the same type mask, operation and clause information for them
+ * as the query classifier would, without the statements having to be parsed
+ * by the query classifier. The recognized statements are:
+ *
+ *   BEGIN [WORK], COMMIT [WORK] and ROLLBACK [WORK]
+ *   START TRANSACTION [READ ONLY | READ WRITE | WITH CONSISTENT SNAPSHOT, ...]
+ *   SET [SESSION | GLOBAL] autocommit = {0 | 1 | ON | OFF | TRUE | FALSE},
+ *     also with @@autocommit, @@session.autocommit and @@global.autocommit
+ *   USE db
+ *   SELECT literal, ...
+ *   SELECT {* | column | literal}, ... FROM table
+ *     [WHERE column op literal [AND column op literal] ...] [LIMIT n [, n]]
+ *
+ * where a literal is a number, a single quoted string, NULL or a placeholder,
+ * a column or a table may be qualified and op is a comparison operator.
+ * Everything else, including statements with executable comments, is left
+ * for the query classifier.
+ *
+ * As the class is used for every statement that is routed, it is defined
+ * in its entirety in the header to allow for aggressive inlining.
+ */
+class PreClassifier
+{
+public:
+    enum token_t
+    {
+        TK_AND,
+        TK_AUTOCOMMIT,
+        TK_BEGIN,
+        TK_COMMA,
+        TK_COMMIT,
+        TK_COMPARISON,
+        TK_CONSISTENT,
+        TK_DOT,
+        TK_EQ,
+        TK_FALSE,
+        TK_FROM,
+        TK_GLOBAL,
+        TK_GLOBAL_VAR,
+        TK_IDENTIFIER,
+        TK_LIMIT,
+        TK_NULL,
+        TK_NUMBER,
+        TK_OFF,
+        TK_ON,
+        TK_ONLY,
+        TK_PLACEHOLDER,
+        TK_READ,
+        TK_ROLLBACK,
+        TK_SELECT,
+        TK_SESSION,
+        TK_SESSION_VAR,
+        TK_SET,
+        TK_SNAPSHOT,
+        TK_STAR,
+        TK_START,
+        TK_STRING,
+        TK_TRANSACTION,
+        TK_TRUE,
+        TK_USE,
+        TK_WHERE,
+        TK_WITH,
+        TK_WORK,
+        TK_WRITE,
+
+        PARSER_UNKNOWN_TOKEN,
+        PARSER_EXHAUSTED,
+    };
+
+    /**
+     * PreClassifier is not thread-safe. As a very lightweight class, the
+     * intention is that an instance is created on the stack whenever a
+     * statement should be classified.
+     *
+     * @code
+     *     void f(const char* pSql, size_t len)
+     *     {
+     *         PreClassifier pc;
+     *
+     *         if (pc.classify(pSql, len))
+     *         {
+     *             uint32_t type_mask = pc.type_mask();
+     *             ...
+     *         }
+     *     }
+     * @endcode
+     */
+    PreClassifier()
+        : m_pI(NULL)
+        , m_pEnd(NULL)
+        , m_pToken(NULL)
+        , m_token_len(0)
+        , m_type_mask(QUERY_TYPE_UNKNOWN)
+        , m_op(QUERY_OP_UNDEFINED)
+        , m_has_clause(false)
+    {
+    }
+
+    /**
+     * Classify a statement.
+     *
+     * @param pSql  SQL statement.
+     * @param len   Length of pSql.
+     *
+     * @return True, if the statement was recognized, in which case the type
+     *         mask, operation and clause information are available. False,
+     *         if the statement must be classified by the query classifier.
+     */
+    bool classify(const char* pSql, size_t len)
+    {
+        m_pI = pSql;
+        m_pEnd = pSql + len;
+        m_type_mask = QUERY_TYPE_UNKNOWN;
+        m_op = QUERY_OP_UNDEFINED;
+        m_has_clause = false;
+
+        // The contents of executable comments are not seen by the parser, so a
+        // recognized statement must not contain any. Most statements are not
+        // recognized, so they are parsed first.
+        return parse() && !memmem(pSql, len, "/*!", 3) && !memmem(pSql, len, "/*M!", 4);
+    }
+
+    /**
+     * @return The type mask of the last recognized statement.
+     */
+    uint32_t type_mask() const
+    {
+        return m_type_mask;
+    }
+
+    /**
+     * @return The operation of the last recognized statement.
+     */
+    qc_query_op_t operation() const
+    {
+        return m_op;
+    }
+
+    /**
+     * @return Whether the last recognized statement has a WHERE clause.
+     */
+    bool has_clause() const
+    {
+        return m_has_clause;
+    }
+
+private:
+    bool parse()
+    {
+        bool rv = false;
+
+        switch (next_token())
+        {
+        case TK_BEGIN:
+            m_type_mask = QUERY_TYPE_BEGIN_TRX;
+            rv = parse_work();
+            break;
+
+        case TK_COMMIT:
+            m_type_mask = QUERY_TYPE_COMMIT;
+            rv = parse_work();
+            break;
+
+        case TK_ROLLBACK:
+            m_type_mask = QUERY_TYPE_ROLLBACK;
+            rv = parse_work();
+            break;
+
+        case TK_START:
+            rv = parse_start();
+            break;
+
+        case TK_SET:
+            rv = parse_set();
+            break;
+
+        case TK_USE:
+            rv = parse_use();
+            break;
+
+        case TK_SELECT:
+            rv = parse_select();
+            break;
+
+        default:
+            ;
+        }
+
+        return rv;
+    }
+
+    bool parse_work()
+    {
+        token_t token = next_token();
+
+        if (token == TK_WORK)
+        {
+            token = next_token();
+        }
+
+        return token == PARSER_EXHAUSTED;
+    }
+
+    bool parse_start()
+    {
+        if (next_token() != TK_TRANSACTION)
+        {
+            return false;
+        }
+
+        m_type_mask = QUERY_TYPE_BEGIN_TRX;
+
+        token_t token = next_token();
+
+        while (token != PARSER_EXHAUSTED)
+        {
+            switch (token)
+            {
+            case TK_READ:
+                token = next_token();
+
+                if (token == TK_ONLY)
+                {
+                    m_type_mask |= QUERY_TYPE_READ;
+                }
+                else if (token == TK_WRITE)
+                {
+                    m_type_mask |= QUERY_TYPE_WRITE;
+                }
+                else
+                {
+                    return false;
+                }
+                break;
+
+            case TK_WITH:
+                if (next_token() != TK_CONSISTENT || next_token() != TK_SNAPSHOT)
+                {
+                    return false;
+                }
+                break;
+
+            default:
+                return false;
+            }
+
+            token = next_token();
+
+            if (token == TK_COMMA)
+            {
+                token = next_token();
+
+                if (token == PARSER_EXHAUSTED)
+                {
+                    return false;
+                }
+            }
+            else if (token != PARSER_EXHAUSTED)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool parse_set()
+    {
+        token_t token = next_token();
+
+        switch (token)
+        {
+        case TK_SESSION:
+        case TK_GLOBAL:
+            token = next_token();
+            break;
+
+        case TK_SESSION_VAR:
+        case TK_GLOBAL_VAR:
+            if (next_token() != TK_DOT)
+            {
+                return false;
+            }
+            token = next_token();
+            break;
+
+        default:
+            ;
+        }
+
+        if (token != TK_AUTOCOMMIT || next_token() != TK_EQ)
+        {
+            return false;
+        }
+
+        switch (next_token())
+        {
+        case TK_NUMBER:
+            if (m_token_len != 1 || (*m_pToken != '0' && *m_pToken != '1'))
+            {
+                return false;
+            }
+            token = (*m_pToken == '1') ? TK_ON : TK_OFF;
+            break;
+
+        case TK_ON:
+        case TK_TRUE:
+            token = TK_ON;
+            break;
+
+        case TK_OFF:
+        case TK_FALSE:
+            token = TK_OFF;
+            break;
+
+        default:
+            return false;
+        }
+
+        m_type_mask = QUERY_TYPE_GSYSVAR_WRITE;
+
+        if (token == TK_ON)
+        {
+            m_type_mask |= (QUERY_TYPE_ENABLE_AUTOCOMMIT | QUERY_TYPE_COMMIT);
+        }
+        else
+        {
+            m_type_mask |= (QUERY_TYPE_DISABLE_AUTOCOMMIT | QUERY_TYPE_BEGIN_TRX);
+        }
+
+        return next_token() == PARSER_EXHAUSTED;
+    }
+
+    bool parse_use()
+    {
+        m_type_mask = QUERY_TYPE_SESSION_WRITE;
+        m_op = QUERY_OP_CHANGE_DB;
+
+        return next_token() == TK_IDENTIFIER && next_token() == PARSER_EXHAUSTED;
+    }
+
+    static bool is_literal(token_t token)
+    {
+        return token == TK_NUMBER || token == TK_STRING || token == TK_NULL || token == TK_PLACEHOLDER;
+    }
+
+    /**
+     * Parse a possibly qualified name whose first part has been read.
+     *
+     * @param max_parts  The maximum number of parts in the name.
+     *
+     * @return The token following the name.
+     */
+    token_t parse_name(int max_parts)
+    {
+        token_t token = next_token();
+
+        for (int i = 1; token == TK_DOT && i < max_parts; ++i)
+        {
+            if (next_token() != TK_IDENTIFIER)
+            {
+                return PARSER_UNKNOWN_TOKEN;
+            }
+
+            token = next_token();
+        }
+
+        return token;
+    }
+
+    bool parse_select()
+    {
+        bool only_literals = true;
+        token_t token;
+
+        do
+        {
+            token = next_token();
+
+            if (is_literal(token))
+            {
+                token = next_token();
+            }
+            else if (token == TK_STAR)
+            {
+                only_literals = false;
+                token = next_token();
+            }
+            else if (token == TK_IDENTIFIER)
+            {
+                only_literals = false;
+                token = parse_name(3);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        while (token == TK_COMMA);
+
+        m_type_mask = QUERY_TYPE_READ;
+        m_op = QUERY_OP_SELECT;
+
+        if (token == PARSER_EXHAUSTED)
+        {
+            return only_literals;
+        }
+        else if (token != TK_FROM || next_token() != TK_IDENTIFIER)
+        {
+            return false;
+        }
+
+        token = parse_name(2);
+
+        if (token == TK_WHERE)
+        {
+            m_has_clause = true;
+
+            do
+            {
+                if (next_token() != TK_IDENTIFIER)
+                {
+                    return false;
+                }
+
+                token = parse_name(3);
+
+                if ((token != TK_EQ && token != TK_COMPARISON) || !is_literal(next_token()))
+                {
+                    return false;
+                }
+
+                token = next_token();
+            }
+            while (token == TK_AND);
+        }
+
+        if (token == TK_LIMIT)
+        {
+            if (next_token() != TK_NUMBER)
+            {
+                return false;
+            }
+
+            token = next_token();
+
+            if (token == TK_COMMA)
+            {
+                if (next_token() != TK_NUMBER)
+                {
+                    return false;
+                }
+
+                token = next_token();
+            }
+        }
+
+        return token == PARSER_EXHAUSTED;
+    }
+
+    static bool is_word_char(char c)
+    {
+        return isalnum((unsigned char)c) || c == '_' || c == '$';
+    }
+
+    // Significantly faster than library version.
+    static char toupper(char c)
+    {
+        return (c >= 'a' && c <='z') ? c - ('a' - 'A') : c;
+    }
+
+    bool token_is(const char* zWord, size_t len) const
+    {
+        bool rv = (m_token_len == len);
+
+        for (size_t i = 0; rv && i < len; ++i)
+        {
+            rv = (toupper(m_pToken[i]) == zWord[i]);
+        }
+
+        return rv;
+    }
+
+    /**
+     * Compare the word at m_pToken with an upper case word.
+     *
+     * @return Less than, equal to or greater than zero, if the word at m_pToken
+     *         sorts before, is equal to or sorts after zWord.
+     */
+    int compare_token(const char* zWord) const
+    {
+        size_t i = 0;
+
+        for (; i < m_token_len && zWord[i]; ++i)
+        {
+            int diff = toupper(m_pToken[i]) - zWord[i];
+
+            if (diff != 0)
+            {
+                return diff;
+            }
+        }
+
+        return (i == m_token_len) ? -(zWord[i] != 0) : 1;
+    }
+
+    /**
+     * Return the keyword token of the word at m_pToken, or TK_IDENTIFIER
+     * if the word is not a keyword.
+     *
+     * The table also contains the other keywords of qc_sqlite. An unquoted
+     * keyword in the place of an identifier may change how the statement is
+     * parsed, so such statements are left for the query classifier.
+     */
+    token_t keyword() const
+    {
+        struct keyword_t
+        {
+            const char* zWord;
+            token_t     token;
+        };
+
+        // Sorted, so that a word can be found with a binary search.
+        static const keyword_t KEYWORDS[] =
+        {
+            { "ABORT", PARSER_UNKNOWN_TOKEN },
+            { "ACTION", PARSER_UNKNOWN_TOKEN },
+            { "ADD", PARSER_UNKNOWN_TOKEN },
+            { "AFTER", PARSER_UNKNOWN_TOKEN },
+            { "AGAINST", PARSER_UNKNOWN_TOKEN },
+            { "ALGORITHM", PARSER_UNKNOWN_TOKEN },
+            { "ALL", PARSER_UNKNOWN_TOKEN },
+            { "ALTER", PARSER_UNKNOWN_TOKEN },
+            { "ANALYZE", PARSER_UNKNOWN_TOKEN },
+            { "AND", TK_AND },
+            { "AS", PARSER_UNKNOWN_TOKEN },
+            { "ASC", PARSER_UNKNOWN_TOKEN },
+            { "ATTACH", PARSER_UNKNOWN_TOKEN },
+            { "AUTOCOMMIT", TK_AUTOCOMMIT },
+            { "AUTOINCREMENT", PARSER_UNKNOWN_TOKEN },
+            { "AUTO_INCREMENT", PARSER_UNKNOWN_TOKEN },
+            { "BEFORE", PARSER_UNKNOWN_TOKEN },
+            { "BEGIN", TK_BEGIN },
+            { "BETWEEN", PARSER_UNKNOWN_TOKEN },
+            { "BINARY", PARSER_UNKNOWN_TOKEN },
+            { "BY", PARSER_UNKNOWN_TOKEN },
+            { "CALL", PARSER_UNKNOWN_TOKEN },
+            { "CASCADE", PARSER_UNKNOWN_TOKEN },
+            { "CASE", PARSER_UNKNOWN_TOKEN },
+            { "CAST", PARSER_UNKNOWN_TOKEN },
+            { "CHARACTER", PARSER_UNKNOWN_TOKEN },
+            { "CHARSET", PARSER_UNKNOWN_TOKEN },
+            { "CHECK", PARSER_UNKNOWN_TOKEN },
+            { "CLOSE", PARSER_UNKNOWN_TOKEN },
+            { "COLLATE", PARSER_UNKNOWN_TOKEN },
+            { "COLUMN", PARSER_UNKNOWN_TOKEN },
+            { "COLUMNS", PARSER_UNKNOWN_TOKEN },
+            { "COMMENT", PARSER_UNKNOWN_TOKEN },
+            { "COMMIT", TK_COMMIT },
+            { "CONCURRENT", PARSER_UNKNOWN_TOKEN },
+            { "CONFLICT", PARSER_UNKNOWN_TOKEN },
+            { "CONSISTENT", TK_CONSISTENT },
+            { "CONSTRAINT", PARSER_UNKNOWN_TOKEN },
+            { "CREATE", PARSER_UNKNOWN_TOKEN },
+            { "CROSS", PARSER_UNKNOWN_TOKEN },
+            { "CURRENT_DATE", PARSER_UNKNOWN_TOKEN },
+            { "CURRENT_TIME", PARSER_UNKNOWN_TOKEN },
+            { "CURRENT_TIMESTAMP", PARSER_UNKNOWN_TOKEN },
+            { "DATA", PARSER_UNKNOWN_TOKEN },
+            { "DATABASE", PARSER_UNKNOWN_TOKEN },
+            { "DATABASES", PARSER_UNKNOWN_TOKEN },
+            { "DEALLOCATE", PARSER_UNKNOWN_TOKEN },
+            { "DEFAULT", PARSER_UNKNOWN_TOKEN },
+            { "DEFERRABLE", PARSER_UNKNOWN_TOKEN },
+            { "DEFERRED", PARSER_UNKNOWN_TOKEN },
+            { "DELAYED", PARSER_UNKNOWN_TOKEN },
+            { "DELETE", PARSER_UNKNOWN_TOKEN },
+            { "DESC", PARSER_UNKNOWN_TOKEN },
+            { "DESCRIBE", PARSER_UNKNOWN_TOKEN },
+            { "DETACH", PARSER_UNKNOWN_TOKEN },
+            { "DISTINCT", PARSER_UNKNOWN_TOKEN },
+            { "DISTINCTROW", PARSER_UNKNOWN_TOKEN },
+            { "DO", PARSER_UNKNOWN_TOKEN },
+            { "DROP", PARSER_UNKNOWN_TOKEN },
+            { "DUMPFILE", PARSER_UNKNOWN_TOKEN },
+            { "EACH", PARSER_UNKNOWN_TOKEN },
+            { "ELSE", PARSER_UNKNOWN_TOKEN },
+            { "ENABLE", PARSER_UNKNOWN_TOKEN },
+            { "END", PARSER_UNKNOWN_TOKEN },
+            { "ENGINE", PARSER_UNKNOWN_TOKEN },
+            { "ENUM", PARSER_UNKNOWN_TOKEN },
+            { "ESCAPE", PARSER_UNKNOWN_TOKEN },
+            { "EXCEPT", PARSER_UNKNOWN_TOKEN },
+            { "EXCLUSIVE", PARSER_UNKNOWN_TOKEN },
+            { "EXECUTE", PARSER_UNKNOWN_TOKEN },
+            { "EXISTS", PARSER_UNKNOWN_TOKEN },
+            { "EXPLAIN", PARSER_UNKNOWN_TOKEN },
+            { "FAIL", PARSER_UNKNOWN_TOKEN },
+            { "FALSE", TK_FALSE },
+            { "FIRST", PARSER_UNKNOWN_TOKEN },
+            { "FLUSH", PARSER_UNKNOWN_TOKEN },
+            { "FOR", PARSER_UNKNOWN_TOKEN },
+            { "FORCE", PARSER_UNKNOWN_TOKEN },
+            { "FOREIGN", PARSER_UNKNOWN_TOKEN },
+            { "FROM", TK_FROM },
+            { "FULL", PARSER_UNKNOWN_TOKEN },
+            { "FULLTEXT", PARSER_UNKNOWN_TOKEN },
+            { "FUNCTION", PARSER_UNKNOWN_TOKEN },
+            { "GLOB", PARSER_UNKNOWN_TOKEN },
+            { "GLOBAL", TK_GLOBAL },
+            { "GRANT", PARSER_UNKNOWN_TOKEN },
+            { "GROUP", PARSER_UNKNOWN_TOKEN },
+            { "HANDLER", PARSER_UNKNOWN_TOKEN },
+            { "HAVING", PARSER_UNKNOWN_TOKEN },
+            { "HIGH_PRIORITY", PARSER_UNKNOWN_TOKEN },
+            { "IF", PARSER_UNKNOWN_TOKEN },
+            { "IGNORE", PARSER_UNKNOWN_TOKEN },
+            { "IMMEDIATE", PARSER_UNKNOWN_TOKEN },
+            { "IN", PARSER_UNKNOWN_TOKEN },
+            { "INDEX", PARSER_UNKNOWN_TOKEN },
+            { "INDEXED", PARSER_UNKNOWN_TOKEN },
+            { "INDEXES", PARSER_UNKNOWN_TOKEN },
+            { "INFILE", PARSER_UNKNOWN_TOKEN },
+            { "INITIALLY", PARSER_UNKNOWN_TOKEN },
+            { "INNER", PARSER_UNKNOWN_TOKEN },
+            { "INSERT", PARSER_UNKNOWN_TOKEN },
+            { "INSTEAD", PARSER_UNKNOWN_TOKEN },
+            { "INTERSECT", PARSER_UNKNOWN_TOKEN },
+            { "INTERVAL", PARSER_UNKNOWN_TOKEN },
+            { "INTO", PARSER_UNKNOWN_TOKEN },
+            { "IS", PARSER_UNKNOWN_TOKEN },
+            { "ISNULL", PARSER_UNKNOWN_TOKEN },
+            { "JOIN", PARSER_UNKNOWN_TOKEN },
+            { "KEY", PARSER_UNKNOWN_TOKEN },
+            { "KEYS", PARSER_UNKNOWN_TOKEN },
+            { "LEFT", PARSER_UNKNOWN_TOKEN },
+            { "LIKE", PARSER_UNKNOWN_TOKEN },
+            { "LIMIT", TK_LIMIT },
+            { "LOAD", PARSER_UNKNOWN_TOKEN },
+            { "LOCAL", PARSER_UNKNOWN_TOKEN },
+            { "LOCK", PARSER_UNKNOWN_TOKEN },
+            { "LOW_PRIORITY", PARSER_UNKNOWN_TOKEN },
+            { "MASTER", PARSER_UNKNOWN_TOKEN },
+            { "MATCH", PARSER_UNKNOWN_TOKEN },
+            { "MERGE", PARSER_UNKNOWN_TOKEN },
+            { "NAMES", PARSER_UNKNOWN_TOKEN },
+            { "NATURAL", PARSER_UNKNOWN_TOKEN },
+            { "NO", PARSER_UNKNOWN_TOKEN },
+            { "NOT", PARSER_UNKNOWN_TOKEN },
+            { "NOTNULL", PARSER_UNKNOWN_TOKEN },
+            { "NO_WRITE_TO_BINLOG", PARSER_UNKNOWN_TOKEN },
+            { "NULL", TK_NULL },
+            { "OF", PARSER_UNKNOWN_TOKEN },
+            { "OFF", TK_OFF },
+            { "OFFSET", PARSER_UNKNOWN_TOKEN },
+            { "ON", TK_ON },
+            { "ONLY", TK_ONLY },
+            { "OPEN", PARSER_UNKNOWN_TOKEN },
+            { "OR", PARSER_UNKNOWN_TOKEN },
+            { "ORDER", PARSER_UNKNOWN_TOKEN },
+            { "OUTER", PARSER_UNKNOWN_TOKEN },
+            { "OUTFILE", PARSER_UNKNOWN_TOKEN },
+            { "PERSISTENT", PARSER_UNKNOWN_TOKEN },
+            { "PLAN", PARSER_UNKNOWN_TOKEN },
+            { "PRAGMA", PARSER_UNKNOWN_TOKEN },
+            { "PREPARE", PARSER_UNKNOWN_TOKEN },
+            { "PRIMARY", PARSER_UNKNOWN_TOKEN },
+            { "PROCEDURE", PARSER_UNKNOWN_TOKEN },
+            { "QUERY", PARSER_UNKNOWN_TOKEN },
+            { "QUICK", PARSER_UNKNOWN_TOKEN },
+            { "RAISE", PARSER_UNKNOWN_TOKEN },
+            { "READ", TK_READ },
+            { "RECURSIVE", PARSER_UNKNOWN_TOKEN },
+            { "REFERENCES", PARSER_UNKNOWN_TOKEN },
+            { "REGEXP", PARSER_UNKNOWN_TOKEN },
+            { "REINDEX", PARSER_UNKNOWN_TOKEN },
+            { "RELEASE", PARSER_UNKNOWN_TOKEN },
+            { "RENAME", PARSER_UNKNOWN_TOKEN },
+            { "REPLACE", PARSER_UNKNOWN_TOKEN },
+            { "RESTRICT", PARSER_UNKNOWN_TOKEN },
+            { "REVOKE", PARSER_UNKNOWN_TOKEN },
+            { "RIGHT", PARSER_UNKNOWN_TOKEN },
+            { "ROLLBACK", TK_ROLLBACK },
+            { "ROLLUP", PARSER_UNKNOWN_TOKEN },
+            { "ROW", PARSER_UNKNOWN_TOKEN },
+            { "SAVEPOINT", PARSER_UNKNOWN_TOKEN },
+            { "SCHEMAS", PARSER_UNKNOWN_TOKEN },
+            { "SELECT", TK_SELECT },
+            { "SEPARATOR", PARSER_UNKNOWN_TOKEN },
+            { "SESSION", TK_SESSION },
+            { "SET", TK_SET },
+            { "SHOW", PARSER_UNKNOWN_TOKEN },
+            { "SLAVE", PARSER_UNKNOWN_TOKEN },
+            { "SNAPSHOT", TK_SNAPSHOT },
+            { "SPATIAL", PARSER_UNKNOWN_TOKEN },
+            { "SQL_BIG_RESULT", PARSER_UNKNOWN_TOKEN },
+            { "SQL_BUFFER_RESULT", PARSER_UNKNOWN_TOKEN },
+            { "SQL_CACHE", PARSER_UNKNOWN_TOKEN },
+            { "SQL_CALC_FOUND_ROWS", PARSER_UNKNOWN_TOKEN },
+            { "SQL_NO_CACHE", PARSER_UNKNOWN_TOKEN },
+            { "SQL_SMALL_RESULT", PARSER_UNKNOWN_TOKEN },
+            { "START", TK_START },
+            { "STATUS", PARSER_UNKNOWN_TOKEN },
+            { "STRAIGHT_JOIN", PARSER_UNKNOWN_TOKEN },
+            { "TABLE", PARSER_UNKNOWN_TOKEN },
+            { "TABLES", PARSER_UNKNOWN_TOKEN },
+            { "TEMP", PARSER_UNKNOWN_TOKEN },
+            { "TEMPORARY", PARSER_UNKNOWN_TOKEN },
+            { "TEMPTABLE", PARSER_UNKNOWN_TOKEN },
+            { "THEN", PARSER_UNKNOWN_TOKEN },
+            { "TO", PARSER_UNKNOWN_TOKEN },
+            { "TRANSACTION", TK_TRANSACTION },
+            { "TRIGGER", PARSER_UNKNOWN_TOKEN },
+            { "TRUE", TK_TRUE },
+            { "TRUNCATE", PARSER_UNKNOWN_TOKEN },
+            { "UNION", PARSER_UNKNOWN_TOKEN },
+            { "UNIQUE", PARSER_UNKNOWN_TOKEN },
+            { "UNLOCK", PARSER_UNKNOWN_TOKEN },
+            { "UNSIGNED", PARSER_UNKNOWN_TOKEN },
+            { "UPDATE", PARSER_UNKNOWN_TOKEN },
+            { "USE", TK_USE },
+            { "USING", PARSER_UNKNOWN_TOKEN },
+            { "VACUUM", PARSER_UNKNOWN_TOKEN },
+            { "VALUE", PARSER_UNKNOWN_TOKEN },
+            { "VALUES", PARSER_UNKNOWN_TOKEN },
+            { "VARIABLES", PARSER_UNKNOWN_TOKEN },
+            { "VIEW", PARSER_UNKNOWN_TOKEN },
+            { "VIRTUAL", PARSER_UNKNOWN_TOKEN },
+            { "WARNINGS", PARSER_UNKNOWN_TOKEN },
+            { "WHEN", PARSER_UNKNOWN_TOKEN },
+            { "WHERE", TK_WHERE },
+            { "WITH", TK_WITH },
+            { "WITHOUT", PARSER_UNKNOWN_TOKEN },
+            { "WORK", TK_WORK },
+            { "WRITE", TK_WRITE },
+            { "ZEROFILL", PARSER_UNKNOWN_TOKEN },
+        };
+
+        int lo = 0;
+        int hi = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]) - 1;
+
+        while (lo <= hi)
+        {
+            int mid = (lo + hi) / 2;
+            int diff = compare_token(KEYWORDS[mid].zWord);
+
+            if (diff == 0)
+            {
+                return KEYWORDS[mid].token;
+            }
+            else if (diff < 0)
+            {
+                hi = mid - 1;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+
+        return TK_IDENTIFIER;
+    }
+
+    /**
+     * Skip a quoted string or identifier, m_pI points at the opening quote.
+     *
+     * @return True, if the closing quote was found.
+     */
+    bool skip_quoted()
+    {
+        char quote = *m_pI++;
+
+        while (m_pI < m_pEnd)
+        {
+            char c = *m_pI++;
+
+            if (c == '\\' && quote != '`')
+            {
+                ++m_pI;
+            }
+            else if (c == quote)
+            {
+                if (m_pI < m_pEnd && *m_pI == quote)
+                {
+                    // A doubled quote does not end the string.
+                    ++m_pI;
+                }
+                else
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    token_t next_number()
+    {
+        if (*m_pI == '-')
+        {
+            ++m_pI;
+        }
+
+        while (m_pI < m_pEnd && isdigit((unsigned char)*m_pI))
+        {
+            ++m_pI;
+        }
+
+        if (m_pI < m_pEnd && *m_pI == '.')
+        {
+            ++m_pI;
+
+            while (m_pI < m_pEnd && isdigit((unsigned char)*m_pI))
+            {
+                ++m_pI;
+            }
+        }
+
+        // Exponents, hexadecimal numbers and identifiers beginning with digits
+        // are not recognized.
+        return (m_pI < m_pEnd && (is_word_char(*m_pI) || *m_pI == '.')) ? PARSER_UNKNOWN_TOKEN : TK_NUMBER;
+    }
+
+    token_t next_token()
+    {
+        token_t token = PARSER_UNKNOWN_TOKEN;
+
+        m_pI = modutil_MySQL_bypass_whitespace(const_cast<char*>(m_pI), m_pEnd - m_pI);
+        m_pToken = m_pI;
+
+        if (m_pI == m_pEnd)
+        {
+            token = PARSER_EXHAUSTED;
+        }
+        else if (*m_pI == ';')
+        {
+            ++m_pI;
+            m_pI = modutil_MySQL_bypass_whitespace(const_cast<char*>(m_pI), m_pEnd - m_pI);
+
+            // Anything after the semicolon is another statement.
+            token = (m_pI == m_pEnd) ? PARSER_EXHAUSTED : PARSER_UNKNOWN_TOKEN;
+        }
+        else
+        {
+            char c = *m_pI;
+
+            if (isalpha((unsigned char)c) || c == '_')
+            {
+                while (m_pI < m_pEnd && is_word_char(*m_pI))
+                {
+                    ++m_pI;
+                }
+
+                m_token_len = m_pI - m_pToken;
+                token = keyword();
+            }
+            else if (isdigit((unsigned char)c) ||
+                     (c == '-' && m_pI + 1 < m_pEnd && isdigit((unsigned char)*(m_pI + 1))))
+            {
+                token = next_number();
+            }
+            else
+            {
+                switch (c)
+                {
+                case '`':
+                    if (skip_quoted())
+                    {
+                        token = TK_IDENTIFIER;
+                    }
+                    break;
+
+                case '\'':
+                    if (skip_quoted())
+                    {
+                        token = TK_STRING;
+                    }
+                    break;
+
+                case '@':
+                    if (m_pI + 2 < m_pEnd && *(m_pI + 1) == '@')
+                    {
+                        m_pI += 2;
+                        m_pToken = m_pI;
+
+                        while (m_pI < m_pEnd && is_word_char(*m_pI))
+                        {
+                            ++m_pI;
+                        }
+
+                        m_token_len = m_pI - m_pToken;
+
+                        if (token_is("AUTOCOMMIT", 10))
+                        {
+                            token = TK_AUTOCOMMIT;
+                        }
+                        else if (token_is("SESSION", 7))
+                        {
+                            token = TK_SESSION_VAR;
+                        }
+                        else if (token_is("GLOBAL", 6))
+                        {
+                            token = TK_GLOBAL_VAR;
+                        }
+                    }
+                    break;
+
+                case ',':
+                    ++m_pI;
+                    token = TK_COMMA;
+                    break;
+
+                case '.':
+                    ++m_pI;
+                    token = TK_DOT;
+                    break;
+
+                case '*':
+                    ++m_pI;
+                    token = TK_STAR;
+                    break;
+
+                case '?':
+                    ++m_pI;
+                    token = TK_PLACEHOLDER;
+                    break;
+
+                case '=':
+                    ++m_pI;
+                    token = TK_EQ;
+                    break;
+
+                case '<':
+                    ++m_pI;
+                    if (m_pI < m_pEnd && (*m_pI == '=' || *m_pI == '>'))
+                    {
+                        ++m_pI;
+                    }
+                    token = TK_COMPARISON;
+                    break;
+
+                case '>':
+                    ++m_pI;
+                    if (m_pI < m_pEnd && *m_pI == '=')
+                    {
+                        ++m_pI;
+                    }
+                    token = TK_COMPARISON;
+                    break;
+
+                case '!':
+                    if (m_pI + 1 < m_pEnd && *(m_pI + 1) == '=')
+                    {
+                        m_pI += 2;
+                        token = TK_COMPARISON;
+                    }
+                    break;
+
+                default:
+                    ;
+                }
+            }
+
+            m_token_len = m_pI - m_pToken;
+        }
+
+        return token;
+    }
+
+private:
+    PreClassifier(const PreClassifier&);
+    PreClassifier& operator = (const PreClassifier&);
+
+private:
+    const char*   m_pI;
+    const char*   m_pEnd;
+    const char*   m_pToken;
+    size_t        m_token_len;
+    uint32_t      m_type_mask;
+    qc_query_op_t m_op;
+    bool          m_has_clause;
+};
+
+}
@@ -36,4 +36,26 @@ typedef enum qc_trx_parse_using
  */
 uint32_t qc_get_trx_type_mask_using(GWBUF* stmt, qc_trx_parse_using_t use);
 
+/**
+ * Set the maximum number of statements in the classification cache.
+ *
+ * If the cache holds more statements than the new maximum, the least
+ * recently used ones are removed as new statements are added.
+ *
+ * @param max_size  Maximum number of cached statements, 0 disables the cache.
+ */
+void qc_set_cache_size(int64_t max_size);
+
+/**
+ * Enable or disable the pre-classifier.
+ *
+ * When enabled, simple statements such as BEGIN, USE db or
+ * SELECT a FROM t WHERE id = 1 are classified without the plugin when only
+ * their type mask, operation or clause information is needed. The
+ * pre-classifier is disabled by default.
+ *
+ * @param enabled  Whether the pre-classifier should be used.
+ */
+void qc_set_preclassifier_enabled(bool enabled);
+
 MXS_END_DECLS
@@ -25,7 +25,16 @@
  * @endverbatim
  */
 #include <maxscale/buffer.h>
+#include <ctype.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+/** AVX2 is used if the CPU supports it, the rest of the code only needs SSE2 */
+#define CANON_HAVE_AVX2 1
+#endif
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/alloc.h>
 #include <maxscale/poll.h>
@@ -512,28 +521,11 @@ GWBUF* modutil_get_next_MySQL_packet(GWBUF** p_readbuf)
     {
         CHK_GWBUF(readbuf);
 
-        size_t totalbuflen = gwbuf_length(readbuf);
-        if (totalbuflen >= MYSQL_HEADER_LEN)
-        {
-            size_t packetlen;
-
-            if (GWBUF_LENGTH(readbuf) >= 3) // The length is in the 3 first bytes.
-            {
-                uint8_t *data = (uint8_t *)GWBUF_DATA((readbuf));
-                packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
-            }
-            else
-            {
-                // The header is split between two GWBUFs.
-                uint8_t data[3];
-                gwbuf_copy_data(readbuf, 0, 3, data);
-                packetlen = MYSQL_GET_PAYLOAD_LEN(data) + 4;
-            }
+        MODUTIL_PACKET next;
 
-            if (packetlen <= totalbuflen)
-            {
-                packet = gwbuf_split(p_readbuf, packetlen);
-            }
+        if (modutil_index_packets(readbuf, &next, 1, NULL) == 1)
+        {
+            packet = gwbuf_split(p_readbuf, next.len);
         }
     }
 
@@ -541,58 +533,144 @@ GWBUF* modutil_get_next_MySQL_packet(GWBUF** p_readbuf)
 }
 
 /**
- * @brief Calculate the length of the complete MySQL packets in the buffer
+ * Copy bytes from a position in a chain of buffers
  *
- * @param buffer Buffer to inspect
- * @return Length of the complete MySQL packets in bytes
+ * @param buffer  The buffer where the position is
+ * @param pos     Position in @c buffer
+ * @param dest    Where the bytes are copied
+ * @param n       How many bytes to copy
+ *
+ * @return How many bytes were copied, less than @c n if the chain ended
  */
-static size_t get_complete_packets_length(GWBUF *buffer)
+static size_t copy_from_chain(const GWBUF* buffer, size_t pos, uint8_t* dest, size_t n)
+{
+    size_t copied = 0;
+
+    while (buffer && copied < n)
+    {
+        size_t available = GWBUF_LENGTH(buffer) - pos;
+        size_t bytes = available < n - copied ? available : n - copied;
+
+        memcpy(dest + copied, (uint8_t*)GWBUF_DATA(buffer) + pos, bytes);
+        copied += bytes;
+        buffer = buffer->next;
+        pos = 0;
+    }
+
+    return copied;
+}
+
+size_t modutil_index_packets(const GWBUF* buffer, MODUTIL_PACKET* packets,
+                             size_t n_max, size_t* n_bytes)
 {
-    uint8_t packet_len[3];
-    uint32_t buflen = GWBUF_LENGTH(buffer);
+    size_t n = 0;
     size_t offset = 0;
-    size_t total = 0;
+    size_t pos = 0;
 
-    while (buffer && gwbuf_copy_data(buffer, offset, 3, packet_len) == 3)
+    while (buffer && n < n_max)
     {
-        uint32_t len = gw_mysql_get_byte3(packet_len) + MYSQL_HEADER_LEN;
+        const uint8_t* data = (const uint8_t*)GWBUF_DATA(buffer);
+        size_t buflen = GWBUF_LENGTH(buffer);
 
-        if (len < buflen)
+        /** The packets that are completely within this buffer */
+        while (n < n_max && pos + MYSQL_HEADER_LEN <= buflen)
         {
+            uint32_t len = MYSQL_GET_PAYLOAD_LEN(data + pos) + MYSQL_HEADER_LEN;
+
+            if (pos + len > buflen)
+            {
+                break;
+            }
+
+            if (packets)
+            {
+                packets[n].offset = offset;
+                packets[n].len = len;
+                packets[n].cmd = len > MYSQL_HEADER_LEN ? data[pos + MYSQL_HEADER_LEN] : 0;
+            }
+
+            ++n;
+            pos += len;
             offset += len;
-            total += len;
-            buflen -= len;
         }
-        /** The packet is spread across multiple buffers or a buffer ends with
-         * a complete packet. */
-        else
+
+        if (n == n_max)
         {
-            uint32_t read_len = len;
+            break;
+        }
 
-            while (read_len >= buflen && buffer)
-            {
-                read_len -= buflen;
-                buffer = buffer->next;
-                buflen = buffer ? GWBUF_LENGTH(buffer) : 0;
-            }
+        if (pos == buflen)
+        {
+            buffer = buffer->next;
+            pos = 0;
+            continue;
+        }
+
+        /** The packet continues in the next buffers */
+        uint8_t header[MYSQL_HEADER_LEN + 1];
+        size_t header_len = copy_from_chain(buffer, pos, header, sizeof(header));
+
+        if (header_len < MYSQL_HEADER_LEN)
+        {
+            break;
+        }
+
+        uint32_t len = MYSQL_GET_PAYLOAD_LEN(header) + MYSQL_HEADER_LEN;
+        size_t left = len;
 
-            /** Either the buffer ended with a complete packet or the buffer
-             * contains more data than is required. */
-            if (read_len == 0 || (buffer && read_len < buflen))
+        while (buffer && left > 0)
+        {
+            size_t available = GWBUF_LENGTH(buffer) - pos;
+
+            if (left < available)
             {
-                total += len;
-                offset = read_len;
-                buflen -= read_len;
+                pos += left;
+                left = 0;
             }
-            /** The buffer chain contains at least one incomplete packet */
             else
             {
-                ss_dassert(!buffer);
-                break;
+                left -= available;
+                buffer = buffer->next;
+                pos = 0;
             }
         }
+
+        if (left > 0)
+        {
+            /** The chain ends with an incomplete packet */
+            break;
+        }
+
+        if (packets)
+        {
+            packets[n].offset = offset;
+            packets[n].len = len;
+            packets[n].cmd = len > MYSQL_HEADER_LEN ? header[MYSQL_HEADER_LEN] : 0;
+        }
+
+        ++n;
+        offset += len;
     }
 
+    if (n_bytes)
+    {
+        *n_bytes = offset;
+    }
+
+    return n;
+}
+
+/**
+ * @brief Calculate the length of the complete MySQL packets in the buffer
+ *
+ * @param buffer Buffer to inspect
+ * @return Length of the complete MySQL packets in bytes
+ */
+static size_t get_complete_packets_length(GWBUF *buffer)
+{
+    size_t total;
+    modutil_index_packets(buffer, NULL, SIZE_MAX, &total);
+
     return total;
 }
 
@@ -713,6 +791,279 @@ modutil_count_signal_packets(GWBUF *reply, int use_ok,  int n_found, int* more)
     return (eof + err);
 }
 
+/** The OK packet carries session state change information */
+#define MODUTIL_SERVER_SESSION_STATE_CHANGED 0x4000
+/** Session state change type of a tracked system variable */
+#define MODUTIL_SESSION_TRACK_SYSTEM_VARIABLES 0
+
+/**
+ * Read a length-encoded integer that must end before @c end
+ *
+ * @param ptr   Pointer to the integer, moved past it on success
+ * @param end   End of the packet
+ * @param value Where the value is stored
+ *
+ * @return True if the integer was read
+ */
+static bool read_lenenc(const uint8_t** ptr, const uint8_t* end, uint64_t* value)
+{
+    const uint8_t* p = *ptr;
+    size_t bytes;
+
+    if (p >= end)
+    {
+        return false;
+    }
+
+    switch (*p)
+    {
+    case 0xfc:
+        bytes = 2;
+        break;
+
+    case 0xfd:
+        bytes = 3;
+        break;
+
+    case 0xfe:
+        bytes = 8;
+        break;
+
+    case 0xfb:
+    case 0xff:
+        /** NULL and ERR markers are not valid here */
+        return false;
+
+    default:
+        *value = *p;
+        *ptr = p + 1;
+        return true;
+    }
+
+    if ((size_t)(end - p) < bytes + 1)
+    {
+        return false;
+    }
+
+    *value = 0;
+
+    for (size_t i = bytes; i > 0; i--)
+    {
+        *value = (*value << 8) | p[i];
+    }
+
+    *ptr = p + bytes + 1;
+    return true;
+}
+
+/**
+ * Read a length-encoded string that must end before @c end
+ *
+ * @param ptr  Pointer to the string, moved past it on success
+ * @param end  End of the packet
+ * @param str  Where the start of the string is stored
+ * @param len  Where the length of the string is stored
+ *
+ * @return True if the string was read
+ */
+static bool read_lenenc_str(const uint8_t** ptr, const uint8_t* end,
+                            const uint8_t** str, uint64_t* len)
+{
+    const uint8_t* p = *ptr;
+
+    if (!read_lenenc(&p, end, len) || *len > (uint64_t)(end - p))
+    {
+        return false;
+    }
+
+    *str = p;
+    *ptr = p + *len;
+    return true;
+}
+
+/**
+ * Find the session state changes of an OK packet
+ *
+ * @param packet      Start of a complete MySQL packet
+ * @param changes     Where the start of the state changes is stored
+ * @param changes_end Where the end of the state changes is stored
+ *
+ * @return True if @c packet is an OK packet with session state changes
+ */
+static bool get_state_changes(const uint8_t* packet, const uint8_t** changes,
+                              const uint8_t** changes_end)
+{
+    const uint8_t* end = packet + MYSQL_HEADER_LEN + MYSQL_GET_PAYLOAD_LEN(packet);
+    const uint8_t* ptr = packet + MYSQL_HEADER_LEN;
+    uint64_t affected_rows;
+    uint64_t insert_id;
+    uint64_t len;
+    const uint8_t* str;
+
+    if (ptr >= end || *ptr++ != MYSQL_REPLY_OK ||
+        !read_lenenc(&ptr, end, &affected_rows) ||
+        !read_lenenc(&ptr, end, &insert_id) ||
+        end - ptr < 4)
+    {
+        return false;
+    }
+
+    uint16_t status = gw_mysql_get_byte2(ptr);
+    ptr += 4; // Status and warnings
+
+    if ((status & MODUTIL_SERVER_SESSION_STATE_CHANGED) == 0 ||
+        !read_lenenc_str(&ptr, end, &str, &len) || // The info string
+        !read_lenenc_str(&ptr, end, &str, &len))   // All of the state changes
+    {
+        return false;
+    }
+
+    *changes = str;
+    *changes_end = str + len;
+    return true;
+}
+
+/**
+ * Read the next tracked system variable from session state changes
+ *
+ * @param ptr       Pointer to the next state change, moved past the variable
+ * @param end       End of the state changes
+ * @param var       Where the name of the variable is stored
+ * @param var_len   Where the length of the name is stored
+ * @param value     Where the value of the variable is stored
+ * @param value_len Where the length of the value is stored
+ *
+ * @return True if a variable was read, false when there are no more
+ */
+static bool next_tracked_variable(const uint8_t** ptr, const uint8_t* end,
+                                  const uint8_t** var, uint64_t* var_len,
+                                  const uint8_t** value, uint64_t* value_len)
+{
+    while (*ptr < end)
+    {
+        uint8_t type = *(*ptr)++;
+        const uint8_t* str;
+        uint64_t len;
+
+        if (!read_lenenc_str(ptr, end, &str, &len))
+        {
+            break;
+        }
+
+        if (type == MODUTIL_SESSION_TRACK_SYSTEM_VARIABLES)
+        {
+            const uint8_t* change = str;
+            const uint8_t* change_end = str + len;
+
+            if (read_lenenc_str(&change, change_end, var, var_len) &&
+                read_lenenc_str(&change, change_end, value, value_len))
+            {
+                return true;
+            }
+        }
+    }
+
+    *ptr = end;
+    return false;
+}
+
+bool modutil_get_tracked_variable(const uint8_t* packet, const char* name,
+                                  char* dest, size_t size)
+{
+    const uint8_t* ptr;
+    const uint8_t* end;
+    const uint8_t* var;
+    const uint8_t* value;
+    uint64_t var_len;
+    uint64_t value_len;
+    size_t name_len = strlen(name);
+    bool found = false;
+
+    if (get_state_changes(packet, &ptr, &end))
+    {
+        while (next_tracked_variable(&ptr, end, &var, &var_len, &value, &value_len))
+        {
+            if (var_len == name_len && strncasecmp((const char*)var, name, name_len) == 0 &&
+                value_len < size)
+            {
+                /** The last change of the variable is the current value */
+                memcpy(dest, value, value_len);
+                dest[value_len] = '\0';
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+int modutil_add_tracked_variables(GWBUF* buf, const uint8_t* packet)
+{
+    const uint8_t* ptr;
+    const uint8_t* end;
+    const uint8_t* var;
+    const uint8_t* value;
+    uint64_t var_len;
+    uint64_t value_len;
+    int n = 0;
+
+    if (get_state_changes(packet, &ptr, &end))
+    {
+        while (next_tracked_variable(&ptr, end, &var, &var_len, &value, &value_len))
+        {
+            char* name = MXS_STRNDUP((const char*)var, var_len);
+            char* val = MXS_STRNDUP((const char*)value, value_len);
+
+            /** Later properties hide earlier ones so the last change wins */
+            if (name && val && gwbuf_add_property(buf, name, val))
+            {
+                n++;
+            }
+
+            MXS_FREE(name);
+            MXS_FREE(val);
+        }
+    }
+
+    return n;
+}
+
+size_t modutil_strip_session_track(uint8_t* packet)
+{
+    const uint8_t* end = packet + MYSQL_HEADER_LEN + MYSQL_GET_PAYLOAD_LEN(packet);
+    const uint8_t* ptr = packet + MYSQL_HEADER_LEN;
+    size_t orig_len = end - packet;
+    uint64_t affected_rows;
+    uint64_t insert_id;
+    uint64_t info_len;
+    const uint8_t* info;
+
+    if (ptr >= end || *ptr++ != MYSQL_REPLY_OK ||
+        !read_lenenc(&ptr, end, &affected_rows) ||
+        !read_lenenc(&ptr, end, &insert_id) ||
+        end - ptr < 4)
+    {
+        return orig_len;
+    }
+
+    uint8_t* status = packet + (ptr - packet);
+    ptr += 4; // Status and warnings
+
+    /** Without an info string both formats are the same */
+    if (ptr == end || !read_lenenc_str(&ptr, end, &info, &info_len))
+    {
+        return orig_len;
+    }
+
+    uint8_t* info_start = status + 4;
+    memmove(info_start, info, info_len);
+    gw_mysql_set_byte2(status, gw_mysql_get_byte2(status) & ~MODUTIL_SERVER_SESSION_STATE_CHANGED);
+
+    size_t len = (info_start + info_len) - packet;
+    gw_mysql_set_byte3(packet, len - MYSQL_HEADER_LEN);
+    return len;
+}
+
 /**
  * Create parse error and EPOLLIN event to event queue of the backend DCB.
  * When event is notified the error message is processed as error reply and routed
@@ -986,108 +1337,249 @@ bool is_mysql_sp_end(const char* start, int len)
 }
 
 /**
- * Create a COM_QUERY packet from a string.
- * @param query Query to create.
- * @return Pointer to GWBUF with the query or NULL if memory allocation failed
+ * Check if a hyphen starts a comment that extends to the end of the line
  */
-GWBUF* modutil_create_query(const char* query)
+static inline bool is_line_comment(const char* ptr, const char* end)
 {
-    ss_dassert(query);
-    size_t len = strlen(query) + 1; // Query plus the command byte
-    GWBUF* rval = gwbuf_alloc(len + MYSQL_HEADER_LEN);
-
-    if (rval)
-    {
-        uint8_t *ptr = (uint8_t*)rval->start;
-        *ptr++ = (len);
-        *ptr++ = (len) >> 8;
-        *ptr++ = (len) >> 16;
-        *ptr++ = 0x0;
-        *ptr++ = 0x03;
-        memcpy(ptr, query, strlen(query));
-        gwbuf_set_type(rval, GWBUF_TYPE_MYSQL);
-    }
+    return ptr + 1 < end && *(ptr + 1) == '-' &&
+           (ptr + 2 == end || isspace((unsigned char)*(ptr + 2)));
+}
 
-    return rval;
+/**
+ * Check if a comment contains SQL that the server executes
+ */
+static inline bool is_executable_comment(const char* ptr, const char* end)
+{
+    return (ptr + 2 < end && *(ptr + 2) == '!') ||
+           (ptr + 3 < end && *(ptr + 2) == 'M' && *(ptr + 3) == '!');
 }
 
 /**
- * Count the number of statements in a query.
- * @param buffer Buffer to analyze.
- * @return Number of statements.
+ * Skip the comment at @c ptr
+ * @return Pointer to the first character after the comment
  */
-int modutil_count_statements(GWBUF* buffer)
+static const char* skip_comment(const char* ptr, const char* end)
 {
-    char* start = ((char*)(buffer)->start + 5);
-    char* ptr = start;
-    char* end = ((char*)(buffer)->end);
-    int num = 1;
+    if (*ptr == '/')
+    {
+        ptr += 2;
+
+        while (ptr < end && !(*ptr == '*' && ptr + 1 < end && *(ptr + 1) == '/'))
+        {
+            ptr++;
+        }
 
-    while (ptr < end && (ptr = strnchr_esc(ptr, ';', end - ptr)))
+        ptr = ptr < end ? ptr + 2 : end;
+    }
+    else
     {
-        num++;
-        while (ptr < end && *ptr == ';')
+        while (ptr < end && *ptr != '\n')
         {
             ptr++;
         }
     }
 
-    ptr = end - 1;
+    return ptr;
+}
 
-    if (ptr >= start && ptr < end)
+/**
+ * Skip whitespace, non-executable comments and delimiters between statements
+ */
+static const char* skip_statement_separators(const char* ptr, const char* end)
+{
+    while (ptr < end)
     {
-        while (ptr > start && isspace(*ptr))
+        if (isspace((unsigned char)*ptr) || *ptr == ';')
         {
-            ptr--;
+            ptr++;
         }
-
-        if (*ptr == ';')
+        else if (*ptr == '#' || (*ptr == '-' && is_line_comment(ptr, end)) ||
+                 (*ptr == '/' && ptr + 1 < end && *(ptr + 1) == '*' &&
+                  !is_executable_comment(ptr, end)))
+        {
+            ptr = skip_comment(ptr, end);
+        }
+        else
         {
-            num--;
+            break;
         }
     }
 
-    return num;
+    return ptr;
 }
 
 /**
- * Initialize the PCRE2 patterns used when converting MySQL wildcards to PCRE syntax.
+ * Find the delimiter that ends the statement that starts at @c ptr
+ * @return Pointer to the delimiter or @c end if the statement is the last one
  */
-void prepare_pcre2_patterns()
+static const char* find_statement_end(const char* ptr, const char* end)
 {
-    spinlock_acquire(&re_lock);
-    if (!pattern_init)
+    char quote = 0;
+
+    while (ptr < end)
     {
-        int err;
-        size_t erroff;
-        PCRE2_UCHAR errbuf[MXS_STRERROR_BUFLEN];
+        char c = *ptr;
 
-        if ((re_percent = pcre2_compile(pattern_percent, PCRE2_ZERO_TERMINATED,
-                                        0, &err, &erroff, NULL)) &&
-            (re_single = pcre2_compile(pattern_single, PCRE2_ZERO_TERMINATED,
-                                       0, &err, &erroff, NULL)) &&
-            (re_escape = pcre2_compile(pattern_escape, PCRE2_ZERO_TERMINATED,
-                                       0, &err, &erroff, NULL)))
+        if (quote)
         {
-            assert(!pattern_init);
-            pattern_init = true;
+            if (c == '\\' && quote != '`')
+            {
+                ptr++;
+            }
+            else if (c == quote)
+            {
+                quote = 0;
+            }
         }
-        else
+        else if (c == '\'' || c == '"' || c == '`')
         {
-            pcre2_get_error_message(err, errbuf, sizeof(errbuf));
-            MXS_ERROR("Failed to compile PCRE2 pattern: %s", errbuf);
+            quote = c;
         }
-
-        if (!pattern_init)
+        else if (c == '/' && ptr + 1 < end && *(ptr + 1) == '*' && is_executable_comment(ptr, end))
         {
-            pcre2_code_free(re_percent);
-            pcre2_code_free(re_single);
-            pcre2_code_free(re_escape);
-            re_percent = NULL;
-            re_single = NULL;
-            re_escape = NULL;
+            /** The server executes the contents of the comment, so a delimiter
+             * inside it ends the statement */
+            ptr += 2;
+            continue;
         }
-    }
+        else if (c == '#' || (c == '-' && is_line_comment(ptr, end)) ||
+                 (c == '/' && ptr + 1 < end && *(ptr + 1) == '*'))
+        {
+            ptr = skip_comment(ptr, end);
+            continue;
+        }
+        else if (c == ';' && !is_mysql_sp_end(ptr, end - ptr))
+        {
+            return ptr;
+        }
+
+        ptr++;
+    }
+
+    return end;
+}
+
+const char* modutil_get_next_statement(const char* sql, const char* end, int* len)
+{
+    const char* start = skip_statement_separators(sql, end);
+
+    if (start == end)
+    {
+        return NULL;
+    }
+
+    const char* stmt_end = find_statement_end(start, end);
+
+    while (stmt_end > start && isspace((unsigned char)*(stmt_end - 1)))
+    {
+        stmt_end--;
+    }
+
+    *len = stmt_end - start;
+    return start;
+}
+
+/**
+ * Create a COM_QUERY packet from a string.
+ * @param query Query to create.
+ * @return Pointer to GWBUF with the query or NULL if memory allocation failed
+ */
+GWBUF* modutil_create_query(const char* query)
+{
+    ss_dassert(query);
+    return modutil_create_query_len(query, strlen(query));
+}
+
+/**
+ * Create a COM_QUERY packet from a string that is not null-terminated.
+ * @param query Query to create.
+ * @param len Length of the query
+ * @return Pointer to GWBUF with the query or NULL if memory allocation failed
+ */
+GWBUF* modutil_create_query_len(const char* query, size_t len)
+{
+    ss_dassert(query && len + 1 < GW_MYSQL_MAX_PACKET_LEN);
+    size_t payload = len + 1; // Query plus the command byte
+    GWBUF* rval = gwbuf_alloc(payload + MYSQL_HEADER_LEN);
+
+    if (rval)
+    {
+        uint8_t *ptr = (uint8_t*)rval->start;
+        *ptr++ = (payload);
+        *ptr++ = (payload) >> 8;
+        *ptr++ = (payload) >> 16;
+        *ptr++ = 0x0;
+        *ptr++ = 0x03;
+        memcpy(ptr, query, len);
+        gwbuf_set_type(rval, GWBUF_TYPE_MYSQL);
+    }
+
+    return rval;
+}
+
+/**
+ * Count the number of statements in a query.
+ *
+ * A query that contains only whitespace, comments or delimiters is counted
+ * as one statement.
+ *
+ * @param buffer Buffer to analyze.
+ * @return Number of statements, at least one.
+ */
+int modutil_count_statements(GWBUF* buffer)
+{
+    const char* ptr = ((char*)(buffer)->start + 5);
+    const char* end = ((char*)(buffer)->end);
+    int num = 0;
+    int len;
+
+    while ((ptr = modutil_get_next_statement(ptr, end, &len)))
+    {
+        num++;
+        ptr += len;
+    }
+
+    return num > 0 ? num : 1;
+}
+
+/**
+ * Initialize the PCRE2 patterns used when converting MySQL wildcards to PCRE syntax.
+ */
+void prepare_pcre2_patterns()
+{
+    spinlock_acquire(&re_lock);
+    if (!pattern_init)
+    {
+        int err;
+        size_t erroff;
+        PCRE2_UCHAR errbuf[MXS_STRERROR_BUFLEN];
+
+        if ((re_percent = pcre2_compile(pattern_percent, PCRE2_ZERO_TERMINATED,
+                                        0, &err, &erroff, NULL)) &&
+            (re_single = pcre2_compile(pattern_single, PCRE2_ZERO_TERMINATED,
+                                       0, &err, &erroff, NULL)) &&
+            (re_escape = pcre2_compile(pattern_escape, PCRE2_ZERO_TERMINATED,
+                                       0, &err, &erroff, NULL)))
+        {
+            assert(!pattern_init);
+            pattern_init = true;
+        }
+        else
+        {
+            pcre2_get_error_message(err, errbuf, sizeof(errbuf));
+            MXS_ERROR("Failed to compile PCRE2 pattern: %s", errbuf);
+        }
+
+        if (!pattern_init)
+        {
+            pcre2_code_free(re_percent);
+            pcre2_code_free(re_single);
+            pcre2_code_free(re_escape);
+            re_percent = NULL;
+            re_single = NULL;
+            re_escape = NULL;
+        }
+    }
     spinlock_release(&re_lock);
 }
 
@@ -1167,56 +1659,686 @@ mxs_pcre2_result_t modutil_mysql_wildcard_match(const char* pattern, const char*
     return rval;
 }
 
-/*
- * Replace user-provided literals with question marks.
+/**
+ * The canonicalizer
  *
- * TODO: Make the canonicalization allocate only one buffer of memory
+ * The canonical form is created in one pass with the following steps, which
+ * are applied as if each one was done on the whole output of the previous one:
  *
- * @param querybuf GWBUF with a COM_QUERY statement
- * @return A copy of the query in its canonical form or NULL if an error occurred.
+ * 1. The contents of single and double quoted strings are replaced with a
+ *    question mark. A quote preceded by a backslash does not end a string.
+ * 2. Comments are removed, except executable comments and the contents of
+ *    backtick quoted identifiers. Block comments must end on the same line.
+ * 3. Numbers, and the names of variables, that are preceded by an operator,
+ *    whitespace or a word boundary and followed by an operator, whitespace
+ *    or the end of the statement are replaced with a question mark.
+ * 4. Whitespace is squeezed into single spaces and trimmed from both ends.
+ *
+ * The cursor reads the output of the first two steps. Lookahead, needed for
+ * example to find out whether a comment ends, is done with a copy of the
+ * cursor. Runs of word characters cannot start a replaced value and are
+ * copied with SIMD instructions when they are available.
  */
-char* modutil_get_canonical(GWBUF* querybuf)
+
+#define CANON_FNV_OFFSET UINT64_C(0xcbf29ce484222325)
+#define CANON_FNV_PRIME  UINT64_C(0x100000001b3)
+
+typedef enum
 {
-    char *querystr = NULL;
+    CANON_PLAIN,  /**< Reading the statement */
+    CANON_QMARK,  /**< The opening quote of a string was returned */
+    CANON_CLOSE   /**< The question mark of a string was returned */
+} canon_phase_t;
 
-    if (GWBUF_LENGTH(querybuf) > MYSQL_HEADER_LEN + 1 && GWBUF_IS_SQL(querybuf))
+typedef struct
+{
+    const char* sql;
+    size_t      len;
+    size_t      last_quote[2];  /**< One past the last single and double quote */
+    bool        no_backticks;   /**< No backticks left after the current position */
+} CANON_INPUT;
+
+typedef struct
+{
+    CANON_INPUT*  in;          /**< Shared by the copies of the cursor */
+    size_t        pos;         /**< Position of the next character */
+    size_t        close;       /**< The closing quote of the current string */
+    canon_phase_t phase;
+    bool          in_backtick; /**< Inside a backtick quoted identifier */
+} CANON_CURSOR;
+
+typedef struct
+{
+    char*    dest;
+    size_t   len;
+    bool     space;   /**< Whitespace was seen after the last character */
+    uint64_t digest;
+} CANON_OUTPUT;
+
+static inline bool canon_is_word(int c)
+{
+    return isalnum(c) || c == '_';
+}
+
+static inline bool canon_is_number(int c)
+{
+    return isdigit(c) || c == '.' || c == '-';
+}
+
+static inline bool canon_is_operator(int c)
+{
+    return (c > 0 && strchr("-=,+*/(", c)) || isspace(c);
+}
+
+static inline bool canon_is_terminator(int c)
+{
+    return (c > 0 && strchr("-=,+*/);", c)) || isspace(c);
+}
+
+/**
+ * Find the closing quote of a string
+ *
+ * The first quote that is not preceded by a backslash closes the string. If
+ * there is no such quote, the last escaped quote does.
+ */
+static bool canon_find_close(const CANON_INPUT* in, size_t open, size_t* close)
+{
+    char quote = in->sql[open];
+    size_t last = in->last_quote[quote == '"'];
+
+    if (last <= open + 1)
     {
-        size_t srcsize = GWBUF_LENGTH(querybuf) - MYSQL_HEADER_LEN - 1;
-        char *src = (char*)GWBUF_DATA(querybuf) + MYSQL_HEADER_LEN + 1;
-        size_t destsize = 0;
-        char *dest = NULL;
+        return false;
+    }
+
+    const char* p = in->sql + open + 1;
+    const char* end = in->sql + last;
+
+    while ((p = memchr(p, quote, end - p)) && p[-1] == '\\')
+    {
+        p++;
+    }
+
+    *close = p ? p - in->sql : last - 1;
+    return true;
+}
+
+/** Read the next character with the strings replaced */
+static int canon_next_unquoted(CANON_CURSOR* c)
+{
+    const CANON_INPUT* in = c->in;
+
+    switch (c->phase)
+    {
+    case CANON_QMARK:
+        c->phase = CANON_CLOSE;
+        return '?';
+
+    case CANON_CLOSE:
+        c->phase = CANON_PLAIN;
+        c->pos = c->close + 1;
+        return (unsigned char)in->sql[c->close];
+
+    default:
+        if (c->pos == in->len || in->sql[c->pos] == '\0')
+        {
+            return -1;
+        }
+        else
+        {
+            int ch = (unsigned char)in->sql[c->pos];
+
+            if ((ch == '\'' || ch == '"') && canon_find_close(in, c->pos, &c->close))
+            {
+                c->phase = CANON_QMARK;
+            }
+            else
+            {
+                c->pos++;
+            }
+
+            return ch;
+        }
+    }
+}
+
+/** Skip to the end of the line */
+static void canon_skip_line(CANON_CURSOR* c)
+{
+    CANON_CURSOR t = *c;
+    int ch;
+
+    while ((ch = canon_next_unquoted(&t)) != -1 && ch != '\n')
+    {
+        *c = t;
+    }
+}
+
+/** Skip a block comment that starts at the cursor, the slash has been read */
+static bool canon_skip_block_comment(CANON_CURSOR* c)
+{
+    CANON_CURSOR t = *c;
+
+    if (canon_next_unquoted(&t) != '*')
+    {
+        return false;
+    }
+
+    CANON_CURSOR e = t;
+    int ch = canon_next_unquoted(&e);
+
+    if (ch == '!' || (ch == 'M' && canon_next_unquoted(&e) == '!'))
+    {
+        /** An executable comment */
+        return false;
+    }
+
+    int prev = -1;
+
+    while ((ch = canon_next_unquoted(&t)) != -1 && ch != '\n')
+    {
+        if (prev == '*' && ch == '/')
+        {
+            *c = t;
+            return true;
+        }
+
+        prev = ch;
+    }
+
+    return false;
+}
+
+/** Check whether a backtick quoted identifier that starts at the cursor ends */
+static bool canon_backtick_ends(CANON_CURSOR* c)
+{
+    CANON_CURSOR t = *c;
+    int ch;
+
+    while ((ch = canon_next_unquoted(&t)) != -1)
+    {
+        if (ch == '`')
+        {
+            return true;
+        }
+    }
+
+    /** The remaining backticks are ordinary characters */
+    c->in->no_backticks = true;
+    return false;
+}
 
-        if (replace_quoted((const char**)&src, &srcsize, &dest, &destsize))
+/** Read the next character with the strings replaced and the comments removed */
+static int canon_next(CANON_CURSOR* c)
+{
+    while (true)
+    {
+        int ch = canon_next_unquoted(c);
+
+        if (c->in_backtick)
         {
-            /** Reset the buffers so that the old result is reused and a new
-             * result is created.*/
-            src = dest;
-            srcsize = destsize;
-            dest = NULL;
-            destsize = 0;
+            c->in_backtick = ch != '`' && ch != -1;
+            return ch;
+        }
 
-            if (remove_mysql_comments((const char**)&src, &srcsize, &dest, &destsize))
+        switch (ch)
+        {
+        case '`':
+            c->in_backtick = !c->in->no_backticks && canon_backtick_ends(c);
+            return ch;
+
+        case '/':
+            if (!canon_skip_block_comment(c))
             {
-                /** Both buffers now contain allocated memory so all we need
-                 * to do is to swap them */
-                if (replace_values((const char**)&dest, &destsize, &src, &srcsize))
+                return ch;
+            }
+            break;
+
+        case '#':
+            canon_skip_line(c);
+            break;
+
+        case '-':
+            {
+                CANON_CURSOR t = *c;
+
+                if (canon_next_unquoted(&t) == '-' && isspace(canon_next_unquoted(&t)))
                 {
-                    querystr = squeeze_whitespace(src);
-                    MXS_FREE(dest);
+                    *c = t;
+                    canon_skip_line(c);
                 }
                 else
                 {
-                    MXS_FREE(src);
-                    MXS_FREE(dest);
+                    return ch;
                 }
             }
-            else
+            break;
+
+        default:
+            return ch;
+        }
+    }
+}
+
+static inline void canon_put(CANON_OUTPUT* out, int c)
+{
+    if (isspace(c))
+    {
+        out->space = out->len > 0;
+    }
+    else
+    {
+        if (out->space)
+        {
+            out->space = false;
+            out->dest[out->len++] = ' ';
+            out->digest = (out->digest ^ ' ') * CANON_FNV_PRIME;
+        }
+
+        out->dest[out->len++] = c;
+        out->digest = (out->digest ^ (unsigned char)c) * CANON_FNV_PRIME;
+    }
+}
+
+/**
+ * Match a value that starts at the cursor
+ *
+ * @param v      Cursor at the start of the value
+ * @param before The character before the value
+ * @param end    On success, cursor after the value and the terminator
+ * @param term   On success, the terminator or -1 at the end of the statement
+ *
+ * @return True if a value was matched
+ */
+static bool canon_match_value(CANON_CURSOR v, int before, CANON_CURSOR* end, int* term)
+{
+    CANON_CURSOR c = v;
+    CANON_CURSOR t = v;
+    CANON_CURSOR after_dash;
+    bool dash = false;
+    int n = 0;
+    int ch;
+
+    /** A number, the longest one that is followed by a terminator */
+    while (canon_is_number(ch = canon_next(&t)))
+    {
+        if (ch == '-' && n > 0)
+        {
+            after_dash = t;
+            dash = true;
+        }
+
+        c = t;
+        n++;
+    }
+
+    if (n > 0)
+    {
+        if (ch == -1 || canon_is_terminator(ch))
+        {
+            *end = ch == -1 ? c : t;
+            *term = ch;
+            return true;
+        }
+        else if (dash)
+        {
+            *end = after_dash;
+            *term = '-';
+            return true;
+        }
+    }
+
+    if (before == '@')
+    {
+        /** The name of a variable */
+        c = t = v;
+        n = 0;
+
+        while (canon_is_word(ch = canon_next(&t)))
+        {
+            c = t;
+            n++;
+        }
+
+        if (n > 0 && (ch == -1 || canon_is_terminator(ch)))
+        {
+            *end = ch == -1 ? c : t;
+            *term = ch;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Try to replace a value at the cursor
+ *
+ * @param c    Cursor at the current character, moved past the replaced value
+ * @param next Cursor after the current character
+ * @param ch   The current character
+ * @param prev The previous character, updated on success
+ * @param out  The output
+ *
+ * @return True if a value was replaced
+ */
+static bool canon_replace_value(CANON_CURSOR* c, const CANON_CURSOR* next, int ch,
+                                int* prev, CANON_OUTPUT* out)
+{
+    CANON_CURSOR end;
+    int term;
+
+    if (canon_is_operator(ch) && canon_match_value(*next, ch, &end, &term))
+    {
+        canon_put(out, ch);
+    }
+    else if (canon_is_word(*prev) != canon_is_word(ch) && canon_match_value(*c, *prev, &end, &term))
+    {
+        /** The value starts at a word boundary */
+    }
+    else if (ch == '@' && canon_match_value(*next, ch, &end, &term))
+    {
+        canon_put(out, ch);
+    }
+    else
+    {
+        return false;
+    }
+
+    canon_put(out, '?');
+
+    if (term != -1)
+    {
+        canon_put(out, term);
+    }
+
+    *c = end;
+    *prev = term;
+    return true;
+}
+
+/**
+ * Get the length of a run of word characters
+ */
+static size_t canon_word_run_scalar(const char* s, size_t len)
+{
+    size_t n = 0;
+
+    while (n < len && canon_is_word((unsigned char)s[n]))
+    {
+        n++;
+    }
+
+    return n;
+}
+
+#if defined(__SSE2__)
+static size_t canon_word_run_sse2(const char* s, size_t len)
+{
+    const __m128i flip = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a' - 1);
+    const __m128i z = _mm_set1_epi8('z' + 1);
+    const __m128i zero = _mm_set1_epi8('0' - 1);
+    const __m128i nine = _mm_set1_epi8('9' + 1);
+    const __m128i underscore = _mm_set1_epi8('_');
+    size_t n = 0;
+
+    for (; n + 16 <= len; n += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + n));
+        __m128i lower = _mm_or_si128(v, flip);
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, a), _mm_cmplt_epi8(lower, z));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, zero), _mm_cmplt_epi8(v, nine));
+        __m128i word = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(v, underscore));
+        unsigned mask = ~_mm_movemask_epi8(word) & 0xffff;
+
+        if (mask)
+        {
+            return n + __builtin_ctz(mask);
+        }
+    }
+
+    return n + canon_word_run_scalar(s + n, len - n);
+}
+#endif
+
+#if defined(CANON_HAVE_AVX2)
+__attribute__((target("avx2")))
+static size_t canon_word_run_avx2(const char* s, size_t len)
+{
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    const __m256i a = _mm256_set1_epi8('a' - 1);
+    const __m256i z = _mm256_set1_epi8('z' + 1);
+    const __m256i zero = _mm256_set1_epi8('0' - 1);
+    const __m256i nine = _mm256_set1_epi8('9' + 1);
+    const __m256i underscore = _mm256_set1_epi8('_');
+    size_t n = 0;
+
+    for (; n + 32 <= len; n += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + n));
+        __m256i lower = _mm256_or_si256(v, flip);
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, a), _mm256_cmpgt_epi8(z, lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, zero), _mm256_cmpgt_epi8(nine, v));
+        __m256i word = _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(v, underscore));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(word);
+
+        if (mask)
+        {
+            return n + __builtin_ctz(mask);
+        }
+    }
+
+    return n + canon_word_run_sse2(s + n, len - n);
+}
+#endif
+
+static size_t canon_word_run(const char* s, size_t len)
+{
+#if defined(CANON_HAVE_AVX2)
+    static int avx2 = -1;
+
+    if (avx2 == -1)
+    {
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+
+    if (avx2)
+    {
+        return canon_word_run_avx2(s, len);
+    }
+#endif
+#if defined(__SSE2__)
+    return canon_word_run_sse2(s, len);
+#else
+    return canon_word_run_scalar(s, len);
+#endif
+}
+
+size_t modutil_canonicalize(const char* sql, size_t len, char* dest, uint64_t* digest)
+{
+    CANON_INPUT in = {sql, len, {0, 0}, false};
+    CANON_CURSOR c = {&in, 0, 0, CANON_PLAIN, false};
+    CANON_OUTPUT out = {dest, 0, false, CANON_FNV_OFFSET};
+    const char* p;
+    int prev = -1;
+
+    if ((p = memrchr(sql, '\'', len)))
+    {
+        in.last_quote[0] = p - sql + 1;
+    }
+
+    if ((p = memrchr(sql, '"', len)))
+    {
+        in.last_quote[1] = p - sql + 1;
+    }
+
+    while (true)
+    {
+        if (c.phase == CANON_PLAIN && canon_is_word(prev))
+        {
+            /** A word character cannot start a value unless it follows a
+             * non-word character, the rest of the word can be copied */
+            size_t n = canon_word_run(sql + c.pos, len - c.pos);
+
+            if (n > 0)
+            {
+                if (out.space)
+                {
+                    out.space = false;
+                    out.dest[out.len++] = ' ';
+                    out.digest = (out.digest ^ ' ') * CANON_FNV_PRIME;
+                }
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    out.dest[out.len++] = sql[c.pos + i];
+                    out.digest = (out.digest ^ (unsigned char)sql[c.pos + i]) * CANON_FNV_PRIME;
+                }
+
+                c.pos += n;
+                prev = (unsigned char)sql[c.pos - 1];
+            }
+        }
+
+        CANON_CURSOR next = c;
+        int ch = canon_next(&next);
+
+        if (ch == -1)
+        {
+            break;
+        }
+        else if (!canon_replace_value(&c, &next, ch, &prev, &out))
+        {
+            canon_put(&out, ch);
+            prev = ch;
+            c = next;
+        }
+    }
+
+    out.dest[out.len] = '\0';
+
+    if (digest)
+    {
+        *digest = out.digest;
+    }
+
+    return out.len;
+}
+
+/** Statements whose canonical form fits in this many bytes are canonicalized on the stack */
+#define MODUTIL_DIGEST_STACK_SIZE 2048
+
+static void modutil_digest_free(void* data)
+{
+    MXS_FREE(data);
+}
+
+/**
+ * Get the SQL of a statement whose digest can be calculated
+ *
+ * @return True if @c buf is a complete COM_QUERY or COM_STMT_PREPARE
+ */
+static bool modutil_digest_sql(GWBUF* buf, const char** sql, size_t* len)
+{
+    if (GWBUF_LENGTH(buf) > MYSQL_HEADER_LEN)
+    {
+        uint8_t* data = GWBUF_DATA(buf);
+        size_t payload_len = MYSQL_GET_PAYLOAD_LEN(data);
+        uint8_t cmd = MYSQL_GET_COMMAND(data);
+
+        if ((cmd == MYSQL_COM_QUERY || cmd == MYSQL_COM_STMT_PREPARE) &&
+            payload_len > 0 && GWBUF_LENGTH(buf) >= MYSQL_HEADER_LEN + payload_len)
+        {
+            *sql = (const char*)data + MYSQL_HEADER_LEN + 1;
+            *len = payload_len - 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const MODUTIL_DIGEST* modutil_get_digest(GWBUF* buf)
+{
+    MODUTIL_DIGEST* digest = (MODUTIL_DIGEST*)gwbuf_get_buffer_object_data(buf, GWBUF_DIGEST_INFO);
+    const char* sql;
+    size_t len;
+
+    if (!digest && modutil_digest_sql(buf, &sql, &len))
+    {
+        digest = (MODUTIL_DIGEST*)MXS_MALLOC(sizeof(MODUTIL_DIGEST));
+
+        if (digest)
+        {
+            mxs_hash128(sql, len, 0, &digest->hash);
+            digest->has_canonical = false;
+            digest->canonical = 0;
+            gwbuf_add_buffer_object(buf, GWBUF_DIGEST_INFO, digest, modutil_digest_free);
+        }
+    }
+
+    return digest;
+}
+
+bool modutil_get_canonical_digest(GWBUF* buf, uint64_t* canonical)
+{
+    MODUTIL_DIGEST* digest = (MODUTIL_DIGEST*)modutil_get_digest(buf);
+    const char* sql;
+    size_t len;
+
+    if (digest && !digest->has_canonical && modutil_digest_sql(buf, &sql, &len))
+    {
+        char stack[MODUTIL_DIGEST_STACK_SIZE];
+        char* dest = stack;
+
+        if (MODUTIL_CANONICAL_SIZE(len) > sizeof(stack))
+        {
+            dest = (char*)MXS_MALLOC(MODUTIL_CANONICAL_SIZE(len));
+        }
+
+        if (dest)
+        {
+            modutil_canonicalize(sql, len, dest, &digest->canonical);
+            digest->has_canonical = true;
+
+            if (dest != stack)
             {
-                MXS_FREE(src);
+                MXS_FREE(dest);
             }
         }
     }
 
+    if (digest && digest->has_canonical)
+    {
+        *canonical = digest->canonical;
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Replace user-provided literals with question marks.
+ *
+ * @param querybuf GWBUF with a COM_QUERY statement
+ * @return A copy of the query in its canonical form or NULL if an error occurred.
+ */
+char* modutil_get_canonical(GWBUF* querybuf)
+{
+    char *querystr = NULL;
+
+    if (GWBUF_LENGTH(querybuf) > MYSQL_HEADER_LEN + 1 && GWBUF_IS_SQL(querybuf))
+    {
+        size_t srcsize = GWBUF_LENGTH(querybuf) - MYSQL_HEADER_LEN - 1;
+        const char *src = (const char*)GWBUF_DATA(querybuf) + MYSQL_HEADER_LEN + 1;
+
+        if ((querystr = MXS_MALLOC(MODUTIL_CANONICAL_SIZE(srcsize))))
+        {
+            modutil_canonicalize(src, srcsize, querystr, NULL);
+        }
+    }
+
     return querystr;
 }
 
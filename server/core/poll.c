@@ -23,12 +23,14 @@
 
 #include <mysql.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <maxscale/alloc.h>
 #include <maxscale/atomic.h>
 #include <maxscale/config.h>
 #include <maxscale/dcb.h>
 #include <maxscale/housekeeper.h>
+#include <maxscale/listener.h>
 #include <maxscale/log_manager.h>
 #include <maxscale/platform.h>
 #include <maxscale/query_classifier.h>
@@ -39,7 +41,10 @@
 #include <maxscale/thread.h>
 #include <maxscale/utils.h>
 
+#include "maxscale/histogram.h"
+#include "maxscale/mpscq.h"
 #include "maxscale/poll.h"
+#include "maxscale/poll_uring.h"
 
 #define         PROFILE_POLL    0
 
@@ -88,18 +93,30 @@ static thread_local DCB* current_dcb;
 /** Fake epoll event struct */
 typedef struct fake_event
 {
+    MXS_MPSCQ_NODE     node;  /*< The queue link, must be the first member */
     DCB               *dcb;   /*< The DCB where this event was generated */
     GWBUF             *data;  /*< Fake data, placed in the DCB's read queue */
     uint32_t           event; /*< The EPOLL event type */
-    struct fake_event *tail;  /*< The last event */
-    struct fake_event *next;  /*< The next event */
+    bool               adopt; /*< The DCB was moved to this thread */
 } fake_event_t;
 
+/**
+ * Thread-specific fake event queue. The eventfd is in the thread's epoll
+ * instance and it is written to when an event is added to an empty queue.
+ * The padding keeps the queues of different threads in separate cache lines.
+ */
+typedef struct fake_event_queue
+{
+    MXS_MPSCQ queue;
+    int       wakeup_fd;
+    char      padding[64 - sizeof(MXS_MPSCQ) - sizeof(int)];
+} fake_event_queue_t;
+
 thread_local int current_thread_id; /**< This thread's ID */
 static int *epoll_fd;    /*< The epoll file descriptor */
+static bool use_io_uring = false; /*< Whether the io_uring engine is used instead of epoll */
 static int next_epoll_fd = 0; /*< Which thread handles the next DCB */
-static fake_event_t **fake_events; /*< Thread-specific fake event queue */
-static SPINLOCK      *fake_event_lock;
+static fake_event_queue_t *fake_events; /*< Thread-specific fake event queue */
 static int do_shutdown = 0;  /*< Flag the shutdown of the poll subsystem */
 
 /** Poll cross-thread messaging variables */
@@ -113,7 +130,9 @@ static simple_mutex_t epoll_wait_mutex; /*< serializes calls to epoll_wait */
 static int n_waiting = 0;    /*< No. of threads in epoll_wait */
 
 static int process_pollq(int thread_id, struct epoll_event *event);
+static void poll_rebalance(int threshold);
 static void poll_add_event_to_dcb(DCB* dcb, GWBUF* buf, uint32_t ev);
+static void poll_push_fake_event(int thread_id, fake_event_t *event);
 static bool poll_dcb_session_check(DCB *dcb, const char *);
 static void poll_check_message(void);
 
@@ -158,7 +177,23 @@ typedef struct
     int n_fds;          /*< No. of descriptors thread is processing */
     DCB *cur_dcb;       /*< Current DCB being processed */
     uint32_t event;     /*< Current event being processed */
-    uint64_t cycle_start; /*< The time when the poll loop was started */
+    uint64_t cycle_start; /*< When epoll_wait returned, in nanoseconds */
+    int64_t n_accepts;    /*< No. of client connections accepted */
+    int64_t last_accepts; /*< No. of accepted connections at the last load sample */
+    double accept_rate;   /*< Accepted connections per second */
+    int n_dcbs;           /*< No. of DCBs currently polled by the thread */
+    int64_t n_assigned;   /*< No. of DCBs assigned to the thread */
+    int64_t n_events;     /*< No. of events returned by epoll_wait */
+    int64_t last_events;  /*< No. of events at the last load sample */
+    int sample_dcbs;      /*< No. of DCBs at the last load sample */
+    double load;          /*< Events per second at the last load sample */
+    uint64_t busy_ns;     /*< Time spent processing events in nanoseconds */
+    uint64_t last_busy_ns; /*< Time spent processing events at the last load sample */
+    double busy;          /*< Percentage of time spent processing events */
+    int migrate_to;       /*< Thread where idle sessions are moved, -1 for none */
+    int migrate_dcbs;     /*< No. of DCBs to move */
+    int64_t n_migrated_in;  /*< No. of DCBs moved to this thread */
+    int64_t n_migrated_out; /*< No. of DCBs moved from this thread */
 } THREAD_DATA;
 
 static THREAD_DATA *thread_data = NULL;    /*< Status of each thread */
@@ -194,17 +229,42 @@ static struct
     ts_stats_t *blockingpolls;  /*< Number of epoll_waits with a timeout specified */
 } pollStats;
 
-#define N_QUEUE_TIMES   30
 /**
- * The event queue statistics
+ * The event types for which queue and execution times are recorded. Errors
+ * are recorded as hangups.
  */
-static struct
+typedef enum
+{
+    POLL_EVENT_READ,
+    POLL_EVENT_WRITE,
+    POLL_EVENT_ACCEPT,
+    POLL_EVENT_HANGUP,
+    POLL_N_EVENT_TYPES
+} POLL_EVENT_TYPE;
+
+static const char *poll_event_type_names[POLL_N_EVENT_TYPES] =
+{
+    "Read",
+    "Write",
+    "Accept",
+    "Hangup"
+};
+
+/**
+ * The event queue statistics of a thread. The queue time is the time from
+ * epoll_wait returning to the start of the processing of the event.
+ */
+typedef struct
 {
-    uint32_t qtimes[N_QUEUE_TIMES + 1];
-    uint32_t exectimes[N_QUEUE_TIMES + 1];
-    ts_stats_t *maxqtime;
-    ts_stats_t *maxexectime;
-} queueStats;
+    MXS_HISTOGRAM qtimes[POLL_N_EVENT_TYPES];    /*< Queue times in nanoseconds */
+    MXS_HISTOGRAM exectimes[POLL_N_EVENT_TYPES]; /*< Execution times in nanoseconds */
+} EVENT_TIMES;
+
+static EVENT_TIMES *event_times = NULL;    /*< Event times of each thread */
+
+/** The number of 100ms buckets in the event time table */
+#define N_QUEUE_TIMES   30
+#define QUEUE_TIME_NS   100000000
 
 /**
  * How frequently to call the poll_loadav function used to monitor the load
@@ -221,6 +281,37 @@ static void poll_loadav(void *);
  */
 static int poll_resolve_error(DCB *, int, bool);
 
+/**
+ * Add a descriptor to or remove it from a thread's poll set
+ *
+ * @param thread_id The thread
+ * @param op        EPOLL_CTL_ADD or EPOLL_CTL_DEL
+ * @param fd        The descriptor
+ * @param ev        The events to poll and the data returned with them
+ *
+ * @return 0 on success, -1 on error with errno set
+ */
+static inline int poll_ctl(int thread_id, int op, int fd, struct epoll_event *ev)
+{
+    return use_io_uring ? poll_uring_ctl(thread_id, op, fd, ev) : epoll_ctl(epoll_fd[thread_id], op, fd, ev);
+}
+
+/**
+ * Wait for events on a thread's poll set
+ *
+ * @param thread_id The thread
+ * @param events    Array where events are stored
+ * @param maxevents Size of the array
+ * @param timeout   Timeout in milliseconds
+ *
+ * @return Number of events or -1 on error
+ */
+static inline int poll_wait(int thread_id, struct epoll_event *events, int maxevents, int timeout)
+{
+    return use_io_uring ? poll_uring_wait(thread_id, events, maxevents, timeout) :
+           epoll_wait(epoll_fd[thread_id], events, maxevents, timeout);
+}
+
 /**
  * Initialise the polling system we are using for the gateway.
  *
@@ -236,7 +327,21 @@ poll_init()
         return;
     }
 
-    for (int i = 0; i < n_threads; i++)
+    if (config_poll_engine() == POLL_ENGINE_IO_URING)
+    {
+        if (poll_uring_init(n_threads))
+        {
+            use_io_uring = true;
+            MXS_NOTICE("Using io_uring to wait for network events.");
+        }
+        else
+        {
+            MXS_WARNING("Could not use io_uring, using epoll instead: %d, %s",
+                        errno, mxs_strerror(errno));
+        }
+    }
+
+    for (int i = 0; i < n_threads && !use_io_uring; i++)
     {
         if ((epoll_fd[i] = epoll_create(MAX_EVENTS)) == -1)
         {
@@ -246,14 +351,24 @@ poll_init()
         }
     }
 
-    if ((fake_events = MXS_CALLOC(n_threads, sizeof(fake_event_t*))) == NULL)
+    if ((fake_events = MXS_CALLOC(n_threads, sizeof(fake_event_queue_t))) == NULL)
     {
         exit(-1);
     }
 
-    if ((fake_event_lock = MXS_CALLOC(n_threads, sizeof(SPINLOCK))) == NULL)
+    for (int i = 0; i < n_threads; i++)
     {
-        exit(-1);
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &fake_events[i];
+
+        if ((fake_events[i].wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ||
+            poll_ctl(i, EPOLL_CTL_ADD, fake_events[i].wakeup_fd, &ev) != 0)
+        {
+            MXS_ERROR("FATAL: Could not create the fake event wakeup descriptor: %d, %s",
+                      errno, mxs_strerror(errno));
+            exit(-1);
+        }
     }
 
     if ((poll_msg = MXS_CALLOC(n_threads, sizeof(int))) == NULL)
@@ -261,19 +376,34 @@ poll_init()
         exit(-1);
     }
 
-    for (int i = 0; i < n_threads; i++)
+    if ((event_times = MXS_CALLOC(n_threads, sizeof(EVENT_TIMES))) == NULL)
     {
-        spinlock_init(&fake_event_lock[i]);
+        exit(-1);
     }
 
     memset(&pollStats, 0, sizeof(pollStats));
-    memset(&queueStats, 0, sizeof(queueStats));
     thread_data = (THREAD_DATA *)MXS_MALLOC(n_threads * sizeof(THREAD_DATA));
     if (thread_data)
     {
         for (int i = 0; i < n_threads; i++)
         {
             thread_data[i].state = THREAD_STOPPED;
+            thread_data[i].n_accepts = 0;
+            thread_data[i].last_accepts = 0;
+            thread_data[i].accept_rate = 0.0;
+            thread_data[i].n_dcbs = 0;
+            thread_data[i].n_assigned = 0;
+            thread_data[i].n_events = 0;
+            thread_data[i].last_events = 0;
+            thread_data[i].sample_dcbs = 0;
+            thread_data[i].load = 0.0;
+            thread_data[i].busy_ns = 0;
+            thread_data[i].last_busy_ns = 0;
+            thread_data[i].busy = 0.0;
+            thread_data[i].migrate_to = -1;
+            thread_data[i].migrate_dcbs = 0;
+            thread_data[i].n_migrated_in = 0;
+            thread_data[i].n_migrated_out = 0;
         }
     }
 
@@ -288,8 +418,6 @@ poll_init()
         (pollStats.n_nothreads = ts_stats_alloc()) == NULL ||
         (pollStats.evq_length = ts_stats_alloc()) == NULL ||
         (pollStats.evq_max = ts_stats_alloc()) == NULL ||
-        (queueStats.maxqtime = ts_stats_alloc()) == NULL ||
-        (queueStats.maxexectime = ts_stats_alloc()) == NULL ||
         (pollStats.blockingpolls = ts_stats_alloc()) == NULL)
     {
         MXS_OOM_MESSAGE("FATAL: Could not allocate statistics data.");
@@ -319,6 +447,96 @@ poll_init()
     max_poll_sleep = config_pollsleep();
 }
 
+/** The events that are polled for each DCB */
+#ifdef EPOLLRDHUP
+#define POLL_DCB_EVENTS (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLHUP | EPOLLET)
+#else
+#define POLL_DCB_EVENTS (EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLET)
+#endif
+
+/**
+ * Return a monotonic timestamp
+ *
+ * @return The current time in nanoseconds
+ */
+static inline uint64_t poll_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Return the socket of a listener that is polled by a thread
+ *
+ * @param dcb       The listener DCB
+ * @param thread_id The thread ID
+ * @return The file descriptor to add to the thread's epoll instance
+ */
+static inline int poll_listener_fd(DCB *dcb, int thread_id)
+{
+    return dcb->reuseport_fds ? dcb->reuseport_fds[thread_id] : dcb->fd;
+}
+
+/**
+ * Return the load of a thread as seen by a thread assignment policy
+ *
+ * The least_load policy scales the event rate measured at the last load
+ * sample with the growth of the thread's DCB count since then. This keeps
+ * all new DCBs from going to the same thread between two samples.
+ *
+ * @param policy    The thread assignment policy
+ * @param thread_id The thread ID
+ * @return The load of the thread, smaller is less loaded
+ */
+static double poll_thread_load(MXS_THREAD_ASSIGNMENT policy, int thread_id)
+{
+    THREAD_DATA *data = &thread_data[thread_id];
+    double load = 0.0;
+
+    if (policy == THREAD_ASSIGN_LEAST_LOAD)
+    {
+        load = data->load * (data->n_dcbs + 1) / (data->sample_dcbs + 1);
+    }
+
+    return load;
+}
+
+/**
+ * Select the thread that polls a new DCB
+ *
+ * The search starts from the next thread in round-robin order so that
+ * threads with equal load get an equal share of the DCBs.
+ *
+ * @return The ID of the selected thread
+ */
+static int poll_select_thread()
+{
+    MXS_THREAD_ASSIGNMENT policy = config_thread_assignment();
+    int owner = (unsigned int)atomic_add(&next_epoll_fd, 1) % n_threads;
+
+    if (policy != THREAD_ASSIGN_ROUND_ROBIN && thread_data)
+    {
+        int start = owner;
+        double min_load = poll_thread_load(policy, owner);
+
+        for (int i = 1; i < n_threads; i++)
+        {
+            int id = (start + i) % n_threads;
+            double load = poll_thread_load(policy, id);
+
+            if (load < min_load ||
+                (load == min_load && thread_data[id].n_dcbs < thread_data[owner].n_dcbs))
+            {
+                owner = id;
+                min_load = load;
+            }
+        }
+    }
+
+    return owner;
+}
+
 int poll_add_dcb(DCB *dcb)
 {
     int rc = -1;
@@ -328,11 +546,7 @@ int poll_add_dcb(DCB *dcb)
 
     CHK_DCB(dcb);
 
-#ifdef EPOLLRDHUP
-    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLHUP | EPOLLET;
-#else
-    ev.events = EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLET;
-#endif
+    ev.events = POLL_DCB_EVENTS;
     ev.data.ptr = dcb;
 
     /*<
@@ -382,9 +596,14 @@ int poll_add_dcb(DCB *dcb)
     {
         owner = dcb->session->client_dcb->thread.id;
     }
+    else if (dcb->dcb_role == DCB_ROLE_CLIENT_HANDLER && dcb->listener && dcb->listener->reuseport)
+    {
+        /** The kernel already distributed the connection to this thread */
+        owner = current_thread_id;
+    }
     else
     {
-        owner = (unsigned int)atomic_add(&next_epoll_fd, 1) % n_threads;
+        owner = poll_select_thread();
     }
 
     dcb->thread.id = owner;
@@ -395,18 +614,21 @@ int poll_add_dcb(DCB *dcb)
 
     if (dcb->dcb_role == DCB_ROLE_SERVICE_LISTENER)
     {
-        /** Listeners are added to all epoll instances */
+        /**
+         * Listeners are added to all epoll instances. A SO_REUSEPORT listener
+         * has a socket of its own for each thread.
+         */
         int nthr = config_threadcount();
 
         for (int i = 0; i < nthr; i++)
         {
-            if ((rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_ADD, dcb->fd, &ev)))
+            if ((rc = poll_ctl(i, EPOLL_CTL_ADD, poll_listener_fd(dcb, i), &ev)))
             {
                 error_num = errno;
                 /** Remove the listener from the previous epoll instances */
                 for (int j = 0; j < i; j++)
                 {
-                    epoll_ctl(epoll_fd[j], EPOLL_CTL_DEL, dcb->fd, &ev);
+                    poll_ctl(j, EPOLL_CTL_DEL, poll_listener_fd(dcb, j), &ev);
                 }
                 break;
             }
@@ -414,10 +636,15 @@ int poll_add_dcb(DCB *dcb)
     }
     else
     {
-        if ((rc = epoll_ctl(epoll_fd[owner], EPOLL_CTL_ADD, dcb->fd, &ev)))
+        if ((rc = poll_ctl(owner, EPOLL_CTL_ADD, dcb->fd, &ev)))
         {
             error_num = errno;
         }
+        else if (thread_data)
+        {
+            atomic_add(&thread_data[owner].n_dcbs, 1);
+            atomic_add_int64(&thread_data[owner].n_assigned, 1);
+        }
     }
 
     if (rc)
@@ -439,6 +666,119 @@ int poll_add_dcb(DCB *dcb)
     return rc;
 }
 
+bool poll_move_dcb(DCB *dcb, int target)
+{
+    int owner = dcb->thread.id;
+    struct epoll_event ev;
+    ev.events = POLL_DCB_EVENTS;
+    ev.data.ptr = dcb;
+
+    ss_dassert(owner == current_thread_id);
+    ss_dassert(dcb->dcb_role != DCB_ROLE_SERVICE_LISTENER);
+
+    fake_event_t *event = MXS_MALLOC(sizeof(*event));
+
+    if (event == NULL)
+    {
+        return false;
+    }
+
+    if (poll_ctl(owner, EPOLL_CTL_DEL, dcb->fd, &ev) != 0)
+    {
+        MXS_ERROR("Failed to remove DCB %p from the epoll instance of thread %d: %d, %s",
+                  dcb, owner, errno, mxs_strerror(errno));
+        MXS_FREE(event);
+        return false;
+    }
+
+    /**
+     * The target thread adds the DCB to its list and epoll instance when it
+     * processes the adoption event. Until then, the fake events for the DCB
+     * are deferred so that the DCB isn't closed before it is in the epoll
+     * instance of the target.
+     */
+    dcb_remove_from_list(dcb);
+    dcb->thread.migrating = true;
+    dcb->thread.id = target;
+
+    event->dcb = dcb;
+    event->data = NULL;
+    event->event = 0;
+    event->adopt = true;
+    poll_push_fake_event(target, event);
+
+    if (thread_data)
+    {
+        atomic_add(&thread_data[owner].n_dcbs, -1);
+        atomic_add_int64(&thread_data[owner].n_migrated_out, 1);
+    }
+
+    return true;
+}
+
+/**
+ * Take ownership of a DCB that was moved from another thread
+ *
+ * @param thread_id The calling thread
+ * @param dcb       The DCB that was moved
+ */
+static void poll_adopt_dcb(int thread_id, DCB *dcb)
+{
+    struct epoll_event ev;
+    ev.events = POLL_DCB_EVENTS;
+    ev.data.ptr = dcb;
+
+    ss_dassert(dcb->thread.id == thread_id);
+    dcb->thread.migrating = false;
+
+    if (dcb->state != DCB_STATE_POLLING)
+    {
+        /** The DCB was closed and removed from polling while it was being
+         * moved, the zombie processing can now free it */
+        return;
+    }
+
+    dcb_add_to_list(dcb);
+
+    if (poll_ctl(thread_id, EPOLL_CTL_ADD, dcb->fd, &ev) != 0)
+    {
+        MXS_ERROR("Failed to add DCB %p to the epoll instance of thread %d, closing "
+                  "the connection: %d, %s", dcb, thread_id, errno, mxs_strerror(errno));
+        poll_fake_hangup_event(dcb);
+    }
+    else if (thread_data)
+    {
+        atomic_add(&thread_data[thread_id].n_dcbs, 1);
+        atomic_add_int64(&thread_data[thread_id].n_migrated_in, 1);
+    }
+}
+
+int poll_thread_dcb_count(int thread_id)
+{
+    return thread_data ? thread_data[thread_id].n_dcbs : 0;
+}
+
+/**
+ * Move idle sessions to another thread if the housekeeper has requested it
+ *
+ * @param thread_id The calling thread
+ */
+static void poll_check_migration(int thread_id)
+{
+    int target = thread_data[thread_id].migrate_to;
+
+    if (target != -1)
+    {
+        thread_data[thread_id].migrate_to = -1;
+        int moved = dcb_migrate_idle_sessions(thread_id, target, thread_data[thread_id].migrate_dcbs);
+
+        if (moved > 0)
+        {
+            MXS_INFO("Moved %d DCBs from thread %d to thread %d.", moved, thread_id, target);
+        }
+    }
+}
+
 int poll_remove_dcb(DCB *dcb)
 {
     int dcbfd, rc = 0;
@@ -465,6 +805,16 @@ int poll_remove_dcb(DCB *dcb)
      */
     dcb->state = DCB_STATE_NOPOLLING;
 
+    if (dcb->thread.migrating)
+    {
+        /**
+         * A DCB that is being moved is in no epoll instance and poll_move_dcb()
+         * already took it out of the old owner's count. The pending adoption
+         * event sees the new state and leaves the DCB alone.
+         */
+        return 0;
+    }
+
     /**
      * Only positive fds can be removed from epoll set.
      * Cloned DCBs can have a state of DCB_STATE_POLLING but are not in
@@ -485,7 +835,7 @@ int poll_remove_dcb(DCB *dcb)
 
             for (int i = 0; i < nthr; i++)
             {
-                int tmp_rc = epoll_ctl(epoll_fd[i], EPOLL_CTL_DEL, dcb->fd, &ev);
+                int tmp_rc = poll_ctl(i, EPOLL_CTL_DEL, poll_listener_fd(dcb, i), &ev);
                 if (tmp_rc && rc == 0)
                 {
                     /** Even if one of the instances failed to remove it, try
@@ -498,10 +848,15 @@ int poll_remove_dcb(DCB *dcb)
         }
         else
         {
-            if ((rc = epoll_ctl(epoll_fd[dcb->thread.id], EPOLL_CTL_DEL, dcbfd, &ev)))
+            if ((rc = poll_ctl(dcb->thread.id, EPOLL_CTL_DEL, dcbfd, &ev)))
             {
                 error_num = errno;
             }
+
+            if (thread_data)
+            {
+                atomic_add(&thread_data[dcb->thread.id].n_dcbs, -1);
+            }
         }
         /**
          * The poll_resolve_error function will always
@@ -680,7 +1035,7 @@ poll_waitevents(void *arg)
         }
 
         ts_stats_increment(pollStats.n_polls, thread_id);
-        if ((nfds = epoll_wait(epoll_fd[thread_id], events, MAX_EVENTS, 0)) == -1)
+        if ((nfds = poll_wait(thread_id, events, MAX_EVENTS, 0)) == -1)
         {
             atomic_add(&n_waiting, -1);
             int eno = errno;
@@ -707,7 +1062,7 @@ poll_waitevents(void *arg)
                 timeout_bias++;
             }
             ts_stats_increment(pollStats.blockingpolls, thread_id);
-            nfds = epoll_wait(epoll_fd[thread_id],
+            nfds = poll_wait(thread_id,
                               events,
                               MAX_EVENTS,
                               (max_poll_sleep * timeout_bias) / 10);
@@ -758,6 +1113,11 @@ poll_waitevents(void *arg)
             atomic_add(&load_samples, 1);
             atomic_add(&load_nfds, nfds);
 
+            if (thread_data)
+            {
+                thread_data[thread_id].n_events += nfds;
+            }
+
             /*
              * Process every DCB that has a new event and add
              * it to the poll queue.
@@ -770,37 +1130,64 @@ poll_waitevents(void *arg)
              */
         }
 
-        thread_data[thread_id].cycle_start = hkheartbeat;
+        uint64_t busy_start = poll_time_ns();
+
+        if (thread_data)
+        {
+            thread_data[thread_id].cycle_start = busy_start;
+        }
 
         /* Process of the queue of waiting requests */
         for (int i = 0; i < nfds; i++)
         {
-            process_pollq(thread_id, &events[i]);
+            if (events[i].data.ptr == &fake_events[thread_id])
+            {
+                /** Fake events were queued, they are processed below */
+                uint64_t count;
+                read(fake_events[thread_id].wakeup_fd, &count, sizeof(count));
+            }
+            else
+            {
+                process_pollq(thread_id, &events[i]);
+            }
         }
 
         fake_event_t *event = NULL;
 
-        /** It is very likely that the queue is empty so to avoid hitting the
-         * spinlock every time we receive events, we only do a dirty read. Currently,
-         * only the monitors inject fake events from external threads. */
-        if (fake_events[thread_id])
+        /** It is very likely that the queue is empty so to avoid the atomic
+         * exchange every time we receive events, we only do a dirty read. */
+        if (!mxs_mpscq_is_empty(&fake_events[thread_id].queue))
         {
-            spinlock_acquire(&fake_event_lock[thread_id]);
-            event = fake_events[thread_id];
-            fake_events[thread_id] = NULL;
-            spinlock_release(&fake_event_lock[thread_id]);
+            event = (fake_event_t*)mxs_mpscq_take_all(&fake_events[thread_id].queue);
         }
 
         while (event)
         {
-            struct epoll_event ev;
-            event->dcb->dcb_fakequeue = event->data;
-            ev.data.ptr = event->dcb;
-            ev.events = event->event;
-            process_pollq(thread_id, &ev);
-            fake_event_t *tmp = event;
-            event = event->next;
-            MXS_FREE(tmp);
+            fake_event_t *next = (fake_event_t*)event->node.next;
+
+            if (event->adopt)
+            {
+                poll_adopt_dcb(thread_id, event->dcb);
+                MXS_FREE(event);
+            }
+            else if (event->dcb->dcb_role != DCB_ROLE_SERVICE_LISTENER &&
+                     (event->dcb->thread.id != thread_id || event->dcb->thread.migrating))
+            {
+                /** The DCB was moved to another thread after the event was queued
+                 * or it is still being moved to this thread */
+                poll_push_fake_event(event->dcb->thread.id, event);
+            }
+            else
+            {
+                struct epoll_event ev;
+                event->dcb->dcb_fakequeue = event->data;
+                ev.data.ptr = event->dcb;
+                ev.events = event->event;
+                process_pollq(thread_id, &ev);
+                MXS_FREE(event);
+            }
+
+            event = next;
         }
 
         dcb_process_idle_sessions(thread_id);
@@ -813,6 +1200,12 @@ poll_waitevents(void *arg)
         /** Process closed DCBs */
         dcb_process_zombies(thread_id);
 
+        if (thread_data)
+        {
+            thread_data[thread_id].busy_ns += poll_time_ns() - busy_start;
+            poll_check_migration(thread_id);
+        }
+
         poll_check_message();
 
         if (thread_data)
@@ -867,6 +1260,38 @@ poll_set_maxwait(unsigned int maxwait)
     max_poll_sleep = maxwait;
 }
 
+/**
+ * Get the type of an event for the event time statistics
+ *
+ * @param dcb The DCB that received the event
+ * @param ev  The epoll event bits
+ *
+ * @return The event type
+ */
+static inline POLL_EVENT_TYPE poll_event_type(DCB *dcb, uint32_t ev)
+{
+#ifdef EPOLLRDHUP
+    uint32_t hangup = EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+#else
+    uint32_t hangup = EPOLLERR | EPOLLHUP;
+#endif
+
+    if ((ev & EPOLLIN) && (dcb->state == DCB_STATE_LISTENING || dcb->state == DCB_STATE_WAITING))
+    {
+        return POLL_EVENT_ACCEPT;
+    }
+    else if (ev & hangup)
+    {
+        return POLL_EVENT_HANGUP;
+    }
+    else if (ev & EPOLLIN)
+    {
+        return POLL_EVENT_READ;
+    }
+
+    return POLL_EVENT_WRITE;
+}
+
 /**
  * Process of the queue of DCB's that have outstanding events
  *
@@ -898,20 +1323,15 @@ process_pollq(int thread_id, struct epoll_event *event)
     current_dcb = dcb; // thread local
 
     /** Calculate event queue statistics */
-    uint64_t started = hkheartbeat;
-    uint64_t qtime = started - thread_data[thread_id].cycle_start;
+    POLL_EVENT_TYPE type = poll_event_type(dcb, ev);
+    uint64_t started = poll_time_ns();
 
-    if (qtime > N_QUEUE_TIMES)
-    {
-        queueStats.qtimes[N_QUEUE_TIMES]++;
-    }
-    else
+    if (thread_data)
     {
-        queueStats.qtimes[qtime]++;
+        mxs_histogram_record(&event_times[thread_id].qtimes[type],
+                             started - thread_data[thread_id].cycle_start);
     }
 
-    ts_stats_set_max(queueStats.maxqtime, qtime, thread_id);
-
     CHK_DCB(dcb);
     if (thread_data)
     {
@@ -1075,18 +1495,7 @@ process_pollq(int thread_id, struct epoll_event *event)
 #endif
 
     /** Calculate event execution statistics */
-    qtime = hkheartbeat - started;
-
-    if (qtime > N_QUEUE_TIMES)
-    {
-        queueStats.exectimes[N_QUEUE_TIMES]++;
-    }
-    else
-    {
-        queueStats.exectimes[qtime % N_QUEUE_TIMES]++;
-    }
-
-    ts_stats_set_max(queueStats.maxexectime, qtime, thread_id);
+    mxs_histogram_record(&event_times[thread_id].exectimes[type], poll_time_ns() - started);
 
     current_dcb = NULL; // thread local
 
@@ -1377,6 +1786,81 @@ dShowThreads(DCB *dcb)
             }
         }
     }
+
+    const char *policy = "round_robin";
+
+    switch (config_thread_assignment())
+    {
+    case THREAD_ASSIGN_LEAST_DCBS:
+        policy = "least_dcbs";
+        break;
+    case THREAD_ASSIGN_LEAST_LOAD:
+        policy = "least_load";
+        break;
+    default:
+        break;
+    }
+
+    dcb_printf(dcb, "\nThread assignment: %s\n", policy);
+    dcb_printf(dcb, "Rebalance threshold: %d%%\n", config_rebalance_threshold());
+    dcb_printf(dcb, "Poll engine: %s\n\n", use_io_uring ? "io_uring" : "epoll");
+    dcb_printf(dcb, " ID | DCBs   | Assigned     | Events/s   | Busy %% | Moved in     | Moved out    "
+               "| Accepts      | Accepts/s\n");
+    dcb_printf(dcb, "----+--------+--------------+------------+--------+--------------+--------------"
+               "+--------------+----------\n");
+    for (i = 0; i < n_threads; i++)
+    {
+        dcb_printf(dcb, " %2d | %6d | %-12" PRId64 " | %-10.2f | %6.2f | %-12" PRId64 " | %-12" PRId64
+                   " | %-12" PRId64 " | %.2f\n",
+                   i, thread_data[i].n_dcbs, thread_data[i].n_assigned, thread_data[i].load,
+                   thread_data[i].busy, thread_data[i].n_migrated_in, thread_data[i].n_migrated_out,
+                   thread_data[i].n_accepts, thread_data[i].accept_rate);
+    }
+}
+
+/**
+ * Request the busiest thread to move idle sessions to the least busy thread
+ *
+ * This is called by the housekeeper after the load of the threads has been
+ * sampled. The number of DCBs to move is chosen so that, assuming an equal
+ * load for each DCB, the difference between the two threads is halved.
+ *
+ * @param threshold Minimum difference in the busy time percentages
+ */
+static void poll_rebalance(int threshold)
+{
+    int busiest = 0;
+    int idlest = 0;
+
+    for (int i = 1; i < n_threads; i++)
+    {
+        if (thread_data[i].busy > thread_data[busiest].busy)
+        {
+            busiest = i;
+        }
+        if (thread_data[i].busy < thread_data[idlest].busy)
+        {
+            idlest = i;
+        }
+    }
+
+    double diff = thread_data[busiest].busy - thread_data[idlest].busy;
+
+    if (diff > threshold && thread_data[busiest].migrate_to == -1)
+    {
+        int n_dcbs = thread_data[busiest].n_dcbs * (diff / 2) / thread_data[busiest].busy;
+        thread_data[busiest].migrate_dcbs = MXS_MAX(n_dcbs, 1);
+        atomic_synchronize();
+        thread_data[busiest].migrate_to = idlest;
+    }
+}
+
+void poll_connection_accepted()
+{
+    if (thread_data)
+    {
+        thread_data[current_thread_id].n_accepts++;
+    }
 }
 
 /**
@@ -1407,6 +1891,34 @@ poll_loadav(void *data)
     }
     avg_samples[next_sample] = current_avg;
     next_sample++;
+
+    if (thread_data)
+    {
+        for (int i = 0; i < n_threads; i++)
+        {
+            int64_t n_accepts = thread_data[i].n_accepts;
+            thread_data[i].accept_rate = (double)(n_accepts - thread_data[i].last_accepts) / POLL_LOAD_FREQ;
+            thread_data[i].last_accepts = n_accepts;
+
+            int64_t n_events = thread_data[i].n_events;
+            thread_data[i].load = (double)(n_events - thread_data[i].last_events) / POLL_LOAD_FREQ;
+            thread_data[i].last_events = n_events;
+            thread_data[i].sample_dcbs = thread_data[i].n_dcbs;
+
+            uint64_t busy_ns = thread_data[i].busy_ns;
+            thread_data[i].busy = 100.0 * (busy_ns - thread_data[i].last_busy_ns) /
+                                  (POLL_LOAD_FREQ * 1000000000.0);
+            thread_data[i].last_busy_ns = busy_ns;
+        }
+
+        int threshold = config_rebalance_threshold();
+
+        if (threshold > 0)
+        {
+            poll_rebalance(threshold);
+        }
+    }
+
     if (next_sample >= n_avg_samples)
     {
         next_sample = 0;
@@ -1435,27 +1947,33 @@ static void poll_add_event_to_dcb(DCB*       dcb,
         event->data = buf;
         event->dcb = dcb;
         event->event = ev;
-        event->next = NULL;
-        event->tail = event;
+        event->adopt = false;
 
-        int thr = dcb->thread.id;
+        poll_push_fake_event(dcb->thread.id, event);
+    }
+}
 
-        /** It is possible that a housekeeper or a monitor thread inserts a fake
-         * event into the thread's event queue which is why the operation needs
-         * to be protected by a spinlock */
-        spinlock_acquire(&fake_event_lock[thr]);
+/**
+ * Add an event to a thread's fake event queue
+ *
+ * Any thread, including the housekeeper and the monitors, can add events.
+ * The owning thread is woken up only when the queue was empty as it will
+ * process all queued events at once.
+ *
+ * @param thread_id The thread that processes the event
+ * @param event     The event to add
+ */
+static void poll_push_fake_event(int thread_id, fake_event_t *event)
+{
+    if (mxs_mpscq_push(&fake_events[thread_id].queue, &event->node))
+    {
+        uint64_t one = 1;
 
-        if (fake_events[thr])
+        if (write(fake_events[thread_id].wakeup_fd, &one, sizeof(one)) != sizeof(one) &&
+            errno != EAGAIN)
         {
-            fake_events[thr]->tail->next = event;
-            fake_events[thr]->tail = event;
+            MXS_ERROR("Failed to wake up thread %d: %d, %s", thread_id, errno, mxs_strerror(errno));
         }
-        else
-        {
-            fake_events[thr] = event;
-        }
-
-        spinlock_release(&fake_event_lock[thr]);
     }
 }
 
@@ -1479,6 +1997,43 @@ void poll_fake_hangup_event(DCB *dcb)
     poll_add_event_to_dcb(dcb, NULL, ev);
 }
 
+/**
+ * Merge the event times of all threads
+ *
+ * @param type      The event type or POLL_N_EVENT_TYPES for all types
+ * @param qtimes    Histogram where the queue times are stored
+ * @param exectimes Histogram where the execution times are stored
+ */
+static void poll_get_event_times(int type, MXS_HISTOGRAM *qtimes, MXS_HISTOGRAM *exectimes)
+{
+    int first = type == POLL_N_EVENT_TYPES ? 0 : type;
+    int last = type == POLL_N_EVENT_TYPES ? POLL_N_EVENT_TYPES - 1 : type;
+
+    mxs_histogram_reset(qtimes);
+    mxs_histogram_reset(exectimes);
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        for (int j = first; j <= last; j++)
+        {
+            mxs_histogram_merge(qtimes, &event_times[i].qtimes[j]);
+            mxs_histogram_merge(exectimes, &event_times[i].exectimes[j]);
+        }
+    }
+}
+
+/**
+ * Convert nanoseconds to microseconds
+ *
+ * @param ns Time in nanoseconds
+ *
+ * @return Time in microseconds
+ */
+static inline double poll_ns_to_us(uint64_t ns)
+{
+    return ns / 1000.0;
+}
+
 /**
  * Print the event queue statistics
  *
@@ -1488,31 +2043,66 @@ void
 dShowEventStats(DCB *pdcb)
 {
     int i;
+    MXS_HISTOGRAM *hist = MXS_MALLOC(2 * sizeof(MXS_HISTOGRAM));
+
+    if (hist == NULL)
+    {
+        return;
+    }
+
+    MXS_HISTOGRAM *qtimes = &hist[0];
+    MXS_HISTOGRAM *exectimes = &hist[1];
+    poll_get_event_times(POLL_N_EVENT_TYPES, qtimes, exectimes);
 
     dcb_printf(pdcb, "\nEvent statistics.\n");
-    dcb_printf(pdcb, "Maximum queue time:           %3" PRId64 "00ms\n", ts_stats_get(queueStats.maxqtime,
-                                                                                      TS_STATS_MAX));
-    dcb_printf(pdcb, "Maximum execution time:       %3" PRId64 "00ms\n", ts_stats_get(queueStats.maxexectime,
-                                                                                      TS_STATS_MAX));
+    dcb_printf(pdcb, "Maximum queue time:           %.3fms\n", qtimes->max / 1000000.0);
+    dcb_printf(pdcb, "Maximum execution time:       %.3fms\n", exectimes->max / 1000000.0);
     dcb_printf(pdcb, "Maximum event queue length:   %3" PRId64 "\n", ts_stats_get(pollStats.evq_max,
                                                                                   TS_STATS_MAX));
     dcb_printf(pdcb, "Total event queue length:     %3" PRId64 "\n", ts_stats_get(pollStats.evq_length,
                                                                                   TS_STATS_SUM));
     dcb_printf(pdcb, "Average event queue length:   %3" PRId64 "\n", ts_stats_get(pollStats.evq_length,
                                                                                   TS_STATS_AVG));
+    dcb_printf(pdcb, "\n");
+    dcb_printf(pdcb, "       |            |    Queue time (us)               |    Execution time (us)\n");
+    dcb_printf(pdcb, "Event  | Events     | p50      | p99      | p999       | p50      | p99      | p999\n");
+    dcb_printf(pdcb, "-------+------------+----------+----------+------------+----------+----------+-----------\n");
+
+    for (i = 0; i < POLL_N_EVENT_TYPES; i++)
+    {
+        poll_get_event_times(i, qtimes, exectimes);
+        dcb_printf(pdcb, "%-6s | %-10" PRIu64 " | %-8.1f | %-8.1f | %-10.1f | %-8.1f | %-8.1f | %-10.1f\n",
+                   poll_event_type_names[i], exectimes->total,
+                   poll_ns_to_us(mxs_histogram_percentile(qtimes, 50)),
+                   poll_ns_to_us(mxs_histogram_percentile(qtimes, 99)),
+                   poll_ns_to_us(mxs_histogram_percentile(qtimes, 99.9)),
+                   poll_ns_to_us(mxs_histogram_percentile(exectimes, 50)),
+                   poll_ns_to_us(mxs_histogram_percentile(exectimes, 99)),
+                   poll_ns_to_us(mxs_histogram_percentile(exectimes, 99.9)));
+    }
+
+    poll_get_event_times(POLL_N_EVENT_TYPES, qtimes, exectimes);
+
     dcb_printf(pdcb, "\n");
     dcb_printf(pdcb, "               |    Number of events\n");
     dcb_printf(pdcb, "Duration       | Queued     | Executed\n");
     dcb_printf(pdcb, "---------------+------------+-----------\n");
-    dcb_printf(pdcb, " < 100ms       | %-10d | %-10d\n",
-               queueStats.qtimes[0], queueStats.exectimes[0]);
+    dcb_printf(pdcb, " < 100ms       | %-10" PRIu64 " | %-10" PRIu64 "\n",
+               mxs_histogram_count(qtimes, 0, QUEUE_TIME_NS),
+               mxs_histogram_count(exectimes, 0, QUEUE_TIME_NS));
     for (i = 1; i < N_QUEUE_TIMES; i++)
     {
-        dcb_printf(pdcb, " %2d00 - %2d00ms | %-10d | %-10d\n", i, i + 1,
-                   queueStats.qtimes[i], queueStats.exectimes[i]);
+        uint64_t low = (uint64_t)i * QUEUE_TIME_NS;
+        uint64_t high = low + QUEUE_TIME_NS;
+        dcb_printf(pdcb, " %2d00 - %2d00ms | %-10" PRIu64 " | %-10" PRIu64 "\n", i, i + 1,
+                   mxs_histogram_count(qtimes, low, high),
+                   mxs_histogram_count(exectimes, low, high));
     }
-    dcb_printf(pdcb, " > %2d00ms      | %-10d | %-10d\n", N_QUEUE_TIMES,
-               queueStats.qtimes[N_QUEUE_TIMES], queueStats.exectimes[N_QUEUE_TIMES]);
+    dcb_printf(pdcb, " > %2d00ms      | %-10" PRIu64 " | %-10" PRIu64 "\n", N_QUEUE_TIMES,
+               mxs_histogram_count(qtimes, (uint64_t)N_QUEUE_TIMES * QUEUE_TIME_NS, UINT64_MAX),
+               mxs_histogram_count(exectimes, (uint64_t)N_QUEUE_TIMES * QUEUE_TIME_NS, UINT64_MAX));
+
+    MXS_FREE(hist);
 }
 
 /**
@@ -1540,9 +2130,24 @@ int64_t poll_get_stat(POLL_STAT stat)
     case POLL_STAT_EVQ_MAX:
         return ts_stats_get(pollStats.evq_max, TS_STATS_MAX);
     case POLL_STAT_MAX_QTIME:
-        return ts_stats_get(queueStats.maxqtime, TS_STATS_MAX);
     case POLL_STAT_MAX_EXECTIME:
-        return ts_stats_get(queueStats.maxexectime, TS_STATS_MAX);
+        {
+            /** The maximum times are reported in 100ms units */
+            uint64_t max = 0;
+
+            for (int i = 0; i < n_threads; i++)
+            {
+                for (int j = 0; j < POLL_N_EVENT_TYPES; j++)
+                {
+                    uint64_t value = stat == POLL_STAT_MAX_QTIME ?
+                                     event_times[i].qtimes[j].max :
+                                     event_times[i].exectimes[j].max;
+                    max = MXS_MAX(max, value);
+                }
+            }
+
+            return max / QUEUE_TIME_NS;
+        }
     default:
         ss_dassert(false);
         break;
@@ -1550,6 +2155,16 @@ int64_t poll_get_stat(POLL_STAT stat)
     return 0;
 }
 
+/**
+ * The state of an event time result set
+ */
+typedef struct
+{
+    int           rowno;     /*< The next row */
+    MXS_HISTOGRAM qtimes;    /*< Merged queue times */
+    MXS_HISTOGRAM exectimes; /*< Merged execution times */
+} EVENT_TIMES_SET;
+
 /**
  * Provide a row to the result set that defines the event queue statistics
  *
@@ -1560,39 +2175,43 @@ int64_t poll_get_stat(POLL_STAT stat)
 static RESULT_ROW *
 eventTimesRowCallback(RESULTSET *set, void *data)
 {
-    int *rowno = (int *)data;
+    EVENT_TIMES_SET *times = (EVENT_TIMES_SET *)data;
     char buf[40];
     RESULT_ROW *row;
+    int rowno = times->rowno;
+    uint64_t low = (uint64_t)rowno * QUEUE_TIME_NS;
+    uint64_t high = low + QUEUE_TIME_NS;
 
-    if (*rowno >= N_QUEUE_TIMES)
+    if (rowno > N_QUEUE_TIMES)
     {
         MXS_FREE(data);
         return NULL;
     }
     row = resultset_make_row(set);
-    if (*rowno == 0)
+    if (rowno == 0)
     {
         resultset_row_set(row, 0, "< 100ms");
     }
-    else if (*rowno == N_QUEUE_TIMES - 1)
+    else if (rowno == N_QUEUE_TIMES)
     {
         snprintf(buf, 39, "> %2d00ms", N_QUEUE_TIMES);
         buf[39] = '\0';
         resultset_row_set(row, 0, buf);
+        high = UINT64_MAX;
     }
     else
     {
-        snprintf(buf, 39, "%2d00 - %2d00ms", *rowno, (*rowno) + 1);
+        snprintf(buf, 39, "%2d00 - %2d00ms", rowno, rowno + 1);
         buf[39] = '\0';
         resultset_row_set(row, 0, buf);
     }
-    snprintf(buf, 39, "%u", queueStats.qtimes[*rowno]);
+    snprintf(buf, 39, "%" PRIu64, mxs_histogram_count(&times->qtimes, low, high));
     buf[39] = '\0';
     resultset_row_set(row, 1, buf);
-    snprintf(buf, 39, "%u", queueStats.exectimes[*rowno]);
+    snprintf(buf, 39, "%" PRIu64, mxs_histogram_count(&times->exectimes, low, high));
     buf[39] = '\0';
     resultset_row_set(row, 2, buf);
-    (*rowno)++;
+    times->rowno++;
     return row;
 }
 
@@ -1605,13 +2224,14 @@ RESULTSET *
 eventTimesGetList()
 {
     RESULTSET *set;
-    int *data;
+    EVENT_TIMES_SET *data;
 
-    if ((data = (int *)MXS_MALLOC(sizeof(int))) == NULL)
+    if ((data = (EVENT_TIMES_SET *)MXS_MALLOC(sizeof(EVENT_TIMES_SET))) == NULL)
     {
         return NULL;
     }
-    *data = 0;
+    data->rowno = 0;
+    poll_get_event_times(POLL_N_EVENT_TYPES, &data->qtimes, &data->exectimes);
     if ((set = resultset_create(eventTimesRowCallback, data)) == NULL)
     {
         MXS_FREE(data);
@@ -1624,6 +2244,85 @@ eventTimesGetList()
     return set;
 }
 
+/**
+ * Provide a row to the result set that defines the event time percentiles
+ *
+ * @param set   The result set
+ * @param data  The index of the row to send
+ * @return The next row or NULL
+ */
+static RESULT_ROW *
+eventLatenciesRowCallback(RESULTSET *set, void *data)
+{
+    EVENT_TIMES_SET *times = (EVENT_TIMES_SET *)data;
+    char buf[40];
+    RESULT_ROW *row;
+
+    if (times->rowno >= POLL_N_EVENT_TYPES)
+    {
+        MXS_FREE(data);
+        return NULL;
+    }
+
+    poll_get_event_times(times->rowno, &times->qtimes, &times->exectimes);
+
+    MXS_HISTOGRAM *hist[] = {&times->qtimes, &times->exectimes};
+    double percentiles[] = {50, 99, 99.9};
+    int col = 0;
+
+    row = resultset_make_row(set);
+    resultset_row_set(row, col++, poll_event_type_names[times->rowno]);
+    snprintf(buf, sizeof(buf), "%" PRIu64, times->exectimes.total);
+    resultset_row_set(row, col++, buf);
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            snprintf(buf, sizeof(buf), "%.1f",
+                     poll_ns_to_us(mxs_histogram_percentile(hist[i], percentiles[j])));
+            resultset_row_set(row, col++, buf);
+        }
+    }
+
+    times->rowno++;
+    return row;
+}
+
+/**
+ * Return a result set with the queue and execution time percentiles of
+ * each event type, in microseconds
+ *
+ * @return A Result set
+ */
+RESULTSET *
+eventLatenciesGetList()
+{
+    RESULTSET *set;
+    EVENT_TIMES_SET *data;
+
+    if ((data = (EVENT_TIMES_SET *)MXS_MALLOC(sizeof(EVENT_TIMES_SET))) == NULL)
+    {
+        return NULL;
+    }
+    data->rowno = 0;
+    if ((set = resultset_create(eventLatenciesRowCallback, data)) == NULL)
+    {
+        MXS_FREE(data);
+        return NULL;
+    }
+    resultset_add_column(set, "Event Type", 10, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "No. Events", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Queue p50", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Queue p99", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Queue p999", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Executed p50", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Executed p99", 12, COL_TYPE_VARCHAR);
+    resultset_add_column(set, "Executed p999", 12, COL_TYPE_VARCHAR);
+
+    return set;
+}
+
 void poll_send_message(enum poll_message msg, void *data)
 {
     spinlock_acquire(&poll_msg_lock);
@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * @file poll_uring.c - The io_uring poll engine
+ *
+ * The engine uses the io_uring system calls directly so that it does not add
+ * a build dependency. It needs multishot poll requests and timed waits, which
+ * are available from Linux 5.13 onwards. On older kernels poll_uring_init
+ * fails and the epoll engine is used instead.
+ *
+ * The user data of a poll request contains the descriptor and a generation
+ * number. A descriptor that is removed gets a new generation when it is added
+ * again, which means that completions of an old request are recognized and
+ * ignored even if they are still in the completion queue.
+ */
+
+#include "maxscale/poll_uring.h"
+
+#include <errno.h>
+
+#include <maxscale/platform.h>
+
+#if defined(HAVE_IO_URING)
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_IO_URING) && defined(IORING_POLL_ADD_MULTI) && defined(IORING_FEAT_EXT_ARG) && \
+    defined(IORING_FEAT_RSRC_TAGS)
+
+#include <endian.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+#include <maxscale/spinlock.h>
+
+/** Number of submission queue entries */
+#define URING_SQ_ENTRIES 1024
+/** Number of completion queue entries, each polled descriptor can have several */
+#define URING_CQ_ENTRIES 16384
+/** User data of the wakeup descriptor's poll request */
+#define URING_WAKEUP_DATA UINT64_MAX
+/** User data of requests whose completions are ignored */
+#define URING_IGNORE_DATA (UINT64_MAX - 1)
+
+/** Features that the engine needs. Resource tags were added in the same
+ * release as multishot poll requests and there is no separate flag for them. */
+#define URING_FEATURES (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | \
+                        IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS)
+
+/**
+ * A polled descriptor
+ */
+typedef struct
+{
+    void     *ptr;    /*< The data returned with the events */
+    uint32_t events;  /*< The polled events */
+    uint32_t gen;     /*< Generation of the poll request, 0 if not polled */
+} uring_fd_t;
+
+/**
+ * The io_uring instance of a thread
+ */
+typedef struct
+{
+    int                  ring_fd;    /*< The io_uring descriptor */
+    int                  wakeup_fd;  /*< Written to when other threads add requests */
+    SPINLOCK             lock;       /*< Protects the submission queue and the descriptors */
+    unsigned            *sq_head;    /*< Head of the submission queue, written by the kernel */
+    unsigned            *sq_tail;    /*< Tail of the submission queue */
+    unsigned             sq_mask;
+    unsigned             sq_entries;
+    struct io_uring_sqe *sqes;       /*< The submission queue entries */
+    unsigned            *cq_head;    /*< Head of the completion queue */
+    unsigned            *cq_tail;    /*< Tail of the completion queue, written by the kernel */
+    unsigned             cq_mask;
+    struct io_uring_cqe *cqes;       /*< The completion queue entries */
+    uring_fd_t          *fds;        /*< Polled descriptors, indexed by the descriptor */
+    int                  n_fds;      /*< Size of the fds array */
+    uint32_t             gen;        /*< The latest generation */
+} poll_uring_t;
+
+static poll_uring_t *rings = NULL;
+static int n_rings = 0;
+
+/** The instance owned by this thread, -1 for threads that do not poll */
+static thread_local int uring_owner = -1;
+
+static inline int uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int uring_enter(poll_uring_t *ring, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, struct io_uring_getevents_arg *arg)
+{
+    return syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, min_complete,
+                   flags, arg, arg ? sizeof(*arg) : 0);
+}
+
+/**
+ * Map the queues of an io_uring instance
+ *
+ * @param ring   The instance
+ * @param params The parameters returned by io_uring_setup
+ *
+ * @return True on success
+ */
+static bool uring_map(poll_uring_t *ring, struct io_uring_params *params)
+{
+    size_t sq_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    size_t cq_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    size_t size = sq_size > cq_size ? sq_size : cq_size;
+
+    /** With IORING_FEAT_SINGLE_MMAP both queues are in the same mapping */
+    char *queues = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_SQ_RING);
+
+    if (queues == MAP_FAILED)
+    {
+        return false;
+    }
+
+    ring->sqes = mmap(NULL, params->sq_entries * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+
+    if (ring->sqes == MAP_FAILED)
+    {
+        munmap(queues, size);
+        return false;
+    }
+
+    ring->sq_head = (unsigned*)(queues + params->sq_off.head);
+    ring->sq_tail = (unsigned*)(queues + params->sq_off.tail);
+    ring->sq_mask = *(unsigned*)(queues + params->sq_off.ring_mask);
+    ring->sq_entries = *(unsigned*)(queues + params->sq_off.ring_entries);
+    ring->cq_head = (unsigned*)(queues + params->cq_off.head);
+    ring->cq_tail = (unsigned*)(queues + params->cq_off.tail);
+    ring->cq_mask = *(unsigned*)(queues + params->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(queues + params->cq_off.cqes);
+
+    /** The submission queue entries are always used in order */
+    unsigned *array = (unsigned*)(queues + params->sq_off.array);
+
+    for (unsigned i = 0; i < ring->sq_entries; i++)
+    {
+        array[i] = i;
+    }
+
+    return true;
+}
+
+/**
+ * Get the number of requests that have not been submitted
+ *
+ * @param ring The instance
+ *
+ * @return Number of requests in the submission queue
+ */
+static inline unsigned uring_pending(poll_uring_t *ring)
+{
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Add a request to the submission queue. The caller must hold the lock.
+ *
+ * If the queue is full, the owner of the instance submits the queued requests
+ * and other threads wait until the owner has done so.
+ *
+ * @param ring The instance
+ *
+ * @return A cleared submission queue entry
+ */
+static struct io_uring_sqe* uring_get_sqe(poll_uring_t *ring)
+{
+    while (uring_pending(ring) >= ring->sq_entries)
+    {
+        if (uring_owner == ring - rings)
+        {
+            uring_enter(ring, uring_pending(ring), 0, 0, NULL);
+        }
+        else
+        {
+            uint64_t one = 1;
+            write(ring->wakeup_fd, &one, sizeof(one));
+            spinlock_release(&ring->lock);
+            sched_yield();
+            spinlock_acquire(&ring->lock);
+        }
+    }
+
+    struct io_uring_sqe *sqe = &ring->sqes[*ring->sq_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/**
+ * Make the latest request visible to the kernel. The caller must hold the lock.
+ *
+ * @param ring The instance
+ */
+static inline void uring_commit_sqe(poll_uring_t *ring)
+{
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Queue a multishot poll request. The caller must hold the lock.
+ *
+ * @param ring   The instance
+ * @param fd     The descriptor
+ * @param events The polled events
+ * @param data   The user data of the request
+ */
+static void uring_queue_poll(poll_uring_t *ring, int fd, uint32_t events, uint64_t data)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+    events = (events << 16) | (events >> 16);
+#endif
+    sqe->poll32_events = events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = data;
+    uring_commit_sqe(ring);
+}
+
+/**
+ * Queue the removal of a poll request. The caller must hold the lock.
+ *
+ * @param ring The instance
+ * @param data The user data of the poll request
+ */
+static void uring_queue_poll_remove(poll_uring_t *ring, uint64_t data)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = data;
+    sqe->user_data = URING_IGNORE_DATA;
+    uring_commit_sqe(ring);
+}
+
+static inline uint64_t uring_data(int fd, uint32_t gen)
+{
+    return ((uint64_t)gen << 32) | (uint32_t)fd;
+}
+
+/**
+ * Make room for a descriptor. The caller must hold the lock.
+ *
+ * @param ring The instance
+ * @param fd   The descriptor
+ *
+ * @return True if the descriptor fits in the array
+ */
+static bool uring_reserve(poll_uring_t *ring, int fd)
+{
+    if (fd >= ring->n_fds)
+    {
+        int n_fds = ring->n_fds ? ring->n_fds : 1024;
+
+        while (fd >= n_fds)
+        {
+            n_fds *= 2;
+        }
+
+        uring_fd_t *fds = MXS_REALLOC(ring->fds, n_fds * sizeof(uring_fd_t));
+
+        if (fds == NULL)
+        {
+            return false;
+        }
+
+        memset(fds + ring->n_fds, 0, (n_fds - ring->n_fds) * sizeof(uring_fd_t));
+        ring->fds = fds;
+        ring->n_fds = n_fds;
+    }
+
+    return true;
+}
+
+/**
+ * Free the instances after a failed initialization
+ *
+ * @param n_threads Number of instances
+ */
+static void uring_free(int n_threads)
+{
+    int eno = errno;
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        if (rings[i].ring_fd != -1)
+        {
+            close(rings[i].ring_fd);
+        }
+
+        if (rings[i].wakeup_fd != -1)
+        {
+            close(rings[i].wakeup_fd);
+        }
+    }
+
+    MXS_FREE(rings);
+    rings = NULL;
+    errno = eno;
+}
+
+bool poll_uring_init(int n_threads)
+{
+    if ((rings = MXS_CALLOC(n_threads, sizeof(poll_uring_t))) == NULL)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        rings[i].ring_fd = -1;
+        rings[i].wakeup_fd = -1;
+    }
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        poll_uring_t *ring = &rings[i];
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = URING_CQ_ENTRIES;
+
+        spinlock_init(&ring->lock);
+
+        if ((ring->ring_fd = uring_setup(URING_SQ_ENTRIES, &params)) == -1)
+        {
+            uring_free(n_threads);
+            return false;
+        }
+
+        if ((params.features & URING_FEATURES) != URING_FEATURES)
+        {
+            errno = ENOTSUP;
+            uring_free(n_threads);
+            return false;
+        }
+
+        if (!uring_map(ring, &params) ||
+            (ring->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+        {
+            uring_free(n_threads);
+            return false;
+        }
+
+        /** Submitted by the owner when it first waits for events */
+        uring_queue_poll(ring, ring->wakeup_fd, EPOLLIN, URING_WAKEUP_DATA);
+    }
+
+    n_rings = n_threads;
+    return true;
+}
+
+int poll_uring_ctl(int thread_id, int op, int fd, struct epoll_event *event)
+{
+    ss_dassert(thread_id >= 0 && thread_id < n_rings);
+    poll_uring_t *ring = &rings[thread_id];
+    int rval = 0;
+
+    spinlock_acquire(&ring->lock);
+
+    if (op == EPOLL_CTL_ADD)
+    {
+        if (fd < 0 || !uring_reserve(ring, fd))
+        {
+            errno = fd < 0 ? EBADF : ENOMEM;
+            rval = -1;
+        }
+        else if (ring->fds[fd].gen)
+        {
+            errno = EEXIST;
+            rval = -1;
+        }
+        else
+        {
+            if (++ring->gen == 0)
+            {
+                ring->gen = 1;
+            }
+
+            ring->fds[fd].ptr = event->data.ptr;
+            ring->fds[fd].events = event->events;
+            ring->fds[fd].gen = ring->gen;
+            uring_queue_poll(ring, fd, event->events, uring_data(fd, ring->gen));
+        }
+    }
+    else if (op == EPOLL_CTL_DEL)
+    {
+        if (fd < 0 || fd >= ring->n_fds || ring->fds[fd].gen == 0)
+        {
+            errno = ENOENT;
+            rval = -1;
+        }
+        else
+        {
+            uint64_t data = uring_data(fd, ring->fds[fd].gen);
+            ring->fds[fd].gen = 0;
+            uring_queue_poll_remove(ring, data);
+        }
+    }
+    else
+    {
+        errno = EINVAL;
+        rval = -1;
+    }
+
+    spinlock_release(&ring->lock);
+
+    if (rval == 0 && uring_owner != thread_id)
+    {
+        /** Wake up the owner so that it submits the request */
+        uint64_t one = 1;
+        write(ring->wakeup_fd, &one, sizeof(one));
+    }
+
+    return rval;
+}
+
+/**
+ * Convert completions into epoll events
+ *
+ * @param ring      The instance
+ * @param events    Array where events are stored
+ * @param maxevents Size of the array
+ *
+ * @return Number of events
+ */
+static int uring_reap(poll_uring_t *ring, struct epoll_event *events, int maxevents)
+{
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    int n = 0;
+
+    if (head == tail)
+    {
+        return 0;
+    }
+
+    spinlock_acquire(&ring->lock);
+
+    while (head != tail && n < maxevents)
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        uint64_t data = cqe->user_data;
+        int32_t res = cqe->res;
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        head++;
+
+        if (data == URING_IGNORE_DATA)
+        {
+            continue;
+        }
+        else if (data == URING_WAKEUP_DATA)
+        {
+            uint64_t count;
+            read(ring->wakeup_fd, &count, sizeof(count));
+
+            if (!more)
+            {
+                uring_queue_poll(ring, ring->wakeup_fd, EPOLLIN, URING_WAKEUP_DATA);
+            }
+            continue;
+        }
+
+        int fd = (int)(data & UINT32_MAX);
+        uint32_t gen = data >> 32;
+
+        if (fd >= ring->n_fds || ring->fds[fd].gen != gen)
+        {
+            /** The descriptor was removed after the event was generated */
+            continue;
+        }
+
+        if (res < 0 && res != -ECANCELED)
+        {
+            /** The request failed, report it as an error on the descriptor */
+            events[n].events = EPOLLERR | EPOLLHUP;
+            events[n].data.ptr = ring->fds[fd].ptr;
+            n++;
+            continue;
+        }
+
+        if (!more)
+        {
+            /** The kernel terminated the multishot request, for example because
+             * the completion queue overflowed. */
+            uring_queue_poll(ring, fd, ring->fds[fd].events, data);
+        }
+
+        if (res > 0)
+        {
+            events[n].events = res;
+            events[n].data.ptr = ring->fds[fd].ptr;
+            n++;
+        }
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    spinlock_release(&ring->lock);
+
+    return n;
+}
+
+int poll_uring_wait(int thread_id, struct epoll_event *events, int maxevents, int timeout)
+{
+    ss_dassert(thread_id >= 0 && thread_id < n_rings);
+    poll_uring_t *ring = &rings[thread_id];
+    uring_owner = thread_id;
+
+    int n = uring_reap(ring, events, maxevents);
+    unsigned to_submit = uring_pending(ring);
+
+    if (n > 0 || timeout == 0)
+    {
+        /** Submit the queued requests without waiting */
+        if (to_submit && uring_enter(ring, to_submit, 0, 0, NULL) == -1 && errno != EBUSY)
+        {
+            return n > 0 ? n : -1;
+        }
+    }
+    else
+    {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+
+        if (timeout > 0)
+        {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+
+        if (uring_enter(ring, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg) == -1 &&
+            errno != ETIME && errno != EBUSY)
+        {
+            return -1;
+        }
+    }
+
+    return n + uring_reap(ring, events + n, maxevents - n);
+}
+
+#else
+
+bool poll_uring_init(int n_threads)
+{
+    errno = ENOSYS;
+    return false;
+}
+
+int poll_uring_ctl(int thread_id, int op, int fd, struct epoll_event *event)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+int poll_uring_wait(int thread_id, struct epoll_event *events, int maxevents, int timeout)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
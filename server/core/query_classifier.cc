@@ -12,12 +12,20 @@
  */
 
 #include "maxscale/query_classifier.h"
+#include <ctype.h>
+#include <list>
+#include <string>
+#include <tr1/unordered_map>
 #include <maxscale/log_manager.h>
 #include <maxscale/modutil.h>
 #include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
 #include <maxscale/platform.h>
 #include <maxscale/pcre2.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/spinlock.hh>
 #include <maxscale/utils.h>
+#include "maxscale/preclassifier.hh"
 #include "maxscale/trxboundaryparser.hh"
 
 #include "../core/maxscale/modules.h"
@@ -44,6 +52,8 @@ static QUERY_CLASSIFIER* classifier;
 
 static qc_trx_parse_using_t qc_trx_parse_using = QC_TRX_PARSE_USING_PARSER;
 
+static bool qc_preclassifier_enabled = false;
+
 
 bool qc_setup(const char* plugin_name, const char* plugin_args)
 {
@@ -178,14 +188,687 @@ void qc_thread_end(uint32_t kind)
     }
 }
 
+/**
+ * The classification cache
+ *
+ * The result of classifying a COM_QUERY is stored using the canonical form of
+ * the statement as the key. When a statement with the same canonical form is
+ * classified, the cached result is attached to the buffer and the statement is
+ * not parsed at all. The cache is divided into shards, each with its own lock
+ * and LRU list, so that the worker threads seldom contend for the same lock.
+ *
+ * A statement is canonicalized only once, the canonical form and the entry
+ * are stored in a reference that is attached to the buffer. An entry contains
+ * only the information that was collected when the statement was parsed. If
+ * more is needed later, the statement is parsed again with everything collected
+ * and the entry is replaced.
+ *
+ * A result is only cached if it cannot depend on the replaced literals:
+ * statements that set system variables (e.g. SET autocommit=?), PREPARE
+ * statements, statements with executable comments or variables, and
+ * statements with names that do not appear in the canonical form (e.g. names
+ * quoted with double quotes) are always parsed.
+ */
+
+/** A cached classification result, shared by the cache and the buffers */
+typedef struct qc_cache_entry
+{
+    int               refcount;
+    uint32_t          collected;     /**< What was collected, see qc_collect_info_t */
+    uint32_t          type_mask;
+    int32_t           op;
+    int32_t           has_clause;
+    int32_t           is_drop_table;
+    char*             created_table_name;
+    char*             prepare_name;
+    char**            table_names;
+    int               n_table_names;
+    char**            table_fullnames;
+    int               n_table_fullnames;
+    char**            database_names;
+    int               n_database_names;
+    QC_FIELD_INFO*    field_infos;
+    uint32_t          n_field_infos;
+    QC_FUNCTION_INFO* function_infos;
+    uint32_t          n_function_infos;
+} QC_CACHE_ENTRY;
+
+/** The classification cache information attached to a buffer */
+typedef struct qc_cache_ref
+{
+    char*           canonical; /**< The cache key, NULL if the statement is not cached */
+    QC_CACHE_ENTRY* entry;     /**< The entry of the statement or NULL */
+} QC_CACHE_REF;
+
+typedef std::list<std::pair<std::string, QC_CACHE_ENTRY*> > QcCacheList;
+typedef std::tr1::unordered_map<std::string, QcCacheList::iterator> QcCacheIndex;
+
+typedef struct qc_cache_shard
+{
+    maxscale::SpinLock lock;
+    QcCacheList        lru;   /**< Most recently used entry first */
+    QcCacheIndex       index;
+    int64_t            hits;
+    int64_t            misses;
+    int64_t            inserts;
+    int64_t            evictions;
+} QC_CACHE_SHARD;
+
+/** Number of independently locked parts of the cache */
+#define QC_CACHE_SHARDS 16
+
+/** Longer statements are not cached, they are rarely repeated and their
+ * canonical forms would take too much space */
+#define QC_CACHE_MAX_STMT_LEN 4096
+
+/** The type bits that depend on the values of the statement */
+static const uint32_t QC_CACHE_EXCLUDED_TYPES = QUERY_TYPE_GSYSVAR_WRITE |
+                                                QUERY_TYPE_ENABLE_AUTOCOMMIT |
+                                                QUERY_TYPE_DISABLE_AUTOCOMMIT |
+                                                QUERY_TYPE_PREPARE_NAMED_STMT;
+
+static QC_CACHE_SHARD qc_cache_shards[QC_CACHE_SHARDS];
+static int64_t qc_cache_max_size = 0;
+static int64_t qc_cache_shard_max_size = 0;
+
+static void qc_cache_free_names(char** names, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        MXS_FREE(names[i]);
+    }
+
+    MXS_FREE(names);
+}
+
+static void qc_cache_entry_free(QC_CACHE_ENTRY* entry)
+{
+    MXS_FREE(entry->created_table_name);
+    MXS_FREE(entry->prepare_name);
+    qc_cache_free_names(entry->table_names, entry->n_table_names);
+    qc_cache_free_names(entry->table_fullnames, entry->n_table_fullnames);
+    qc_cache_free_names(entry->database_names, entry->n_database_names);
+
+    for (uint32_t i = 0; i < entry->n_field_infos; i++)
+    {
+        MXS_FREE(entry->field_infos[i].database);
+        MXS_FREE(entry->field_infos[i].table);
+        MXS_FREE(entry->field_infos[i].column);
+    }
+
+    MXS_FREE(entry->field_infos);
+
+    for (uint32_t i = 0; i < entry->n_function_infos; i++)
+    {
+        MXS_FREE(entry->function_infos[i].name);
+    }
+
+    MXS_FREE(entry->function_infos);
+    MXS_FREE(entry);
+}
+
+static void qc_cache_entry_release(void* data)
+{
+    QC_CACHE_ENTRY* entry = (QC_CACHE_ENTRY*)data;
+
+    if (atomic_add(&entry->refcount, -1) == 1)
+    {
+        qc_cache_entry_free(entry);
+    }
+}
+
+static void qc_cache_ref_free(void* data)
+{
+    QC_CACHE_REF* ref = (QC_CACHE_REF*)data;
+
+    if (ref->entry)
+    {
+        qc_cache_entry_release(ref->entry);
+    }
+
+    MXS_FREE(ref->canonical);
+    MXS_FREE(ref);
+}
+
+static inline bool qc_cache_entry_has(const QC_CACHE_ENTRY* entry, uint32_t collect)
+{
+    return (entry->collected & collect) == collect;
+}
+
+static char* qc_cache_strdup(const char* str)
+{
+    return str ? MXS_STRDUP_A(str) : NULL;
+}
+
+static char** qc_cache_copy_names(char** names, int n)
+{
+    char** copy = NULL;
+
+    if (n > 0)
+    {
+        copy = (char**)MXS_MALLOC((n + 1) * sizeof(char*));
+        MXS_ABORT_IF_NULL(copy);
+        copy[n] = NULL;
+
+        for (int i = 0; i < n; i++)
+        {
+            copy[i] = MXS_STRDUP_A(names[i]);
+        }
+    }
+
+    return copy;
+}
+
+static inline bool qc_cache_is_name_char(char c)
+{
+    return isalnum(c) || c == '_' || c == '$';
+}
+
+/**
+ * Check that a name is found in the canonical statement as a whole word
+ *
+ * A name that is not found came from a replaced literal and the next statement
+ * with the same canonical form could have a different name in its place.
+ *
+ * @param canonical The canonical statement
+ * @param name      The name to look for
+ *
+ * @return True if the name is found
+ */
+static bool qc_cache_has_name(const char* canonical, const char* name)
+{
+    size_t len = strlen(name);
+
+    if (len == 0)
+    {
+        return true;
+    }
+
+    for (const char* p = strcasestr(canonical, name); p; p = strcasestr(p + 1, name))
+    {
+        if ((p == canonical || !qc_cache_is_name_char(name[0]) || !qc_cache_is_name_char(p[-1])) &&
+            (!qc_cache_is_name_char(name[len - 1]) || !qc_cache_is_name_char(p[len])))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool qc_cache_has_names(const char* canonical, char** names, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (!qc_cache_has_name(canonical, names[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Check whether the entry can be used for all statements with its canonical form
+ */
+static bool qc_cache_is_cacheable(const QC_CACHE_ENTRY* entry, const char* canonical)
+{
+    bool rval = (entry->type_mask & QC_CACHE_EXCLUDED_TYPES) == 0 &&
+                qc_cache_has_names(canonical, entry->table_names, entry->n_table_names) &&
+                qc_cache_has_names(canonical, entry->database_names, entry->n_database_names) &&
+                (!entry->created_table_name || qc_cache_has_name(canonical, entry->created_table_name)) &&
+                (!entry->prepare_name || qc_cache_has_name(canonical, entry->prepare_name));
+
+    for (uint32_t i = 0; rval && i < entry->n_field_infos; i++)
+    {
+        const QC_FIELD_INFO* info = &entry->field_infos[i];
+
+        rval = qc_cache_has_name(canonical, info->column) &&
+               (!info->table || qc_cache_has_name(canonical, info->table)) &&
+               (!info->database || qc_cache_has_name(canonical, info->database));
+    }
+
+    for (uint32_t i = 0; rval && i < entry->n_function_infos; i++)
+    {
+        rval = qc_cache_has_name(canonical, entry->function_infos[i].name);
+    }
+
+    return rval;
+}
+
+/**
+ * Create a cache entry from a statement that the plugin has parsed
+ *
+ * Only the information that was collected is copied, asking the plugin for
+ * anything else would make it parse the statement again.
+ *
+ * @param query   A parsed statement
+ * @param collect What the plugin collected when it parsed the statement
+ *
+ * @return A new entry with a reference count of one, or NULL if the plugin
+ *         could not provide all the information
+ */
+static QC_CACHE_ENTRY* qc_cache_entry_create(GWBUF* query, uint32_t collect)
+{
+    QC_CACHE_ENTRY* entry = (QC_CACHE_ENTRY*)MXS_CALLOC(1, sizeof(QC_CACHE_ENTRY));
+    MXS_ABORT_IF_NULL(entry);
+    entry->refcount = 1;
+    entry->collected = collect;
+
+    const QC_FIELD_INFO* field_infos = NULL;
+    const QC_FUNCTION_INFO* function_infos = NULL;
+
+    if (classifier->qc_get_type_mask(query, &entry->type_mask) != QC_RESULT_OK ||
+        classifier->qc_get_operation(query, &entry->op) != QC_RESULT_OK ||
+        classifier->qc_query_has_clause(query, &entry->has_clause) != QC_RESULT_OK ||
+        classifier->qc_is_drop_table_query(query, &entry->is_drop_table) != QC_RESULT_OK ||
+        classifier->qc_get_prepare_name(query, &entry->prepare_name) != QC_RESULT_OK ||
+        ((collect & QC_COLLECT_TABLES) &&
+         (classifier->qc_get_table_names(query, 0, &entry->table_names,
+                                         &entry->n_table_names) != QC_RESULT_OK ||
+          classifier->qc_get_table_names(query, 1, &entry->table_fullnames,
+                                         &entry->n_table_fullnames) != QC_RESULT_OK)) ||
+        ((collect & QC_COLLECT_DATABASES) &&
+         classifier->qc_get_database_names(query, &entry->database_names,
+                                           &entry->n_database_names) != QC_RESULT_OK) ||
+        ((collect & QC_COLLECT_FIELDS) &&
+         classifier->qc_get_field_info(query, &field_infos, &entry->n_field_infos) != QC_RESULT_OK) ||
+        ((collect & QC_COLLECT_FUNCTIONS) &&
+         classifier->qc_get_function_info(query, &function_infos,
+                                          &entry->n_function_infos) != QC_RESULT_OK))
+    {
+        /** The field and function infos belong to the plugin */
+        entry->n_field_infos = 0;
+        entry->n_function_infos = 0;
+        qc_cache_entry_free(entry);
+        return NULL;
+    }
+
+    if (collect & QC_COLLECT_TABLES)
+    {
+        /** An error only means that the statement does not create a table */
+        classifier->qc_get_created_table_name(query, &entry->created_table_name);
+    }
+
+    if (entry->n_field_infos > 0)
+    {
+        entry->field_infos = (QC_FIELD_INFO*)MXS_MALLOC(entry->n_field_infos * sizeof(QC_FIELD_INFO));
+        MXS_ABORT_IF_NULL(entry->field_infos);
+
+        for (uint32_t i = 0; i < entry->n_field_infos; i++)
+        {
+            entry->field_infos[i].database = qc_cache_strdup(field_infos[i].database);
+            entry->field_infos[i].table = qc_cache_strdup(field_infos[i].table);
+            entry->field_infos[i].column = qc_cache_strdup(field_infos[i].column);
+            entry->field_infos[i].usage = field_infos[i].usage;
+        }
+    }
+
+    if (entry->n_function_infos > 0)
+    {
+        entry->function_infos =
+            (QC_FUNCTION_INFO*)MXS_MALLOC(entry->n_function_infos * sizeof(QC_FUNCTION_INFO));
+        MXS_ABORT_IF_NULL(entry->function_infos);
+
+        for (uint32_t i = 0; i < entry->n_function_infos; i++)
+        {
+            entry->function_infos[i].name = qc_cache_strdup(function_infos[i].name);
+            entry->function_infos[i].usage = function_infos[i].usage;
+        }
+    }
+
+    return entry;
+}
+
+static QC_CACHE_SHARD* qc_cache_get_shard(const std::string& key)
+{
+    /** The low bits of the string hash are poorly distributed for statements
+     * that differ only at the end, so the hash is mixed before it is used */
+    uint64_t hash = std::tr1::hash<std::string>()(key) * UINT64_C(0x9E3779B97F4A7C15);
+    return &qc_cache_shards[(hash >> 32) % QC_CACHE_SHARDS];
+}
+
+/**
+ * Find an entry and mark it as the most recently used one
+ *
+ * @return The entry with its reference count incremented or NULL if not found
+ */
+static QC_CACHE_ENTRY* qc_cache_find(const std::string& key)
+{
+    QC_CACHE_SHARD* shard = qc_cache_get_shard(key);
+    QC_CACHE_ENTRY* entry = NULL;
+    maxscale::SpinLockGuard guard(shard->lock);
+    QcCacheIndex::iterator it = shard->index.find(key);
+
+    if (it != shard->index.end())
+    {
+        shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+        entry = it->second->second;
+        atomic_add(&entry->refcount, 1);
+        shard->hits++;
+    }
+    else
+    {
+        shard->misses++;
+    }
+
+    return entry;
+}
+
+/**
+ * Add an entry, removing the least recently used ones if the shard is full
+ *
+ * An existing entry is replaced if the new one contains more information.
+ *
+ * @param key   The canonical statement
+ * @param entry The entry, the cache takes over the reference of the caller
+ */
+static void qc_cache_insert(const std::string& key, QC_CACHE_ENTRY* entry)
+{
+    QC_CACHE_SHARD* shard = qc_cache_get_shard(key);
+    std::list<QC_CACHE_ENTRY*> evicted;
+
+    {
+        maxscale::SpinLockGuard guard(shard->lock);
+        QcCacheIndex::iterator it = shard->index.find(key);
+
+        if (it != shard->index.end())
+        {
+            QC_CACHE_ENTRY* old_entry = it->second->second;
+
+            if (!qc_cache_entry_has(old_entry, entry->collected))
+            {
+                shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+                it->second->second = entry;
+                shard->inserts++;
+                evicted.push_back(old_entry);
+                entry = NULL;
+            }
+        }
+        else
+        {
+            while (!shard->lru.empty() && (int64_t)shard->lru.size() >= qc_cache_shard_max_size)
+            {
+                evicted.push_back(shard->lru.back().second);
+                shard->index.erase(shard->lru.back().first);
+                shard->lru.pop_back();
+                shard->evictions++;
+            }
+
+            shard->lru.push_front(std::make_pair(key, entry));
+            shard->index[key] = shard->lru.begin();
+            shard->inserts++;
+            entry = NULL;
+        }
+    }
+
+    if (entry)
+    {
+        /** Another thread added the statement */
+        evicted.push_back(entry);
+    }
+
+    for (std::list<QC_CACHE_ENTRY*>::iterator it = evicted.begin(); it != evicted.end(); it++)
+    {
+        qc_cache_entry_release(*it);
+    }
+}
+
+/**
+ * Remove an entry
+ *
+ * @param key The canonical statement
+ */
+static void qc_cache_remove(const std::string& key)
+{
+    QC_CACHE_SHARD* shard = qc_cache_get_shard(key);
+    QC_CACHE_ENTRY* entry = NULL;
+
+    {
+        maxscale::SpinLockGuard guard(shard->lock);
+        QcCacheIndex::iterator it = shard->index.find(key);
+
+        if (it != shard->index.end())
+        {
+            entry = it->second->second;
+            shard->lru.erase(it->second);
+            shard->index.erase(it);
+        }
+    }
+
+    if (entry)
+    {
+        qc_cache_entry_release(entry);
+    }
+}
+
+/**
+ * Check the properties of the statement that can be seen without canonicalizing it
+ */
+static bool qc_cache_is_candidate(GWBUF* query)
+{
+    char* sql;
+    int len;
+
+    return query->next == NULL &&
+           GWBUF_LENGTH(query) > MYSQL_HEADER_LEN + 1 &&
+           GWBUF_LENGTH(query) <= MYSQL_HEADER_LEN + 1 + QC_CACHE_MAX_STMT_LEN &&
+           modutil_is_SQL(query) &&
+           modutil_extract_SQL(query, &sql, &len) &&
+           len == (int)(GWBUF_LENGTH(query) - MYSQL_HEADER_LEN - 1) &&
+           !memmem(sql, len, "/*!", 3) &&
+           !memmem(sql, len, "/*M!", 4);
+}
+
+/**
+ * Get the cache reference of a statement
+ *
+ * The statement is canonicalized when the reference is created, so that it
+ * is done at most once per buffer.
+ *
+ * @param query The statement
+ *
+ * @return The reference or NULL if the statement was parsed before the cache
+ *         was consulted
+ */
+static QC_CACHE_REF* qc_cache_get_ref(GWBUF* query)
+{
+    QC_CACHE_REF* ref = (QC_CACHE_REF*)gwbuf_get_buffer_object_data(query, GWBUF_QC_CACHE_INFO);
+
+    if (ref == NULL && !GWBUF_IS_PARSED(query))
+    {
+        ref = (QC_CACHE_REF*)MXS_CALLOC(1, sizeof(QC_CACHE_REF));
+        MXS_ABORT_IF_NULL(ref);
+
+        if (qc_cache_is_candidate(query))
+        {
+            ref->canonical = modutil_get_canonical(query);
+
+            if (ref->canonical && strchr(ref->canonical, '@'))
+            {
+                /** The names of variables are replaced in the canonical form */
+                MXS_FREE(ref->canonical);
+                ref->canonical = NULL;
+            }
+        }
+
+        gwbuf_add_buffer_object(query, GWBUF_QC_CACHE_INFO, ref, qc_cache_ref_free);
+    }
+
+    return ref;
+}
+
+/**
+ * Parse a statement and store the result in the cache
+ *
+ * @param query   The statement
+ * @param ref     The cache reference of the statement
+ * @param collect What information is needed
+ */
+static void qc_cache_update(GWBUF* query, QC_CACHE_REF* ref, uint32_t collect)
+{
+    if (ref->entry)
+    {
+        /** The new entry replaces the current one. Like the plugins do, everything
+         * is collected so that a statement is parsed at most twice. */
+        collect = QC_COLLECT_ALL;
+    }
+
+    int32_t result = QC_QUERY_INVALID;
+    QC_CACHE_ENTRY* new_entry = NULL;
+
+    if (classifier->qc_parse(query, collect, &result) == QC_RESULT_OK && result == QC_QUERY_PARSED)
+    {
+        new_entry = qc_cache_entry_create(query, collect);
+    }
+
+    if (new_entry && qc_cache_is_cacheable(new_entry, ref->canonical))
+    {
+        atomic_add(&new_entry->refcount, 1);
+        qc_cache_insert(ref->canonical, new_entry);
+    }
+    else
+    {
+        if (new_entry)
+        {
+            if (ref->entry)
+            {
+                /** The names that were not collected for the current entry show
+                 * that the statement cannot be cached after all */
+                qc_cache_remove(ref->canonical);
+            }
+
+            qc_cache_entry_release(new_entry);
+            new_entry = NULL;
+        }
+
+        /** The plugin is used for the rest of the statement's classification */
+        MXS_FREE(ref->canonical);
+        ref->canonical = NULL;
+    }
+
+    if (ref->entry)
+    {
+        qc_cache_entry_release(ref->entry);
+    }
+
+    ref->entry = new_entry;
+}
+
+/**
+ * Get the cached classification of a statement
+ *
+ * The first time a statement is classified, its canonical form is looked up
+ * from the cache. If the statement is not found or the entry does not contain
+ * the needed information, the statement is parsed by the plugin with what is
+ * needed and the result is added to the cache.
+ *
+ * @param query   The statement
+ * @param collect What information is needed
+ *
+ * @return The cached entry or NULL if the plugin should be used
+ */
+static QC_CACHE_ENTRY* qc_cache_get(GWBUF* query, uint32_t collect)
+{
+    QC_CACHE_ENTRY* entry = NULL;
+    QC_CACHE_REF* ref;
+
+    if (qc_cache_max_size != 0 && (ref = qc_cache_get_ref(query)))
+    {
+        if (ref->canonical && ref->entry == NULL)
+        {
+            ref->entry = qc_cache_find(ref->canonical);
+        }
+
+        if (ref->canonical && (ref->entry == NULL || !qc_cache_entry_has(ref->entry, collect)))
+        {
+            qc_cache_update(query, ref, collect);
+        }
+
+        if (ref->entry && qc_cache_entry_has(ref->entry, collect))
+        {
+            entry = ref->entry;
+        }
+    }
+
+    return entry;
+}
+
+void qc_set_cache_size(int64_t max_size)
+{
+    qc_cache_shard_max_size = (max_size + QC_CACHE_SHARDS - 1) / QC_CACHE_SHARDS;
+    qc_cache_max_size = max_size;
+}
+
+void qc_get_cache_stats(QC_CACHE_STATS* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->max_size = qc_cache_max_size;
+
+    for (int i = 0; i < QC_CACHE_SHARDS; i++)
+    {
+        QC_CACHE_SHARD* shard = &qc_cache_shards[i];
+        maxscale::SpinLockGuard guard(shard->lock);
+
+        stats->size += shard->lru.size();
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->inserts += shard->inserts;
+        stats->evictions += shard->evictions;
+    }
+}
+
+/**
+ * Classify a statement with the pre-classifier
+ *
+ * Only statements that have not been parsed are pre-classified, so that a
+ * statement that has been parsed by the plugin is classified consistently.
+ *
+ * @param query The statement
+ * @param pc    The pre-classifier that holds the result
+ *
+ * @return True if the statement was recognized by the pre-classifier
+ */
+static bool qc_preclassify(GWBUF* query, maxscale::PreClassifier* pc)
+{
+    char* sql;
+    int len;
+
+    return qc_preclassifier_enabled &&
+           query->next == NULL &&
+           !GWBUF_IS_PARSED(query) &&
+           !gwbuf_get_buffer_object_data(query, GWBUF_QC_CACHE_INFO) &&
+           modutil_extract_SQL(query, &sql, &len) &&
+           len == (int)(GWBUF_LENGTH(query) - MYSQL_HEADER_LEN - 1) &&
+           pc->classify(sql, len);
+}
+
+void qc_set_preclassifier_enabled(bool enabled)
+{
+    qc_preclassifier_enabled = enabled;
+}
+
 qc_parse_result_t qc_parse(GWBUF* query, uint32_t collect)
 {
     QC_TRACE();
     ss_dassert(classifier);
 
     int32_t result = QC_QUERY_INVALID;
+    maxscale::PreClassifier pc;
 
-    classifier->qc_parse(query, collect, &result);
+    if (collect == QC_COLLECT_ESSENTIALS && qc_preclassify(query, &pc))
+    {
+        result = QC_QUERY_PARSED;
+    }
+    else if (qc_cache_get(query, collect))
+    {
+        result = QC_QUERY_PARSED;
+    }
+    else
+    {
+        classifier->qc_parse(query, collect, &result);
+    }
 
     return (qc_parse_result_t)result;
 }
@@ -196,8 +879,85 @@ uint32_t qc_get_type_mask(GWBUF* query)
     ss_dassert(classifier);
 
     uint32_t type_mask = QUERY_TYPE_UNKNOWN;
+    maxscale::PreClassifier pc;
+    QC_CACHE_ENTRY* entry;
 
-    classifier->qc_get_type_mask(query, &type_mask);
+    if (qc_preclassify(query, &pc))
+    {
+        type_mask = pc.type_mask();
+    }
+    else if ((entry = qc_cache_get(query, QC_COLLECT_ESSENTIALS)))
+    {
+        type_mask = entry->type_mask;
+    }
+    else
+    {
+        classifier->qc_get_type_mask(query, &type_mask);
+    }
+
+    return type_mask;
+}
+
+/**
+ * Get the type mask of one statement of a multi-statement query. What the
+ * classifier can't fully parse may modify data, so it is treated as a write.
+ *
+ * @param stmt  A buffer containing a COM_QUERY packet.
+ *
+ * @return The type mask of the statement.
+ */
+static uint32_t qc_get_part_type_mask(GWBUF* stmt)
+{
+    uint32_t type_mask = qc_get_type_mask(stmt);
+
+    if (type_mask == QUERY_TYPE_UNKNOWN ||
+        qc_parse(stmt, QC_COLLECT_ESSENTIALS) != QC_QUERY_PARSED)
+    {
+        type_mask |= QUERY_TYPE_WRITE;
+    }
+
+    return type_mask;
+}
+
+uint32_t qc_get_multi_type_mask(GWBUF* query)
+{
+    QC_TRACE();
+    ss_dassert(classifier);
+
+    // The whole query covers at least the first statement.
+    uint32_t type_mask = qc_get_type_mask(query);
+    char* sql;
+    int len;
+
+    if (modutil_extract_SQL(query, &sql, &len))
+    {
+        const char* end = sql + len;
+        const char* stmt = modutil_get_next_statement(sql, end, &len);
+        bool multi = false;
+
+        while (stmt && (stmt = modutil_get_next_statement(stmt + len, end, &len)))
+        {
+            GWBUF* part = modutil_create_query_len(stmt, len);
+
+            if (part)
+            {
+                type_mask |= qc_get_part_type_mask(part);
+                gwbuf_free(part);
+            }
+            else
+            {
+                type_mask |= QUERY_TYPE_WRITE;
+            }
+
+            multi = true;
+        }
+
+        if (multi)
+        {
+            // The first statement decides what the whole query parses as.
+            type_mask |= qc_get_part_type_mask(query);
+        }
+    }
 
     return type_mask;
 }
@@ -208,8 +968,21 @@ qc_query_op_t qc_get_operation(GWBUF* query)
     ss_dassert(classifier);
 
     int32_t op = QUERY_OP_UNDEFINED;
+    maxscale::PreClassifier pc;
+    QC_CACHE_ENTRY* entry;
 
-    classifier->qc_get_operation(query, &op);
+    if (qc_preclassify(query, &pc))
+    {
+        op = pc.operation();
+    }
+    else if ((entry = qc_cache_get(query, QC_COLLECT_ESSENTIALS)))
+    {
+        op = entry->op;
+    }
+    else
+    {
+        classifier->qc_get_operation(query, &op);
+    }
 
     return (qc_query_op_t)op;
 }
@@ -220,8 +993,16 @@ char* qc_get_created_table_name(GWBUF* query)
     ss_dassert(classifier);
 
     char* name = NULL;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_TABLES);
 
-    classifier->qc_get_created_table_name(query, &name);
+    if (entry)
+    {
+        name = qc_cache_strdup(entry->created_table_name);
+    }
+    else
+    {
+        classifier->qc_get_created_table_name(query, &name);
+    }
 
     return name;
 }
@@ -232,8 +1013,16 @@ bool qc_is_drop_table_query(GWBUF* query)
     ss_dassert(classifier);
 
     int32_t is_drop_table = 0;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_ESSENTIALS);
 
-    classifier->qc_is_drop_table_query(query, &is_drop_table);
+    if (entry)
+    {
+        is_drop_table = entry->is_drop_table;
+    }
+    else
+    {
+        classifier->qc_is_drop_table_query(query, &is_drop_table);
+    }
 
     return (is_drop_table != 0) ? true : false;
 }
@@ -245,8 +1034,22 @@ char** qc_get_table_names(GWBUF* query, int* tblsize, bool fullnames)
 
     char** names = NULL;
     *tblsize = 0;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_TABLES);
 
-    classifier->qc_get_table_names(query, fullnames, &names, tblsize);
+    if (entry && fullnames)
+    {
+        names = qc_cache_copy_names(entry->table_fullnames, entry->n_table_fullnames);
+        *tblsize = entry->n_table_fullnames;
+    }
+    else if (entry)
+    {
+        names = qc_cache_copy_names(entry->table_names, entry->n_table_names);
+        *tblsize = entry->n_table_names;
+    }
+    else
+    {
+        classifier->qc_get_table_names(query, fullnames, &names, tblsize);
+    }
 
     return names;
 }
@@ -281,8 +1084,21 @@ bool qc_query_has_clause(GWBUF* query)
     ss_dassert(classifier);
 
     int32_t has_clause = 0;
+    maxscale::PreClassifier pc;
+    QC_CACHE_ENTRY* entry;
 
-    classifier->qc_query_has_clause(query, &has_clause);
+    if (qc_preclassify(query, &pc))
+    {
+        has_clause = pc.has_clause();
+    }
+    else if ((entry = qc_cache_get(query, QC_COLLECT_ESSENTIALS)))
+    {
+        has_clause = entry->has_clause;
+    }
+    else
+    {
+        classifier->qc_query_has_clause(query, &has_clause);
+    }
 
     return (has_clause != 0) ? true : false;
 }
@@ -295,8 +1111,17 @@ void qc_get_field_info(GWBUF* query, const QC_FIELD_INFO** infos, size_t* n_info
     *infos = NULL;
 
     uint32_t n = 0;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_FIELDS);
 
-    classifier->qc_get_field_info(query, infos, &n);
+    if (entry)
+    {
+        *infos = entry->field_infos;
+        n = entry->n_field_infos;
+    }
+    else
+    {
+        classifier->qc_get_field_info(query, infos, &n);
+    }
 
     *n_infos = n;
 }
@@ -309,8 +1134,17 @@ void qc_get_function_info(GWBUF* query, const QC_FUNCTION_INFO** infos, size_t*
     *infos = NULL;
 
     uint32_t n = 0;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_FUNCTIONS);
 
-    classifier->qc_get_function_info(query, infos, &n);
+    if (entry)
+    {
+        *infos = entry->function_infos;
+        n = entry->n_function_infos;
+    }
+    else
+    {
+        classifier->qc_get_function_info(query, infos, &n);
+    }
 
     *n_infos = n;
 }
@@ -322,8 +1156,17 @@ char** qc_get_database_names(GWBUF* query, int* sizep)
 
     char** names = NULL;
     *sizep = 0;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_DATABASES);
 
-    classifier->qc_get_database_names(query, &names, sizep);
+    if (entry)
+    {
+        names = qc_cache_copy_names(entry->database_names, entry->n_database_names);
+        *sizep = entry->n_database_names;
+    }
+    else
+    {
+        classifier->qc_get_database_names(query, &names, sizep);
+    }
 
     return names;
 }
@@ -334,8 +1177,16 @@ char* qc_get_prepare_name(GWBUF* query)
     ss_dassert(classifier);
 
     char* name = NULL;
+    QC_CACHE_ENTRY* entry = qc_cache_get(query, QC_COLLECT_ESSENTIALS);
 
-    classifier->qc_get_prepare_name(query, &name);
+    if (entry)
+    {
+        name = qc_cache_strdup(entry->prepare_name);
+    }
+    else
+    {
+        classifier->qc_get_prepare_name(query, &name);
+    }
 
     return name;
 }
@@ -347,6 +1198,7 @@ GWBUF* qc_get_preparable_stmt(GWBUF* stmt)
 
     GWBUF* preparable_stmt = NULL;
 
+    /** PREPARE statements are never cached */
     classifier->qc_get_preparable_stmt(stmt, &preparable_stmt);
 
     return preparable_stmt;
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Compare the time it takes to get the type mask of statements with and
+ * without the pre-classifier. Each statement is classified in a new buffer,
+ * as it would be when it arrives from a client.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <unistd.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../maxscale/query_classifier.h"
+#include "../maxscale/preclassifier.hh"
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include "../../../query_classifier/test/testreader.hh"
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] = "usage: preclassifier_profile [-n count] file...\n";
+
+timespec timespec_subtract(const timespec& later, const timespec& earlier)
+{
+    timespec result = { 0, 0 };
+
+    ss_dassert((later.tv_sec > earlier.tv_sec) ||
+               ((later.tv_sec == earlier.tv_sec) && (later.tv_nsec > earlier.tv_nsec)));
+
+    if (later.tv_nsec >= earlier.tv_nsec)
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec;
+        result.tv_nsec = later.tv_nsec - earlier.tv_nsec;
+    }
+    else
+    {
+        result.tv_sec = later.tv_sec - earlier.tv_sec - 1;
+        result.tv_nsec = 1000000000 + later.tv_nsec - earlier.tv_nsec;
+    }
+
+    return result;
+}
+
+GWBUF* create_gwbuf(const string& stmt)
+{
+    size_t len = stmt.length();
+    size_t payload_len = len + 1;
+    size_t gwbuf_len = MYSQL_HEADER_LEN + payload_len;
+
+    GWBUF* pBuf = gwbuf_alloc(gwbuf_len);
+
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf))) = payload_len;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 1)) = (payload_len >> 8);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 2)) = (payload_len >> 16);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 3)) = 0x00;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 4)) = 0x03;
+    memcpy((char*)GWBUF_DATA(pBuf) + 5, stmt.c_str(), len);
+
+    return pBuf;
+}
+
+timespec classify(const vector<string>& stmts)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    for (vector<string>::const_iterator it = stmts.begin(); it != stmts.end(); ++it)
+    {
+        GWBUF* pStmt = create_gwbuf(*it);
+        qc_get_type_mask(pStmt);
+        gwbuf_free(pStmt);
+    }
+
+    struct timespec finish;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &finish);
+
+    return timespec_subtract(finish, start);
+}
+
+void timespec_add(timespec& total, const timespec& t)
+{
+    total.tv_sec += t.tv_sec;
+    total.tv_nsec += t.tv_nsec;
+
+    if (total.tv_nsec >= 1000000000)
+    {
+        total.tv_sec += 1;
+        total.tv_nsec -= 1000000000;
+    }
+}
+
+void report(const char* zWhat, const vector<string>& stmts, int nCount)
+{
+    timespec parsed = { 0, 0 };
+    timespec preclassified = { 0, 0 };
+
+    // The measurements are interleaved so that they are equally affected
+    // by whatever else happens on the machine.
+    for (int i = 0; i < nCount; ++i)
+    {
+        qc_set_preclassifier_enabled(false);
+        timespec_add(parsed, classify(stmts));
+
+        qc_set_preclassifier_enabled(true);
+        timespec_add(preclassified, classify(stmts));
+    }
+
+    cout << zWhat << " (" << stmts.size() << " statements)\n"
+         << "  Parsed       : " << parsed.tv_sec << "."
+         << setfill('0') << setw(9) << parsed.tv_nsec << "\n"
+         << "  Preclassified: " << preclassified.tv_sec << "."
+         << setfill('0') << setw(9) << preclassified.tv_nsec << endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+
+    int nCount = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            nCount = atoi(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc == EXIT_SUCCESS) && (optind < argc) && (nCount > 0))
+    {
+        rc = EXIT_FAILURE;
+
+        set_datadir(strdup("/tmp"));
+        set_langdir(strdup("."));
+        set_process_datadir(strdup("/tmp"));
+
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            if (qc_setup("qc_sqlite", NULL) && qc_process_init(QC_INIT_BOTH))
+            {
+                vector<string> all;
+                vector<string> recognized;
+
+                for (int i = optind; i < argc; ++i)
+                {
+                    ifstream in(argv[i]);
+                    maxscale::TestReader reader(in);
+                    string stmt;
+
+                    while (reader.get_statement(stmt) == maxscale::TestReader::RESULT_STMT)
+                    {
+                        maxscale::PreClassifier pc;
+
+                        if (pc.classify(stmt.c_str(), stmt.length()))
+                        {
+                            recognized.push_back(stmt);
+                        }
+
+                        all.push_back(stmt);
+                    }
+                }
+
+                report("All", all, nCount);
+                report("Recognized", recognized, nCount);
+
+                qc_process_end(QC_INIT_BOTH);
+                rc = EXIT_SUCCESS;
+            }
+            else
+            {
+                cerr << "error: Could not initialize qc_sqlite." << endl;
+            }
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
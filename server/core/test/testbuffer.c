@@ -36,6 +36,7 @@
 #include <maxscale/alloc.h>
 #include <maxscale/buffer.h>
 #include <maxscale/hint.h>
+#include <maxscale/limits.h>
 
 /**
  * Generate predefined test data
@@ -441,6 +442,98 @@ void test_clone()
     gwbuf_free(original);
 }
 
+void test_pool()
+{
+    /** A freed buffer is reused by the next allocation of the same size class */
+    GWBUF* buffer = gwbuf_alloc(100);
+    uint8_t* data = GWBUF_DATA(buffer);
+    gwbuf_free(buffer);
+
+    buffer = gwbuf_alloc(120);
+    ss_dassert(GWBUF_DATA(buffer) == data);
+    ss_dassert(GWBUF_LENGTH(buffer) == 120);
+    gwbuf_free(buffer);
+
+    /** The data of a cloned buffer stays valid after the original is freed */
+    buffer = gwbuf_alloc_and_load(5, "12345");
+    GWBUF* clone = gwbuf_clone(buffer);
+    gwbuf_free(buffer);
+
+    GWBUF* other = gwbuf_alloc(5);
+    ss_dassert(GWBUF_DATA(other) != GWBUF_DATA(clone));
+    ss_dassert(memcmp(GWBUF_DATA(clone), "12345", 5) == 0);
+    gwbuf_free(other);
+    gwbuf_free(clone);
+
+    /** Buffers larger than the largest size class are not pooled */
+    buffer = gwbuf_alloc(MXS_MAX_NW_READ_BUFFER_SIZE + 1);
+    ss_dassert(buffer->sbuf->size_class == -1);
+    memset(GWBUF_DATA(buffer), 0, GWBUF_LENGTH(buffer));
+    gwbuf_free(buffer);
+
+    buffer = gwbuf_alloc(MXS_MAX_NW_READ_BUFFER_SIZE);
+    ss_dassert(buffer->sbuf->size_class != -1);
+    memset(GWBUF_DATA(buffer), 0, GWBUF_LENGTH(buffer));
+    gwbuf_free(buffer);
+}
+
+void test_tailroom()
+{
+    /** The unused part of the size class can be appended to */
+    GWBUF* buffer = gwbuf_alloc(100);
+    ss_dassert(gwbuf_tailroom(buffer) == 28);
+
+    buffer = gwbuf_rtrim(buffer, 50);
+    ss_dassert(gwbuf_tailroom(buffer) == 78);
+
+    memcpy(buffer->end, "12345", 5);
+    buffer->end = (uint8_t*)buffer->end + 5;
+    ss_dassert(GWBUF_LENGTH(buffer) == 55);
+    ss_dassert(memcmp(GWBUF_DATA(buffer) + 50, "12345", 5) == 0);
+
+    /** Shared data must not be modified */
+    GWBUF* clone = gwbuf_clone(buffer);
+    ss_dassert(gwbuf_tailroom(buffer) == 0);
+    ss_dassert(gwbuf_tailroom(clone) == 0);
+    gwbuf_free(clone);
+    ss_dassert(gwbuf_tailroom(buffer) == 73);
+    gwbuf_free(buffer);
+
+    /** Buffers that are not pooled have no room */
+    buffer = gwbuf_alloc(MXS_MAX_NW_READ_BUFFER_SIZE + 1);
+    ss_dassert(gwbuf_tailroom(buffer) == 0);
+    gwbuf_free(buffer);
+}
+
+static int n_buffer_objects_freed = 0;
+
+static void buffer_object_free(void* data)
+{
+    ++n_buffer_objects_freed;
+}
+
+void test_buffer_objects()
+{
+    int data = 0;
+
+    /** Prepared statement information does not mark the buffer as parsed */
+    GWBUF* buffer = gwbuf_alloc(10);
+    gwbuf_add_buffer_object(buffer, GWBUF_PS_INFO, &data, buffer_object_free);
+    ss_dassert(!GWBUF_IS_PARSED(buffer));
+    ss_dassert(gwbuf_get_buffer_object_data(buffer, GWBUF_PS_INFO) == &data);
+    ss_dassert(gwbuf_get_buffer_object_data(buffer, GWBUF_PARSING_INFO) == NULL);
+
+    /** Neither does the classification cache information */
+    gwbuf_add_buffer_object(buffer, GWBUF_QC_CACHE_INFO, &data, buffer_object_free);
+    ss_dassert(!GWBUF_IS_PARSED(buffer));
+
+    gwbuf_add_buffer_object(buffer, GWBUF_PARSING_INFO, &data, buffer_object_free);
+    ss_dassert(GWBUF_IS_PARSED(buffer));
+
+    gwbuf_free(buffer);
+    ss_dassert(n_buffer_objects_freed == 3);
+}
+
 /**
  * test1    Allocate a buffer and do lots of things
  *
@@ -562,6 +655,9 @@ test1()
     test_consume();
     test_compare();
     test_clone();
+    test_pool();
+    test_tailroom();
+    test_buffer_objects();
 
     return 0;
 }
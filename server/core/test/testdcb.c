@@ -33,6 +33,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <maxscale/config.h>
 #include <maxscale/dcb.h>
@@ -81,6 +83,59 @@ test1()
     return 0;
 }
 
+/**
+ * test2    Drain a chain of buffers through a socket with vectored writes
+ *
+ */
+static int
+test2()
+{
+    int fds[2];
+    int     n_buffers = 100;
+    int     bufsize = 10;
+    SERV_LISTENER dummy;
+    GWBUF *chain = NULL;
+
+    ss_dfprintf(stderr, "testdcb : drain a chain of %d buffers", n_buffers);
+    ss_info_dassert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "Socket pair must be created");
+
+    DCB *dcb = dcb_alloc(DCB_ROLE_INTERNAL, &dummy);
+    dcb->fd = fds[0];
+
+    for (int i = 0; i < n_buffers; i++)
+    {
+        GWBUF *buf = gwbuf_alloc(bufsize);
+        memset(GWBUF_DATA(buf), 'a' + i % 26, bufsize);
+        chain = gwbuf_append(chain, buf);
+    }
+
+    dcb->writeq = chain;
+    dcb->writeqlen = n_buffers * bufsize;
+
+    int written = dcb_drain_writeq(dcb);
+    ss_info_dassert(written == n_buffers * bufsize, "All data must be written");
+    ss_info_dassert(dcb->writeq == NULL, "Write queue must be empty");
+    ss_info_dassert(dcb->writeqlen == 0, "Write queue length must be zero");
+    ss_info_dassert(dcb->stats.n_write_calls == 1, "Chain must be written with one call");
+    ss_info_dassert(dcb->stats.n_write_iovecs == n_buffers, "All buffers must be in the call");
+
+    char data[n_buffers * bufsize];
+    ss_info_dassert(read(fds[1], data, sizeof(data)) == sizeof(data), "All data must be readable");
+
+    for (int i = 0; i < n_buffers * bufsize; i++)
+    {
+        ss_info_dassert(data[i] == 'a' + (i / bufsize) % 26, "Data must be written in order");
+    }
+
+    ss_dfprintf(stderr, "\t..done\n");
+    dcb->fd = DCBFD_CLOSED;
+    close(fds[0]);
+    close(fds[1]);
+    dcb_free_all_memory(dcb);
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int result = 0;
@@ -89,6 +144,7 @@ int main(int argc, char **argv)
     dcb_global_init();
 
     result += test1();
+    result += test2();
 
     exit(result);
 }
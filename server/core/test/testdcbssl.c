@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test that SSL reads are decrypted into buffers that are sized for the data
+ * that is available. The connection is made over a socket pair with a self
+ * signed certificate that is created by the test.
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/dcb.h>
+#include <maxscale/debug.h>
+#include <maxscale/limits.h>
+#include <maxscale/thread.h>
+
+/** Sizes of the writes done by the client, the largest is split into several records */
+static const int write_sizes[] = {10, 3000, 16384, 20000};
+
+#define N_WRITES (sizeof(write_sizes) / sizeof(write_sizes[0]))
+
+/** The largest overhead that a TLS record can have */
+#define MAX_RECORD_OVERHEAD 256
+
+/**
+ * Check that a buffer was allocated for the data it holds. The buffers come
+ * from power of two size classes, so a right-sized buffer has less room left
+ * than it has data, plus the overhead of the records that were estimated.
+ */
+static bool is_right_sized(GWBUF* buf)
+{
+    return gwbuf_tailroom(buf) < GWBUF_LENGTH(buf) + MAX_RECORD_OVERHEAD;
+}
+
+static SSL* client_ssl;
+
+#if defined(TEST_DCBSSL_COUNT_ALLOCATIONS)
+/**
+ * The allocations are counted by replacing the allocation functions of the
+ * C library. That cannot be done if another allocator is used.
+ */
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+static __thread uint64_t n_allocations;
+
+void* malloc(size_t size)
+{
+    ++n_allocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    ++n_allocations;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    ++n_allocations;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static EVP_PKEY* create_key()
+{
+    EVP_PKEY* pkey = NULL;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+
+    ss_info_dassert(ctx && EVP_PKEY_keygen_init(ctx) > 0 &&
+                    EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) > 0 &&
+                    EVP_PKEY_keygen(ctx, &pkey) > 0, "Key should be created");
+    EVP_PKEY_CTX_free(ctx);
+
+    return pkey;
+}
+
+static X509* create_certificate(EVP_PKEY* pkey)
+{
+    X509* cert = X509_new();
+    ss_info_dassert(cert, "Certificate should be created");
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (unsigned char*)"maxscale", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    ss_info_dassert(X509_sign(cert, pkey, EVP_sha256()) > 0, "Certificate should be signed");
+
+    return cert;
+}
+
+static void client_connect(void* data)
+{
+    ss_info_dassert(SSL_connect(client_ssl) == 1, "Client should connect");
+}
+
+static void fill(uint8_t* ptr, int len, int offset)
+{
+    for (int i = 0; i < len; i++)
+    {
+        ptr[i] = (uint8_t)((offset + i) % 251);
+    }
+}
+
+/**
+ * Everything the client writes is read with one dcb_read into as few buffers
+ * as the maximum read size allows
+ */
+static int test_read(DCB* dcb)
+{
+    uint8_t data[20000];
+    int total = 0;
+
+    ss_dfprintf(stderr, "testdcbssl : Read what the client writes");
+
+    for (size_t i = 0; i < N_WRITES; i++)
+    {
+        fill(data, write_sizes[i], total);
+        ss_info_dassert(SSL_write(client_ssl, data, write_sizes[i]) == write_sizes[i],
+                        "Client write should work");
+        total += write_sizes[i];
+    }
+
+    GWBUF* head = NULL;
+    int n = dcb_read(dcb, &head, 0);
+    ss_info_dassert(n == total, "Everything should be read");
+    ss_info_dassert(gwbuf_length(head) == (size_t)total, "The buffers should contain everything");
+
+    int n_buffers = 0;
+    int offset = 0;
+
+    for (GWBUF* b = head; b; b = b->next)
+    {
+        int len = GWBUF_LENGTH(b);
+        uint8_t* ptr = GWBUF_DATA(b);
+
+        for (int i = 0; i < len; i++)
+        {
+            ss_info_dassert(ptr[i] == (uint8_t)((offset + i) % 251), "The data should match");
+        }
+
+        ss_info_dassert(len > 0 && len <= MXS_MAX_NW_READ_BUFFER_SIZE, "Buffer should not be empty");
+        ss_info_dassert(is_right_sized(b), "Buffer should be sized for the data");
+        offset += len;
+        n_buffers++;
+    }
+
+    ss_info_dassert(n_buffers <= (total + MXS_MAX_NW_READ_BUFFER_SIZE - 1) / MXS_MAX_NW_READ_BUFFER_SIZE + 1,
+                    "The records should be coalesced into as few buffers as possible");
+    gwbuf_free(head);
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+/**
+ * Nothing is allocated when there is nothing to read
+ */
+static int test_no_data(DCB* dcb)
+{
+    ss_dfprintf(stderr, "testdcbssl : Read when there is no data");
+
+    GWBUF* head = NULL;
+#if defined(TEST_DCBSSL_COUNT_ALLOCATIONS)
+    uint64_t allocations = n_allocations;
+#endif
+    int n = dcb_read(dcb, &head, 0);
+    ss_info_dassert(n == 0 && head == NULL, "Nothing should be read");
+#if defined(TEST_DCBSSL_COUNT_ALLOCATIONS)
+    ss_info_dassert(n_allocations == allocations, "Nothing should be allocated");
+#endif
+
+    ss_dfprintf(stderr, "\t..done\nRead a small write");
+    ss_info_dassert(SSL_write(client_ssl, "x", 1) == 1, "Client write should work");
+    n = dcb_read(dcb, &head, 0);
+    ss_info_dassert(n == 1 && head && head->next == NULL && GWBUF_LENGTH(head) == 1,
+                    "One byte should be read");
+    ss_info_dassert(is_right_sized(head), "Buffer should be sized for the data");
+    gwbuf_free(head);
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+    int sv[2];
+
+    SSL_library_init();
+    SSL_load_error_strings();
+
+    EVP_PKEY* pkey = create_key();
+    X509* cert = create_certificate(pkey);
+
+    SSL_CTX* server_ctx = SSL_CTX_new(SSLv23_server_method());
+    SSL_CTX* client_ctx = SSL_CTX_new(SSLv23_client_method());
+    ss_info_dassert(server_ctx && client_ctx, "Contexts should be created");
+    ss_info_dassert(SSL_CTX_use_certificate(server_ctx, cert) == 1 &&
+                    SSL_CTX_use_PrivateKey(server_ctx, pkey) == 1, "Certificate should be used");
+
+    ss_info_dassert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "Socket pair should be created");
+
+    SSL* server_ssl = SSL_new(server_ctx);
+    client_ssl = SSL_new(client_ctx);
+    SSL_set_fd(server_ssl, sv[0]);
+    SSL_set_fd(client_ssl, sv[1]);
+
+    THREAD thr;
+    ss_info_dassert(thread_start(&thr, client_connect, NULL), "Thread should start");
+    ss_info_dassert(SSL_accept(server_ssl) == 1, "Server should accept");
+    thread_wait(thr);
+
+    /** The DCBs read from non-blocking sockets */
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+
+    DCB* dcb = dcb_alloc(DCB_ROLE_INTERNAL, NULL);
+    ss_info_dassert(dcb, "DCB should be created");
+    dcb->fd = sv[0];
+    dcb->ssl = server_ssl;
+    dcb->ssl_state = SSL_ESTABLISHED;
+
+    result += test_no_data(dcb);
+    result += test_read(dcb);
+
+    SSL_free(client_ssl);
+    SSL_CTX_free(client_ctx);
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+
+    return result;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+
+#include "../maxscale/histogram.h"
+
+/**
+ * Check that a reported value is within the relative error of the histogram
+ */
+static bool close_enough(uint64_t expected, uint64_t value)
+{
+    uint64_t diff = expected > value ? expected - value : value - expected;
+    return diff <= expected / MXS_HISTOGRAM_SUB_BUCKETS;
+}
+
+/**
+ * Small values are exact
+ */
+static int test_small()
+{
+    MXS_HISTOGRAM *hist = MXS_MALLOC(sizeof(*hist));
+    ss_dassert(hist);
+    mxs_histogram_reset(hist);
+
+    ss_dfprintf(stderr, "testhistogram : Empty histogram");
+    ss_info_dassert(mxs_histogram_percentile(hist, 50) == 0, "Empty histogram should return 0");
+
+    ss_dfprintf(stderr, "\t..done\nExact small values");
+
+    for (uint64_t i = 1; i <= 50; i++)
+    {
+        mxs_histogram_record(hist, i);
+    }
+
+    ss_info_dassert(hist->total == 50, "Total should be 50");
+    ss_info_dassert(hist->max == 50, "Maximum should be 50");
+    ss_info_dassert(mxs_histogram_percentile(hist, 50) == 25, "Median should be 25");
+    ss_info_dassert(mxs_histogram_percentile(hist, 100) == 50, "100th percentile should be 50");
+    ss_info_dassert(mxs_histogram_percentile(hist, 0) == 1, "0th percentile should be 1");
+    ss_info_dassert(mxs_histogram_count(hist, 10, 20) == 10, "Range should have 10 values");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    MXS_FREE(hist);
+    return 0;
+}
+
+/**
+ * Large values are within the relative error and percentiles are ordered
+ */
+static int test_large()
+{
+    MXS_HISTOGRAM *hist = MXS_MALLOC(sizeof(*hist));
+    ss_dassert(hist);
+    mxs_histogram_reset(hist);
+
+    ss_dfprintf(stderr, "testhistogram : Relative error of large values");
+
+    /** 1000 values from 1 microsecond to 1 second */
+    for (uint64_t i = 1; i <= 1000; i++)
+    {
+        uint64_t value = i * 1000000;
+        mxs_histogram_reset(hist);
+        mxs_histogram_record(hist, value);
+        mxs_histogram_record(hist, value * 2);
+        ss_info_dassert(close_enough(value, mxs_histogram_percentile(hist, 50)),
+                        "Value should be within the relative error");
+    }
+
+    ss_dfprintf(stderr, "\t..done\nPercentiles of a uniform distribution");
+    mxs_histogram_reset(hist);
+
+    for (uint64_t i = 1; i <= 100000; i++)
+    {
+        mxs_histogram_record(hist, i * 1000);
+    }
+
+    ss_info_dassert(close_enough(50000000, mxs_histogram_percentile(hist, 50)), "Median should be 50ms");
+    ss_info_dassert(close_enough(99000000, mxs_histogram_percentile(hist, 99)), "p99 should be 99ms");
+    ss_info_dassert(close_enough(99900000, mxs_histogram_percentile(hist, 99.9)), "p999 should be 99.9ms");
+    ss_info_dassert(mxs_histogram_percentile(hist, 100) == 100000000, "Maximum should be exact");
+
+    ss_dfprintf(stderr, "\t..done\nValues larger than the maximum");
+    mxs_histogram_record(hist, UINT64_MAX);
+    ss_info_dassert(hist->max == MXS_HISTOGRAM_MAX_VALUE, "Large value should be capped");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    MXS_FREE(hist);
+    return 0;
+}
+
+/**
+ * Merged histograms contain the values of both
+ */
+static int test_merge()
+{
+    MXS_HISTOGRAM *a = MXS_MALLOC(sizeof(*a));
+    MXS_HISTOGRAM *b = MXS_MALLOC(sizeof(*b));
+    ss_dassert(a && b);
+    mxs_histogram_reset(a);
+    mxs_histogram_reset(b);
+
+    ss_dfprintf(stderr, "testhistogram : Merge histograms");
+
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        mxs_histogram_record(a, 1000);
+        mxs_histogram_record(b, 1000000);
+    }
+
+    mxs_histogram_record(b, 5000000);
+    mxs_histogram_merge(a, b);
+
+    ss_info_dassert(a->total == 2001, "Merged total should be 2001");
+    ss_info_dassert(a->max == 5000000, "Merged maximum should be 5000000");
+    ss_info_dassert(close_enough(1000, mxs_histogram_percentile(a, 25)), "p25 should be 1000");
+    ss_info_dassert(close_enough(1000000, mxs_histogram_percentile(a, 75)), "p75 should be 1000000");
+    ss_info_dassert(mxs_histogram_count(a, 0, 100000) == 1000, "Range should have 1000 values");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    MXS_FREE(a);
+    MXS_FREE(b);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    result += test_small();
+    result += test_large();
+    result += test_merge();
+
+    exit(result);
+}
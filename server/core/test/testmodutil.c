@@ -36,6 +36,7 @@
 #include <maxscale/alloc.h>
 #include <maxscale/modutil.h>
 #include <maxscale/buffer.h>
+#include <maxscale/protocol/mysql.h>
 
 /**
  * test1    Allocate a service and do lots of other things
@@ -628,6 +629,290 @@ void test_bypass_whitespace()
     ss_info_dassert(*sql == 'S', "9");
 }
 
+void test_split_statements()
+{
+    /** The expected statements are separated with '|' */
+    struct
+    {
+        const char* sql;
+        const char* statements;
+    } tests[] =
+    {
+        {"SELECT 1", "SELECT 1"},
+        {"SELECT 1;", "SELECT 1"},
+        {"  SELECT 1 ;  ;; ", "SELECT 1"},
+        {"", ""},
+        {" ; ", ""},
+        {"SELECT 1;SELECT 2", "SELECT 1|SELECT 2"},
+        {"SELECT 1; SELECT 2; -- comment", "SELECT 1|SELECT 2"},
+        {"SELECT 1; /* comment */ UPDATE t SET a = 1", "SELECT 1|UPDATE t SET a = 1"},
+        {"SELECT 1; # comment\nDELETE FROM t", "SELECT 1|DELETE FROM t"},
+        {"SELECT 1 -- comment; with delimiter\n; SELECT 2", "SELECT 1 -- comment; with delimiter|SELECT 2"},
+        {"SELECT 1 /* ; */; SELECT 2", "SELECT 1 /* ; */|SELECT 2"},
+        {"SELECT 1; /*!40101 SET NAMES utf8 */", "SELECT 1|/*!40101 SET NAMES utf8 */"},
+        {"SELECT 1; /*M!100100 SET NAMES utf8 */", "SELECT 1|/*M!100100 SET NAMES utf8 */"},
+        {"SELECT 1 /*! ; DROP TABLE t */", "SELECT 1 /*!|DROP TABLE t */"},
+        {"SELECT 1 /*!40101 ; SELECT 2 */; SELECT 3", "SELECT 1 /*!40101|SELECT 2 */|SELECT 3"},
+        {"SELECT 1 /*M!100100 ; DROP TABLE t */", "SELECT 1 /*M!100100|DROP TABLE t */"},
+        {"SELECT 1 /*! ';' */; SELECT 2", "SELECT 1 /*! ';' */|SELECT 2"},
+        {"SELECT ';'; SELECT \";\"", "SELECT ';'|SELECT \";\""},
+        {"SELECT 'a\\';'; SELECT 2", "SELECT 'a\\';'|SELECT 2"},
+        {"SELECT 'a'';'; SELECT 2", "SELECT 'a'';'|SELECT 2"},
+        {"SELECT `a;b` FROM t; SELECT 2", "SELECT `a;b` FROM t|SELECT 2"},
+        {"CREATE PROCEDURE p() BEGIN SELECT 1; END; SELECT 2",
+         "CREATE PROCEDURE p() BEGIN SELECT 1; END|SELECT 2"},
+        {"SELECT 1; SELECT 'unterminated;", "SELECT 1|SELECT 'unterminated;"},
+        {"SELECT 1 /* unterminated; SELECT 2", "SELECT 1 /* unterminated; SELECT 2"},
+    };
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        const char* sql = tests[i].sql;
+        const char* end = sql + strlen(sql);
+        const char* expected = tests[i].statements;
+        const char* stmt = sql;
+        int n_expected = *expected ? 1 : 0;
+        int len;
+
+        for (const char* p = expected; *p; p++)
+        {
+            if (*p == '|')
+            {
+                n_expected++;
+            }
+        }
+
+        while ((stmt = modutil_get_next_statement(stmt, end, &len)))
+        {
+            const char* sep = strchr(expected, '|');
+            int expected_len = sep ? sep - expected : strlen(expected);
+
+            ss_info_dassert(len == expected_len && memcmp(stmt, expected, len) == 0,
+                            "Statement should match the expected one");
+            ss_info_dassert(stmt >= sql && stmt + len <= end,
+                            "Statement should point into the query");
+
+            expected = sep ? sep + 1 : expected + expected_len;
+            stmt += len;
+        }
+
+        ss_info_dassert(*expected == '\0', "All expected statements should be found");
+
+        GWBUF* buffer = modutil_create_query_len(sql, end - sql);
+        ss_info_dassert(buffer && gwbuf_length(buffer) == (size_t)(end - sql) + 5,
+                        "Query should be created");
+        ss_info_dassert(modutil_count_statements(buffer) == (n_expected > 0 ? n_expected : 1),
+                        "Statement count should match, a query without statements counts as one");
+        gwbuf_free(buffer);
+    }
+}
+
+void test_index_packets()
+{
+    enum { N_INDEXED = 200, MAX_PAYLOAD = 40, MAX_DATA = N_INDEXED * (MAX_PAYLOAD + 5) };
+    uint8_t data[MAX_DATA];
+    MODUTIL_PACKET expected[N_INDEXED];
+    MODUTIL_PACKET found[N_INDEXED];
+
+    for (int round = 0; round < 100; round++)
+    {
+        size_t len = 0;
+
+        for (int i = 0; i < N_INDEXED; i++)
+        {
+            uint32_t payload_len = random() % MAX_PAYLOAD;
+            expected[i].offset = len;
+            expected[i].len = payload_len + MYSQL_HEADER_LEN;
+            expected[i].cmd = payload_len ? 1 + random() % 255 : 0;
+
+            data[len++] = payload_len;
+            data[len++] = 0;
+            data[len++] = 0;
+            data[len++] = i;
+
+            for (uint32_t j = 0; j < payload_len; j++)
+            {
+                data[len++] = j == 0 ? expected[i].cmd : random();
+            }
+        }
+
+        /** The last packet is incomplete */
+        size_t complete_len = expected[N_INDEXED - 1].offset;
+        len -= expected[N_INDEXED - 1].len / 2 + 1;
+
+        /** Split the data into buffers of random size, some of them empty */
+        GWBUF* head = NULL;
+        size_t pos = 0;
+
+        while (pos < len)
+        {
+            size_t n = random() % (round % 2 ? 8 : 300);
+
+            if (n > len - pos)
+            {
+                n = len - pos;
+            }
+
+            head = gwbuf_append(head, n ? gwbuf_alloc_and_load(n, data + pos) : gwbuf_alloc(0));
+            pos += n;
+        }
+
+        size_t n_bytes;
+        size_t n = modutil_index_packets(head, found, N_INDEXED, &n_bytes);
+        ss_info_dassert(n == N_INDEXED - 1, "All complete packets should be found");
+        ss_info_dassert(n_bytes == complete_len, "The length of the complete packets should be returned");
+
+        for (size_t i = 0; i < n; i++)
+        {
+            ss_info_dassert(found[i].offset == expected[i].offset, "Offsets should match");
+            ss_info_dassert(found[i].len == expected[i].len, "Lengths should match");
+            ss_info_dassert(found[i].cmd == expected[i].cmd, "Commands should match");
+        }
+
+        n = modutil_index_packets(head, found, 10, &n_bytes);
+        ss_info_dassert(n == 10, "No more packets than asked for should be found");
+        ss_info_dassert(n_bytes == expected[10].offset, "The length of the found packets should be returned");
+
+        n = modutil_index_packets(head, NULL, SIZE_MAX, &n_bytes);
+        ss_info_dassert(n == N_INDEXED - 1 && n_bytes == complete_len, "Only counting should work");
+
+        gwbuf_free(head);
+    }
+}
+
+void test_digest()
+{
+    GWBUF* buf1 = modutil_create_query("SELECT a FROM t1 WHERE b = 1");
+    GWBUF* buf2 = modutil_create_query("SELECT a FROM t1 WHERE b = 2");
+    GWBUF* buf3 = modutil_create_query("SELECT a FROM t1 WHERE b = 1");
+
+    const MODUTIL_DIGEST* digest1 = modutil_get_digest(buf1);
+    const MODUTIL_DIGEST* digest2 = modutil_get_digest(buf2);
+    const MODUTIL_DIGEST* digest3 = modutil_get_digest(buf3);
+    ss_info_dassert(digest1 && digest2 && digest3, "The digests should be calculated");
+
+    /** The digest is calculated once and shared with clones */
+    GWBUF* clone = gwbuf_clone(buf1);
+    ss_info_dassert(modutil_get_digest(buf1) == digest1, "The digest should be stored in the buffer");
+    ss_info_dassert(modutil_get_digest(clone) == digest1, "A clone should share the digest");
+    ss_info_dassert(!GWBUF_IS_PARSED(buf1), "The digest should not mark the buffer parsed");
+
+    ss_info_dassert(mxs_hash128_equal(&digest1->hash, &digest3->hash), "Same SQL, same hash");
+    ss_info_dassert(!mxs_hash128_equal(&digest1->hash, &digest2->hash), "Different SQL, different hash");
+    ss_info_dassert(!digest1->has_canonical, "The canonical form should not be hashed unless asked for");
+
+    uint64_t canonical1;
+    uint64_t canonical2;
+    ss_info_dassert(modutil_get_canonical_digest(buf1, &canonical1) &&
+                    modutil_get_canonical_digest(buf2, &canonical2), "The canonical digests should be calculated");
+    ss_info_dassert(digest1->has_canonical, "The canonical digest should be stored in the digest");
+    ss_info_dassert(canonical1 == canonical2, "Same canonical form, same digest");
+
+    gwbuf_free(clone);
+    gwbuf_free(buf1);
+    gwbuf_free(buf2);
+    gwbuf_free(buf3);
+
+    /** Only statements have a digest */
+    GWBUF* ping = gwbuf_alloc_and_load(5, "\x01\x00\x00\x00\x0e");
+    ss_info_dassert(modutil_get_digest(ping) == NULL, "A COM_PING should not have a digest");
+    ss_info_dassert(!modutil_get_canonical_digest(ping, &canonical1), "A COM_PING should not have a digest");
+    gwbuf_free(ping);
+}
+
+void test_tracked_variable()
+{
+    /** An OK packet with session state changes for autocommit and last_gtid */
+    uint8_t ok_tracked[] =
+        "\x2e\x00\x00\x01"       // Header
+        "\x00\x01\x00"            // OK, affected rows and insert ID
+        "\x02\x40\x00\x00"        // Autocommit and state changed, no warnings
+        "\x00"                    // No info
+        "\x25"                    // Length of the state changes
+        "\x00\x0e\x0a" "autocommit" "\x02" "ON"
+        "\x00\x13\x09" "last_gtid" "\x08" "0-3000-3";
+    char value[32];
+
+    ss_info_dassert(modutil_get_tracked_variable(ok_tracked, "last_gtid", value, sizeof(value)),
+                    "The GTID should be found");
+    ss_info_dassert(strcmp(value, "0-3000-3") == 0, "The GTID should match");
+    ss_info_dassert(modutil_get_tracked_variable(ok_tracked, "autocommit", value, sizeof(value)),
+                    "The autocommit value should be found");
+    ss_info_dassert(strcmp(value, "ON") == 0, "The autocommit value should match");
+    ss_info_dassert(!modutil_get_tracked_variable(ok_tracked, "last_gtid", value, 8),
+                    "A value that does not fit should not be returned");
+    ss_info_dassert(!modutil_get_tracked_variable(ok_tracked, "sql_mode", value, sizeof(value)),
+                    "An unchanged variable should not be found");
+
+    /** Without the state change flag, the rest of the packet is the info string */
+    ok_tracked[8] = 0x00;
+    ss_info_dassert(!modutil_get_tracked_variable(ok_tracked, "last_gtid", value, sizeof(value)),
+                    "Changes should only be read when the server reports them");
+    ok_tracked[8] = 0x40;
+
+    /** A state change that claims to be longer than the packet */
+    ok_tracked[12] = 0x26;
+    ss_info_dassert(!modutil_get_tracked_variable(ok_tracked, "last_gtid", value, sizeof(value)),
+                    "A malformed packet should be rejected");
+    ok_tracked[0] = 0x0d;
+    ok_tracked[12] = 0x25;
+    ss_info_dassert(!modutil_get_tracked_variable(ok_tracked, "last_gtid", value, sizeof(value)),
+                    "A truncated packet should be rejected");
+
+    ss_info_dassert(!modutil_get_tracked_variable((uint8_t*)ok, "last_gtid", value, sizeof(value)),
+                    "A plain OK packet has no state changes");
+}
+
+void test_strip_session_track()
+{
+    /** An OK packet with an info string and a tracked last_gtid */
+    uint8_t ok_tracked[] =
+        "\x1f\x00\x00\x01"       // Header
+        "\x00\x01\x00"            // OK, affected rows and insert ID
+        "\x02\x40\x00\x00"        // Autocommit and state changed, no warnings
+        "\x03" "abc"               // Info
+        "\x13"                    // Length of the state changes
+        "\x00\x11\x09" "last_gtid" "\x06" "0-1-22";
+    uint8_t ok_plain[] =
+        "\x0a\x00\x00\x01"
+        "\x00\x01\x00"
+        "\x02\x00\x00\x00"
+        "abc";
+
+    GWBUF* buffer = gwbuf_alloc_and_load(sizeof(ok_tracked) - 1, ok_tracked);
+    ss_info_dassert(modutil_add_tracked_variables(buffer, ok_tracked) == 1,
+                    "One variable should be added");
+    char* value = gwbuf_get_property(buffer, "last_gtid");
+    ss_info_dassert(value && strcmp(value, "0-1-22") == 0, "The property should be the GTID");
+    gwbuf_free(buffer);
+
+    size_t len = modutil_strip_session_track(ok_tracked);
+    ss_info_dassert(len == sizeof(ok_plain) - 1, "The state changes should be removed");
+    ss_info_dassert(memcmp(ok_tracked, ok_plain, len) == 0,
+                    "The packet should be in the format of the client");
+
+    /** Without an info string the formats are the same */
+    uint8_t ok_empty[] = "\x07\x00\x00\x01\x00\x00\x00\x02\x00\x00\x00";
+    ss_info_dassert(modutil_strip_session_track(ok_empty) == sizeof(ok_empty) - 1,
+                    "An OK packet without info should not change");
+
+    /** Only the changes are removed when there is no info string */
+    uint8_t ok_no_info[] =
+        "\x1c\x00\x00\x01"
+        "\x00\x00\x00"
+        "\x02\x40\x00\x00"
+        "\x00"
+        "\x13"
+        "\x00\x11\x09" "last_gtid" "\x06" "0-1-23";
+    ss_info_dassert(modutil_strip_session_track(ok_no_info) == 11 &&
+                    memcmp(ok_no_info, ok_empty, 11) == 0,
+                    "The packet should be a plain OK packet");
+
+    uint8_t eof[] = "\x05\x00\x00\x05\xfe\x00\x00\x02\x00";
+    ss_info_dassert(modutil_strip_session_track(eof) == sizeof(eof) - 1 &&
+                    eof[7] == 0x02, "Other packets should not change");
+}
+
 int main(int argc, char **argv)
 {
     int result = 0;
@@ -642,5 +927,10 @@ int main(int argc, char **argv)
     test_strnchr_esc_mysql();
     test_large_packets();
     test_bypass_whitespace();
+    test_split_statements();
+    test_index_packets();
+    test_digest();
+    test_tracked_variable();
+    test_strip_session_track();
     exit(result);
 }
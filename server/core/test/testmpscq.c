@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test and benchmark for the lock-free fake event queue
+ *
+ * A number of producer threads add events to the queue of one consumer which
+ * is woken up with an eventfd, the same way the poll threads process fake
+ * events. The throughput is compared with a spinlock protected list, which
+ * is how the fake events used to be queued.
+ *
+ * Usage: test_mpscq [max producers] [events per producer]
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+#include <maxscale/spinlock.h>
+#include <maxscale/thread.h>
+
+#include "../maxscale/mpscq.h"
+
+#define MAX_PRODUCERS 64
+
+typedef struct test_event
+{
+    MXS_MPSCQ_NODE     node;
+    int                producer;
+    int                seq;
+    struct test_event *next;
+    struct test_event *tail;
+} test_event_t;
+
+typedef struct
+{
+    bool          lockfree;
+    int           n_events;
+    int           wakeup_fd;
+    MXS_MPSCQ     queue;
+    SPINLOCK      lock;
+    test_event_t *list;
+} test_queue_t;
+
+typedef struct
+{
+    test_queue_t *queue;
+    int           id;
+} producer_t;
+
+static void wakeup(test_queue_t *queue)
+{
+    uint64_t one = 1;
+    ssize_t n = write(queue->wakeup_fd, &one, sizeof(one));
+    ss_dassert(n == sizeof(one));
+}
+
+static void push_lockfree(test_queue_t *queue, test_event_t *event)
+{
+    if (mxs_mpscq_push(&queue->queue, &event->node))
+    {
+        wakeup(queue);
+    }
+}
+
+static void push_spinlock(test_queue_t *queue, test_event_t *event)
+{
+    bool was_empty;
+    event->next = NULL;
+    event->tail = event;
+
+    spinlock_acquire(&queue->lock);
+
+    if ((was_empty = queue->list == NULL))
+    {
+        queue->list = event;
+    }
+    else
+    {
+        queue->list->tail->next = event;
+        queue->list->tail = event;
+    }
+
+    spinlock_release(&queue->lock);
+
+    if (was_empty)
+    {
+        wakeup(queue);
+    }
+}
+
+static void producer(void *data)
+{
+    producer_t *p = (producer_t*)data;
+
+    for (int i = 0; i < p->queue->n_events; i++)
+    {
+        test_event_t *event = MXS_MALLOC(sizeof(*event));
+        ss_dassert(event);
+        event->producer = p->id;
+        event->seq = i;
+
+        if (p->queue->lockfree)
+        {
+            push_lockfree(p->queue, event);
+        }
+        else
+        {
+            push_spinlock(p->queue, event);
+        }
+    }
+}
+
+static test_event_t* take_all(test_queue_t *queue)
+{
+    test_event_t *events = NULL;
+
+    if (queue->lockfree)
+    {
+        events = (test_event_t*)mxs_mpscq_take_all(&queue->queue);
+
+        /** Use the same link as the spinlock protected list */
+        for (test_event_t *e = events; e; e = e->next)
+        {
+            e->next = (test_event_t*)e->node.next;
+        }
+    }
+    else
+    {
+        spinlock_acquire(&queue->lock);
+        events = queue->list;
+        queue->list = NULL;
+        spinlock_release(&queue->lock);
+    }
+
+    return events;
+}
+
+/**
+ * Run the producers and consume all events
+ *
+ * @return Number of events per second
+ */
+static double run(bool lockfree, int n_producers, int n_events)
+{
+    test_queue_t queue = {.lockfree = lockfree, .n_events = n_events, .queue = MXS_MPSCQ_INIT,
+                          .lock = SPINLOCK_INIT, .list = NULL};
+    queue.wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    ss_dassert(queue.wakeup_fd != -1);
+
+    producer_t producers[MAX_PRODUCERS];
+    THREAD threads[MAX_PRODUCERS];
+    int next_seq[MAX_PRODUCERS] = {};
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < n_producers; i++)
+    {
+        producers[i].queue = &queue;
+        producers[i].id = i;
+        THREAD *thr = thread_start(&threads[i], producer, &producers[i]);
+        ss_dassert(thr);
+    }
+
+    int64_t total = (int64_t)n_producers * n_events;
+
+    while (total > 0)
+    {
+        uint64_t count;
+        ssize_t n = read(queue.wakeup_fd, &count, sizeof(count));
+        ss_dassert(n == sizeof(count));
+
+        test_event_t *event = take_all(&queue);
+
+        while (event)
+        {
+            /** The events of one producer must arrive in the order they were added */
+            ss_info_dassert(event->seq == next_seq[event->producer], "Events should be in order");
+            next_seq[event->producer]++;
+            total--;
+
+            test_event_t *next = event->next;
+            MXS_FREE(event);
+            event = next;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < n_producers; i++)
+    {
+        thread_wait(threads[i]);
+        ss_dassert(next_seq[i] == n_events);
+    }
+
+    close(queue.wakeup_fd);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+    return secs > 0 ? n_producers * n_events / secs : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int max_producers = argc > 1 ? atoi(argv[1]) : 4;
+    int n_events = argc > 2 ? atoi(argv[2]) : 100000;
+
+    if (max_producers < 1 || max_producers > MAX_PRODUCERS || n_events < 1)
+    {
+        fprintf(stderr, "Usage: %s [max producers (1-%d)] [events per producer]\n",
+                argv[0], MAX_PRODUCERS);
+        return 1;
+    }
+
+    printf("Producers | Lock-free events/s | Spinlock events/s\n");
+    printf("----------+--------------------+------------------\n");
+
+    for (int i = 1; i <= max_producers; i++)
+    {
+        double lockfree = run(true, i, n_events);
+        double spinlock = run(false, i, n_events);
+        printf("%9d | %18.0f | %17.0f\n", i, lockfree, spinlock);
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test closing of a DCB while it is being moved from one thread to another
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <maxscale/dcb.h>
+#include <maxscale/listener.h>
+
+#include "test_utils.h"
+
+static void* poll_thread(void *arg)
+{
+    poll_waitevents(arg);
+    return NULL;
+}
+
+/**
+ * A DCB that is closed after poll_move_dcb() but before the target thread
+ * has adopted it must not be removed from an epoll instance or a thread's
+ * DCB count a second time and it must not be freed before the adoption
+ * event is processed.
+ */
+static int
+test1()
+{
+    SERV_LISTENER dummy;
+    int fds[2];
+
+    memset(&dummy, 0, sizeof(dummy));
+    ss_dfprintf(stderr, "testpollmigrate : Initialise the polling system.");
+    config_get_global_options()->n_threads = 2;
+    ts_stats_init();
+    mxs_log_init(NULL, TEST_LOG_DIR, MXS_LOG_TARGET_DEFAULT);
+    dcb_global_init();
+    poll_init();
+    hkinit();
+
+    ss_dfprintf(stderr, "\t..done\nAdd a DCB");
+    DCB *dcb = dcb_alloc(DCB_ROLE_CLIENT_HANDLER, &dummy);
+    ss_info_dassert(dcb, "dcb_alloc() should succeed");
+    int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ss_info_dassert(rc == 0, "socketpair() should succeed");
+    dcb->fd = fds[0];
+
+    rc = poll_add_dcb(dcb);
+    ss_info_dassert(rc == 0, "poll_add_dcb() should succeed");
+    int owner = dcb->thread.id;
+    int target = owner == 0 ? 1 : 0;
+    ss_info_dassert(poll_thread_dcb_count(owner) == 1, "Owner should have one DCB");
+
+    ss_dfprintf(stderr, "\t..done\nMove the DCB and close it");
+    current_thread_id = owner;
+    bool moved = poll_move_dcb(dcb, target);
+    ss_info_dassert(moved, "poll_move_dcb() should succeed");
+    ss_info_dassert(dcb->thread.migrating, "DCB should be migrating");
+    ss_info_dassert(dcb->thread.id == target, "DCB should belong to the target");
+    ss_info_dassert(poll_thread_dcb_count(owner) == 0, "Owner should have no DCBs");
+    ss_info_dassert(poll_thread_dcb_count(target) == 0, "Target should have no DCBs");
+
+    current_thread_id = target;
+    dcb_close(dcb);
+    dcb_process_zombies(target);
+    dcb_process_zombies(target);
+
+    ss_info_dassert(dcb->state == DCB_STATE_NOPOLLING, "DCB should not be polling");
+    ss_info_dassert(dcb->thread.migrating, "DCB should still be migrating");
+    ss_info_dassert(poll_thread_dcb_count(target) == 0, "Target should have no DCBs");
+
+    ss_dfprintf(stderr, "\t..done\nProcess the adoption event");
+    pthread_t thr;
+    rc = pthread_create(&thr, NULL, poll_thread, (void*)(intptr_t)target);
+    ss_info_dassert(rc == 0, "pthread_create() should succeed");
+    sleep(2);
+    poll_shutdown();
+    pthread_join(thr, NULL);
+
+    ss_info_dassert(poll_thread_dcb_count(owner) == 0, "Owner should have no DCBs");
+    ss_info_dassert(poll_thread_dcb_count(target) == 0, "Target should have no DCBs");
+    close(fds[1]);
+    ss_dfprintf(stderr, "\t..done\n");
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    result += test1();
+
+    exit(result);
+}
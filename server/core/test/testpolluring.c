@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the io_uring poll engine. The test passes without doing anything if
+ * the engine is not supported by the kernel or was not built.
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <maxscale/debug.h>
+#include <maxscale/thread.h>
+
+#include "../maxscale/poll_uring.h"
+
+#define MAX_EVENTS 16
+
+static int pipe_fds[2];
+
+static bool has_event(struct epoll_event *events, int n, void *ptr, uint32_t mask)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (events[i].data.ptr == ptr && (events[i].events & mask))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Events are returned for added descriptors until they are removed
+ */
+static int test_events()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &pipe_fds[0];
+
+    ss_dfprintf(stderr, "testpolluring : Add a descriptor");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, pipe_fds[0], &ev) == 0, "Adding should work");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, pipe_fds[0], &ev) == -1 && errno == EEXIST,
+                    "Adding twice should fail with EEXIST");
+
+    ss_dfprintf(stderr, "\t..done\nWait with a timeout");
+    int n = poll_uring_wait(0, events, MAX_EVENTS, 100);
+    ss_info_dassert(n == 0, "There should be no events");
+
+    ss_dfprintf(stderr, "\t..done\nRead event");
+    ss_info_dassert(write(pipe_fds[1], "a", 1) == 1, "Write should work");
+    n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    ss_info_dassert(n == 1 && has_event(events, n, &pipe_fds[0], EPOLLIN), "Read event should be returned");
+
+    ss_dfprintf(stderr, "\t..done\nSecond read event");
+    ss_info_dassert(write(pipe_fds[1], "b", 1) == 1, "Write should work");
+    n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    ss_info_dassert(n == 1 && has_event(events, n, &pipe_fds[0], EPOLLIN), "Read event should be returned");
+
+    char buf[2];
+    ss_info_dassert(read(pipe_fds[0], buf, sizeof(buf)) == 2, "Read should work");
+
+    ss_dfprintf(stderr, "\t..done\nRemove the descriptor");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, pipe_fds[0], &ev) == 0, "Removing should work");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, pipe_fds[0], &ev) == -1 && errno == ENOENT,
+                    "Removing twice should fail with ENOENT");
+    ss_info_dassert(write(pipe_fds[1], "c", 1) == 1, "Write should work");
+    n = poll_uring_wait(0, events, MAX_EVENTS, 100);
+    ss_info_dassert(n == 0, "There should be no events after removal");
+    ss_info_dassert(read(pipe_fds[0], buf, sizeof(buf)) == 1, "Read should work");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+static void add_from_thread(void *data)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &pipe_fds[1];
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, pipe_fds[0], &ev) == 0, "Adding should work");
+    ss_info_dassert(write(pipe_fds[1], "d", 1) == 1, "Write should work");
+}
+
+/**
+ * A descriptor added by another thread wakes up the owner
+ */
+static int test_other_thread()
+{
+    struct epoll_event events[MAX_EVENTS];
+    THREAD thr;
+
+    ss_dfprintf(stderr, "testpolluring : Add from another thread");
+    ss_info_dassert(thread_start(&thr, add_from_thread, NULL), "Thread should start");
+
+    int n = 0;
+
+    for (int i = 0; i < 10 && !has_event(events, n, &pipe_fds[1], EPOLLIN); i++)
+    {
+        n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    }
+
+    thread_wait(thr);
+    ss_info_dassert(has_event(events, n, &pipe_fds[1], EPOLLIN), "Read event should be returned");
+
+    char buf[2];
+    struct epoll_event ev;
+    ss_info_dassert(read(pipe_fds[0], buf, sizeof(buf)) == 1, "Read should work");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, pipe_fds[0], &ev) == 0, "Removing should work");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+/**
+ * Write readiness and hangups are returned like epoll returns them
+ */
+static int test_write_and_hangup()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct epoll_event ev;
+    int sv[2];
+
+    ss_dfprintf(stderr, "testpolluring : Write event");
+    ss_info_dassert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "Socket pair should be created");
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLHUP | EPOLLET;
+    ev.data.ptr = &sv[0];
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, sv[0], &ev) == 0, "Adding should work");
+    int n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    ss_info_dassert(has_event(events, n, &sv[0], EPOLLOUT), "Write event should be returned");
+
+    ss_dfprintf(stderr, "\t..done\nHangup event");
+    close(sv[1]);
+    n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    ss_info_dassert(has_event(events, n, &sv[0], EPOLLRDHUP | EPOLLHUP), "Hangup should be returned");
+
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, sv[0], &ev) == 0, "Removing should work");
+    close(sv[0]);
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+/**
+ * A descriptor that is added again only returns events with the new data
+ */
+static int test_readd()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct epoll_event ev;
+    char buf[2];
+
+    ss_dfprintf(stderr, "testpolluring : Add, remove and add again");
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &pipe_fds[0];
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, pipe_fds[0], &ev) == 0, "Adding should work");
+    ss_info_dassert(write(pipe_fds[1], "e", 1) == 1, "Write should work");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, pipe_fds[0], &ev) == 0, "Removing should work");
+
+    ev.data.ptr = &pipe_fds[1];
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, pipe_fds[0], &ev) == 0, "Adding again should work");
+    int n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+    ss_info_dassert(has_event(events, n, &pipe_fds[1], EPOLLIN), "Read event should be returned");
+    ss_info_dassert(!has_event(events, n, &pipe_fds[0], EPOLLIN), "Old data should not be returned");
+
+    ss_info_dassert(read(pipe_fds[0], buf, sizeof(buf)) == 1, "Read should work");
+    ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, pipe_fds[0], &ev) == 0, "Removing should work");
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+#define N_PIPES (MAX_EVENTS * 4)
+
+static int many_fds[N_PIPES][2];
+
+static void remove_from_thread(void *data)
+{
+    struct epoll_event ev;
+
+    for (int i = 0; i < N_PIPES; i += 2)
+    {
+        ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, many_fds[i][0], &ev) == 0, "Removing should work");
+    }
+}
+
+/**
+ * More events than fit in one call are returned by the following calls and
+ * descriptors removed by another thread return no more events
+ */
+static int test_many()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct epoll_event ev;
+    bool seen[N_PIPES];
+    int n_seen = 0;
+
+    ss_dfprintf(stderr, "testpolluring : Events for %d descriptors", N_PIPES);
+    memset(seen, 0, sizeof(seen));
+
+    for (int i = 0; i < N_PIPES; i++)
+    {
+        ss_info_dassert(pipe(many_fds[i]) == 0, "Pipe should be created");
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &many_fds[i];
+        ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_ADD, many_fds[i][0], &ev) == 0, "Adding should work");
+        ss_info_dassert(write(many_fds[i][1], "f", 1) == 1, "Write should work");
+    }
+
+    for (int i = 0; i < N_PIPES && n_seen < N_PIPES; i++)
+    {
+        int n = poll_uring_wait(0, events, MAX_EVENTS, 1000);
+        ss_info_dassert(n > 0 && n <= MAX_EVENTS, "Events should be returned");
+
+        for (int j = 0; j < n; j++)
+        {
+            int idx = (int (*)[2])events[j].data.ptr - many_fds;
+            ss_info_dassert(idx >= 0 && idx < N_PIPES && !seen[idx], "Each event should be returned once");
+            seen[idx] = true;
+            n_seen++;
+        }
+    }
+
+    ss_info_dassert(n_seen == N_PIPES, "All events should be returned");
+
+    ss_dfprintf(stderr, "\t..done\nRemove from another thread");
+    THREAD thr;
+    ss_info_dassert(thread_start(&thr, remove_from_thread, NULL), "Thread should start");
+    thread_wait(thr);
+
+    for (int i = 0; i < N_PIPES; i++)
+    {
+        ss_info_dassert(write(many_fds[i][1], "g", 1) == 1, "Write should work");
+    }
+
+    n_seen = 0;
+    int n;
+
+    while ((n = poll_uring_wait(0, events, MAX_EVENTS, 100)) > 0)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            int idx = (int (*)[2])events[j].data.ptr - many_fds;
+            ss_info_dassert(idx % 2 == 1, "Removed descriptors should not return events");
+            n_seen++;
+        }
+    }
+
+    ss_info_dassert(n_seen == N_PIPES / 2, "The remaining descriptors should return events");
+
+    for (int i = 0; i < N_PIPES; i++)
+    {
+        if (i % 2 == 1)
+        {
+            ss_info_dassert(poll_uring_ctl(0, EPOLL_CTL_DEL, many_fds[i][0], &ev) == 0, "Removing should work");
+        }
+
+        close(many_fds[i][0]);
+        close(many_fds[i][1]);
+    }
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    if (!poll_uring_init(1))
+    {
+        printf("io_uring is not supported: %s\n", strerror(errno));
+        return 0;
+    }
+
+    ss_info_dassert(pipe(pipe_fds) == 0, "Pipe should be created");
+
+    result += test_events();
+    result += test_other_thread();
+    result += test_write_and_hangup();
+    result += test_readd();
+    result += test_many();
+
+    exit(result);
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test that the statements recognized by the pre-classifier get the same
+ * classification as when they are parsed by qc_sqlite.
+ */
+
+#include <maxscale/cppdefs.hh>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../maxscale/query_classifier.h"
+#include "../maxscale/preclassifier.hh"
+#include <maxscale/alloc.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include "../../../query_classifier/test/testreader.hh"
+
+using namespace std;
+
+namespace
+{
+
+char USAGE[] =
+    "test_preclassifier [-v] [file]"
+    "\n"
+    "-v 0, only return code\n"
+    "   1, failed cases (default)\n"
+    "   2, all recognized cases\n";
+
+enum verbosity_t
+{
+    VERBOSITY_NOTHING    = 0,
+    VERBOSITY_FAILED     = 1,
+    VERBOSITY_RECOGNIZED = 2,
+};
+
+/** Statements that must be recognized */
+const char* RECOGNIZED[] =
+{
+    "BEGIN",
+    "begin work;",
+    "COMMIT",
+    "COMMIT WORK",
+    "ROLLBACK",
+    "START TRANSACTION",
+    "START TRANSACTION READ ONLY",
+    "START TRANSACTION READ WRITE",
+    "START TRANSACTION READ ONLY, WITH CONSISTENT SNAPSHOT",
+    "SET autocommit=0",
+    "SET autocommit = 1",
+    "SET AUTOCOMMIT=ON",
+    "SET autocommit=false",
+    "SET SESSION autocommit=1",
+    "SET @@autocommit=0",
+    "SET @@session.autocommit=1",
+    "SET @@global.autocommit=0",
+    "USE test",
+    "USE `my db`",
+    "SELECT 1",
+    "SELECT 1, 'a', NULL, -2.5",
+    "SELECT * FROM t1",
+    "SELECT a, b FROM db1.t1",
+    "SELECT t1.a FROM t1 WHERE t1.id = 1",
+    "SELECT a FROM t1 WHERE id = 5 AND b = 'x' LIMIT 1",
+    "SELECT `a` FROM `t1` WHERE `b` >= 2 LIMIT 10, 20",
+    "select a from t1 where b != 'it''s';",
+    "/* comment */ SELECT a FROM t1 -- comment\n",
+};
+
+/** Statements that must not be recognized */
+const char* NOT_RECOGNIZED[] =
+{
+    "BEGIN; SELECT 1",
+    "ROLLBACK TO SAVEPOINT sp",
+    "START TRANSACTION READ ONLY WITH CONSISTENT SNAPSHOT",
+    "SET autocommit=2",
+    "SET autocommit=1, sql_mode=''",
+    "SELECT a",
+    "SELECT @@version",
+    "SELECT a FROM t1 FOR UPDATE",
+    "SELECT a FROM t1 WHERE b = c",
+    "SELECT a FROM t1 WHERE b = @x",
+    "SELECT a FROM t1 WHERE b = 1 OR c = 2",
+    "SELECT /*!40001 SQL_NO_CACHE */ a FROM t1",
+    "SELECT DISTINCT a FROM t1",
+    "SELECT a FROM t1, t2",
+    "SELECT 1e5",
+};
+
+GWBUF* create_gwbuf(const char* zStmt)
+{
+    size_t len = strlen(zStmt);
+    size_t payload_len = len + 1;
+    size_t gwbuf_len = MYSQL_HEADER_LEN + payload_len;
+
+    GWBUF* pBuf = gwbuf_alloc(gwbuf_len);
+
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf))) = payload_len;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 1)) = (payload_len >> 8);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 2)) = (payload_len >> 16);
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 3)) = 0x00;
+    *((unsigned char*)((char*)GWBUF_DATA(pBuf) + 4)) = 0x03;
+    memcpy((char*)GWBUF_DATA(pBuf) + 5, zStmt, len);
+
+    return pBuf;
+}
+
+class Tester
+{
+public:
+    Tester(uint32_t verbosity)
+        : m_verbosity(verbosity)
+    {
+    }
+
+    /**
+     * Compare the pre-classification of a statement with the classification
+     * done by the query classifier.
+     *
+     * @param zStmt      The statement.
+     * @param recognized If not NULL, whether the statement should be recognized.
+     */
+    int run(const char* zStmt, const bool* recognized = NULL)
+    {
+        int rc = EXIT_SUCCESS;
+
+        maxscale::PreClassifier pc;
+        bool is_recognized = pc.classify(zStmt, strlen(zStmt));
+
+        if (recognized && *recognized != is_recognized)
+        {
+            if (m_verbosity & VERBOSITY_FAILED)
+            {
+                cout << zStmt << ": " << (is_recognized ? "recognized" : "not recognized") << endl;
+            }
+
+            rc = EXIT_FAILURE;
+        }
+        else if (is_recognized)
+        {
+            GWBUF* pStmt = create_gwbuf(zStmt);
+
+            uint32_t type_mask = qc_get_type_mask(pStmt);
+            qc_query_op_t op = qc_get_operation(pStmt);
+            bool has_clause = qc_query_has_clause(pStmt);
+
+            gwbuf_free(pStmt);
+
+            char* zType_mask_qc = qc_typemask_to_string(type_mask);
+            char* zType_mask_pc = qc_typemask_to_string(pc.type_mask());
+
+            if (type_mask != pc.type_mask() || op != pc.operation() || has_clause != pc.has_clause())
+            {
+                if (m_verbosity & VERBOSITY_FAILED)
+                {
+                    cout << zStmt << "\n"
+                         << "  QC : " << zType_mask_qc << ", " << qc_op_to_string(op)
+                         << ", " << has_clause << "\n"
+                         << "  PRE: " << zType_mask_pc << ", " << qc_op_to_string(pc.operation())
+                         << ", " << pc.has_clause() << endl;
+                }
+
+                rc = EXIT_FAILURE;
+            }
+            else if (m_verbosity & VERBOSITY_RECOGNIZED)
+            {
+                cout << zStmt << ": " << zType_mask_pc << endl;
+            }
+
+            MXS_FREE(zType_mask_qc);
+            MXS_FREE(zType_mask_pc);
+        }
+
+        return rc;
+    }
+
+    int run(istream& in)
+    {
+        int rc = EXIT_SUCCESS;
+
+        maxscale::TestReader reader(in);
+
+        string stmt;
+
+        while (reader.get_statement(stmt) == maxscale::TestReader::RESULT_STMT)
+        {
+            if (run(stmt.c_str()) == EXIT_FAILURE)
+            {
+                rc = EXIT_FAILURE;
+            }
+        }
+
+        return rc;
+    }
+
+    int run_builtin()
+    {
+        int rc = EXIT_SUCCESS;
+        bool recognized = true;
+
+        for (size_t i = 0; i < sizeof(RECOGNIZED) / sizeof(RECOGNIZED[0]); ++i)
+        {
+            if (run(RECOGNIZED[i], &recognized) == EXIT_FAILURE)
+            {
+                rc = EXIT_FAILURE;
+            }
+        }
+
+        recognized = false;
+
+        for (size_t i = 0; i < sizeof(NOT_RECOGNIZED) / sizeof(NOT_RECOGNIZED[0]); ++i)
+        {
+            if (run(NOT_RECOGNIZED[i], &recognized) == EXIT_FAILURE)
+            {
+                rc = EXIT_FAILURE;
+            }
+        }
+
+        return rc;
+    }
+
+private:
+    Tester(const Tester&);
+    Tester& operator = (const Tester&);
+
+private:
+    uint32_t m_verbosity;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rc = EXIT_SUCCESS;
+
+    int verbosity = VERBOSITY_FAILED;
+
+    int c;
+    while ((c = getopt(argc, argv, "v:")) != -1)
+    {
+        switch (c)
+        {
+        case 'v':
+            verbosity = atoi(optarg);
+            break;
+
+        default:
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    if ((rc == EXIT_SUCCESS) && (argc - optind <= 1))
+    {
+        rc = EXIT_FAILURE;
+
+        set_datadir(strdup("/tmp"));
+        set_langdir(strdup("."));
+        set_process_datadir(strdup("/tmp"));
+
+        if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+        {
+            if (qc_setup("qc_sqlite", NULL) && qc_process_init(QC_INIT_BOTH))
+            {
+                // The statements are compared with what qc_sqlite returns.
+                qc_set_preclassifier_enabled(false);
+
+                Tester tester(verbosity);
+
+                if (optind == argc)
+                {
+                    rc = tester.run_builtin();
+                }
+                else
+                {
+                    ifstream in(argv[optind]);
+
+                    if (in)
+                    {
+                        rc = tester.run(in);
+                    }
+                    else
+                    {
+                        cerr << "error: Could not open " << argv[optind] << "." << endl;
+                    }
+                }
+
+                qc_process_end(QC_INIT_BOTH);
+            }
+            else
+            {
+                cerr << "error: Could not initialize qc_sqlite." << endl;
+            }
+
+            mxs_log_finish();
+        }
+        else
+        {
+            cerr << "error: Could not initialize log." << endl;
+        }
+    }
+    else
+    {
+        cout << USAGE << endl;
+    }
+
+    return rc;
+}
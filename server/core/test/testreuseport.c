@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test that a reuseport listener has a socket of its own for each thread and
+ * that each socket is only polled by the thread that owns it
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+
+#include "../poll.c"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <maxscale/listener.h>
+
+#include "test_utils.h"
+
+#define N_THREADS 3
+
+/** Find a port that nothing listens on */
+static uint16_t free_port()
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ss_info_dassert(fd != -1, "socket() should succeed");
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int rc = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    ss_info_dassert(rc == 0, "bind() should succeed");
+    rc = getsockname(fd, (struct sockaddr*)&addr, &len);
+    ss_info_dassert(rc == 0, "getsockname() should succeed");
+    close(fd);
+
+    return ntohs(addr.sin_port);
+}
+
+/** Check whether a file descriptor is in the epoll instance of a thread */
+static bool is_polled_by(int thread_id, int fd)
+{
+    struct epoll_event ev;
+    ev.events = POLL_DCB_EVENTS;
+    ev.data.ptr = NULL;
+
+    return epoll_ctl(epoll_fd[thread_id], EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+static int test_reuseport()
+{
+    ss_dfprintf(stderr, "testreuseport : One listener socket per thread");
+
+    SERV_LISTENER port;
+    memset(&port, 0, sizeof(port));
+    port.reuseport = true;
+
+    DCB *dcb = dcb_alloc(DCB_ROLE_SERVICE_LISTENER, &port);
+    ss_info_dassert(dcb, "dcb_alloc() should succeed");
+
+    char config[64];
+    uint16_t portno = free_port();
+    snprintf(config, sizeof(config), "127.0.0.1|%u", portno);
+
+    int rc = dcb_listen(dcb, config, "test");
+    ss_info_dassert(rc == 0, "dcb_listen() should succeed");
+    ss_info_dassert(dcb->reuseport_fds, "The listener should have per-thread sockets");
+    ss_info_dassert(dcb->reuseport_fds[0] == dcb->fd, "The first thread should use the listener's socket");
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = dcb->reuseport_fds[i];
+
+        ss_info_dassert(getsockname(fd, (struct sockaddr*)&addr, &len) == 0 &&
+                        ntohs(addr.sin_port) == portno, "The socket should be bound to the port");
+
+        for (int j = 0; j < i; j++)
+        {
+            ss_info_dassert(dcb->reuseport_fds[j] != fd, "Each thread should have its own socket");
+        }
+
+        for (int j = 0; j < N_THREADS; j++)
+        {
+            ss_info_dassert(is_polled_by(j, fd) == (i == j),
+                            "The socket should only be polled by the thread that owns it");
+        }
+    }
+
+    ss_dfprintf(stderr, "\t..done\nRemove the listener");
+    rc = poll_remove_dcb(dcb);
+    ss_info_dassert(rc == 0, "poll_remove_dcb() should succeed");
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        ss_info_dassert(!is_polled_by(i, dcb->reuseport_fds[i]),
+                        "The socket should be removed from the thread");
+    }
+
+    for (int i = 1; i < N_THREADS; i++)
+    {
+        close(dcb->reuseport_fds[i]);
+    }
+
+    close(dcb->fd);
+    MXS_FREE(dcb->reuseport_fds);
+    dcb->reuseport_fds = NULL;
+    dcb->fd = DCBFD_CLOSED;
+
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    config_get_global_options()->n_threads = N_THREADS;
+    ts_stats_init();
+    mxs_log_init(NULL, TEST_LOG_DIR, MXS_LOG_TARGET_DEFAULT);
+    dcb_global_init();
+    poll_init();
+
+    result += test_reuseport();
+
+    exit(result);
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the thread_assignment policies that select the thread of a new DCB
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+
+#include "../poll.c"
+
+#include <sys/socket.h>
+#include <maxscale/listener.h>
+
+#include "test_utils.h"
+
+#define N_THREADS 3
+#define MAX_DCBS  32
+
+static SERV_LISTENER dummy;
+static DCB *dcbs[MAX_DCBS];
+static int peers[MAX_DCBS];
+static int n_dcbs = 0;
+
+/**
+ * Add a new client DCB to the polling system
+ *
+ * @return The thread that the DCB was assigned to
+ */
+static int add_dcb()
+{
+    int fds[2];
+    ss_info_dassert(n_dcbs < MAX_DCBS, "Too many DCBs");
+    DCB *dcb = dcb_alloc(DCB_ROLE_CLIENT_HANDLER, &dummy);
+    ss_info_dassert(dcb, "dcb_alloc() should succeed");
+    int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ss_info_dassert(rc == 0, "socketpair() should succeed");
+    dcb->fd = fds[0];
+
+    rc = poll_add_dcb(dcb);
+    ss_info_dassert(rc == 0, "poll_add_dcb() should succeed");
+
+    dcbs[n_dcbs] = dcb;
+    peers[n_dcbs] = fds[1];
+    n_dcbs++;
+
+    return dcb->thread.id;
+}
+
+/**
+ * Remove a DCB from the polling system
+ *
+ * @param index Index of the DCB in the order they were added
+ */
+static void remove_dcb(int index)
+{
+    DCB *dcb = dcbs[index];
+    ss_info_dassert(dcb, "DCB should not be removed twice");
+    int rc = poll_remove_dcb(dcb);
+    ss_info_dassert(rc == 0, "poll_remove_dcb() should succeed");
+    close(dcb->fd);
+    close(peers[index]);
+    dcb->fd = DCBFD_CLOSED;
+    dcbs[index] = NULL;
+}
+
+static void remove_all_dcbs()
+{
+    for (int i = 0; i < n_dcbs; i++)
+    {
+        if (dcbs[i])
+        {
+            remove_dcb(i);
+        }
+    }
+
+    n_dcbs = 0;
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        ss_info_dassert(poll_thread_dcb_count(i) == 0, "Threads should have no DCBs");
+    }
+}
+
+/**
+ * With round_robin the threads are used in turn
+ */
+static int test_round_robin()
+{
+    ss_dfprintf(stderr, "testthreadassign : round_robin");
+    config_get_global_options()->thread_assignment = THREAD_ASSIGN_ROUND_ROBIN;
+
+    int first = add_dcb();
+
+    for (int i = 1; i < 2 * N_THREADS; i++)
+    {
+        ss_info_dassert(add_dcb() == (first + i) % N_THREADS, "Threads should be used in turn");
+    }
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        ss_info_dassert(poll_thread_dcb_count(i) == 2, "Each thread should have two DCBs");
+    }
+
+    remove_all_dcbs();
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+/**
+ * With least_dcbs a new DCB goes to the thread with the fewest DCBs
+ */
+static int test_least_dcbs()
+{
+    ss_dfprintf(stderr, "testthreadassign : least_dcbs");
+    config_get_global_options()->thread_assignment = THREAD_ASSIGN_LEAST_DCBS;
+
+    for (int i = 0; i < 3 * N_THREADS; i++)
+    {
+        add_dcb();
+    }
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        ss_info_dassert(poll_thread_dcb_count(i) == 3, "Each thread should have three DCBs");
+    }
+
+    /** Leave one thread with only one DCB, it gets the next two DCBs */
+    int target = dcbs[0]->thread.id;
+    int removed = 0;
+
+    for (int i = 0; i < n_dcbs && removed < 2; i++)
+    {
+        if (dcbs[i]->thread.id == target)
+        {
+            remove_dcb(i);
+            removed++;
+        }
+    }
+
+    ss_info_dassert(add_dcb() == target, "The thread with the fewest DCBs should be selected");
+    ss_info_dassert(add_dcb() == target, "The thread with the fewest DCBs should be selected");
+    ss_info_dassert(poll_thread_dcb_count(target) == 3, "The thread should have three DCBs");
+
+    remove_all_dcbs();
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+/**
+ * With least_load a new DCB goes to the thread with the lowest event rate,
+ * scaled by the DCBs it has received since the load was sampled
+ */
+static int test_least_load()
+{
+    ss_dfprintf(stderr, "testthreadassign : least_load");
+    config_get_global_options()->thread_assignment = THREAD_ASSIGN_LEAST_LOAD;
+
+    /** With no load, the DCBs are spread like with least_dcbs */
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        add_dcb();
+    }
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        ss_info_dassert(poll_thread_dcb_count(i) == 1, "Each thread should have one DCB");
+    }
+
+    /** Thread 0 handles 100 events per second, thread 1 10 and thread 2 20 */
+    const int rates[N_THREADS] = {100, 10, 20};
+
+    for (int i = 0; i < N_THREADS; i++)
+    {
+        thread_data[i].n_events += rates[i] * POLL_LOAD_FREQ;
+    }
+
+    poll_loadav(NULL);
+
+    /**
+     * Thread 1 gets new DCBs until its scaled load reaches that of thread 2,
+     * with equal loads the thread with fewer DCBs is selected
+     */
+    ss_info_dassert(add_dcb() == 1, "The least loaded thread should be selected");
+    ss_info_dassert(add_dcb() == 1, "The scaled load should still be the lowest");
+    ss_info_dassert(add_dcb() == 2, "The thread with fewer DCBs should be selected");
+    ss_info_dassert(poll_thread_dcb_count(0) == 1, "The busiest thread should get no DCBs");
+
+    /** A new sample with no events resets the loads */
+    poll_loadav(NULL);
+    ss_info_dassert(add_dcb() == 0, "The thread with the fewest DCBs should be selected");
+
+    remove_all_dcbs();
+    ss_dfprintf(stderr, "\t..done\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    memset(&dummy, 0, sizeof(dummy));
+    config_get_global_options()->n_threads = N_THREADS;
+    ts_stats_init();
+    mxs_log_init(NULL, TEST_LOG_DIR, MXS_LOG_TARGET_DEFAULT);
+    dcb_global_init();
+    poll_init();
+
+    result += test_round_robin();
+    result += test_least_dcbs();
+    result += test_least_load();
+
+    exit(result);
+}
@@ -1021,3 +1021,106 @@ long get_processor_count()
 #endif
     return processors;
 }
+
+static inline uint64_t hash128_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash128_fmix(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return k;
+}
+
+static inline uint64_t hash128_tail(const uint8_t* tail, size_t n)
+{
+    uint64_t k = 0;
+
+    for (size_t i = n; i > 0; --i)
+    {
+        k = (k << 8) | tail[i - 1];
+    }
+
+    return k;
+}
+
+void mxs_hash128(const void* data, size_t len, uint32_t seed, MXS_HASH128* hash)
+{
+    static const uint64_t C1 = 0x87c37b91114253d5ULL;
+    static const uint64_t C2 = 0x4cf5ad432745937fULL;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t nblocks = len / 16;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    for (size_t i = 0; i < nblocks; ++i)
+    {
+        uint64_t k1;
+        uint64_t k2;
+
+        // memcpy, because the data need not be aligned.
+        memcpy(&k1, bytes + i * 16, sizeof(k1));
+        memcpy(&k2, bytes + i * 16 + 8, sizeof(k2));
+
+        k1 *= C1;
+        k1 = hash128_rotl(k1, 31);
+        k1 *= C2;
+        h1 ^= k1;
+
+        h1 = hash128_rotl(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= C2;
+        k2 = hash128_rotl(k2, 33);
+        k2 *= C1;
+        h2 ^= k2;
+
+        h2 = hash128_rotl(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = bytes + nblocks * 16;
+    size_t rest = len & 15;
+
+    if (rest > 8)
+    {
+        uint64_t k2 = hash128_tail(tail + 8, rest - 8);
+        k2 *= C2;
+        k2 = hash128_rotl(k2, 33);
+        k2 *= C1;
+        h2 ^= k2;
+    }
+
+    if (rest > 0)
+    {
+        uint64_t k1 = hash128_tail(tail, rest > 8 ? 8 : rest);
+        k1 *= C1;
+        k1 = hash128_rotl(k1, 31);
+        k1 *= C2;
+        h1 ^= k1;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = hash128_fmix(h1);
+    h2 = hash128_fmix(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    hash->lo = h1;
+    hash->hi = h2;
+}
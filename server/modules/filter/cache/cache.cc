@@ -16,12 +16,12 @@
 #include <new>
 #include <set>
 #include <string>
-#include <zlib.h>
 #include <maxscale/alloc.h>
 #include <maxscale/buffer.h>
 #include <maxscale/modutil.h>
 #include <maxscale/query_classifier.h>
 #include <maxscale/paths.h>
+#include <maxscale/utils.h>
 #include "storagefactory.hh"
 #include "storage.hh"
 
@@ -125,27 +125,31 @@ cache_result_t Cache::get_default_key(const char* zDefault_db,
 {
     ss_dassert(GWBUF_IS_CONTIGUOUS(pQuery));
 
-    char *pSql;
-    int length;
+    // The hash of the statement is calculated once per buffer, whoever needs it first.
+    const MODUTIL_DIGEST* pDigest = modutil_get_digest(const_cast<GWBUF*>(pQuery));
 
-    modutil_extract_SQL(const_cast<GWBUF*>(pQuery), &pSql, &length);
-
-    uint64_t crc1 = crc32(0, Z_NULL, 0);
+    if (!pDigest)
+    {
+        return CACHE_RESULT_ERROR;
+    }
 
-    const Bytef* pData;
+    MXS_HASH128 hash = pDigest->hash;
 
     if (zDefault_db)
     {
-        pData = reinterpret_cast<const Bytef*>(zDefault_db);
-        crc1 = crc32(crc1, pData, strlen(zDefault_db));
-    }
+        // The database is hashed with a different seed, so that a database
+        // and a statement with swapped contents do not give the same key.
+        const uint32_t DEFAULT_DB_SEED = 0x9e3779b9;
+        MXS_HASH128 db_hash;
 
-    pData = reinterpret_cast<const Bytef*>(pSql);
+        mxs_hash128(zDefault_db, strlen(zDefault_db), DEFAULT_DB_SEED, &db_hash);
 
-    crc1 = crc32(crc1, pData, length);
-    uint64_t crc2 = crc32(crc1, pData, length);
+        hash.lo ^= db_hash.lo;
+        hash.hi ^= db_hash.hi;
+    }
 
-    pKey->data = (crc1 << 32 | crc2);
+    pKey->data[0] = hash.lo;
+    pKey->data[1] = hash.hi;
 
     return CACHE_RESULT_OK;
 }
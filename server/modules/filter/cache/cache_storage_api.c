@@ -17,9 +17,10 @@
 size_t cache_key_hash(const CACHE_KEY* key)
 {
     ss_dassert(key);
-    ss_dassert(sizeof(key->data) == sizeof(size_t));
+    ss_dassert(sizeof(key->data[0]) == sizeof(size_t));
 
-    return key->data;
+    // The key is a hash already, so one half of it is as good as any.
+    return key->data[0];
 }
 
 bool cache_key_equal_to(const CACHE_KEY* lhs, const CACHE_KEY* rhs)
@@ -27,7 +28,7 @@ bool cache_key_equal_to(const CACHE_KEY* lhs, const CACHE_KEY* rhs)
     ss_dassert(lhs);
     ss_dassert(rhs);
 
-    return lhs->data == rhs->data;
+    return lhs->data[0] == rhs->data[0] && lhs->data[1] == rhs->data[1];
 }
 
 
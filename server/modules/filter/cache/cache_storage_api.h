@@ -62,7 +62,7 @@ typedef void* CACHE_STORAGE;
 
 typedef struct cache_key
 {
-    uint64_t data;
+    uint64_t data[2]; /*< 128-bit hash of the default database and the statement */
 } CACHE_KEY;
 
 /**
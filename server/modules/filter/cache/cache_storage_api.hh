@@ -51,7 +51,7 @@ std::string cache_key_to_string(const CACHE_KEY& key);
 
 inline bool operator == (const CACHE_KEY& lhs, const CACHE_KEY& rhs)
 {
-    return lhs.data == rhs.data;
+    return lhs.data[0] == rhs.data[0] && lhs.data[1] == rhs.data[1];
 }
 
 inline bool operator != (const CACHE_KEY& lhs, const CACHE_KEY& rhs)
@@ -64,7 +64,8 @@ class CacheKey : public CACHE_KEY
 public:
     CacheKey()
     {
-        data = 0;
+        data[0] = 0;
+        data[1] = 0;
     }
 };
 
@@ -186,7 +186,7 @@ CacheFilterSession::CacheFilterSession(MXS_SESSION* pSession, Cache* pCache, cha
     , m_refreshing(false)
     , m_is_read_only(true)
 {
-    m_key.data = 0;
+    memset(&m_key, 0, sizeof(m_key));
 
     reset_response_state();
 }
@@ -178,7 +178,8 @@ int TesterStorage::run(size_t n_threads,
 
         CacheKey key;
 
-        key.data = i;
+        key.data[0] = i;
+        key.data[1] = 0;
 
         vector<uint8_t> value(size, static_cast<uint8_t>(i));
 
@@ -118,6 +118,48 @@ int test(StorageFactory& factory, istream& in)
     return rv;
 }
 
+int test_default_db()
+{
+    int rv = EXIT_SUCCESS;
+
+    GWBUF* pQuery = Tester::gwbuf_from_string("SELECT a FROM t1");
+    ss_dassert(pQuery);
+
+    if (pQuery)
+    {
+        // The same statement in different default databases must get different keys.
+        const char* zDbs[] = { NULL, "", "db1", "db2" };
+        const size_t n_dbs = sizeof(zDbs) / sizeof(zDbs[0]);
+        CACHE_KEY keys[n_dbs];
+
+        for (size_t i = 0; i < n_dbs; ++i)
+        {
+            if (Cache::get_default_key(zDbs[i], pQuery, &keys[i]) != CACHE_RESULT_OK)
+            {
+                cerr << "error: Could not generate a key." << endl;
+                rv = EXIT_FAILURE;
+            }
+
+            for (size_t j = 0; j < i; ++j)
+            {
+                if (keys[i] == keys[j])
+                {
+                    cerr << "error: Same key generated for different default databases." << endl;
+                    rv = EXIT_FAILURE;
+                }
+            }
+        }
+
+        gwbuf_free(pQuery);
+    }
+    else
+    {
+        rv = EXIT_FAILURE;
+    }
+
+    return rv;
+}
+
 }
 
 int main(int argc, char* argv[])
@@ -136,7 +178,11 @@ int main(int argc, char* argv[])
 
                 if (pFactory)
                 {
-                    if (argc == 2)
+                    if (test_default_db() == EXIT_FAILURE)
+                    {
+                        rv = EXIT_FAILURE;
+                    }
+                    else if (argc == 2)
                     {
                         rv = test(*pFactory, cin);
                     }
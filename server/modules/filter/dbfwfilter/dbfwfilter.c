@@ -2323,6 +2323,144 @@ static bool command_is_mandatory(const GWBUF *buffer)
     }
 }
 
+/**
+ * Check if the rules of a user allow a query
+ *
+ * @param my_instance Fwfilter instance
+ * @param my_session Fwfilter session
+ * @param queue The GWBUF containing the query, it must contain only one statement
+ * @param user The user whose rulebook is checked
+ * @return True if the query is allowed
+ */
+static bool query_is_allowed(FW_INSTANCE* my_instance, FW_SESSION* my_session,
+                             GWBUF* queue, DBFW_USER* user)
+{
+    DCB *dcb = my_session->session->client_dcb;
+    GWBUF* analyzed_queue = queue;
+
+    // QUERY_TYPE_PREPARE_STMT need not be handled separately as the
+    // information about statements in COM_STMT_PREPARE packets is
+    // accessed exactly like the information of COM_QUERY packets. However,
+    // with named prepared statements in COM_QUERY packets, we need to take
+    // out the preparable statement and base our decisions on that.
+
+    if ((modutil_is_SQL(queue) || modutil_is_SQL_prepare(queue)) &&
+        qc_query_is_type(qc_get_type_mask(queue), QUERY_TYPE_PREPARE_NAMED_STMT))
+    {
+        analyzed_queue = qc_get_preparable_stmt(queue);
+        ss_dassert(analyzed_queue);
+    }
+
+    bool query_ok = false;
+    bool match = false;
+    char* rname = NULL;
+
+    if (check_match_any(my_instance, my_session, analyzed_queue, user, &rname) ||
+        check_match_all(my_instance, my_session, analyzed_queue, user, false, &rname) ||
+        check_match_all(my_instance, my_session, analyzed_queue, user, true, &rname))
+    {
+        match = true;
+    }
+
+    switch (my_instance->action)
+    {
+    case FW_ACTION_ALLOW:
+        if (match)
+        {
+            query_ok = true;
+        }
+        break;
+
+    case FW_ACTION_BLOCK:
+        if (!match)
+        {
+            query_ok = true;
+        }
+        break;
+
+    case FW_ACTION_IGNORE:
+        query_ok = true;
+        break;
+
+    default:
+        MXS_ERROR("Unknown dbfwfilter action: %d", my_instance->action);
+        ss_dassert(false);
+        break;
+    }
+
+    if (my_instance->log_match != FW_LOG_NONE)
+    {
+        char *sql;
+        int len;
+        if (modutil_extract_SQL(analyzed_queue, &sql, &len))
+        {
+            len = MXS_MIN(len, FW_MAX_SQL_LEN);
+            if (match && my_instance->log_match & FW_LOG_MATCH)
+            {
+                ss_dassert(rname);
+                MXS_NOTICE("[%s] Rule '%s' for '%s' matched by %s@%s: %.*s",
+                           dcb->service->name, rname, user->name,
+                           dcb->user, dcb->remote, len, sql);
+            }
+            else if (!match && my_instance->log_match & FW_LOG_NO_MATCH)
+            {
+                MXS_NOTICE("[%s] Query for '%s' by %s@%s was not matched: %.*s",
+                           dcb->service->name, user->name, dcb->user,
+                           dcb->remote, len, sql);
+            }
+        }
+    }
+
+    MXS_FREE(rname);
+
+    return query_ok;
+}
+
+/**
+ * Check if the rules of a user allow all statements of a multi-statement query
+ *
+ * The statements are checked one at a time and the query is allowed only if
+ * all of them are.
+ *
+ * @param my_instance Fwfilter instance
+ * @param my_session Fwfilter session
+ * @param queue The GWBUF containing the multi-statement COM_QUERY
+ * @param user The user whose rulebook is checked
+ * @return True if all statements are allowed
+ */
+static bool multi_stmt_is_allowed(FW_INSTANCE* my_instance, FW_SESSION* my_session,
+                                  GWBUF* queue, DBFW_USER* user)
+{
+    bool query_ok = true;
+    char* sql;
+    int len;
+
+    if (modutil_extract_SQL(queue, &sql, &len))
+    {
+        const char* end = sql + len;
+        const char* stmt = sql;
+
+        while (query_ok && (stmt = modutil_get_next_statement(stmt, end, &len)))
+        {
+            GWBUF* part = modutil_create_query_len(stmt, len);
+
+            if (part)
+            {
+                query_ok = query_is_allowed(my_instance, my_session, part, user);
+                gwbuf_free(part);
+            }
+            else
+            {
+                query_ok = false;
+            }
+
+            stmt += len;
+        }
+    }
+
+    return query_ok;
+}
+
 /**
  * The routeQuery entry point. This is passed the query buffer
  * to which the filter should be applied. Once processed the
@@ -2352,124 +2490,46 @@ routeQuery(MXS_FILTER *instance, MXS_FILTER_SESSION *session, GWBUF *queue)
         thr_rule_version = rule_version;
     }
 
-    uint32_t type = 0;
+    DBFW_USER *user = find_user_data(thr_users, dcb->user, dcb->remote);
+    bool query_ok = command_is_mandatory(queue);
 
-    if (modutil_is_SQL(queue) || modutil_is_SQL_prepare(queue))
-    {
-        type = qc_get_type_mask(queue);
-    }
-
-    if (modutil_is_SQL(queue) && modutil_count_statements(queue) > 1)
-    {
-        GWBUF* err = gen_dummy_error(my_session, "This filter does not support "
-                                     "multi-statements.");
-        gwbuf_free(queue);
-        MXS_FREE(my_session->errmsg);
-        my_session->errmsg = NULL;
-        rval = dcb->func.write(dcb, err);
-    }
-    else
+    if (user)
     {
-        GWBUF* analyzed_queue = queue;
-
-        // QUERY_TYPE_PREPARE_STMT need not be handled separately as the
-        // information about statements in COM_STMT_PREPARE packets is
-        // accessed exactly like the information of COM_QUERY packets. However,
-        // with named prepared statements in COM_QUERY packets, we need to take
-        // out the preparable statement and base our decisions on that.
+        bool allowed;
 
-        if (qc_query_is_type(type, QUERY_TYPE_PREPARE_NAMED_STMT))
+        if (modutil_is_SQL(queue) && modutil_count_statements(queue) > 1)
         {
-            analyzed_queue = qc_get_preparable_stmt(queue);
-            ss_dassert(analyzed_queue);
+            allowed = multi_stmt_is_allowed(my_instance, my_session, queue, user);
         }
-
-        DBFW_USER *user = find_user_data(thr_users, dcb->user, dcb->remote);
-        bool query_ok = command_is_mandatory(queue);
-
-        if (user)
+        else
         {
-            bool match = false;
-            char* rname = NULL;
-
-            if (check_match_any(my_instance, my_session, analyzed_queue, user, &rname) ||
-                check_match_all(my_instance, my_session, analyzed_queue, user, false, &rname) ||
-                check_match_all(my_instance, my_session, analyzed_queue, user, true, &rname))
-            {
-                match = true;
-            }
-
-            switch (my_instance->action)
-            {
-            case FW_ACTION_ALLOW:
-                if (match)
-                {
-                    query_ok = true;
-                }
-                break;
-
-            case FW_ACTION_BLOCK:
-                if (!match)
-                {
-                    query_ok = true;
-                }
-                break;
-
-            case FW_ACTION_IGNORE:
-                query_ok = true;
-                break;
-
-            default:
-                MXS_ERROR("Unknown dbfwfilter action: %d", my_instance->action);
-                ss_dassert(false);
-                break;
-            }
-
-            if (my_instance->log_match != FW_LOG_NONE)
-            {
-                char *sql;
-                int len;
-                if (modutil_extract_SQL(analyzed_queue, &sql, &len))
-                {
-                    len = MXS_MIN(len, FW_MAX_SQL_LEN);
-                    if (match && my_instance->log_match & FW_LOG_MATCH)
-                    {
-                        ss_dassert(rname);
-                        MXS_NOTICE("[%s] Rule '%s' for '%s' matched by %s@%s: %.*s",
-                                   dcb->service->name, rname, user->name,
-                                   dcb->user, dcb->remote, len, sql);
-                    }
-                    else if (!match && my_instance->log_match & FW_LOG_NO_MATCH)
-                    {
-                        MXS_NOTICE("[%s] Query for '%s' by %s@%s was not matched: %.*s",
-                                   dcb->service->name, user->name, dcb->user,
-                                   dcb->remote, len, sql);
-                    }
-                }
-            }
-
-            MXS_FREE(rname);
+            allowed = query_is_allowed(my_instance, my_session, queue, user);
         }
-        /** If the instance is in whitelist mode, only users that have a rule
-         * defined for them are allowed */
-        else if (my_instance->action != FW_ACTION_ALLOW)
+
+        if (allowed)
         {
             query_ok = true;
         }
+    }
+    /** If the instance is in whitelist mode, only users that have a rule
+     * defined for them are allowed */
+    else if (my_instance->action != FW_ACTION_ALLOW)
+    {
+        query_ok = true;
+    }
 
-        if (query_ok)
-        {
-            rval = my_session->down.routeQuery(my_session->down.instance,
-                                               my_session->down.session, queue);
-        }
-        else
-        {
-            GWBUF* forward = gen_dummy_error(my_session, my_session->errmsg);
-            gwbuf_free(queue);
-            MXS_FREE(my_session->errmsg);
-            my_session->errmsg = NULL;
-            rval = dcb->func.write(dcb, forward);
-        }
+    if (query_ok)
+    {
+        rval = my_session->down.routeQuery(my_session->down.instance,
+                                           my_session->down.session, queue);
+    }
+    else
+    {
+        GWBUF* forward = gen_dummy_error(my_session, my_session->errmsg);
+        gwbuf_free(queue);
+        MXS_FREE(my_session->errmsg);
+        my_session->errmsg = NULL;
+        rval = dcb->func.write(dcb, forward);
     }
 
     return rval;
@@ -699,7 +699,8 @@ gw_read_and_write(DCB *dcb)
     uint64_t capabilities = service_get_capabilities(session->service);
     MySQLProtocol *proto = (MySQLProtocol *)dcb->protocol;
 
-    if (rcap_type_required(capabilities, RCAP_TYPE_STMT_OUTPUT) || proto->ignore_reply)
+    if (rcap_type_required(capabilities, RCAP_TYPE_STMT_OUTPUT) || proto->ignore_reply ||
+        proto->session_track)
     {
         GWBUF *tmp = modutil_get_complete_packets(&read_buffer);
         /* Put any residue into the read queue */
@@ -867,6 +868,14 @@ gw_read_and_write(DCB *dcb)
             read_buffer = NULL;
         }
 
+        if (proto->session_track && (stmt = mysql_track_reply(proto, stmt)) == NULL)
+        {
+            /** Failed to rewrite the session state changes */
+            gwbuf_free(read_buffer);
+            poll_fake_hangup_event(dcb);
+            return 0;
+        }
+
         if (session_ok_to_route(dcb))
         {
             gwbuf_set_type(stmt, GWBUF_TYPE_MYSQL);
@@ -970,6 +979,7 @@ static int gw_MySQLWrite_backend(DCB *dcb, GWBUF *queue)
         ss_dassert(dcb->persistentstart == 0);
         dcb->was_persistent = false;
         backend_protocol->ignore_reply = false;
+        mysql_track_reset(backend_protocol);
 
         if (dcb->state != DCB_STATE_POLLING ||
             backend_protocol->protocol_auth_state != MXS_AUTH_STATE_COMPLETE)
@@ -1114,6 +1124,11 @@ static int gw_MySQLWrite_backend(DCB *dcb, GWBUF *queue)
             }
             else
             {
+                if (backend_protocol->session_track)
+                {
+                    mysql_track_command(backend_protocol, queue);
+                }
+
                 /** Write to backend */
                 rc = dcb_write(dcb, queue);
             }
@@ -1447,6 +1462,13 @@ static int backend_write_delayqueue(DCB *dcb, GWBUF *buffer)
     }
     else
     {
+        MySQLProtocol *proto = (MySQLProtocol*)dcb->protocol;
+
+        if (proto->session_track)
+        {
+            mysql_track_command(proto, buffer);
+        }
+
         rc = dcb_write(dcb, buffer);
     }
 
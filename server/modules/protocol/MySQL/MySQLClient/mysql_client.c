@@ -79,6 +79,9 @@ static char *gw_default_auth();
 static int gw_connection_limit(DCB *dcb, int limit);
 static int MySQLSendHandshake(DCB* dcb);
 static int route_by_statement(MXS_SESSION *, uint64_t, GWBUF **);
+
+/** How many packets route_by_statement indexes at a time */
+#define ROUTE_BY_STATEMENT_BATCH 64
 static void mysql_client_auth_error_handling(DCB *dcb, int auth_val, int packet_number);
 static int gw_read_do_authentication(DCB *dcb, GWBUF *read_buffer, int nbytes_read);
 static int gw_read_normal_data(DCB *dcb, GWBUF *read_buffer, int nbytes_read);
@@ -420,6 +423,13 @@ int MySQLSendHandshake(DCB* dcb)
  */
 int gw_MySQLWrite_client(DCB *dcb, GWBUF *queue)
 {
+    MySQLProtocol* proto = (MySQLProtocol*)dcb->protocol;
+
+    if (proto && proto->pending_ps_infos)
+    {
+        mysql_ps_registry_reply(proto, queue);
+    }
+
     return dcb_write(dcb, queue);
 }
 
@@ -1392,6 +1402,7 @@ gw_client_close(DCB *dcb)
     }
 #endif
     MXS_DEBUG("%lu [gw_client_close]", pthread_self());
+    mysql_ps_registry_free((MySQLProtocol*)dcb->protocol);
     mysql_protocol_done(dcb);
     session = dcb->session;
     /**
@@ -1473,6 +1484,9 @@ static int route_by_statement(MXS_SESSION* session, uint64_t capabilities, GWBUF
 {
     int rc;
     GWBUF* packetbuf;
+    MODUTIL_PACKET packets[ROUTE_BY_STATEMENT_BATCH];
+    size_t n_packets = 0;
+    size_t i = 0;
 #if defined(SS_DEBUG)
     GWBUF* tmpbuf;
 
@@ -1487,15 +1501,41 @@ static int route_by_statement(MXS_SESSION* session, uint64_t capabilities, GWBUF
     {
         ss_dassert(GWBUF_IS_TYPE_MYSQL((*p_readbuf)));
 
-        /**
-         * Collect incoming bytes to a buffer until complete packet has
-         * arrived and then return the buffer.
-         */
-        // TODO: This should be replaced with modutil_get_next_MySQL_packet.
-        packetbuf = gw_MySQL_get_next_packet(p_readbuf);
+        if (i == n_packets)
+        {
+            /** Find the boundaries of the next batch of packets in one pass */
+            n_packets = modutil_index_packets(*p_readbuf, packets, ROUTE_BY_STATEMENT_BATCH, NULL);
+            i = 0;
+        }
+
+        if (i < n_packets)
+        {
+            /**
+             * A packet that was read alone is routed without copying it, the
+             * packets of a pipelined read are copied into buffers of their own.
+             */
+            packetbuf = mysql_take_packet(p_readbuf, packets[i].len);
+
+            if (packetbuf == NULL)
+            {
+                // TODO: A memory allocation failure. We should close the dcb
+                // TODO: and terminate the session.
+                rc = 0;
+                goto return_rc;
+            }
+        }
+        else
+        {
+            packetbuf = NULL;
+        }
 
         if (packetbuf != NULL)
         {
+            mysql_server_cmd_t cmd = packets[i].len > MYSQL_HEADER_LEN ?
+                                     (mysql_server_cmd_t)packets[i].cmd :
+                                     MYSQL_COM_UNDEFINED;
+            ++i;
+
             CHK_GWBUF(packetbuf);
             ss_dassert(GWBUF_IS_TYPE_MYSQL(packetbuf));
             /**
@@ -1514,35 +1554,20 @@ static int route_by_statement(MXS_SESSION* session, uint64_t capabilities, GWBUF
 
             if (rcap_type_required(capabilities, RCAP_TYPE_CONTIGUOUS_INPUT))
             {
-                if (!GWBUF_IS_CONTIGUOUS(packetbuf))
-                {
-                    // TODO: As long as gw_MySQL_get_next_packet is used above, the buffer
-                    // TODO: will be contiguous. That function should be replaced with
-                    // TODO: modutil_get_next_MySQL_packet.
-                    GWBUF* tmp = gwbuf_make_contiguous(packetbuf);
-                    if (tmp)
-                    {
-                        packetbuf = tmp;
-                    }
-                    else
-                    {
-                        // TODO: A memory allocation failure. We should close the dcb
-                        // TODO: and terminate the session.
-                        rc = 0;
-                        goto return_rc;
-                    }
-                }
+                /**
+                 * Prepared statements are classified once, when they are prepared,
+                 * and the classification is attached to each execution of them.
+                 */
+                mysql_ps_registry_command((MySQLProtocol*)session->client_dcb->protocol, packetbuf);
 
                 if (rcap_type_required(capabilities, RCAP_TYPE_TRANSACTION_TRACKING))
                 {
-                    uint8_t *data = GWBUF_DATA(packetbuf);
-
                     if (session_trx_is_ending(session))
                     {
                         session_set_trx_state(session, SESSION_TRX_INACTIVE);
                     }
 
-                    if (MYSQL_GET_COMMAND(data) == MYSQL_COM_QUERY)
+                    if (cmd == MYSQL_COM_QUERY)
                     {
                         uint32_t type = qc_get_trx_type_mask(packetbuf);
 
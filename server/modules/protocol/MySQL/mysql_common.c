@@ -45,9 +45,11 @@
 #include <maxscale/utils.h>
 #include <maxscale/protocol/mysql.h>
 #include <maxscale/alloc.h>
+#include <maxscale/atomic.h>
 #include <maxscale/log_manager.h>
 #include <netinet/tcp.h>
 #include <maxscale/modutil.h>
+#include <maxscale/mysql_utils.h>
 
 uint8_t null_client_sha1[MYSQL_SCRAMBLE_LEN] = "";
 
@@ -146,6 +148,7 @@ void mysql_protocol_done(DCB* dcb)
         }
 
         gwbuf_free(p->stored_query);
+        MXS_FREE(p->track_cmds);
 
         p->protocol_state = MYSQL_PROTOCOL_DONE;
     }
@@ -564,6 +567,10 @@ GWBUF* gw_MySQL_get_next_packet(GWBUF** p_readbuf)
     }
 
     packetbuf = gwbuf_alloc(packetlen);
+    if (packetbuf == NULL)
+    {
+        goto return_packetbuf;
+    }
     target = GWBUF_DATA(packetbuf);
     packetbuf->gwbuf_type = readbuf->gwbuf_type; /*< Copy the type too */
     /**
@@ -589,6 +596,40 @@ return_packetbuf:
     return packetbuf;
 }
 
+/**
+ * Take the first packet off a read buffer
+ *
+ * A packet that is the only data in its block is split off without copying.
+ * All other packets are copied into buffers of their own. The parsing
+ * information and the other buffer objects are stored in the shared block,
+ * so a packet that shares it with other packets would see their
+ * classification, and it would keep the whole block alive for as long as
+ * the packet is kept.
+ *
+ * @param p_readbuf Address of read buffer pointer
+ * @param packetlen Length of the first packet, which must be complete
+ *
+ * @return The packet in contiguous memory, NULL if memory allocation failed
+ */
+GWBUF* mysql_take_packet(GWBUF** p_readbuf, size_t packetlen)
+{
+    GWBUF* readbuf = *p_readbuf;
+    GWBUF* packetbuf;
+
+    if (readbuf->next == NULL && GWBUF_LENGTH(readbuf) == packetlen &&
+        readbuf->start == readbuf->sbuf->data && readbuf->sbuf->refcount == 1)
+    {
+        packetbuf = readbuf;
+        *p_readbuf = NULL;
+    }
+    else
+    {
+        packetbuf = gw_MySQL_get_next_packet(p_readbuf);
+    }
+
+    return packetbuf;
+}
+
 /**
  * Move <npackets> from buffer pointed to by <*p_readbuf>.
  * Appears to be unused 11 May 2016 (Martin)
@@ -1303,6 +1344,15 @@ create_capabilities(MySQLProtocol *conn, bool db_specified, bool compress)
 
     final_capabilities |= (int)GW_MYSQL_CAPABILITIES_PLUGIN_AUTH;
 
+    if ((conn->server_capabilities & GW_MYSQL_CAPABILITIES_SESSION_TRACK) &&
+        conn->owner_dcb->session &&
+        rcap_type_required(service_get_capabilities(conn->owner_dcb->session->service),
+                           RCAP_TYPE_SESSION_STATE_TRACKING))
+    {
+        /** The router wants to see the session state changes in OK packets */
+        final_capabilities |= (uint32_t)GW_MYSQL_CAPABILITIES_SESSION_TRACK;
+    }
+
     return final_capabilities;
 }
 
@@ -1337,6 +1387,9 @@ mxs_auth_state_t gw_send_backend_auth(DCB *dcb)
     uint32_t capabilities = create_capabilities(conn, (local_session.db && strlen(local_session.db)), false);
     gw_mysql_set_byte4(client_capabilities, capabilities);
 
+    /** The client never negotiates it so the replies must be rewritten */
+    conn->session_track = capabilities & GW_MYSQL_CAPABILITIES_SESSION_TRACK;
+
     /**
      * Use the default authentication plugin name. If the server is using a
      * different authentication mechanism, it will send an AuthSwitchRequest
@@ -1497,6 +1550,8 @@ gw_decode_mysql_server_handshake(MySQLProtocol *conn, uint8_t *payload)
     // get capabilities part 2 (2 bytes)
     memcpy(&capab_ptr[2], &mysql_server_capabilities_two, 2);
 
+    conn->server_capabilities = gw_mysql_get_byte4(capab_ptr);
+
     // 2 bytes shift
     payload += 2;
 
@@ -1597,3 +1652,593 @@ bool mxs_mysql_is_result_set(GWBUF *buffer)
 
     return rval;
 }
+
+/**
+ * Release a reference to the classification of a prepared statement.
+ *
+ * @param data  The MYSQL_PS_INFO to release.
+ */
+static void ps_info_release(void* data)
+{
+    MYSQL_PS_INFO* info = (MYSQL_PS_INFO*)data;
+
+    if (atomic_add(&info->refcount, -1) == 1)
+    {
+        MXS_FREE(info);
+    }
+}
+
+/**
+ * Find the position of a prepared statement in the registry.
+ *
+ * @param proto  The client protocol.
+ * @param id     The statement id.
+ *
+ * @return The index of the statement, or of the position where it
+ *         should be inserted if it is not in the registry.
+ */
+static size_t ps_registry_lower_bound(const MySQLProtocol* proto, uint32_t id)
+{
+    size_t low = 0;
+    size_t high = proto->n_ps_infos;
+
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+
+        if (proto->ps_infos[mid]->id < id)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * Find the statement a COM_STMT_EXECUTE, COM_STMT_SEND_LONG_DATA or
+ * COM_STMT_CLOSE refers to.
+ *
+ * @param proto   The client protocol.
+ * @param packet  A contiguous packet.
+ * @param index   On return, the index of the statement in the registry.
+ *
+ * @return The statement or NULL if it is not in the registry.
+ */
+static MYSQL_PS_INFO* ps_registry_find(const MySQLProtocol* proto, GWBUF* packet, size_t* index)
+{
+    MYSQL_PS_INFO* rval = NULL;
+
+    if (GWBUF_LENGTH(packet) >= MYSQL_HEADER_LEN + 1 + 4)
+    {
+        uint32_t id = gw_mysql_get_byte4(GWBUF_DATA(packet) + MYSQL_HEADER_LEN + 1);
+        size_t i = ps_registry_lower_bound(proto, id);
+
+        if (i < proto->n_ps_infos && proto->ps_infos[i]->id == id)
+        {
+            rval = proto->ps_infos[i];
+            *index = i;
+        }
+    }
+
+    return rval;
+}
+
+/**
+ * Add a prepared statement whose id is known to the registry. The server
+ * assigns ids in increasing order, so the statement is appended.
+ *
+ * @param proto  The client protocol.
+ * @param info   The classification of the statement. The registry takes
+ *               over the reference of the caller.
+ */
+static void ps_registry_add(MySQLProtocol* proto, MYSQL_PS_INFO* info)
+{
+    if (proto->n_ps_infos == proto->ps_infos_capacity)
+    {
+        size_t capacity = proto->ps_infos_capacity ? 2 * proto->ps_infos_capacity : 8;
+        MYSQL_PS_INFO** ps_infos =
+            (MYSQL_PS_INFO**)MXS_REALLOC(proto->ps_infos, capacity * sizeof(MYSQL_PS_INFO*));
+
+        if (!ps_infos)
+        {
+            ps_info_release(info);
+            return;
+        }
+
+        proto->ps_infos = ps_infos;
+        proto->ps_infos_capacity = capacity;
+    }
+
+    proto->ps_infos[proto->n_ps_infos++] = info;
+}
+
+/**
+ * Drop the statements that are waiting for their ids.
+ *
+ * @param proto  The client protocol.
+ */
+static void ps_registry_drop_pending(MySQLProtocol* proto)
+{
+    while (proto->pending_ps_infos)
+    {
+        MYSQL_PS_INFO* info = proto->pending_ps_infos;
+        proto->pending_ps_infos = info->next;
+        ps_info_release(info);
+    }
+}
+
+/**
+ * Classify a COM_STMT_PREPARE and queue the classification until the
+ * server has assigned an id to the statement. The parsing information
+ * stays in the buffer, so the router does not need to parse it again.
+ *
+ * @param proto   The client protocol.
+ * @param packet  A contiguous COM_STMT_PREPARE packet.
+ */
+static void ps_registry_prepare(MySQLProtocol* proto, GWBUF* packet)
+{
+    MYSQL_PS_INFO* info = (MYSQL_PS_INFO*)MXS_MALLOC(sizeof(MYSQL_PS_INFO));
+
+    if (info)
+    {
+        info->id = 0;
+        /** The classifier marks the statement as being prepared, which is not
+         * true for the executions of it */
+        info->type_mask = qc_get_type_mask(packet) & ~QUERY_TYPE_PREPARE_STMT;
+        info->operation = qc_get_operation(packet);
+        info->long_data = false;
+        info->refcount = 1;
+        info->next = NULL;
+
+        MYSQL_PS_INFO** pp = &proto->pending_ps_infos;
+
+        while (*pp)
+        {
+            pp = &(*pp)->next;
+        }
+
+        *pp = info;
+    }
+}
+
+void mysql_ps_registry_command(MySQLProtocol* proto, GWBUF* packet)
+{
+    uint8_t header[MYSQL_HEADER_LEN + 1];
+    MYSQL_PS_INFO* info;
+    size_t i;
+
+    /**
+     * Only the first packet of a command has the sequence number 0. This
+     * skips the data of LOAD DATA LOCAL INFILE and the rest of large packets.
+     */
+    if (gwbuf_copy_data(packet, 0, sizeof(header), header) != sizeof(header) ||
+        MYSQL_GET_PACKET_NO(header) != 0)
+    {
+        return;
+    }
+
+    switch (MYSQL_GET_COMMAND(header))
+    {
+    case MYSQL_COM_STMT_PREPARE:
+        ps_registry_prepare(proto, packet);
+        break;
+
+    case MYSQL_COM_STMT_EXECUTE:
+        ps_registry_drop_pending(proto);
+
+        if ((info = ps_registry_find(proto, packet, &i)))
+        {
+            atomic_add(&info->refcount, 1);
+            gwbuf_add_buffer_object(packet, GWBUF_PS_INFO, info, ps_info_release);
+        }
+        break;
+
+    case MYSQL_COM_STMT_SEND_LONG_DATA:
+        /** The data is only sent to the master */
+        if ((info = ps_registry_find(proto, packet, &i)))
+        {
+            info->long_data = true;
+        }
+        break;
+
+    case MYSQL_COM_STMT_CLOSE:
+        if ((info = ps_registry_find(proto, packet, &i)))
+        {
+            ps_info_release(info);
+            memmove(&proto->ps_infos[i], &proto->ps_infos[i + 1],
+                    (proto->n_ps_infos - i - 1) * sizeof(MYSQL_PS_INFO*));
+            --proto->n_ps_infos;
+        }
+        break;
+
+    case MYSQL_COM_CHANGE_USER:
+        /** The server closes the statements of the session */
+        mysql_ps_registry_free(proto);
+        proto->last_ps_id = 0;
+        break;
+
+    case MYSQL_COM_QUIT:
+        break;
+
+    default:
+        ps_registry_drop_pending(proto);
+        break;
+    }
+}
+
+void mysql_ps_registry_reply(MySQLProtocol* proto, GWBUF* reply)
+{
+    /** COM_STMT_PREPARE_OK: status, id, columns, params, filler and warnings */
+    uint8_t header[MYSQL_PS_OK_PACKET_LEN];
+    size_t offset = 0;
+    size_t len;
+
+    while (proto->pending_ps_infos &&
+           (len = gwbuf_copy_data(reply, offset, sizeof(header), header)) > MYSQL_HEADER_LEN)
+    {
+        /**
+         * The response to a COM_STMT_PREPARE starts with a packet whose
+         * sequence number is 1. It is followed by the parameter and column
+         * definitions. The server assigns ids in increasing order.
+         */
+        if (MYSQL_GET_PACKET_NO(header) == 1)
+        {
+            uint8_t status = header[MYSQL_HEADER_LEN];
+            uint32_t id = len == sizeof(header) ? gw_mysql_get_byte4(header + MYSQL_HEADER_LEN + 1) : 0;
+
+            if (status == MYSQL_REPLY_OK && len == sizeof(header) &&
+                MYSQL_GET_PAYLOAD_LEN(header) == MYSQL_PS_OK_PACKET_LEN - MYSQL_HEADER_LEN &&
+                header[MYSQL_HEADER_LEN + 9] == 0 && id > proto->last_ps_id)
+            {
+                MYSQL_PS_INFO* info = proto->pending_ps_infos;
+                proto->pending_ps_infos = info->next;
+                info->next = NULL;
+                info->id = id;
+                proto->last_ps_id = id;
+                ps_registry_add(proto, info);
+            }
+            else if (status == MYSQL_REPLY_ERR)
+            {
+                MYSQL_PS_INFO* info = proto->pending_ps_infos;
+                proto->pending_ps_infos = info->next;
+                ps_info_release(info);
+            }
+        }
+
+        offset += MYSQL_GET_PAYLOAD_LEN(header) + MYSQL_HEADER_LEN;
+    }
+}
+
+void mysql_ps_registry_free(MySQLProtocol* proto)
+{
+    for (size_t i = 0; i < proto->n_ps_infos; ++i)
+    {
+        ps_info_release(proto->ps_infos[i]);
+    }
+
+    MXS_FREE(proto->ps_infos);
+    proto->ps_infos = NULL;
+    proto->n_ps_infos = 0;
+    proto->ps_infos_capacity = 0;
+
+    ps_registry_drop_pending(proto);
+}
+
+/**
+ * Get the status flags of an OK packet.
+ *
+ * @param packet A complete OK packet.
+ *
+ * @return The status flags or 0 if the packet is too short.
+ */
+static uint16_t track_ok_status(const uint8_t* packet)
+{
+    const uint8_t* end = packet + MYSQL_HEADER_LEN + MYSQL_GET_PAYLOAD_LEN(packet);
+    const uint8_t* ptr = packet + MYSQL_HEADER_LEN + 1;
+
+    /** Affected rows and last insert id */
+    for (int i = 0; i < 2 && ptr < end; i++)
+    {
+        ptr += mxs_leint_bytes(ptr);
+    }
+
+    return end - ptr >= 2 ? gw_mysql_get_byte2(ptr) : 0;
+}
+
+/**
+ * Get the status flags of an EOF packet.
+ *
+ * @param packet A complete EOF packet.
+ *
+ * @return The status flags or 0 if the packet has none.
+ */
+static uint16_t track_eof_status(const uint8_t* packet)
+{
+    return MYSQL_GET_PAYLOAD_LEN(packet) >= 5 ? gw_mysql_get_byte2(packet + MYSQL_HEADER_LEN + 3) : 0;
+}
+
+/**
+ * The reply to the oldest command is complete.
+ *
+ * @param proto The backend protocol.
+ */
+static void track_pop(MySQLProtocol* proto)
+{
+    memmove(proto->track_cmds, proto->track_cmds + 1, --proto->n_track_cmds);
+    proto->track_state = MYSQL_TRACK_START;
+}
+
+/**
+ * Follow the reply to the oldest command by one packet.
+ *
+ * @param proto  The backend protocol.
+ * @param packet A complete packet that does not continue a large one.
+ *
+ * @return True if the packet is an OK packet that ends a command or a result
+ *         of it, i.e. one that can carry session state changes.
+ */
+static bool track_reply_packet(MySQLProtocol* proto, const uint8_t* packet)
+{
+    if (proto->n_track_cmds == 0)
+    {
+        return false;
+    }
+
+    uint8_t cmd = proto->track_cmds[0];
+    uint8_t type = packet[MYSQL_HEADER_LEN];
+    uint32_t payload_len = MYSQL_GET_PAYLOAD_LEN(packet);
+    /** A row can start with 0xfe but it is then longer than an EOF packet */
+    bool is_eof = type == MYSQL_REPLY_EOF && payload_len + MYSQL_HEADER_LEN <= MYSQL_EOF_PACKET_LEN;
+    bool rval = false;
+
+    switch (proto->track_state)
+    {
+    case MYSQL_TRACK_START:
+        switch (cmd)
+        {
+        case MYSQL_COM_QUERY:
+        case MYSQL_COM_STMT_EXECUTE:
+        case MYSQL_COM_PROCESS_INFO:
+            if (type == MYSQL_REPLY_OK)
+            {
+                rval = true;
+
+                if ((track_ok_status(packet) & SERVER_MORE_RESULTS_EXIST) == 0)
+                {
+                    track_pop(proto);
+                }
+            }
+            else if (type == MYSQL_REPLY_ERR)
+            {
+                track_pop(proto);
+            }
+            else if (type != MYSQL_REPLY_LOCAL_INFILE)
+            {
+                /** After LOAD DATA LOCAL INFILE the reply to the file is an
+                 * OK or an ERR packet, otherwise this is a column count */
+                proto->track_state = MYSQL_TRACK_COLUMNS;
+            }
+            break;
+
+        case MYSQL_COM_STMT_PREPARE:
+            /** COM_STMT_PREPARE_OK: status, id, columns, params, filler and
+             * warnings followed by the parameter and column definitions */
+            if (type == MYSQL_REPLY_OK && payload_len >= 9)
+            {
+                uint16_t columns = gw_mysql_get_byte2(packet + MYSQL_HEADER_LEN + 5);
+                uint16_t params = gw_mysql_get_byte2(packet + MYSQL_HEADER_LEN + 7);
+                proto->track_skip = (columns ? columns + 1 : 0) + (params ? params + 1 : 0);
+            }
+            else
+            {
+                proto->track_skip = 0;
+            }
+
+            if (proto->track_skip)
+            {
+                proto->track_state = MYSQL_TRACK_SKIP;
+            }
+            else
+            {
+                track_pop(proto);
+            }
+            break;
+
+        case MYSQL_COM_FIELD_LIST:
+        case MYSQL_COM_STMT_FETCH:
+            if (type == MYSQL_REPLY_ERR || is_eof)
+            {
+                track_pop(proto);
+            }
+            else
+            {
+                proto->track_state = MYSQL_TRACK_ROWS;
+            }
+            break;
+
+        case MYSQL_COM_CHANGE_USER:
+            /** Authentication switch requests come before the result */
+            if (type == MYSQL_REPLY_OK || type == MYSQL_REPLY_ERR)
+            {
+                rval = type == MYSQL_REPLY_OK;
+                track_pop(proto);
+            }
+            break;
+
+        case MYSQL_COM_STATISTICS:
+            /** The reply is a plain string */
+            track_pop(proto);
+            break;
+
+        case MYSQL_COM_BINLOG_DUMP:
+        case MYSQL_COM_TABLE_DUMP:
+            /** The replication stream does not end */
+            proto->track_state = MYSQL_TRACK_DISABLED;
+            break;
+
+        default:
+            rval = type == MYSQL_REPLY_OK;
+            track_pop(proto);
+            break;
+        }
+        break;
+
+    case MYSQL_TRACK_COLUMNS:
+        if (is_eof)
+        {
+            /** A cursor was opened and the rows are read with COM_STMT_FETCH */
+            if (cmd == MYSQL_COM_STMT_EXECUTE &&
+                (track_eof_status(packet) & SERVER_STATUS_CURSOR_EXISTS))
+            {
+                track_pop(proto);
+            }
+            else
+            {
+                proto->track_state = MYSQL_TRACK_ROWS;
+            }
+        }
+        break;
+
+    case MYSQL_TRACK_ROWS:
+        if (is_eof && (track_eof_status(packet) & SERVER_MORE_RESULTS_EXIST))
+        {
+            proto->track_state = MYSQL_TRACK_START;
+        }
+        else if (is_eof || type == MYSQL_REPLY_ERR)
+        {
+            track_pop(proto);
+        }
+        break;
+
+    case MYSQL_TRACK_SKIP:
+        if (--proto->track_skip == 0)
+        {
+            track_pop(proto);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return rval;
+}
+
+void mysql_track_command(MySQLProtocol* proto, GWBUF* buffer)
+{
+    uint8_t header[MYSQL_HEADER_LEN + 1];
+    size_t offset = 0;
+
+    while (proto->track_state != MYSQL_TRACK_DISABLED &&
+           gwbuf_copy_data(buffer, offset, sizeof(header), header) == sizeof(header))
+    {
+        /**
+         * Only the first packet of a command has the sequence number 0. This
+         * skips the data of LOAD DATA LOCAL INFILE and the rest of large packets.
+         */
+        if (MYSQL_GET_PACKET_NO(header) == 0)
+        {
+            switch (MYSQL_GET_COMMAND(header))
+            {
+            case MYSQL_COM_QUIT:
+            case MYSQL_COM_STMT_SEND_LONG_DATA:
+            case MYSQL_COM_STMT_CLOSE:
+                /** No reply */
+                break;
+
+            default:
+                if (proto->n_track_cmds == proto->track_cmds_capacity)
+                {
+                    size_t capacity = proto->track_cmds_capacity ? 2 * proto->track_cmds_capacity : 8;
+                    uint8_t* cmds = (uint8_t*)MXS_REALLOC(proto->track_cmds, capacity);
+
+                    if (!cmds)
+                    {
+                        MXS_ERROR("Failed to record a command, session state changes "
+                                  "are no longer removed from the replies.");
+                        proto->track_state = MYSQL_TRACK_DISABLED;
+                        return;
+                    }
+
+                    proto->track_cmds = cmds;
+                    proto->track_cmds_capacity = capacity;
+                }
+
+                proto->track_cmds[proto->n_track_cmds++] = MYSQL_GET_COMMAND(header);
+                break;
+            }
+        }
+
+        offset += MYSQL_GET_PAYLOAD_LEN(header) + MYSQL_HEADER_LEN;
+    }
+}
+
+GWBUF* mysql_track_reply(MySQLProtocol* proto, GWBUF* reply)
+{
+    if (proto->track_state == MYSQL_TRACK_DISABLED)
+    {
+        return reply;
+    }
+
+    GWBUF* contiguous = gwbuf_make_contiguous(reply);
+
+    if (contiguous == NULL)
+    {
+        gwbuf_free(reply);
+        return NULL;
+    }
+
+    reply = contiguous;
+    uint8_t* ptr = GWBUF_DATA(reply);
+    uint8_t* end = ptr + GWBUF_LENGTH(reply);
+    uint8_t* dest = ptr;
+
+    while (end - ptr >= MYSQL_HEADER_LEN)
+    {
+        size_t len = MYSQL_GET_PAYLOAD_LEN(ptr) + MYSQL_HEADER_LEN;
+        size_t new_len = len;
+        bool continued = proto->track_continued;
+        proto->track_continued = len - MYSQL_HEADER_LEN == GW_MYSQL_MAX_PACKET_LEN;
+
+        ss_dassert(len <= (size_t)(end - ptr));
+
+        if (!continued && len > MYSQL_HEADER_LEN &&
+            track_reply_packet(proto, ptr))
+        {
+            modutil_add_tracked_variables(reply, ptr);
+            new_len = modutil_strip_session_track(ptr);
+        }
+
+        if (dest != ptr)
+        {
+            memmove(dest, ptr, new_len);
+        }
+
+        dest += new_len;
+        ptr += len;
+    }
+
+    if (dest != end)
+    {
+        reply = gwbuf_rtrim(reply, end - dest);
+    }
+
+    return reply;
+}
+
+void mysql_track_reset(MySQLProtocol* proto)
+{
+    proto->n_track_cmds = 0;
+    proto->track_skip = 0;
+    proto->track_continued = false;
+
+    if (proto->track_state != MYSQL_TRACK_DISABLED)
+    {
+        proto->track_state = MYSQL_TRACK_START;
+    }
+}
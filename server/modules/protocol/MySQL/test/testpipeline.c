@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test that pipelined statements that arrive in one read are classified
+ * each on its own
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/modutil.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+#include <maxscale/query_classifier.h>
+
+static GWBUF* create_query(const char* sql)
+{
+    GWBUF* buffer = modutil_create_query((char*)sql);
+    ss_dassert(buffer);
+    buffer->gwbuf_type = GWBUF_TYPE_MYSQL;
+
+    return buffer;
+}
+
+/**
+ * Two statements that are read at the same time share one block
+ */
+static void test_pipelined()
+{
+    GWBUF* first = create_query("SELECT a FROM t1");
+    GWBUF* second = create_query("UPDATE t1 SET a = 1");
+    size_t first_len = gwbuf_length(first);
+    size_t second_len = gwbuf_length(second);
+    GWBUF* readbuf = gwbuf_make_contiguous(gwbuf_append(first, second));
+    ss_dassert(readbuf);
+
+    first = mysql_take_packet(&readbuf, first_len);
+    ss_dassert(first && readbuf);
+    second = mysql_take_packet(&readbuf, second_len);
+    ss_dassert(second && readbuf == NULL);
+
+    ss_info_dassert(gwbuf_length(first) == first_len && GWBUF_IS_CONTIGUOUS(first) &&
+                    gwbuf_length(second) == second_len && GWBUF_IS_CONTIGUOUS(second),
+                    "The packets should be taken whole");
+    ss_info_dassert(first->sbuf != second->sbuf, "Pipelined packets should not share a block");
+    ss_info_dassert(GWBUF_IS_TYPE_MYSQL(first) && GWBUF_IS_TYPE_MYSQL(second),
+                    "The type should be kept");
+
+    ss_info_dassert(qc_get_type_mask(first) == QUERY_TYPE_READ, "The first statement is a read");
+    ss_info_dassert(qc_get_operation(first) == QUERY_OP_SELECT, "The first statement is a SELECT");
+    ss_info_dassert(qc_query_is_type(qc_get_type_mask(second), QUERY_TYPE_WRITE),
+                    "The second statement is a write");
+    ss_info_dassert(qc_get_operation(second) == QUERY_OP_UPDATE, "The second statement is an UPDATE");
+
+    gwbuf_free(first);
+    gwbuf_free(second);
+}
+
+/**
+ * A statement that is read alone is not copied and one that spans several
+ * reads is made contiguous
+ */
+static void test_single()
+{
+    GWBUF* readbuf = create_query("SELECT a FROM t1");
+    GWBUF* orig = readbuf;
+    size_t len = gwbuf_length(readbuf);
+
+    GWBUF* packet = mysql_take_packet(&readbuf, len);
+    ss_info_dassert(packet == orig && readbuf == NULL, "A packet read alone should not be copied");
+    gwbuf_free(packet);
+
+    GWBUF* query = create_query("UPDATE t1 SET a = 1");
+    len = gwbuf_length(query);
+    readbuf = gwbuf_split(&query, 5);
+    readbuf = gwbuf_append(readbuf, query);
+    ss_dassert(!GWBUF_IS_CONTIGUOUS(readbuf));
+
+    packet = mysql_take_packet(&readbuf, len);
+    ss_info_dassert(packet && readbuf == NULL && GWBUF_IS_CONTIGUOUS(packet) &&
+                    gwbuf_length(packet) == len, "A split packet should be made contiguous");
+    ss_info_dassert(qc_get_operation(packet) == QUERY_OP_UPDATE, "The statement is an UPDATE");
+    gwbuf_free(packet);
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        config_get_global_options()->n_threads = 1;
+
+        set_libdir(MXS_STRDUP_A("../../../../../query_classifier/qc_sqlite/"));
+
+        if (qc_setup("qc_sqlite", "") && qc_process_init(QC_INIT_BOTH))
+        {
+            test_pipelined();
+            test_single();
+            rc = EXIT_SUCCESS;
+
+            qc_process_end(QC_INIT_BOTH);
+        }
+        else
+        {
+            MXS_ERROR("Could not initialize query classifier.");
+        }
+
+        mxs_log_finish();
+    }
+
+    return rc;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the prepared statement registry of the MySQL client protocol
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+
+/**
+ * Create a MySQL packet.
+ *
+ * @param seq      The sequence number
+ * @param payload  The payload
+ * @param len      Length of the payload
+ *
+ * @return The packet
+ */
+static GWBUF* create_packet(uint8_t seq, const uint8_t* payload, size_t len)
+{
+    GWBUF* buffer = gwbuf_alloc(MYSQL_HEADER_LEN + len);
+    ss_dassert(buffer);
+    uint8_t* data = GWBUF_DATA(buffer);
+
+    gw_mysql_set_byte3(data, len);
+    data[3] = seq;
+    memcpy(data + MYSQL_HEADER_LEN, payload, len);
+
+    return buffer;
+}
+
+static GWBUF* create_prepare(const char* sql)
+{
+    size_t len = strlen(sql);
+    uint8_t payload[len + 1];
+
+    payload[0] = MYSQL_COM_STMT_PREPARE;
+    memcpy(payload + 1, sql, len);
+
+    return create_packet(0, payload, sizeof(payload));
+}
+
+static GWBUF* create_stmt_command(uint8_t seq, uint8_t cmd, uint32_t id)
+{
+    uint8_t payload[] = {cmd, 0, 0, 0, 0};
+    gw_mysql_set_byte4(payload + 1, id);
+
+    return create_packet(seq, payload, sizeof(payload));
+}
+
+static GWBUF* create_prepare_ok(uint32_t id, uint16_t columns)
+{
+    uint8_t payload[MYSQL_PS_OK_PACKET_LEN - MYSQL_HEADER_LEN] = {MYSQL_REPLY_OK};
+    gw_mysql_set_byte4(payload + 1, id);
+    gw_mysql_set_byte2(payload + 5, columns);
+
+    GWBUF* buffer = create_packet(1, payload, sizeof(payload));
+
+    /** The column definitions and the EOF packet */
+    for (uint16_t i = 0; i < columns; i++)
+    {
+        uint8_t coldef[] = {3, 'd', 'e', 'f', 0, 0, 0, 1, 'a', 1, 'a', 0x0c};
+        buffer = gwbuf_append(buffer, create_packet(2 + i, coldef, sizeof(coldef)));
+    }
+
+    if (columns)
+    {
+        uint8_t eof[] = {MYSQL_REPLY_EOF, 0, 0, 2, 0};
+        buffer = gwbuf_append(buffer, create_packet(2 + columns, eof, sizeof(eof)));
+    }
+
+    return gwbuf_make_contiguous(buffer);
+}
+
+static GWBUF* create_err(uint8_t seq)
+{
+    uint8_t payload[] = {MYSQL_REPLY_ERR, 0x28, 0x04, '#', '4', '2', '0', '0', '0', 'e'};
+    return create_packet(seq, payload, sizeof(payload));
+}
+
+static GWBUF* create_query(const char* sql)
+{
+    size_t len = strlen(sql);
+    uint8_t payload[len + 1];
+
+    payload[0] = MYSQL_COM_QUERY;
+    memcpy(payload + 1, sql, len);
+
+    return create_packet(0, payload, sizeof(payload));
+}
+
+/** Send a command through the registry and return the statement it executes */
+static const MYSQL_PS_INFO* execute(MySQLProtocol* proto, uint32_t id)
+{
+    static GWBUF* buffer = NULL;
+
+    gwbuf_free(buffer);
+    buffer = create_stmt_command(0, MYSQL_COM_STMT_EXECUTE, id);
+    mysql_ps_registry_command(proto, buffer);
+
+    return mysql_get_ps_info(buffer);
+}
+
+static void command(MySQLProtocol* proto, GWBUF* buffer)
+{
+    mysql_ps_registry_command(proto, buffer);
+    gwbuf_free(buffer);
+}
+
+static void reply(MySQLProtocol* proto, GWBUF* buffer)
+{
+    mysql_ps_registry_reply(proto, buffer);
+    gwbuf_free(buffer);
+}
+
+/**
+ * The classification of a prepared statement is attached to its executions
+ */
+static void test_execute()
+{
+    MySQLProtocol proto;
+    memset(&proto, 0, sizeof(proto));
+
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    ss_dassert(proto.pending_ps_infos);
+    ss_dassert(execute(&proto, 1) == NULL);
+
+    /** The execute dropped the statement that was still waiting for its id */
+    ss_dassert(proto.pending_ps_infos == NULL);
+    reply(&proto, create_prepare_ok(1, 1));
+    ss_dassert(execute(&proto, 1) == NULL);
+
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    reply(&proto, create_prepare_ok(2, 1));
+    ss_dassert(proto.pending_ps_infos == NULL);
+
+    const MYSQL_PS_INFO* info = execute(&proto, 2);
+    ss_dassert(info);
+    ss_info_dassert(info->type_mask == QUERY_TYPE_READ,
+                    "The executions of a statement are not prepares");
+    ss_dassert(info->operation == QUERY_OP_SELECT);
+    ss_dassert(execute(&proto, 3) == NULL);
+
+    command(&proto, create_prepare("INSERT INTO t1 VALUES (?)"));
+    reply(&proto, create_prepare_ok(3, 0));
+    info = execute(&proto, 3);
+    ss_dassert(info);
+    ss_dassert(qc_query_is_type(info->type_mask, QUERY_TYPE_WRITE));
+
+    /** Long data is tracked and closing removes the statement */
+    ss_dassert(!execute(&proto, 2)->long_data);
+    command(&proto, create_stmt_command(0, MYSQL_COM_STMT_SEND_LONG_DATA, 2));
+    ss_dassert(execute(&proto, 2)->long_data);
+    command(&proto, create_stmt_command(0, MYSQL_COM_STMT_CLOSE, 2));
+    ss_dassert(execute(&proto, 2) == NULL);
+    ss_dassert(execute(&proto, 3));
+
+    execute(&proto, 0);
+    mysql_ps_registry_free(&proto);
+    ss_dassert(proto.n_ps_infos == 0);
+}
+
+/**
+ * Only the first packet of a response to a COM_STMT_PREPARE assigns an id
+ */
+static void test_reply()
+{
+    MySQLProtocol proto;
+    memset(&proto, 0, sizeof(proto));
+
+    /** An error drops the statement */
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    reply(&proto, create_err(1));
+    ss_dassert(proto.pending_ps_infos == NULL);
+
+    /** Two prepares whose responses are in one buffer */
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    command(&proto, create_prepare("SELECT b FROM t1"));
+    GWBUF* buffer = gwbuf_append(create_prepare_ok(1, 2), create_prepare_ok(2, 1));
+    reply(&proto, gwbuf_make_contiguous(buffer));
+    ss_dassert(proto.pending_ps_infos == NULL);
+    ss_dassert(execute(&proto, 1) && execute(&proto, 2));
+
+    /** A packet that is not the first one of a response is ignored */
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    GWBUF* ok = create_prepare_ok(3, 0);
+    GWBUF_DATA(ok)[3] = 2;
+    reply(&proto, ok);
+    ss_dassert(proto.pending_ps_infos);
+
+    /** The server never reuses ids */
+    reply(&proto, create_prepare_ok(2, 0));
+    ss_dassert(proto.pending_ps_infos);
+    reply(&proto, create_prepare_ok(3, 0));
+    ss_dassert(proto.pending_ps_infos == NULL);
+    ss_dassert(execute(&proto, 3));
+
+    /** The response of any other command can't be told apart */
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    command(&proto, create_query("SELECT 1"));
+    ss_dassert(proto.pending_ps_infos == NULL);
+    reply(&proto, create_prepare_ok(4, 0));
+    ss_dassert(execute(&proto, 4) == NULL);
+
+    /** Packets that continue an earlier command don't prepare anything */
+    GWBUF* data = create_prepare("SELECT a FROM t1");
+    GWBUF_DATA(data)[3] = 2;
+    command(&proto, data);
+    ss_dassert(proto.pending_ps_infos == NULL);
+
+    /** COM_CHANGE_USER closes the statements */
+    uint8_t change_user[] = {MYSQL_COM_CHANGE_USER, 'u', 0, 0};
+    command(&proto, create_packet(0, change_user, sizeof(change_user)));
+    ss_dassert(execute(&proto, 3) == NULL);
+    command(&proto, create_prepare("SELECT a FROM t1"));
+    reply(&proto, create_prepare_ok(1, 0));
+    ss_dassert(execute(&proto, 1));
+
+    execute(&proto, 0);
+    mysql_ps_registry_free(&proto);
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        config_get_global_options()->n_threads = 1;
+
+        set_libdir(MXS_STRDUP_A("../../../../../query_classifier/qc_sqlite/"));
+
+        if (qc_setup("qc_sqlite", "") && qc_process_init(QC_INIT_BOTH))
+        {
+            test_execute();
+            test_reply();
+            rc = EXIT_SUCCESS;
+
+            qc_process_end(QC_INIT_BOTH);
+        }
+        else
+        {
+            MXS_ERROR("Could not initialize query classifier.");
+        }
+
+        mxs_log_finish();
+    }
+
+    return rc;
+}
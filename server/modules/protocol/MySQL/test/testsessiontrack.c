@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the removal of session state changes from the replies of a backend
+ * that negotiated CLIENT_SESSION_TRACK
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/protocol/mysql.h>
+
+/** An OK packet with the info "abc" and a new value for last_gtid */
+static const uint8_t ok_tracked[] =
+{
+    0x00, 0x01, 0x00, 0x02, 0x40, 0x00, 0x00, 0x03, 'a', 'b', 'c',
+    0x13, 0x00, 0x11, 0x09, 'l', 'a', 's', 't', '_', 'g', 't', 'i', 'd',
+    0x06, '0', '-', '1', '-', '2', '2'
+};
+
+/** The same OK packet in the format of a client without CLIENT_SESSION_TRACK */
+static const uint8_t ok_plain[] = {0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 'a', 'b', 'c'};
+
+static const uint8_t coldef[] = {3, 'd', 'e', 'f', 0, 0, 0, 1, 'a', 1, 'a', 0x0c};
+static const uint8_t eof[] = {MYSQL_REPLY_EOF, 0, 0, 2, 0};
+static const uint8_t eof_more[] = {MYSQL_REPLY_EOF, 0, 0, 0x0a, 0};
+
+/**
+ * Create a MySQL packet.
+ *
+ * @param seq      The sequence number
+ * @param payload  The payload
+ * @param len      Length of the payload
+ *
+ * @return The packet
+ */
+static GWBUF* create_packet(uint8_t seq, const uint8_t* payload, size_t len)
+{
+    GWBUF* buffer = gwbuf_alloc(MYSQL_HEADER_LEN + len);
+    ss_dassert(buffer);
+    uint8_t* data = GWBUF_DATA(buffer);
+
+    gw_mysql_set_byte3(data, len);
+    data[3] = seq;
+    memcpy(data + MYSQL_HEADER_LEN, payload, len);
+
+    return buffer;
+}
+
+static void command(MySQLProtocol* proto, uint8_t cmd)
+{
+    uint8_t payload[] = {cmd, 'x'};
+    GWBUF* buffer = create_packet(0, payload, sizeof(payload));
+    mysql_track_command(proto, buffer);
+    gwbuf_free(buffer);
+}
+
+/** Append a packet to a reply */
+static GWBUF* add(GWBUF* reply, uint8_t seq, const uint8_t* payload, size_t len)
+{
+    return gwbuf_append(reply, create_packet(seq, payload, len));
+}
+
+/** Check that a packet of the reply has the given payload */
+static bool packet_is(GWBUF* reply, size_t offset, const uint8_t* payload, size_t len)
+{
+    uint8_t header[MYSQL_HEADER_LEN];
+    uint8_t data[len];
+
+    return gwbuf_copy_data(reply, offset, sizeof(header), header) == sizeof(header) &&
+           MYSQL_GET_PAYLOAD_LEN(header) == len &&
+           gwbuf_copy_data(reply, offset + MYSQL_HEADER_LEN, len, data) == len &&
+           memcmp(data, payload, len) == 0;
+}
+
+/**
+ * An OK packet that ends a command is rewritten, one in a result set is not
+ */
+static void test_result_set()
+{
+    MySQLProtocol proto;
+    memset(&proto, 0, sizeof(proto));
+
+    /** A row that looks like an OK packet is followed by a real one */
+    command(&proto, MYSQL_COM_QUERY);
+    command(&proto, MYSQL_COM_QUERY);
+    uint8_t colcount[] = {1};
+    GWBUF* reply = create_packet(1, colcount, sizeof(colcount));
+    reply = add(reply, 2, coldef, sizeof(coldef));
+    reply = add(reply, 3, eof, sizeof(eof));
+    reply = add(reply, 4, ok_tracked, sizeof(ok_tracked));
+    reply = add(reply, 5, eof, sizeof(eof));
+    reply = add(reply, 1, ok_tracked, sizeof(ok_tracked));
+
+    size_t offset = gwbuf_length(reply) - MYSQL_HEADER_LEN - sizeof(ok_tracked);
+    reply = mysql_track_reply(&proto, reply);
+    ss_dassert(reply);
+
+    ss_info_dassert(packet_is(reply, offset - MYSQL_HEADER_LEN - sizeof(eof) -
+                              MYSQL_HEADER_LEN - sizeof(ok_tracked),
+                              ok_tracked, sizeof(ok_tracked)),
+                    "A row should not be modified");
+    ss_info_dassert(packet_is(reply, offset, ok_plain, sizeof(ok_plain)),
+                    "The OK packet should be in the format of the client");
+    ss_info_dassert(gwbuf_length(reply) == offset + MYSQL_HEADER_LEN + sizeof(ok_plain),
+                    "The reply should end with the OK packet");
+    char* gtid = gwbuf_get_property(reply, "last_gtid");
+    ss_info_dassert(gtid && strcmp(gtid, "0-1-22") == 0, "The GTID should be a property");
+    ss_info_dassert(proto.n_track_cmds == 0, "Both commands should be complete");
+    gwbuf_free(reply);
+
+    /** A multi-statement write ends with an OK packet after the result set */
+    command(&proto, MYSQL_COM_QUERY);
+    reply = create_packet(1, colcount, sizeof(colcount));
+    reply = add(reply, 2, coldef, sizeof(coldef));
+    reply = add(reply, 3, eof, sizeof(eof));
+    reply = add(reply, 4, eof_more, sizeof(eof_more));
+    offset = gwbuf_length(reply);
+    reply = add(reply, 5, ok_tracked, sizeof(ok_tracked));
+
+    reply = mysql_track_reply(&proto, reply);
+    ss_info_dassert(packet_is(reply, offset, ok_plain, sizeof(ok_plain)),
+                    "The OK packet after a result set should be rewritten");
+    ss_info_dassert(gwbuf_get_property(reply, "last_gtid"), "The GTID should be a property");
+    ss_dassert(proto.n_track_cmds == 0);
+    gwbuf_free(reply);
+
+    MXS_FREE(proto.track_cmds);
+}
+
+/**
+ * The replies can arrive in any number of reads
+ */
+static void test_split_reply()
+{
+    MySQLProtocol proto;
+    memset(&proto, 0, sizeof(proto));
+
+    command(&proto, MYSQL_COM_QUERY);
+    command(&proto, MYSQL_COM_QUERY);
+    uint8_t colcount[] = {1};
+    const uint8_t* payloads[] = {colcount, coldef, eof, ok_tracked, eof, ok_tracked};
+    size_t lengths[] = {sizeof(colcount), sizeof(coldef), sizeof(eof), sizeof(ok_tracked),
+                        sizeof(eof), sizeof(ok_tracked)
+                       };
+
+    for (int i = 0; i < 6; i++)
+    {
+        GWBUF* reply = mysql_track_reply(&proto, create_packet(i, payloads[i], lengths[i]));
+
+        if (i == 5)
+        {
+            ss_info_dassert(packet_is(reply, 0, ok_plain, sizeof(ok_plain)),
+                            "The OK packet should be rewritten");
+        }
+        else
+        {
+            ss_info_dassert(packet_is(reply, 0, payloads[i], lengths[i]),
+                            "Other packets should not be modified");
+        }
+
+        gwbuf_free(reply);
+    }
+
+    ss_dassert(proto.n_track_cmds == 0);
+    MXS_FREE(proto.track_cmds);
+}
+
+/**
+ * The reply to COM_STMT_PREPARE is not an OK packet
+ */
+static void test_prepare()
+{
+    MySQLProtocol proto;
+    memset(&proto, 0, sizeof(proto));
+
+    command(&proto, MYSQL_COM_STMT_PREPARE);
+    command(&proto, MYSQL_COM_STMT_CLOSE);
+    command(&proto, MYSQL_COM_QUERY);
+    ss_info_dassert(proto.n_track_cmds == 2, "COM_STMT_CLOSE has no reply");
+
+    /** A statement with one parameter that looks like an OK packet */
+    uint8_t prepare_ok[] = {MYSQL_REPLY_OK, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0};
+    GWBUF* reply = create_packet(1, prepare_ok, sizeof(prepare_ok));
+    reply = add(reply, 2, ok_tracked, sizeof(ok_tracked));
+    reply = add(reply, 3, eof, sizeof(eof));
+    size_t offset = gwbuf_length(reply);
+    reply = add(reply, 1, ok_tracked, sizeof(ok_tracked));
+
+    reply = mysql_track_reply(&proto, reply);
+    ss_info_dassert(packet_is(reply, 0, prepare_ok, sizeof(prepare_ok)),
+                    "The COM_STMT_PREPARE_OK should not be modified");
+    ss_info_dassert(packet_is(reply, MYSQL_HEADER_LEN + sizeof(prepare_ok),
+                              ok_tracked, sizeof(ok_tracked)),
+                    "A parameter definition should not be modified");
+    ss_info_dassert(packet_is(reply, offset, ok_plain, sizeof(ok_plain)),
+                    "The OK packet of the query should be rewritten");
+    ss_dassert(proto.n_track_cmds == 0);
+    gwbuf_free(reply);
+
+    /** An unsolicited packet is not modified */
+    reply = mysql_track_reply(&proto, create_packet(1, ok_tracked, sizeof(ok_tracked)));
+    ss_dassert(packet_is(reply, 0, ok_tracked, sizeof(ok_tracked)));
+    gwbuf_free(reply);
+
+    MXS_FREE(proto.track_cmds);
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        test_result_set();
+        test_split_reply();
+        test_prepare();
+        rc = EXIT_SUCCESS;
+
+        mxs_log_finish();
+    }
+
+    return rc;
+}
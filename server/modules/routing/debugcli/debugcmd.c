@@ -29,6 +29,7 @@
 #include <maxscale/cdefs.h>
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,6 +47,7 @@
 #include <maxscale/log_manager.h>
 #include <maxscale/maxscale.h>
 #include <maxscale/modulecmd.h>
+#include <maxscale/query_classifier.h>
 #include <maxscale/router.h>
 #include <maxscale/server.h>
 #include <maxscale/service.h>
@@ -96,6 +98,7 @@ struct subcommand
 
 static void telnetdShowUsers(DCB *);
 static void show_log_throttling(DCB *);
+static void show_qc_cache(DCB *);
 
 static void showVersion(DCB *dcb)
 {
@@ -115,6 +118,12 @@ struct subcommand showoptions[] =
         {0}
     },
 #endif
+    {
+        "bufferstats", 0, 0, dprintBufferStats,
+        "Show buffer allocation and pooling statistics",
+        "Usage: show bufferstats",
+        {0}
+    },
     {
         "dcbs", 0, 0, dprintAllDCBs,
         "Show all DCBs",
@@ -213,6 +222,12 @@ struct subcommand showoptions[] =
         "Example: show persistent db-server-1",
         {ARG_TYPE_SERVER}
     },
+    {
+        "qc_cache", 0, 0, show_qc_cache,
+        "Show the query classification cache statistics",
+        "Usage: show qc_cache",
+        {0}
+    },
     {
         "server", 1, 1, dprintServer,
         "Show server details",
@@ -2198,6 +2213,26 @@ show_log_throttling(DCB *dcb)
     dcb_printf(dcb, "%lu %lu %lu\n", t.count, t.window_ms, t.suppress_ms);
 }
 
+/**
+ * Print the statistics of the query classification cache
+ *
+ * @param dcb   The DCB to print to
+ */
+static void
+show_qc_cache(DCB *dcb)
+{
+    QC_CACHE_STATS stats;
+    qc_get_cache_stats(&stats);
+
+    dcb_printf(dcb, "Query Classification Cache\n");
+    dcb_printf(dcb, "Maximum size:     %" PRId64 "\n", stats.max_size);
+    dcb_printf(dcb, "Current size:     %" PRId64 "\n", stats.size);
+    dcb_printf(dcb, "Hits:             %" PRId64 "\n", stats.hits);
+    dcb_printf(dcb, "Misses:           %" PRId64 "\n", stats.misses);
+    dcb_printf(dcb, "Inserts:          %" PRId64 "\n", stats.inserts);
+    dcb_printf(dcb, "Evictions:        %" PRId64 "\n", stats.evictions);
+}
+
 /**
  * Command to shutdown a running monitor
  *
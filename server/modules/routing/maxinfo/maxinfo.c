@@ -689,6 +689,7 @@ static struct uri_table
     { "/variables", maxinfo_variables },
     { "/status", maxinfo_status },
     { "/event/times", eventTimesGetList },
+    { "/event/latencies", eventLatenciesGetList },
     { NULL, NULL }
 };
 
@@ -267,6 +267,26 @@ exec_show_eventTimes(DCB *dcb, MAXINFO_TREE *tree)
     resultset_free(set);
 }
 
+/**
+ * Fetch the event time percentiles
+ *
+ * @param dcb   DCB to which to stream result set
+ * @param tree  Potential like clause (currently unused)
+ */
+static void
+exec_show_eventLatencies(DCB *dcb, MAXINFO_TREE *tree)
+{
+    RESULTSET *set;
+
+    if ((set = eventLatenciesGetList()) == NULL)
+    {
+        return;
+    }
+
+    resultset_stream_mysql(set, dcb);
+    resultset_free(set);
+}
+
 /**
  * The table of show commands that are supported
  */
@@ -286,6 +306,7 @@ static struct
     { "modules", exec_show_modules },
     { "monitors", exec_show_monitors },
     { "eventTimes", exec_show_eventTimes },
+    { "eventLatencies", exec_show_eventLatencies },
     { NULL, NULL }
 };
 
@@ -13,7 +13,9 @@
 
 #include "readwritesplit.h"
 
+#include <ctype.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 #include <strings.h>
 #include <string.h>
@@ -105,6 +107,10 @@ static bool handle_error_new_connection(ROUTER_INSTANCE *inst,
 static bool have_enough_servers(ROUTER_CLIENT_SES *rses, const int min_nsrv,
                                 int router_nsrv, ROUTER_INSTANCE *router);
 static bool create_backends(ROUTER_CLIENT_SES *rses, backend_ref_t** dest, int* n_backend);
+static void update_gtid_pos(ROUTER_CLIENT_SES *rses, GWBUF *reply);
+static void update_response_time(backend_ref_t *bref);
+static void handle_gtid_wait_reply(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
+                                   backend_ref_t *bref, GWBUF *reply);
 
 /**
  * Enum values for router parameters
@@ -122,6 +128,7 @@ static const MXS_ENUM_VALUE slave_selection_criteria_values[] =
     {"LEAST_ROUTER_CONNECTIONS", LEAST_ROUTER_CONNECTIONS},
     {"LEAST_BEHIND_MASTER",      LEAST_BEHIND_MASTER},
     {"LEAST_CURRENT_OPERATIONS", LEAST_CURRENT_OPERATIONS},
+    {"ADAPTIVE_ROUTING",         ADAPTIVE_ROUTING},
     {NULL}
 };
 
@@ -194,9 +201,14 @@ MXS_MODULE *MXS_CREATE_MODULE()
             {"retry_failed_reads", MXS_MODULE_PARAM_BOOL, "true"},
             {"disable_sescmd_history", MXS_MODULE_PARAM_BOOL, "true"},
             {"max_sescmd_history", MXS_MODULE_PARAM_COUNT, "0"},
+            {"compact_sescmd_history", MXS_MODULE_PARAM_BOOL, "true"},
+            {"lazy_connect", MXS_MODULE_PARAM_BOOL, "false"},
             {"strict_multi_stmt",  MXS_MODULE_PARAM_BOOL, "true"},
             {"strict_sp_calls",  MXS_MODULE_PARAM_BOOL, "false"},
+            {"strict_sescmd_routing",  MXS_MODULE_PARAM_BOOL, "true"},
             {"master_accept_reads", MXS_MODULE_PARAM_BOOL, "false"},
+            {"causal_reads", MXS_MODULE_PARAM_BOOL, "false"},
+            {"causal_reads_timeout", MXS_MODULE_PARAM_COUNT, "10"},
             {MXS_END_MODULE_PARAMS}
         }
     };
@@ -277,9 +289,14 @@ static MXS_ROUTER *createInstance(SERVICE *service, char **options)
     router->rwsplit_config.retry_failed_reads = config_get_bool(params, "retry_failed_reads");
     router->rwsplit_config.strict_multi_stmt = config_get_bool(params, "strict_multi_stmt");
     router->rwsplit_config.strict_sp_calls = config_get_bool(params, "strict_sp_calls");
+    router->rwsplit_config.strict_sescmd_routing = config_get_bool(params, "strict_sescmd_routing");
     router->rwsplit_config.disable_sescmd_history = config_get_bool(params, "disable_sescmd_history");
     router->rwsplit_config.max_sescmd_history = config_get_integer(params, "max_sescmd_history");
+    router->rwsplit_config.compact_sescmd_history = config_get_bool(params, "compact_sescmd_history");
+    router->rwsplit_config.lazy_connect = config_get_bool(params, "lazy_connect");
     router->rwsplit_config.master_accept_reads = config_get_bool(params, "master_accept_reads");
+    router->rwsplit_config.causal_reads = config_get_bool(params, "causal_reads");
+    router->rwsplit_config.causal_reads_timeout = config_get_integer(params, "causal_reads_timeout");
 
     if (!handle_max_slaves(router, config_get_string(params, "max_slave_connections")) ||
         (options && !rwsplit_process_router_options(router, options)))
@@ -295,6 +312,15 @@ static MXS_ROUTER *createInstance(SERVICE *service, char **options)
         router->rwsplit_config.max_sescmd_history = 0;
     }
 
+    /** Lazily connected slaves need the history to restore the session state */
+    if (router->rwsplit_config.lazy_connect &&
+        router->rwsplit_config.disable_sescmd_history)
+    {
+        MXS_WARNING("Service '%s': lazy_connect requires disable_sescmd_history=false, "
+                    "slaves are connected when the session starts.", service->name);
+        router->rwsplit_config.lazy_connect = false;
+    }
+
     return (MXS_ROUTER *)router;
 }
 
@@ -495,11 +521,24 @@ static void freeSession(MXS_ROUTER *router_instance, MXS_ROUTER_SESSION *router_
         while (p != NULL)
         {
             q = p->rses_prop_next;
+
+            if (i == RSES_PROP_TYPE_SESCMD)
+            {
+                atomic_add_uint64(&router_cli_ses->router->stats.n_sescmd_history, -1);
+            }
+
             rses_property_done(p);
             p = q;
         }
     }
 
+    for (int i = 0; i < router_cli_ses->rses_nbackends; i++)
+    {
+        backend_ref_t *bref = &router_cli_ses->rses_backend_ref[i];
+        gwbuf_free(bref->bref_pending_cmd);
+        gwbuf_free(bref->bref_gtid_reply);
+    }
+
     MXS_FREE(router_cli_ses->rses_backend_ref);
     MXS_FREE(router_cli_ses);
     return;
@@ -537,6 +576,10 @@ void close_failed_bref(backend_ref_t *bref, bool fatal)
         gwbuf_free(bref->bref_pending_cmd);
         bref->bref_pending_cmd = NULL;
     }
+
+    bref_clear_state(bref, BREF_WAITING_GTID);
+    gwbuf_free(bref->bref_gtid_reply);
+    bref->bref_gtid_reply = NULL;
 }
 
 /**
@@ -610,12 +653,22 @@ static void diagnostics(MXS_ROUTER *instance, DCB *dcb)
                router->rwsplit_config.strict_multi_stmt ? "true" : "false");
     dcb_printf(dcb, "\tstrict_sp_calls:           %s\n",
                router->rwsplit_config.strict_sp_calls ? "true" : "false");
+    dcb_printf(dcb, "\tstrict_sescmd_routing:     %s\n",
+               router->rwsplit_config.strict_sescmd_routing ? "true" : "false");
     dcb_printf(dcb, "\tdisable_sescmd_history:    %s\n",
                router->rwsplit_config.disable_sescmd_history ? "true" : "false");
     dcb_printf(dcb, "\tmax_sescmd_history:        %d\n",
                router->rwsplit_config.max_sescmd_history);
+    dcb_printf(dcb, "\tcompact_sescmd_history:    %s\n",
+               router->rwsplit_config.compact_sescmd_history ? "true" : "false");
+    dcb_printf(dcb, "\tlazy_connect:              %s\n",
+               router->rwsplit_config.lazy_connect ? "true" : "false");
     dcb_printf(dcb, "\tmaster_accept_reads:       %s\n",
                router->rwsplit_config.master_accept_reads ? "true" : "false");
+    dcb_printf(dcb, "\tcausal_reads:              %s\n",
+               router->rwsplit_config.causal_reads ? "true" : "false");
+    dcb_printf(dcb, "\tcausal_reads_timeout:      %d\n",
+               router->rwsplit_config.causal_reads_timeout);
     dcb_printf(dcb, "\n");
 
     if (router->stats.n_queries > 0)
@@ -638,6 +691,36 @@ static void diagnostics(MXS_ROUTER *instance, DCB *dcb)
     dcb_printf(dcb, "\tNumber of queries forwarded to all:   	%" PRIu64 " (%.2f%%)\n",
                router->stats.n_all, all_pct);
 
+    if (router->rwsplit_config.causal_reads)
+    {
+        dcb_printf(dcb, "\tNumber of causal reads sent to master: 	%" PRIu64 "\n",
+                   router->stats.n_gtid_wait_timeouts);
+    }
+
+    if (!router->rwsplit_config.disable_sescmd_history)
+    {
+        dcb_printf(dcb, "\tSession commands in history:          	%" PRIu64 "\n",
+                   router->stats.n_sescmd_history);
+        dcb_printf(dcb, "\tSession commands removed by compaction:	%" PRIu64 "\n",
+                   router->stats.n_sescmd_compacted);
+    }
+
+    dcb_printf(dcb, "\tSlaves closed by session commands:    	%" PRIu64 "\n",
+               router->stats.n_sescmd_slaves_closed);
+
+    if (router->rwsplit_config.lazy_connect)
+    {
+        uint64_t deferred = router->stats.n_slaves_deferred;
+        uint64_t lazy = router->stats.n_lazy_connects;
+        uint64_t replies = router->stats.n_lazy_replies;
+
+        dcb_printf(dcb, "\tSlave connections avoided:            	%" PRIu64 "\n",
+                   deferred > lazy ? deferred - lazy : 0);
+        dcb_printf(dcb, "\tSlave connections opened by reads:    	%" PRIu64 "\n", lazy);
+        dcb_printf(dcb, "\tAverage lazy connect latency (us):    	%" PRIu64 "\n",
+                   replies ? router->stats.lazy_connect_time / replies : 0);
+    }
+
     if ((weightby = serviceGetWeightingParameter(router->service)) != NULL)
     {
         dcb_printf(dcb, "\tConnection distribution based on %s "
@@ -701,6 +784,18 @@ static void clientReply(MXS_ROUTER *instance,
     CHK_BACKEND_REF(bref);
     sescmd_cursor_t *scur = &bref->bref_sescmd_cur;
 
+    if (BREF_IS_WAITING_GTID(bref))
+    {
+        /** The client is not waiting for the reply to MASTER_GTID_WAIT */
+        handle_gtid_wait_reply(router_inst, router_cli_ses, bref, writebuf);
+        return;
+    }
+    else if (router_cli_ses->rses_config.causal_reads &&
+             bref == router_cli_ses->rses_master_ref)
+    {
+        update_gtid_pos(router_cli_ses, writebuf);
+    }
+
     /** Statement was successfully executed, free the stored statement */
     session_clear_stmt(backend_dcb->session);
 
@@ -750,6 +845,16 @@ static void clientReply(MXS_ROUTER *instance,
      */
     else if (BREF_IS_QUERY_ACTIVE(bref))
     {
+        if (bref->bref_connect_start)
+        {
+            /** The first reply of a lazily connected slave */
+            atomic_add_uint64(&router_inst->stats.lazy_connect_time,
+                              rwsplit_now() - bref->bref_connect_start);
+            atomic_add_uint64(&router_inst->stats.n_lazy_replies, 1);
+            bref->bref_connect_start = 0;
+        }
+
+        update_response_time(bref);
         bref_clear_state(bref, BREF_QUERY_ACTIVE);
         /** Set response status as replied */
         bref_clear_state(bref, BREF_WAITING_RESULT);
@@ -777,11 +882,27 @@ static void clientReply(MXS_ROUTER *instance,
                      bref->ref->server->name, bref->ref->server->port);
         }
     }
+    else if (bref->bref_pending_cmd != NULL &&
+             needs_causal_read(router_cli_ses, bref))
+    {
+        /** The stored query was routed while a session command was executing */
+        GWBUF *query = bref->bref_pending_cmd;
+        bref->bref_pending_cmd = NULL;
+
+        if (!route_causal_read(router_cli_ses, bref, query, false))
+        {
+            MXS_ERROR("Failed to route a stored query that waits for the GTID position %s.",
+                      router_cli_ses->gtid_pos);
+        }
+
+        gwbuf_free(query);
+    }
     else if (bref->bref_pending_cmd != NULL) /*< non-sescmd is waiting to be routed */
     {
         int ret;
 
         CHK_GWBUF(bref->bref_pending_cmd);
+        bref->bref_query_start = rwsplit_now();
 
         if ((ret = bref->bref_dcb->func.write(bref->bref_dcb,
                                               gwbuf_clone(bref->bref_pending_cmd))) == 1)
@@ -825,7 +946,16 @@ static void clientReply(MXS_ROUTER *instance,
  */
 static uint64_t getCapabilities(MXS_ROUTER* instance)
 {
-    return RCAP_TYPE_STMT_INPUT | RCAP_TYPE_TRANSACTION_TRACKING;
+    ROUTER_INSTANCE *router = (ROUTER_INSTANCE *)instance;
+    uint64_t rval = RCAP_TYPE_STMT_INPUT | RCAP_TYPE_TRANSACTION_TRACKING;
+
+    if (router->rwsplit_config.causal_reads)
+    {
+        /** The master reports the GTID of each write in the OK packet */
+        rval |= RCAP_TYPE_SESSION_STATE_TRACKING;
+    }
+
+    return rval;
 }
 
 /*
@@ -1159,14 +1289,15 @@ static bool rwsplit_process_router_options(ROUTER_INSTANCE *router,
                 c = GET_SELECT_CRITERIA(value);
                 ss_dassert(c == LEAST_GLOBAL_CONNECTIONS ||
                            c == LEAST_ROUTER_CONNECTIONS || c == LEAST_BEHIND_MASTER ||
-                           c == LEAST_CURRENT_OPERATIONS || c == UNDEFINED_CRITERIA);
+                           c == LEAST_CURRENT_OPERATIONS || c == ADAPTIVE_ROUTING ||
+                           c == UNDEFINED_CRITERIA);
 
                 if (c == UNDEFINED_CRITERIA)
                 {
                     MXS_ERROR("Unknown slave selection criteria \"%s\". "
                               "Allowed values are LEAST_GLOBAL_CONNECTIONS, "
-                              "LEAST_ROUTER_CONNECTIONS, LEAST_BEHIND_MASTER,"
-                              "and LEAST_CURRENT_OPERATIONS.",
+                              "LEAST_ROUTER_CONNECTIONS, LEAST_BEHIND_MASTER, "
+                              "LEAST_CURRENT_OPERATIONS and ADAPTIVE_ROUTING.",
                               STRCRITERIA(router->rwsplit_config.slave_selection_criteria));
                     success = false;
                 }
@@ -1183,6 +1314,14 @@ static bool rwsplit_process_router_options(ROUTER_INSTANCE *router,
             {
                 router->rwsplit_config.disable_sescmd_history = config_truth_value(value);
             }
+            else if (strcmp(options[i], "compact_sescmd_history") == 0)
+            {
+                router->rwsplit_config.compact_sescmd_history = config_truth_value(value);
+            }
+            else if (strcmp(options[i], "lazy_connect") == 0)
+            {
+                router->rwsplit_config.lazy_connect = config_truth_value(value);
+            }
             else if (strcmp(options[i], "master_accept_reads") == 0)
             {
                 router->rwsplit_config.master_accept_reads = config_truth_value(value);
@@ -1195,10 +1334,22 @@ static bool rwsplit_process_router_options(ROUTER_INSTANCE *router,
             {
                 router->rwsplit_config.strict_sp_calls = config_truth_value(value);
             }
+            else if (strcmp(options[i], "strict_sescmd_routing") == 0)
+            {
+                router->rwsplit_config.strict_sescmd_routing = config_truth_value(value);
+            }
             else if (strcmp(options[i], "retry_failed_reads") == 0)
             {
                 router->rwsplit_config.retry_failed_reads = config_truth_value(value);
             }
+            else if (strcmp(options[i], "causal_reads") == 0)
+            {
+                router->rwsplit_config.causal_reads = config_truth_value(value);
+            }
+            else if (strcmp(options[i], "causal_reads_timeout") == 0)
+            {
+                router->rwsplit_config.causal_reads_timeout = atoi(value);
+            }
             else if (strcmp(options[i], "master_failure_mode") == 0)
             {
                 if (strcasecmp(value, "fail_instantly") == 0)
@@ -1469,9 +1620,11 @@ static bool reroute_stored_statement(ROUTER_CLIENT_SES *rses, backend_ref_t *old
 
             if (BREF_IS_IN_USE(bref) && bref != old &&
                 !SERVER_IS_MASTER(bref->ref->server) &&
-                SERVER_IS_SLAVE(bref->ref->server))
+                SERVER_IS_SLAVE(bref->ref->server) &&
+                (!rses->rses_config.causal_reads || !rses->gtid_pos[0] || bref->bref_gtid_synced))
             {
-                /** Found a valid candidate; a non-master slave that's in use */
+                /** Found a valid candidate; a non-master slave that's in use and,
+                 * with causal_reads, has replicated the session's last write */
                 if (bref->bref_dcb->func.write(bref->bref_dcb, stored))
                 {
                     MXS_INFO("Retrying failed read at '%s'.", bref->ref->server->unique_name);
@@ -1581,9 +1734,11 @@ static bool handle_error_new_connection(ROUTER_INSTANCE *inst,
     max_slave_rlag = rses_get_max_replication_lag(myrses);
     /**
      * Try to get replacement slave or at least the minimum
-     * number of slave connections for router session.
+     * number of slave connections for router session. A new slave can only
+     * be used if the whole session command history is available, the session
+     * disables it when max_sescmd_history is exceeded.
      */
-    if (inst->rwsplit_config.disable_sescmd_history)
+    if (myrses->rses_config.disable_sescmd_history)
     {
         succp = have_enough_servers(myrses, 1, myrses->rses_nbackends, inst) ? true : false;
     }
@@ -1731,3 +1886,232 @@ static bool create_backends(ROUTER_CLIENT_SES *rses, backend_ref_t** dest, int*
     *dest = backend_ref;
     return true;
 }
+
+/**
+ * @brief Check that a GTID position can be used in a query
+ *
+ * @param gtid GTID position reported by the master
+ * @return True if the position only has domain-server-sequence triplets
+ */
+static bool is_valid_gtid_pos(const char *gtid)
+{
+    if (*gtid == '\0')
+    {
+        return false;
+    }
+
+    for (const char *c = gtid; *c; c++)
+    {
+        if (!isdigit((unsigned char)*c) && *c != '-' && *c != ',')
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Store the GTID of the last write done by the session
+ *
+ * The master reports the GTID of each committed write in the OK packet when
+ * last_gtid is in session_track_system_variables. The backend protocol adds
+ * the tracked variables of all OK packets in the reply as buffer properties,
+ * the last one of them is the current position. A new position means that
+ * none of the slaves are known to have caught up.
+ *
+ * @param rses  Router client session
+ * @param reply Reply from the master
+ */
+static void update_gtid_pos(ROUTER_CLIENT_SES *rses, GWBUF *reply)
+{
+    char *gtid = gwbuf_get_property(reply, "last_gtid");
+
+    if (gtid && strlen(gtid) < RWSPLIT_GTID_MAXLEN &&
+        is_valid_gtid_pos(gtid) && strcmp(gtid, rses->gtid_pos) != 0)
+    {
+        strcpy(rses->gtid_pos, gtid);
+
+        for (int i = 0; i < rses->rses_nbackends; i++)
+        {
+            rses->rses_backend_ref[i].bref_gtid_synced = false;
+        }
+    }
+}
+
+/**
+ * @brief Check whether a reply to MASTER_GTID_WAIT is complete
+ *
+ * @param reply Contiguous reply
+ * @return True if the whole result set or an error has been received
+ */
+static bool gtid_wait_reply_complete(GWBUF *reply)
+{
+    uint8_t *ptr = GWBUF_DATA(reply);
+    size_t len = GWBUF_LENGTH(reply);
+    int more = 0;
+
+    if (len <= MYSQL_HEADER_LEN || MYSQL_GET_PAYLOAD_LEN(ptr) + MYSQL_HEADER_LEN > len)
+    {
+        return false;
+    }
+
+    return PTR_IS_ERR(ptr) || modutil_count_signal_packets(reply, 0, 0, &more) == 2;
+}
+
+/**
+ * @brief Check whether the slave caught up with the master
+ *
+ * MASTER_GTID_WAIT returns 0 when the position is reached and -1 on timeout.
+ *
+ * @param reply Complete and contiguous reply
+ * @return True if the slave has replicated the position
+ */
+static bool gtid_wait_succeeded(GWBUF *reply)
+{
+    uint8_t *ptr = GWBUF_DATA(reply);
+    uint8_t *end = ptr + GWBUF_LENGTH(reply);
+
+    if (PTR_IS_ERR(ptr))
+    {
+        return false;
+    }
+
+    /** Skip the column count, the column definition and the EOF packet */
+    for (int i = 0; i < 3 && ptr < end; i++)
+    {
+        ptr += MYSQL_GET_PAYLOAD_LEN(ptr) + MYSQL_HEADER_LEN;
+    }
+
+    /** The row has one length-encoded string */
+    return end - ptr >= MYSQL_HEADER_LEN + 2 && ptr[4] == 1 && ptr[5] == '0';
+}
+
+/**
+ * @brief Process a reply to MASTER_GTID_WAIT
+ *
+ * Once the whole reply has been read, the query that waited for the slave is
+ * sent to it. If the slave did not catch up in time, the query is sent to the
+ * master instead.
+ *
+ * @param inst  Router instance
+ * @param rses  Router client session
+ * @param bref  Slave that executed MASTER_GTID_WAIT
+ * @param reply Part of the reply
+ */
+static void handle_gtid_wait_reply(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
+                                   backend_ref_t *bref, GWBUF *reply)
+{
+    bref->bref_gtid_reply = gwbuf_append(bref->bref_gtid_reply, reply);
+
+    GWBUF *tmp = gwbuf_make_contiguous(bref->bref_gtid_reply);
+
+    if (tmp == NULL)
+    {
+        /** The buffer is freed when the backend reference is closed */
+        poll_fake_hangup_event(bref->bref_dcb);
+        return;
+    }
+
+    bref->bref_gtid_reply = tmp;
+
+    if (!gtid_wait_reply_complete(tmp))
+    {
+        return;
+    }
+
+    bool synced = gtid_wait_succeeded(tmp);
+    GWBUF *query = bref->bref_pending_cmd;
+    bref->bref_pending_cmd = NULL;
+    bref->bref_gtid_reply = NULL;
+    gwbuf_free(tmp);
+    bref_clear_state(bref, BREF_WAITING_GTID);
+    ss_dassert(query);
+
+    backend_ref_t *master = rses->rses_master_ref;
+
+    if (!synced && master && BREF_IS_IN_USE(master))
+    {
+        MXS_INFO("[%s]:%d did not replicate the GTID position %s in %d seconds, "
+                 "routing the query to the master.", bref->ref->server->name,
+                 bref->ref->server->port, rses->gtid_pos,
+                 rses->rses_config.causal_reads_timeout);
+        atomic_add_uint64(&inst->stats.n_gtid_wait_timeouts, 1);
+        bref_clear_state(bref, BREF_WAITING_RESULT);
+        session_clear_stmt(rses->client_dcb->session);
+
+        if (!handle_got_target(inst, rses, query, master->bref_dcb,
+                               rses->rses_config.retry_failed_reads))
+        {
+            MXS_ERROR("Failed to route query to the master after a GTID wait timed out.");
+        }
+
+        gwbuf_free(query);
+        return;
+    }
+
+    if (synced)
+    {
+        bref->bref_gtid_synced = true;
+    }
+    else
+    {
+        MXS_WARNING("[%s]:%d did not replicate the GTID position %s and no master "
+                    "is available, the query may return stale data.",
+                    bref->ref->server->name, bref->ref->server->port, rses->gtid_pos);
+    }
+
+    /** The time spent waiting for the GTID position is not part of the sample */
+    bref->bref_query_start = rwsplit_now();
+
+    if (bref->bref_dcb->func.write(bref->bref_dcb, query) == 1)
+    {
+        atomic_add_uint64(&inst->stats.n_queries, 1);
+        bref_set_state(bref, BREF_QUERY_ACTIVE);
+    }
+    else
+    {
+        MXS_ERROR("Failed to route query to [%s]:%d after waiting for the GTID "
+                  "position %s.", bref->ref->server->name, bref->ref->server->port,
+                  rses->gtid_pos);
+    }
+}
+
+uint64_t rwsplit_response_time(const SERVER *server, uint64_t now)
+{
+    uint64_t avg = server->stats.response_time;
+    uint64_t sampled = server->stats.response_time_sampled;
+
+    if (avg && now > sampled)
+    {
+        avg = avg * exp2(-(double)(now - sampled) / RWSPLIT_RESPONSE_TIME_HALF_LIFE);
+    }
+
+    return avg;
+}
+
+/**
+ * @brief Add a response time sample to the server's average
+ *
+ * The average decays with a factor of 1/8 per sample, so a server that slows
+ * down is noticed after a few queries, and with time, see
+ * rwsplit_response_time(). The average is shared by all sessions and is
+ * updated without locking; a lost update only delays the convergence.
+ *
+ * @param bref Backend reference that received the first part of a reply
+ */
+static void update_response_time(backend_ref_t *bref)
+{
+    SERVER_STATS *stats = &bref->ref->server->stats;
+    uint64_t now = rwsplit_now();
+    uint64_t sample = now - bref->bref_query_start;
+    uint64_t avg = rwsplit_response_time(bref->ref->server, now);
+
+    if (sample == 0)
+    {
+        sample = 1;
+    }
+
+    stats->response_time = avg ? (avg * 7 + sample) / 8 : sample;
+    stats->response_time_sampled = now;
+}
@@ -30,6 +30,7 @@
 #include <maxscale/cdefs.h>
 
 #include <math.h>
+#include <time.h>
 
 #include <maxscale/dcb.h>
 #include <maxscale/hashtable.h>
@@ -44,7 +45,8 @@ typedef enum bref_state
     BREF_WAITING_RESULT   = 0x02, /*< for session commands only */
     BREF_QUERY_ACTIVE     = 0x04, /*< for other queries */
     BREF_CLOSED           = 0x08,
-    BREF_FATAL_FAILURE    = 0x10 /*< Backend references that should be dropped */
+    BREF_FATAL_FAILURE    = 0x10, /*< Backend references that should be dropped */
+    BREF_WAITING_GTID     = 0x20  /*< Waiting for the slave to catch up with the master */
 } bref_state_t;
 
 #define BREF_IS_NOT_USED(s)         ((s)->bref_state & ~BREF_IN_USE)
@@ -53,6 +55,7 @@ typedef enum bref_state
 #define BREF_IS_QUERY_ACTIVE(s)     ((s)->bref_state & BREF_QUERY_ACTIVE)
 #define BREF_IS_CLOSED(s)           ((s)->bref_state & BREF_CLOSED)
 #define BREF_HAS_FAILED(s)          ((s)->bref_state & BREF_FATAL_FAILURE)
+#define BREF_IS_WAITING_GTID(s)     ((s)->bref_state & BREF_WAITING_GTID)
 
 typedef enum backend_type_t
 {
@@ -106,8 +109,9 @@ typedef enum select_criteria
     LEAST_ROUTER_CONNECTIONS,   /*< connections established by this router */
     LEAST_BEHIND_MASTER,
     LEAST_CURRENT_OPERATIONS,
+    ADAPTIVE_ROUTING,           /*< weighted by the average response time */
     DEFAULT_CRITERIA   = LEAST_CURRENT_OPERATIONS,
-    LAST_CRITERIA               /*< not used except for an index */
+    LAST_CRITERIA      = ADAPTIVE_ROUTING + 1 /*< not used except for an index */
 } select_criteria_t;
 
 static inline const char* select_criteria_to_str(select_criteria_t type)
@@ -126,6 +130,9 @@ static inline const char* select_criteria_to_str(select_criteria_t type)
     case LEAST_CURRENT_OPERATIONS:
         return "LEAST_CURRENT_OPERATIONS";
 
+    case ADAPTIVE_ROUTING:
+        return "ADAPTIVE_ROUTING";
+
     default:
         return "UNDEFINED_CRITERIA";
     }
@@ -165,6 +172,12 @@ static inline const char* failure_mode_to_str(enum failure_mode type)
 #define CONFIG_MAX_SLAVE_RLAG -1 /*< not used */
 #define CONFIG_SQL_VARIABLES_IN TYPE_ALL
 
+/** Maximum length of a GTID position, enough for several replication domains */
+#define RWSPLIT_GTID_MAXLEN 256
+
+/** Maximum length of a session command history compaction key */
+#define RWSPLIT_SESCMD_KEY_MAXLEN 128
+
 #define GET_SELECT_CRITERIA(s)                                                                  \
         (strncmp(s,"LEAST_GLOBAL_CONNECTIONS", strlen("LEAST_GLOBAL_CONNECTIONS")) == 0 ?       \
         LEAST_GLOBAL_CONNECTIONS : (                                                            \
@@ -173,7 +186,9 @@ static inline const char* failure_mode_to_str(enum failure_mode type)
         strncmp(s,"LEAST_ROUTER_CONNECTIONS", strlen("LEAST_ROUTER_CONNECTIONS")) == 0 ?        \
         LEAST_ROUTER_CONNECTIONS : (                                                            \
         strncmp(s,"LEAST_CURRENT_OPERATIONS", strlen("LEAST_CURRENT_OPERATIONS")) == 0 ?        \
-        LEAST_CURRENT_OPERATIONS : UNDEFINED_CRITERIA))))
+        LEAST_CURRENT_OPERATIONS : (                                                            \
+        strncmp(s,"ADAPTIVE_ROUTING", strlen("ADAPTIVE_ROUTING")) == 0 ?                        \
+        ADAPTIVE_ROUTING : UNDEFINED_CRITERIA)))))
 
 /**
  * Session variable command
@@ -191,6 +206,8 @@ typedef struct mysql_sescmd_st
                                    *  LOCAL_INFILE. Slave servers are compared to this
                                    *  when they return session command replies.*/
     int      position; /*< Position of this command */
+    char*    my_sescmd_key; /*< History compaction key, NULL if the command
+                             *  can't be replaced by a later command */
 #if defined(SS_DEBUG)
     skygw_chk_t        my_sescmd_chk_tail;
 #endif
@@ -252,6 +269,11 @@ typedef struct backend_ref_st
     GWBUF*          bref_pending_cmd; /**< For stmt which can't be routed due active sescmd execution */
     unsigned char   reply_cmd;  /**< The reply the backend server sent to a session command.
                                  * Used to detect slaves that fail to execute session command. */
+    GWBUF*          bref_gtid_reply; /**< Partial response to MASTER_GTID_WAIT */
+    uint64_t        bref_query_start; /**< When the last query was routed, see rwsplit_now() */
+    bool            bref_gtid_synced; /**< The slave has caught up with the last write */
+    uint64_t        bref_connect_start; /**< When a lazy connection was opened, 0 after
+                                          *  its first reply */
 #if defined(SS_DEBUG)
     skygw_chk_t     bref_chk_tail;
 #endif
@@ -269,13 +291,20 @@ typedef struct rwsplit_config_st
                                                 * to master or all nodes */
     int               max_sescmd_history; /**< Maximum amount of session commands to store */
     bool              disable_sescmd_history; /**< Disable session command history */
+    bool              compact_sescmd_history; /**< Drop overridden session commands
+                                                * from the history */
+    bool              lazy_connect; /**< Connect to slaves when the first read needs one */
     bool              master_accept_reads; /**< Use master for reads */
     bool              strict_multi_stmt; /**< Force non-multistatement queries to be routed
                                              * to the master after a multistatement query. */
     bool              strict_sp_calls; /**< Lock session to master after an SP call */
+    bool              strict_sescmd_routing; /**< Session commands must be routed to
+                                               * all backends */
     enum failure_mode master_failure_mode; /**< Master server failure handling mode.
                                                * @see enum failure_mode */
     bool              retry_failed_reads; /**< Retry failed reads on other servers */
+    bool              causal_reads; /**< Reads on slaves wait for the session's last write */
+    int               causal_reads_timeout; /**< Seconds a slave may wait for a write */
 } rwsplit_config_t;
 
 #if defined(PREP_STMT_CACHING)
@@ -316,11 +345,13 @@ struct router_client_session
     int              rses_nbackends;
     int              rses_nsescmd;  /*< Number of executed session commands */
     bool             rses_load_active; /*< If LOAD DATA LOCAL INFILE is being currently executed */
+    bool             rses_ps_master_only; /*< A statement was prepared only on the master */
     bool             have_tmp_tables;
     uint64_t         rses_load_data_sent; /*< How much data has been sent */
     DCB*             client_dcb;
     int              pos_generator;
     backend_ref_t    *forced_node; /*< Current server where all queries should be sent */
+    char             gtid_pos[RWSPLIT_GTID_MAXLEN]; /*< GTID of the last write, empty if none */
 #if defined(PREP_STMT_CACHING)
     HASHTABLE*       rses_prep_stmt[2];
 #endif
@@ -341,6 +372,14 @@ typedef struct
     uint64_t n_master;   /*< Number of stmts sent to master */
     uint64_t n_slave;    /*< Number of stmts sent to slave */
     uint64_t n_all;      /*< Number of stmts sent to all */
+    uint64_t n_gtid_wait_timeouts; /*< Causal reads that were sent to master */
+    uint64_t n_sescmd_history; /*< Session commands currently stored in histories */
+    uint64_t n_sescmd_compacted; /*< Session commands removed by history compaction */
+    uint64_t n_slaves_deferred; /*< Slave connections not opened at session start */
+    uint64_t n_lazy_connects; /*< Slave connections opened by the first read */
+    uint64_t n_lazy_replies; /*< Lazy connections that have returned their first reply */
+    uint64_t lazy_connect_time; /*< Total time from a lazy connect to its first reply, us */
+    uint64_t n_sescmd_slaves_closed; /*< Slaves closed due to failed session commands */
 } ROUTER_STATS;
 
 /**
@@ -358,6 +397,21 @@ typedef struct router_instance
 #define BACKEND_TYPE(b) (SERVER_IS_MASTER((b)->backend_server) ? BE_MASTER :    \
         (SERVER_IS_SLAVE((b)->backend_server) ? BE_SLAVE :  BE_UNDEFINED));
 
+/**
+ * The average response time of a server is halved for each second that it
+ * is not updated. A slave that was slow once still gets a few reads and is
+ * used again once it is fast.
+ */
+#define RWSPLIT_RESPONSE_TIME_HALF_LIFE 1000000
+
+/** Monotonic time in microseconds, used to measure response times */
+static inline uint64_t rwsplit_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 MXS_END_DECLS
 
 #endif /*< _RWSPLITROUTER_H */
@@ -72,6 +72,18 @@ void rses_property_done(rses_property_t *prop);
 int rses_get_max_slavecount(ROUTER_CLIENT_SES *rses, int router_nservers);
 int rses_get_max_replication_lag(ROUTER_CLIENT_SES *rses);
 
+/**
+ * @brief Get the average response time of a server
+ *
+ * The stored average is decayed by the time since it was last updated, see
+ * RWSPLIT_RESPONSE_TIME_HALF_LIFE.
+ *
+ * @param server Server to inspect
+ * @param now    Current time, see rwsplit_now()
+ * @return The average response time in microseconds, zero if not measured
+ */
+uint64_t rwsplit_response_time(const SERVER *server, uint64_t now);
+
 /*
  * The following are implemented in rwsplit_route_stmt.c
  */
@@ -98,10 +110,16 @@ bool handle_master_is_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
                              DCB **target_dcb);
 bool handle_got_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
                        GWBUF *querybuf, DCB *target_dcb, bool store);
+bool needs_causal_read(ROUTER_CLIENT_SES *rses, backend_ref_t *bref);
+bool route_causal_read(ROUTER_CLIENT_SES *rses, backend_ref_t *bref,
+                       GWBUF *querybuf, bool store);
 bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
                          GWBUF *querybuf, ROUTER_INSTANCE *inst,
                          int packet_type,
                          qc_query_type_t qtype);
+double response_time_weight(const backend_ref_t *bref, uint64_t now);
+backend_ref_t *pick_by_response_time(backend_ref_t *cand, backend_ref_t *new,
+                                     double *total_weight, uint64_t now);
 
 /*
  * The following are implemented in rwsplit_session_cmd.c
@@ -133,6 +151,7 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
                                     MXS_SESSION *session,
                                     ROUTER_INSTANCE *router,
                                     bool active_session);
+bool connect_lazy_slave(ROUTER_CLIENT_SES *rses, int max_rlag);
 
 /*
  * The following are implemented in rwsplit_tmp_table_multi.c
@@ -146,7 +165,9 @@ bool is_read_tmp_table(ROUTER_CLIENT_SES *router_cli_ses,
 void check_create_tmp_table(ROUTER_CLIENT_SES *router_cli_ses,
                             GWBUF *querybuf, qc_query_type_t type);
 bool check_for_multi_stmt(GWBUF *buf, void *protocol, mysql_server_cmd_t packet_type);
+bool is_read_only_multi_stmt(ROUTER_CLIENT_SES *rses, GWBUF *buf, qc_query_type_t type);
 bool check_for_sp_call(GWBUF *buf, mysql_server_cmd_t packet_type);
+bool check_for_ps_id_use(GWBUF *buf, mysql_server_cmd_t packet_type);
 qc_query_type_t determine_query_type(GWBUF *querybuf, int packet_type, bool non_empty_packet);
 void close_failed_bref(backend_ref_t *bref, bool fatal);
 
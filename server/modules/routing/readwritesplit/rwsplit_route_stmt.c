@@ -18,7 +18,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <maxscale/alloc.h>
+#include <maxscale/modutil.h>
+#include <maxscale/random_jkiss.h>
 
 #include <maxscale/router.h>
 #include "rwsplit_internal.h"
@@ -71,6 +74,12 @@ bool route_single_stmt(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
     packet_type = determine_packet_type(querybuf, &non_empty_packet);
     qtype = determine_query_type(querybuf, packet_type, non_empty_packet);
 
+    if (packet_type == MYSQL_COM_STMT_EXECUTE && rses->rses_ps_master_only)
+    {
+        /** The slaves don't have every statement the client has prepared */
+        qtype |= QUERY_TYPE_MASTER_READ;
+    }
+
     if (non_empty_packet)
     {
         handle_multi_temp_and_load(rses, querybuf, packet_type, (int *)&qtype);
@@ -97,6 +106,13 @@ bool route_single_stmt(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
          *   eventually to master
          */
         route_target = get_route_target(rses, qtype, querybuf->hint);
+
+        if (!rses->rses_ps_master_only && !TARGET_IS_ALL(route_target) &&
+            check_for_ps_id_use(querybuf, (mysql_server_cmd_t)packet_type))
+        {
+            /** The statement ids of the slaves no longer match the master's */
+            rses->rses_ps_master_only = true;
+        }
     }
     else
     {
@@ -153,6 +169,26 @@ bool route_single_stmt(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
     return succp;
 } /* route_single_stmt */
 
+/**
+ * @brief Close a slave that failed to accept a session command
+ *
+ * Used when strict_sescmd_routing is disabled. The session continues with the
+ * remaining backends instead of failing the whole session command.
+ *
+ * @param inst Router instance
+ * @param bref The failed slave
+ */
+static void close_sescmd_slave(ROUTER_INSTANCE *inst, backend_ref_t *bref)
+{
+    MXS_WARNING("Closing connection to slave '%s', it failed to accept a "
+                "session command.", bref->ref->server->unique_name);
+    close_failed_bref(bref, true);
+    RW_CHK_DCB(bref, bref->bref_dcb);
+    dcb_close(bref->bref_dcb);
+    RW_CLOSE_BREF(bref);
+    atomic_add_uint64(&inst->stats.n_sescmd_slaves_closed, 1);
+}
+
 /**
  * Execute in backends used by current router session.
  * Save session variable commands to router session property
@@ -170,7 +206,8 @@ bool route_single_stmt(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
  * @param qtype         Query type from query_classifier
  *
  * @return True if at least one backend is used and routing succeed to all
- * backends being used, otherwise false.
+ * backends being used, otherwise false. With strict_sescmd_routing disabled,
+ * slaves that fail are closed and don't count as backends being used.
  *
  */
 bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
@@ -226,6 +263,12 @@ bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
                 {
                     nsucc += 1;
                 }
+                else if (!router_cli_ses->rses_config.strict_sescmd_routing &&
+                         &backend_ref[i] != router_cli_ses->rses_master_ref)
+                {
+                    close_sescmd_slave(inst, &backend_ref[i]);
+                    nbackends -= 1;
+                }
             }
         }
         gwbuf_free(querybuf);
@@ -284,6 +327,7 @@ bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
             tmp = prop;
             router_cli_ses->rses_properties[RSES_PROP_TYPE_SESCMD] = prop->rses_prop_next;
             rses_property_done(tmp);
+            atomic_add_uint64(&inst->stats.n_sescmd_history, -1);
             prop = router_cli_ses->rses_properties[RSES_PROP_TYPE_SESCMD];
         }
     }
@@ -308,6 +352,8 @@ bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
         return false;
     }
 
+    atomic_add_uint64(&inst->stats.n_sescmd_history, 1);
+
     for (i = 0; i < router_cli_ses->rses_nbackends; i++)
     {
         if (BREF_IS_IN_USE((&backend_ref[i])))
@@ -356,6 +402,13 @@ bool route_session_write(ROUTER_CLIENT_SES *router_cli_ses,
                     MXS_ERROR("Failed to execute session command in [%s]:%d",
                               backend_ref[i].ref->server->name,
                               backend_ref[i].ref->server->port);
+
+                    if (!router_cli_ses->rses_config.strict_sescmd_routing &&
+                        &backend_ref[i] != router_cli_ses->rses_master_ref)
+                    {
+                        close_sescmd_slave(inst, &backend_ref[i]);
+                        nbackends -= 1;
+                    }
                 }
             }
         }
@@ -527,6 +580,9 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
     if (btype == BE_SLAVE)
     {
         backend_ref_t *candidate_bref = NULL;
+        bool adaptive = rses->rses_config.slave_selection_criteria == ADAPTIVE_ROUTING;
+        uint64_t now = adaptive ? rwsplit_now() : 0;
+        double total_weight = 0;
 
         for (i = 0; i < rses->rses_nbackends; i++)
         {
@@ -558,6 +614,7 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
                     /** found master */
                     candidate_bref = &backend_ref[i];
                     candidate.status = candidate_bref->ref->server->status;
+                    total_weight = response_time_weight(candidate_bref, now);
                     succp = true;
                 }
                 /**
@@ -572,6 +629,7 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
                     /** found slave */
                     candidate_bref = &backend_ref[i];
                     candidate.status = candidate_bref->ref->server->status;
+                    total_weight = response_time_weight(candidate_bref, now);
                     succp = true;
                 }
             }
@@ -588,6 +646,7 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
                 /** found slave */
                 candidate_bref = &backend_ref[i];
                 candidate.status = candidate_bref->ref->server->status;
+                total_weight = response_time_weight(candidate_bref, now);
                 succp = true;
             }
             /**
@@ -602,8 +661,16 @@ bool rwsplit_get_dcb(DCB **p_dcb, ROUTER_CLIENT_SES *rses, backend_type_t btype,
                     (b->server->rlag != MAX_RLAG_NOT_AVAILABLE &&
                      b->server->rlag <= max_rlag))
                 {
-                    candidate_bref = check_candidate_bref(candidate_bref, &backend_ref[i],
-                                                          rses->rses_config.slave_selection_criteria);
+                    if (adaptive)
+                    {
+                        candidate_bref = pick_by_response_time(candidate_bref, &backend_ref[i],
+                                                               &total_weight, now);
+                    }
+                    else
+                    {
+                        candidate_bref = check_candidate_bref(candidate_bref, &backend_ref[i],
+                                                              rses->rses_config.slave_selection_criteria);
+                    }
                     candidate.status = candidate_bref->ref->server->status;
                 }
                 else
@@ -703,6 +770,8 @@ route_target_t get_route_target(ROUTER_CLIENT_SES *rses,
      */
     else if (!load_active &&
              (qc_query_is_type(qtype, QUERY_TYPE_SESSION_WRITE) ||
+              /** Binary protocol prepared statements are prepared everywhere */
+              qc_query_is_type(qtype, QUERY_TYPE_PREPARE_STMT) ||
               /** Configured to allow writing user variables to all nodes */
               (use_sql_variables_in == TYPE_ALL &&
                qc_query_is_type(qtype, QUERY_TYPE_USERVAR_WRITE)) ||
@@ -722,9 +791,11 @@ route_target_t get_route_target(ROUTER_CLIENT_SES *rses,
          * They can be safely routed to all backends since the execution
          * is done later.
          *
-         * With prepared statement caching the task of routing
-         * the execution of the prepared statements to the right server would be
-         * an easy one. Currently this is not supported.
+         * The client protocol stores the classification of each prepared
+         * statement, so executions of plain reads can be routed to slaves.
+         * The statements are prepared in the same order on all backends,
+         * including the ones that replay the session command history, so
+         * they get the same ids on all of them.
          */
         if (qc_query_is_type(qtype, QUERY_TYPE_READ) &&
             !(qc_query_is_type(qtype, QUERY_TYPE_PREPARE_STMT) ||
@@ -892,9 +963,13 @@ handle_multi_temp_and_load(ROUTER_CLIENT_SES *rses, GWBUF *querybuf,
      * If we do not have a master node, assigning the forced node is not
      * effective since we don't have a node to force queries to. In this
      * situation, assigning QUERY_TYPE_WRITE for the query will trigger
-     * the error processing. */
+     * the error processing.
+     *
+     * A multi-statement query where every statement is a plain read does
+     * not modify the session state and it is routed like a single read. */
     if ((rses->forced_node == NULL || rses->forced_node != rses->rses_master_ref) &&
-        (check_for_multi_stmt(querybuf, rses->client_dcb->protocol, packet_type) ||
+        ((check_for_multi_stmt(querybuf, rses->client_dcb->protocol, packet_type) &&
+          !is_read_only_multi_stmt(rses, querybuf, *qtype)) ||
          check_for_sp_call(querybuf, packet_type)))
     {
         if (rses->rses_master_ref)
@@ -946,6 +1021,12 @@ handle_multi_temp_and_load(ROUTER_CLIENT_SES *rses, GWBUF *querybuf,
             {
                 *qtype |= QUERY_TYPE_MASTER_READ;
             }
+            else if (packet_type == MYSQL_COM_STMT_EXECUTE &&
+                     qc_query_is_type(*qtype, QUERY_TYPE_READ))
+            {
+                /** The tables of a prepared statement are not known here */
+                *qtype |= QUERY_TYPE_MASTER_READ;
+            }
         }
         check_create_tmp_table(rses, querybuf, *qtype);
     }
@@ -1067,6 +1148,11 @@ bool handle_slave_is_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
 {
     int rlag_max = rses_get_max_replication_lag(rses);
 
+    if (rses->rses_config.lazy_connect)
+    {
+        connect_lazy_slave(rses, rlag_max);
+    }
+
     /**
      * Search suitable backend server, get DCB in target_dcb
      */
@@ -1247,6 +1333,15 @@ handle_got_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
         return true;
     }
 
+    if (needs_causal_read(rses, bref) && bref->bref_pending_cmd == NULL)
+    {
+        /** The slave must first replicate the session's last write */
+        return route_causal_read(rses, bref, querybuf, store);
+    }
+
+    /** Only the query itself is timed, see update_response_time in readwritesplit.c */
+    bref->bref_query_start = rwsplit_now();
+
     if (target_dcb->func.write(target_dcb, gwbuf_clone(querybuf)) == 1)
     {
         if (store && !session_store_stmt(rses->client_dcb->session, querybuf, target_dcb->server))
@@ -1283,6 +1378,60 @@ handle_got_target(ROUTER_INSTANCE *inst, ROUTER_CLIENT_SES *rses,
     }
 }
 
+/**
+ * @brief Check whether a query must wait for the slave to catch up
+ *
+ * @param rses Router client session
+ * @param bref Target of the query
+ *
+ * @return True if @c bref is a slave that is not known to have replicated
+ *         the session's last write
+ */
+bool needs_causal_read(ROUTER_CLIENT_SES *rses, backend_ref_t *bref)
+{
+    return rses->rses_config.causal_reads && rses->gtid_pos[0] &&
+           bref != rses->rses_master_ref && !bref->bref_gtid_synced;
+}
+
+/**
+ * @brief Route a read that must see the session's last write
+ *
+ * MASTER_GTID_WAIT is executed on the slave and the query is stored until the
+ * reply arrives, see handle_gtid_wait_reply in readwritesplit.c.
+ *
+ * @param rses      Router client session
+ * @param bref      Slave where the query is routed
+ * @param querybuf  The query
+ * @param store     Whether the query should be stored for retrying
+ *
+ * @return True if MASTER_GTID_WAIT was sent to the slave
+ */
+bool route_causal_read(ROUTER_CLIENT_SES *rses, backend_ref_t *bref,
+                       GWBUF *querybuf, bool store)
+{
+    char sql[RWSPLIT_GTID_MAXLEN + 64];
+    snprintf(sql, sizeof(sql), "SELECT MASTER_GTID_WAIT('%s', %d)",
+             rses->gtid_pos, rses->rses_config.causal_reads_timeout);
+    GWBUF *wait = modutil_create_query(sql);
+
+    if (wait == NULL || bref->bref_dcb->func.write(bref->bref_dcb, wait) != 1)
+    {
+        MXS_ERROR("Failed to route MASTER_GTID_WAIT to [%s]:%d.",
+                  bref->ref->server->name, bref->ref->server->port);
+        return false;
+    }
+
+    if (store && !session_store_stmt(rses->client_dcb->session, querybuf, bref->ref->server))
+    {
+        MXS_ERROR("Failed to store current statement, it won't be retried if it fails.");
+    }
+
+    bref->bref_pending_cmd = gwbuf_clone(querybuf);
+    bref_set_state(bref, BREF_WAITING_GTID);
+    bref_set_state(bref, BREF_WAITING_RESULT);
+    return true;
+}
+
 /**
  * @brief Create a generic router session property structure.
  *
@@ -1392,6 +1541,50 @@ static backend_ref_t *check_candidate_bref(backend_ref_t *cand,
     }
 }
 
+/**
+ * @brief The share of reads a server gets with ADAPTIVE_ROUTING
+ *
+ * @param bref Backend reference
+ * @param now  Current time, see rwsplit_now()
+ * @return Server weight divided by the average response time. A server that
+ *         has not been measured yet counts as very fast so that it gets
+ *         measured.
+ */
+double response_time_weight(const backend_ref_t *bref, uint64_t now)
+{
+    uint64_t response_time = rwsplit_response_time(bref->ref->server, now);
+    return (double)bref->ref->weight / (response_time ? response_time : 1);
+}
+
+/**
+ * @brief Choose between two servers with ADAPTIVE_ROUTING
+ *
+ * Called for each candidate in turn, this selects a server with a probability
+ * proportional to its weight, i.e. inversely proportional to its response time.
+ *
+ * @param cand         The current candidate
+ * @param new          The next server to consider
+ * @param total_weight Sum of the weights of the servers considered so far,
+ *                     updated with the weight of @c new
+ * @param now          Current time, see rwsplit_now()
+ *
+ * @return The chosen server
+ */
+backend_ref_t *pick_by_response_time(backend_ref_t *cand, backend_ref_t *new,
+                                     double *total_weight, uint64_t now)
+{
+    double weight = response_time_weight(new, now);
+    *total_weight += weight;
+
+    if (*total_weight > 0 &&
+        (double)random_jkiss() / ((double)UINT_MAX + 1) * *total_weight < weight)
+    {
+        cand = new;
+    }
+
+    return cand;
+}
+
 /********************************
  * This routine returns the root master server from MySQL replication tree
  * Get the root Master rule:
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 
 #include <maxscale/router.h>
 #include "rwsplit_internal.h"
@@ -50,6 +51,8 @@ static int bref_cmp_behind_master(const void *bref1, const void *bref2);
 
 static int bref_cmp_current_load(const void *bref1, const void *bref2);
 
+static int bref_cmp_response_time(const void *bref1, const void *bref2);
+
 /**
  * The order of functions _must_ match with the order the select criteria are
  * listed in select_criteria_t definition in readwritesplit.h
@@ -60,7 +63,8 @@ int (*criteria_cmpfun[LAST_CRITERIA])(const void *, const void *) =
     bref_cmp_global_conn,
     bref_cmp_router_conn,
     bref_cmp_behind_master,
-    bref_cmp_current_load
+    bref_cmp_current_load,
+    bref_cmp_response_time
 };
 
 /**
@@ -239,10 +243,27 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
 
     ss_dassert(slaves_connected < max_nslaves || max_nslaves == 0);
 
+    /**
+     * With lazy_connect, slaves are connected by the first read that needs
+     * one. A session without a master needs its slaves right away.
+     */
+    bool connect_slaves = !router->rwsplit_config.lazy_connect ||
+                          *p_master_ref == NULL || !BREF_IS_IN_USE(*p_master_ref);
+
+    if (!connect_slaves && !active_session)
+    {
+        int deferred = MXS_MIN(max_nslaves, slaves_found) - slaves_connected;
+
+        if (deferred > 0)
+        {
+            atomic_add_uint64(&router->stats.n_slaves_deferred, deferred);
+        }
+    }
+
     backend_ref_t *bref = get_slave_candidate(backend_ref, router_nservers, master_host, p);
 
     /** Connect to all possible slaves */
-    while (bref && slaves_connected < max_nslaves)
+    while (connect_slaves && bref && slaves_connected < max_nslaves)
     {
         if (connect_server(bref, session, true))
         {
@@ -266,7 +287,11 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
 
         if (MXS_LOG_PRIORITY_IS_ENABLED(LOG_INFO))
         {
-            if (slaves_connected < max_nslaves)
+            if (!connect_slaves)
+            {
+                MXS_INFO("Slave connections are opened when the first read needs one.");
+            }
+            else if (slaves_connected < max_nslaves)
             {
                 MXS_INFO("Couldn't connect to maximum number of "
                          "slaves. Connected successfully to %d slaves "
@@ -313,6 +338,102 @@ bool select_connect_backend_servers(backend_ref_t **p_master_ref,
     return succp;
 }
 
+/**
+ * @brief Check whether a slave's replication lag is acceptable
+ *
+ * @param bref     Backend reference
+ * @param max_rlag Maximum allowed replication lag
+ * @return True if the slave can be used for reads
+ */
+static bool bref_rlag_is_valid(const backend_ref_t *bref, int max_rlag)
+{
+    SERVER *server = bref->ref->server;
+
+    return max_rlag == MAX_RLAG_UNDEFINED ||
+           (server->rlag != MAX_RLAG_NOT_AVAILABLE && server->rlag <= max_rlag);
+}
+
+/**
+ * @brief Connect to a slave for a read
+ *
+ * Used with lazy_connect. If the session has no slave that could be used for
+ * reads, the best slave candidate is connected. The session command history
+ * is replayed on it before the read is executed.
+ *
+ * @param rses     Router session
+ * @param max_rlag Maximum allowed replication lag
+ * @return True if a new slave connection was opened
+ */
+bool connect_lazy_slave(ROUTER_CLIENT_SES *rses, int max_rlag)
+{
+    backend_ref_t *backend_ref = rses->rses_backend_ref;
+    SERVER *master = rses->rses_master_ref ? rses->rses_master_ref->ref->server : NULL;
+    int max_nslaves = rses_get_max_slavecount(rses, rses->rses_nbackends);
+    int nslaves = 0;
+
+    /** Without the history the slave's session state can't be restored */
+    if (rses->rses_config.disable_sescmd_history)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        if (BREF_IS_IN_USE(&backend_ref[i]) &&
+            bref_valid_for_slave(&backend_ref[i], master))
+        {
+            if (bref_rlag_is_valid(&backend_ref[i], max_rlag))
+            {
+                /** An existing connection can be used */
+                return false;
+            }
+
+            nslaves++;
+        }
+    }
+
+    int (*cmpfun)(const void *, const void *) =
+        criteria_cmpfun[rses->rses_config.slave_selection_criteria];
+
+    while (nslaves < max_nslaves)
+    {
+        backend_ref_t *candidate = NULL;
+
+        for (int i = 0; i < rses->rses_nbackends; i++)
+        {
+            if (!BREF_IS_IN_USE(&backend_ref[i]) &&
+                bref_valid_for_connect(&backend_ref[i]) &&
+                bref_valid_for_slave(&backend_ref[i], master) &&
+                bref_rlag_is_valid(&backend_ref[i], max_rlag) &&
+                (candidate == NULL || cmpfun(candidate, &backend_ref[i]) > 0))
+            {
+                candidate = &backend_ref[i];
+            }
+        }
+
+        if (candidate == NULL)
+        {
+            break;
+        }
+
+        uint64_t start = rwsplit_now();
+
+        if (connect_server(candidate, rses->client_dcb->session, true))
+        {
+            candidate->bref_connect_start = start;
+            atomic_add_uint64(&rses->router->stats.n_lazy_connects, 1);
+            MXS_INFO("Connected to slave '%s' for the first read of the session.",
+                     candidate->ref->server->unique_name);
+            return true;
+        }
+
+        /** Failed to connect, mark server as failed */
+        bref_set_state(candidate, BREF_FATAL_FAILURE);
+    }
+
+    return false;
+}
+
 /** Compare number of connections from this router in backend servers */
 static int bref_cmp_router_conn(const void *bref1, const void *bref2)
 {
@@ -430,6 +551,7 @@ static bool connect_server(backend_ref_t *bref, MXS_SESSION *session, bool execu
     {
         bref_clear_state(bref, BREF_CLOSED);
         bref->closed_at = 0;
+        bref->bref_connect_start = 0;
 
         if (!execute_history || execute_sescmd_history(bref))
         {
@@ -476,7 +598,8 @@ static void log_server_connections(select_criteria_t select_criteria,
     if (select_criteria == LEAST_GLOBAL_CONNECTIONS ||
         select_criteria == LEAST_ROUTER_CONNECTIONS ||
         select_criteria == LEAST_BEHIND_MASTER ||
-        select_criteria == LEAST_CURRENT_OPERATIONS)
+        select_criteria == LEAST_CURRENT_OPERATIONS ||
+        select_criteria == ADAPTIVE_ROUTING)
     {
         MXS_INFO("Servers and %s connection counts:",
                  select_criteria == LEAST_GLOBAL_CONNECTIONS ? "all MaxScale"
@@ -511,6 +634,14 @@ static void log_server_connections(select_criteria_t select_criteria,
                 MXS_INFO("replication lag : %d in \t[%s]:%d %s",
                          b->server->rlag, b->server->name,
                          b->server->port, STRSRVSTATUS(b->server));
+                break;
+
+            case ADAPTIVE_ROUTING:
+                MXS_INFO("average response time : %" PRIu64 " us in \t[%s]:%d %s",
+                         rwsplit_response_time(b->server, rwsplit_now()), b->server->name,
+                         b->server->port, STRSRVSTATUS(b->server));
+                break;
+
             default:
                 break;
             }
@@ -558,3 +689,32 @@ static SERVER_REF *get_root_master(backend_ref_t *servers, int router_nservers)
     }
     return master_host;
 }
+
+/** Compare the average response times of backend servers */
+static int bref_cmp_response_time(const void *bref1, const void *bref2)
+{
+    SERVER_REF *b1 = ((backend_ref_t *)bref1)->ref;
+    SERVER_REF *b2 = ((backend_ref_t *)bref2)->ref;
+    uint64_t now = rwsplit_now();
+    uint64_t rt1 = rwsplit_response_time(b1->server, now);
+    uint64_t rt2 = rwsplit_response_time(b2->server, now);
+
+    if (b1->weight == 0 && b2->weight == 0)
+    {
+        return (rt1 > rt2) - (rt1 < rt2);
+    }
+    else if (b1->weight == 0)
+    {
+        return 1;
+    }
+    else if (b2->weight == 0)
+    {
+        return -1;
+    }
+
+    /** Unlike the other counters, the times are too large to be scaled in an int */
+    double t1 = (1.0 + rt1) / b1->weight;
+    double t2 = (1.0 + rt2) / b2->weight;
+
+    return (t1 > t2) - (t1 < t2);
+}
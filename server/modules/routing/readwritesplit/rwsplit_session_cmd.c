@@ -13,12 +13,15 @@
 
 #include "readwritesplit.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <strings.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 
+#include <maxscale/alloc.h>
+#include <maxscale/modutil.h>
 #include <maxscale/router.h>
 #include "rwsplit_internal.h"
 
@@ -39,6 +42,8 @@ static bool sescmd_cursor_history_empty(sescmd_cursor_t *scur);
 static void sescmd_cursor_reset(sescmd_cursor_t *scur);
 static bool sescmd_cursor_next(sescmd_cursor_t *scur);
 static rses_property_t *mysql_sescmd_get_property(mysql_sescmd_t *scmd);
+static char *sescmd_get_key(GWBUF *buf, unsigned char packet_type);
+static void sescmd_compact_history(ROUTER_CLIENT_SES *rses, mysql_sescmd_t *scmd);
 
 /*
  * The following functions, all to do with the handling of session commands,
@@ -92,6 +97,8 @@ mysql_sescmd_t *mysql_sescmd_init(rses_property_t *rses_prop,
     sescmd->my_sescmd_buf = sescmd_buf;
     sescmd->my_sescmd_packet_type = packet_type;
     sescmd->position = atomic_add(&rses->pos_generator, 1);
+    sescmd->my_sescmd_key = rses->rses_config.compact_sescmd_history ?
+                            sescmd_get_key(sescmd_buf, packet_type) : NULL;
 
     return sescmd;
 }
@@ -105,6 +112,7 @@ void mysql_sescmd_done(mysql_sescmd_t *sescmd)
     }
     CHK_RSES_PROP(sescmd->my_sescmd_prop);
     gwbuf_free(sescmd->my_sescmd_buf);
+    MXS_FREE(sescmd->my_sescmd_key);
     memset(sescmd, 0, sizeof(mysql_sescmd_t));
 }
 
@@ -174,6 +182,7 @@ GWBUF *sescmd_cursor_process_replies(GWBUF *replybuf,
                 RW_CHK_DCB(bref, bref->bref_dcb);
                 dcb_close(bref->bref_dcb);
                 RW_CLOSE_BREF(bref);
+                atomic_add_uint64(&ses->router->stats.n_sescmd_slaves_closed, 1);
                 *reconnect = true;
                 gwbuf_free(replybuf);
                 replybuf = NULL;
@@ -198,6 +207,13 @@ GWBUF *sescmd_cursor_process_replies(GWBUF *replybuf,
             MXS_INFO("Server '%s' responded to a session command, sending the response "
                      "to the client.", bref->ref->server->unique_name);
 
+            /** Only a successful command can replace the older ones */
+            if (scmd->reply_cmd == MYSQL_REPLY_OK && scmd->my_sescmd_key &&
+                !ses->rses_config.disable_sescmd_history)
+            {
+                sescmd_compact_history(ses, scmd);
+            }
+
             for (int i = 0; i < ses->rses_nbackends; i++)
             {
                 if (!BREF_IS_WAITING_RESULT(&ses->rses_backend_ref[i]))
@@ -215,6 +231,7 @@ GWBUF *sescmd_cursor_process_replies(GWBUF *replybuf,
                             dcb_close(ses->rses_backend_ref[i].bref_dcb);
                             RW_CLOSE_BREF(&ses->rses_backend_ref[i]);
                         }
+                        atomic_add_uint64(&ses->router->stats.n_sescmd_slaves_closed, 1);
                         *reconnect = true;
                         MXS_INFO("Disabling slave [%s]:%d, result differs from "
                                  "master's result. Master: %d Slave: %d",
@@ -465,3 +482,506 @@ static rses_property_t *mysql_sescmd_get_property(mysql_sescmd_t *scmd)
     CHK_MYSQL_SESCMD(scmd);
     return scmd->my_sescmd_prop;
 }
+
+/**
+ * Skip whitespace and comments
+ *
+ * Executable comments contain SQL and can't be skipped.
+ *
+ * @param ptr Pointer to the current position, updated on success
+ * @param end End of the SQL
+ *
+ * @return False if an executable or an unterminated comment was found
+ */
+static bool sescmd_skip_space(const char **ptr, const char *end)
+{
+    const char *p = *ptr;
+
+    while (p < end)
+    {
+        if (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        else if (*p == '#' || (end - p > 2 && p[0] == '-' && p[1] == '-' &&
+                               isspace((unsigned char)p[2])))
+        {
+            while (p < end && *p != '\n')
+            {
+                p++;
+            }
+        }
+        else if (end - p > 1 && p[0] == '/' && p[1] == '*')
+        {
+            if ((end - p > 2 && p[2] == '!') ||
+                (end - p > 3 && p[2] == 'M' && p[3] == '!'))
+            {
+                return false;
+            }
+
+            for (p += 2; p < end && !(p[0] == '*' && end - p > 1 && p[1] == '/'); p++)
+            {
+                ;
+            }
+
+            if (p == end)
+            {
+                return false;
+            }
+
+            p += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    *ptr = p;
+    return true;
+}
+
+/**
+ * Read an identifier, plain or quoted with backticks, in lower case
+ *
+ * @param ptr  Pointer to the current position, updated on success
+ * @param end  End of the SQL
+ * @param dest Destination buffer
+ * @param size Size of @c dest
+ *
+ * @return True if a non-empty identifier that fits into @c dest was read
+ */
+static bool sescmd_read_identifier(const char **ptr, const char *end, char *dest, size_t size)
+{
+    const char *p = *ptr;
+    size_t len = 0;
+
+    if (p < end && *p == '`')
+    {
+        for (p++; p < end && *p != '`'; p++)
+        {
+            if (len + 1 >= size)
+            {
+                return false;
+            }
+            dest[len++] = tolower((unsigned char)*p);
+        }
+
+        /** Escaped backticks are not supported */
+        if (p == end || (++p < end && *p == '`'))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        for (; p < end && (isalnum((unsigned char)*p) || *p == '_' || *p == '$'); p++)
+        {
+            if (len + 1 >= size)
+            {
+                return false;
+            }
+            dest[len++] = tolower((unsigned char)*p);
+        }
+    }
+
+    dest[len] = '\0';
+    *ptr = p;
+    return len > 0;
+}
+
+/**
+ * Skip a literal value
+ *
+ * Accepted values are numbers, bare words such as ON or DEFAULT and single
+ * quoted strings. Strings whose value could depend on the SQL mode or on the
+ * character set of the connection are rejected.
+ *
+ * @param ptr Pointer to the current position, updated on success
+ * @param end End of the SQL
+ *
+ * @return True if a literal value was skipped
+ */
+static bool sescmd_skip_literal(const char **ptr, const char *end)
+{
+    const char *p = *ptr;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        p++;
+    }
+
+    if (p < end && *p == '\'')
+    {
+        for (p++; p < end && *p != '\''; p++)
+        {
+            if (*p == '\\' || (unsigned char)*p > 0x7f)
+            {
+                return false;
+            }
+        }
+
+        if (p == end || (++p < end && *p == '\''))
+        {
+            return false;
+        }
+    }
+    else if (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+    {
+        while (p < end && (isalnum((unsigned char)*p) || *p == '_' || *p == '.'))
+        {
+            p++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    *ptr = p;
+    return true;
+}
+
+/**
+ * Check that only whitespace, comments and an optional semicolon remain
+ *
+ * @param p   Current position
+ * @param end End of the SQL
+ *
+ * @return True if the end of the statement was reached
+ */
+static bool sescmd_at_end(const char *p, const char *end)
+{
+    if (!sescmd_skip_space(&p, end))
+    {
+        return false;
+    }
+
+    if (p < end && *p == ';')
+    {
+        p++;
+
+        if (!sescmd_skip_space(&p, end))
+        {
+            return false;
+        }
+    }
+
+    return p == end;
+}
+
+/**
+ * Parse the compaction key of a SET statement
+ *
+ * Only statements that assign a literal value to exactly one session or user
+ * variable, or that use SET NAMES, have a key.
+ *
+ * @param p    Position after the SET keyword
+ * @param end  End of the SQL
+ * @param key  Destination buffer for the key
+ * @param size Size of @c key
+ *
+ * @return True if the statement has a key
+ */
+static bool sescmd_parse_set(const char *p, const char *end, char *key, size_t size)
+{
+    char name[RWSPLIT_SESCMD_KEY_MAXLEN - 5];
+    bool user_var = false;
+
+    if (!sescmd_skip_space(&p, end) || p == end)
+    {
+        return false;
+    }
+
+    if (*p == '@')
+    {
+        p++;
+
+        if (p < end && *p == '@')
+        {
+            p++;
+
+            if (!sescmd_read_identifier(&p, end, name, sizeof(name)))
+            {
+                return false;
+            }
+
+            if (p < end && *p == '.')
+            {
+                /** Global variables are not a part of the session state */
+                if (strcmp(name, "session") != 0 && strcmp(name, "local") != 0)
+                {
+                    return false;
+                }
+
+                p++;
+
+                if (!sescmd_read_identifier(&p, end, name, sizeof(name)))
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            user_var = true;
+
+            if (!sescmd_read_identifier(&p, end, name, sizeof(name)))
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        if (!sescmd_read_identifier(&p, end, name, sizeof(name)))
+        {
+            return false;
+        }
+
+        if (strcmp(name, "names") == 0)
+        {
+            /** SET NAMES charset [COLLATE collation] */
+            if (!sescmd_skip_space(&p, end) || !sescmd_skip_literal(&p, end))
+            {
+                return false;
+            }
+
+            if (!sescmd_at_end(p, end))
+            {
+                if (!sescmd_skip_space(&p, end) ||
+                    !sescmd_read_identifier(&p, end, name, sizeof(name)) ||
+                    strcmp(name, "collate") != 0 ||
+                    !sescmd_skip_space(&p, end) ||
+                    !sescmd_skip_literal(&p, end) ||
+                    !sescmd_at_end(p, end))
+                {
+                    return false;
+                }
+            }
+
+            snprintf(key, size, "SET NAMES");
+            return true;
+        }
+
+        if (strcmp(name, "session") == 0 || strcmp(name, "local") == 0)
+        {
+            if (!sescmd_skip_space(&p, end) ||
+                !sescmd_read_identifier(&p, end, name, sizeof(name)))
+            {
+                return false;
+            }
+        }
+    }
+
+    if (!sescmd_skip_space(&p, end) || p == end)
+    {
+        return false;
+    }
+
+    if (*p == ':')
+    {
+        p++;
+    }
+
+    if (p == end || *p != '=')
+    {
+        return false;
+    }
+
+    p++;
+
+    if (!sescmd_skip_space(&p, end) || !sescmd_skip_literal(&p, end) ||
+        !sescmd_at_end(p, end))
+    {
+        return false;
+    }
+
+    snprintf(key, size, "SET %s%s", user_var ? "@" : "", name);
+    return true;
+}
+
+/**
+ * Parse the compaction key of a text protocol session command
+ *
+ * @param p    Start of the SQL
+ * @param end  End of the SQL
+ * @param key  Destination buffer for the key
+ * @param size Size of @c key
+ *
+ * @return True if the statement has a key
+ */
+static bool sescmd_parse_key(const char *p, const char *end, char *key, size_t size)
+{
+    char word[RWSPLIT_SESCMD_KEY_MAXLEN / 2];
+    char name[RWSPLIT_SESCMD_KEY_MAXLEN / 2];
+
+    if (!sescmd_skip_space(&p, end) ||
+        !sescmd_read_identifier(&p, end, word, sizeof(word)))
+    {
+        return false;
+    }
+
+    if (strcmp(word, "set") == 0)
+    {
+        return sescmd_parse_set(p, end, key, size);
+    }
+    else if (strcmp(word, "use") == 0)
+    {
+        if (sescmd_skip_space(&p, end) &&
+            sescmd_read_identifier(&p, end, name, sizeof(name)) &&
+            sescmd_at_end(p, end))
+        {
+            snprintf(key, size, "USE");
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the history compaction key of a session command
+ *
+ * Two commands with the same key modify the same part of the session state
+ * and the later one fully replaces the effect of the earlier one. Commands
+ * without a key are never removed from the history.
+ *
+ * @param buf         Session command buffer
+ * @param packet_type Command byte of the packet
+ *
+ * @return Allocated key or NULL if the command has no key
+ */
+static char *sescmd_get_key(GWBUF *buf, unsigned char packet_type)
+{
+    char key[RWSPLIT_SESCMD_KEY_MAXLEN] = "";
+
+    if (packet_type == MYSQL_COM_INIT_DB)
+    {
+        snprintf(key, sizeof(key), "USE");
+    }
+    else if (packet_type == MYSQL_COM_QUERY && GWBUF_LENGTH(buf) == gwbuf_length(buf))
+    {
+        char *sql;
+        int len;
+
+        if (modutil_extract_SQL(buf, &sql, &len))
+        {
+            sescmd_parse_key(sql, sql + len, key, sizeof(key));
+        }
+    }
+
+    return *key ? MXS_STRDUP(key) : NULL;
+}
+
+/**
+ * Check whether a history entry prevents the removal of the entries before it
+ *
+ * Commands without a key may depend on any part of the session state. This
+ * includes PREPARE statements, which depend on the default database. They
+ * are also never removed themselves: each one uses up a statement ID and a
+ * backend that replays the history must assign the same IDs as the master.
+ *
+ * @param scmd Session command
+ *
+ * @return True if the older entries must be kept
+ */
+static bool sescmd_is_barrier(mysql_sescmd_t *scmd)
+{
+    return scmd->my_sescmd_key == NULL;
+}
+
+/**
+ * @brief Remove one command from the session command history
+ *
+ * A command can't be removed while a backend's cursor points to it. Cursors
+ * that point to the command after it are moved to the preceding link so that
+ * they keep pointing to the same command.
+ *
+ * @param rses Router session
+ * @param link The link that points to the command
+ *
+ * @return True if the command was removed
+ */
+static bool sescmd_remove_from_history(ROUTER_CLIENT_SES *rses, rses_property_t **link)
+{
+    rses_property_t *prop = *link;
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        backend_ref_t *bref = &rses->rses_backend_ref[i];
+
+        if (BREF_IS_IN_USE(bref) && bref->bref_sescmd_cur.scmd_cur_ptr_property == link)
+        {
+            return false;
+        }
+    }
+
+    *link = prop->rses_prop_next;
+
+    for (int i = 0; i < rses->rses_nbackends; i++)
+    {
+        sescmd_cursor_t *scur = &rses->rses_backend_ref[i].bref_sescmd_cur;
+
+        if (scur->scmd_cur_ptr_property == &prop->rses_prop_next)
+        {
+            scur->scmd_cur_ptr_property = link;
+            scur->scmd_cur_cmd = *link ? &(*link)->rses_prop_data.sescmd : NULL;
+        }
+        else if (scur->scmd_cur_cmd == &prop->rses_prop_data.sescmd)
+        {
+            scur->scmd_cur_cmd = NULL;
+        }
+    }
+
+    rses_property_done(prop);
+    atomic_add(&rses->rses_nsescmd, -1);
+    atomic_add_uint64(&rses->router->stats.n_sescmd_history, -1);
+    atomic_add_uint64(&rses->router->stats.n_sescmd_compacted, 1);
+
+    return true;
+}
+
+/**
+ * @brief Remove session commands that a newer command has replaced
+ *
+ * Older commands with the same key as @c scmd are removed if no barrier
+ * command was executed after them. The history then only holds the latest
+ * value of each variable and the latest default database.
+ *
+ * @param rses Router session
+ * @param scmd A session command that the master executed successfully
+ */
+static void sescmd_compact_history(ROUTER_CLIENT_SES *rses, mysql_sescmd_t *scmd)
+{
+    rses_property_t **head = &rses->rses_properties[RSES_PROP_TYPE_SESCMD];
+    rses_property_t **start = head;
+    rses_property_t **link;
+
+    for (link = head; *link && *link != scmd->my_sescmd_prop; link = &(*link)->rses_prop_next)
+    {
+        if (sescmd_is_barrier(&(*link)->rses_prop_data.sescmd))
+        {
+            start = link;
+        }
+    }
+
+    link = start;
+
+    while (*link && *link != scmd->my_sescmd_prop)
+    {
+        mysql_sescmd_t *old = &(*link)->rses_prop_data.sescmd;
+
+        if (old->my_sescmd_key == NULL || !old->my_sescmd_is_replied ||
+            strcmp(old->my_sescmd_key, scmd->my_sescmd_key) != 0 ||
+            !sescmd_remove_from_history(rses, link))
+        {
+            link = &(*link)->rses_prop_next;
+        }
+        else
+        {
+            MXS_INFO("Removed an overridden session command from the history: %s",
+                     scmd->my_sescmd_key);
+        }
+    }
+}
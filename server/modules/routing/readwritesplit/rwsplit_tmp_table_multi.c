@@ -355,11 +355,77 @@ bool check_for_multi_stmt(GWBUF *buf, void *protocol, mysql_server_cmd_t packet_
     return rval;
 }
 
+/**
+ * @brief Check if a multi-statement query only reads data
+ *
+ * Each statement is classified separately. If all of them are plain reads
+ * and no temporary tables exist, the query does not modify the session state
+ * and it can be routed like a single read.
+ *
+ * @param rses Router client session
+ * @param buf Buffer containing the full query
+ * @param type Type of the query as classified from its first statement
+ * @return True if every statement of the query is a plain read
+ */
+bool is_read_only_multi_stmt(ROUTER_CLIENT_SES *rses, GWBUF *buf, qc_query_type_t type)
+{
+    return type == QUERY_TYPE_READ && !rses->have_tmp_tables &&
+           qc_get_multi_type_mask(buf) == QUERY_TYPE_READ;
+}
+
 bool check_for_sp_call(GWBUF *buf, mysql_server_cmd_t packet_type)
 {
     return packet_type == MYSQL_COM_QUERY && qc_get_operation(buf) == QUERY_OP_CALL;
 }
 
+/**
+ * @brief Check if a command may allocate a prepared statement ID
+ *
+ * The binary protocol executions use the statement IDs that the master
+ * assigned. They match the IDs of the slaves only as long as every command
+ * that uses up an ID is executed on every backend. Besides COM_STMT_PREPARE,
+ * a text protocol PREPARE, EXECUTE IMMEDIATE or a stored procedure can
+ * allocate one. Statements that can't be fully parsed and multi-statement
+ * queries that are not plain reads may contain any of them.
+ *
+ * @param buf Buffer containing the full query
+ * @param packet_type Type of the packet
+ * @return True if executing the command may allocate a statement ID
+ */
+bool check_for_ps_id_use(GWBUF *buf, mysql_server_cmd_t packet_type)
+{
+    bool rval = false;
+
+    if (packet_type == MYSQL_COM_STMT_PREPARE)
+    {
+        rval = true;
+    }
+    else if (packet_type == MYSQL_COM_QUERY)
+    {
+        uint32_t type = qc_get_multi_type_mask(buf);
+
+        rval = (type & (QUERY_TYPE_PREPARE_STMT | QUERY_TYPE_PREPARE_NAMED_STMT)) ||
+               qc_parse(buf, QC_COLLECT_ESSENTIALS) != QC_QUERY_PARSED ||
+               qc_get_operation(buf) == QUERY_OP_CALL ||
+               (type != QUERY_TYPE_READ && modutil_count_statements(buf) > 1);
+    }
+
+    return rval;
+}
+
+/**
+ * Types that keep the executions of a prepared statement on the master
+ * even if the statement reads data
+ */
+#define PS_MASTER_ONLY_TYPES (QUERY_TYPE_WRITE | QUERY_TYPE_MASTER_READ |                  \
+                              QUERY_TYPE_SESSION_WRITE | QUERY_TYPE_USERVAR_WRITE |        \
+                              QUERY_TYPE_USERVAR_READ | QUERY_TYPE_GSYSVAR_WRITE |         \
+                              QUERY_TYPE_BEGIN_TRX | QUERY_TYPE_COMMIT |                   \
+                              QUERY_TYPE_ROLLBACK | QUERY_TYPE_ENABLE_AUTOCOMMIT |         \
+                              QUERY_TYPE_DISABLE_AUTOCOMMIT | QUERY_TYPE_PREPARE_NAMED_STMT | \
+                              QUERY_TYPE_EXEC_STMT | QUERY_TYPE_CREATE_TMP_TABLE |         \
+                              QUERY_TYPE_READ_TMP_TABLE)
+
 /**
  * @brief Determine the type of a query
  *
@@ -389,9 +455,12 @@ determine_query_type(GWBUF *querybuf, int packet_type, bool non_empty_packet)
             qtype = QUERY_TYPE_SESSION_WRITE;
             break;
 
+        case MYSQL_COM_STMT_CLOSE:  /*< free prepared statement on all servers */
+            qtype = QUERY_TYPE_SESSION_WRITE;
+            break;
+
         case MYSQL_COM_CREATE_DB:           /**< 5 DDL must go to the master */
         case MYSQL_COM_DROP_DB:             /**< 6 DDL must go to the master */
-        case MYSQL_COM_STMT_CLOSE:          /*< free prepared statement */
         case MYSQL_COM_STMT_SEND_LONG_DATA: /*< send data to column */
         case MYSQL_COM_STMT_RESET: /*< resets the data of a prepared statement */
             qtype = QUERY_TYPE_WRITE;
@@ -407,8 +476,26 @@ determine_query_type(GWBUF *querybuf, int packet_type, bool non_empty_packet)
             break;
 
         case MYSQL_COM_STMT_EXECUTE:
-            /** Parsing is not needed for this type of packet */
+            /** The statement was classified by the protocol when it was prepared */
             qtype = QUERY_TYPE_EXEC_STMT;
+            {
+                const MYSQL_PS_INFO *info = mysql_get_ps_info(querybuf);
+
+                uint8_t flags = 0;
+
+                /** The flags byte follows the statement id. A cursor is read
+                 * with COM_STMT_FETCH, which is routed to the master. */
+                gwbuf_copy_data(querybuf, MYSQL_HEADER_LEN + 5, 1, &flags);
+
+                /** Only plain reads are safe to execute on a slave. The long
+                 * data of a statement is only sent to the master. */
+                if (info && !info->long_data && flags == 0 &&
+                    qc_query_is_type(info->type_mask, QUERY_TYPE_READ) &&
+                    (info->type_mask & PS_MASTER_ONLY_TYPES) == 0)
+                {
+                    qtype |= QUERY_TYPE_READ;
+                }
+            }
             break;
 
         case MYSQL_COM_SHUTDOWN:       /**< 8 where should shutdown be routed ? */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the routing of binary protocol prepared statements
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include "../readwritesplit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/alloc.h>
+#include <maxscale/config.h>
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+#include <maxscale/modutil.h>
+#include <maxscale/paths.h>
+#include <maxscale/protocol/mysql.h>
+
+#include "../rwsplit_internal.h"
+
+static void ps_info_free(void* data)
+{
+}
+
+/** Create a COM_STMT_EXECUTE or COM_STMT_CLOSE for statement 1 */
+static GWBUF* create_stmt_command(uint8_t cmd, MYSQL_PS_INFO* info)
+{
+    uint8_t data[] = {5, 0, 0, 0, cmd, 1, 0, 0, 0};
+    GWBUF* buffer = gwbuf_alloc_and_load(sizeof(data), data);
+    ss_dassert(buffer);
+
+    if (info)
+    {
+        gwbuf_add_buffer_object(buffer, GWBUF_PS_INFO, info, ps_info_free);
+    }
+
+    return buffer;
+}
+
+/** Create a COM_STMT_EXECUTE for statement 1 with the given flags */
+static GWBUF* create_execute(MYSQL_PS_INFO* info, uint8_t flags)
+{
+    uint8_t data[] = {10, 0, 0, 0, MYSQL_COM_STMT_EXECUTE, 1, 0, 0, 0, flags, 1, 0, 0, 0};
+    GWBUF* buffer = gwbuf_alloc_and_load(sizeof(data), data);
+    ss_dassert(buffer);
+
+    if (info)
+    {
+        gwbuf_add_buffer_object(buffer, GWBUF_PS_INFO, info, ps_info_free);
+    }
+
+    return buffer;
+}
+
+static qc_query_type_t execute_type(MYSQL_PS_INFO* info, uint8_t flags)
+{
+    GWBUF* buffer = create_execute(info, flags);
+    qc_query_type_t type = determine_query_type(buffer, MYSQL_COM_STMT_EXECUTE, true);
+    gwbuf_free(buffer);
+
+    return type;
+}
+
+/**
+ * Only executions of plain reads are classified as reads
+ */
+static void test_query_type()
+{
+    MYSQL_PS_INFO info;
+    memset(&info, 0, sizeof(info));
+
+    ss_dassert(execute_type(NULL, 0) == QUERY_TYPE_EXEC_STMT);
+
+    info.type_mask = QUERY_TYPE_READ;
+    ss_dassert(execute_type(&info, 0) == (QUERY_TYPE_EXEC_STMT | QUERY_TYPE_READ));
+
+    info.type_mask = QUERY_TYPE_READ | QUERY_TYPE_SYSVAR_READ;
+    ss_dassert(execute_type(&info, 0) == (QUERY_TYPE_EXEC_STMT | QUERY_TYPE_READ));
+
+    info.type_mask = QUERY_TYPE_READ | QUERY_TYPE_WRITE;
+    ss_dassert(execute_type(&info, 0) == QUERY_TYPE_EXEC_STMT);
+
+    info.type_mask = QUERY_TYPE_READ | QUERY_TYPE_USERVAR_WRITE;
+    ss_dassert(execute_type(&info, 0) == QUERY_TYPE_EXEC_STMT);
+
+    info.type_mask = QUERY_TYPE_WRITE;
+    ss_dassert(execute_type(&info, 0) == QUERY_TYPE_EXEC_STMT);
+
+    info.type_mask = QUERY_TYPE_READ;
+    info.long_data = true;
+    ss_dassert(execute_type(&info, 0) == QUERY_TYPE_EXEC_STMT);
+
+    /** The fetches from a cursor go to the master, so must the execute */
+    info.long_data = false;
+    ss_info_dassert(execute_type(&info, 1) == QUERY_TYPE_EXEC_STMT,
+                    "A read that opens a cursor should not go to a slave");
+
+    GWBUF* buffer = create_stmt_command(MYSQL_COM_STMT_CLOSE, NULL);
+    ss_dassert(determine_query_type(buffer, MYSQL_COM_STMT_CLOSE, true) == QUERY_TYPE_SESSION_WRITE);
+    gwbuf_free(buffer);
+}
+
+/**
+ * Statements are prepared on all backends and reads are executed on slaves
+ */
+static void test_route_target()
+{
+    ROUTER_CLIENT_SES rses;
+    backend_ref_t master;
+    DCB dcb;
+    MXS_SESSION session;
+
+    memset(&rses, 0, sizeof(rses));
+    memset(&master, 0, sizeof(master));
+    memset(&dcb, 0, sizeof(dcb));
+    memset(&session, 0, sizeof(session));
+    session.autocommit = true;
+    session.trx_state = SESSION_TRX_INACTIVE;
+    dcb.session = &session;
+    rses.client_dcb = &dcb;
+    rses.rses_master_ref = &master;
+    rses.rses_config.use_sql_variables_in = TYPE_ALL;
+
+    route_target_t target = get_route_target(&rses, QUERY_TYPE_READ | QUERY_TYPE_PREPARE_STMT, NULL);
+    ss_dassert(target == TARGET_ALL);
+
+    target = get_route_target(&rses, QUERY_TYPE_WRITE | QUERY_TYPE_PREPARE_STMT, NULL);
+    ss_dassert(target == TARGET_ALL);
+
+    target = get_route_target(&rses, QUERY_TYPE_EXEC_STMT | QUERY_TYPE_READ, NULL);
+    ss_dassert(target == TARGET_SLAVE);
+
+    target = get_route_target(&rses, QUERY_TYPE_EXEC_STMT, NULL);
+    ss_dassert(target == TARGET_MASTER);
+
+    target = get_route_target(&rses, QUERY_TYPE_EXEC_STMT | QUERY_TYPE_READ | QUERY_TYPE_MASTER_READ, NULL);
+    ss_dassert(target == TARGET_MASTER);
+
+    target = get_route_target(&rses, QUERY_TYPE_SESSION_WRITE, NULL);
+    ss_dassert(target == TARGET_ALL);
+
+    /** Statements are prepared only on the master after a multi-statement query */
+    rses.forced_node = &master;
+    target = get_route_target(&rses, QUERY_TYPE_READ | QUERY_TYPE_PREPARE_STMT, NULL);
+    ss_dassert(target == TARGET_MASTER);
+}
+
+static bool query_uses_ps_id(const char* sql)
+{
+    GWBUF* buffer = modutil_create_query((char*)sql);
+    ss_dassert(buffer);
+    bool rval = check_for_ps_id_use(buffer, MYSQL_COM_QUERY);
+    gwbuf_free(buffer);
+
+    return rval;
+}
+
+/**
+ * Commands that may allocate a statement ID are recognized
+ */
+static void test_ps_id_use()
+{
+    GWBUF* buffer = create_stmt_command(MYSQL_COM_STMT_EXECUTE, NULL);
+    ss_dassert(!check_for_ps_id_use(buffer, MYSQL_COM_STMT_EXECUTE));
+    ss_dassert(check_for_ps_id_use(buffer, MYSQL_COM_STMT_PREPARE));
+    gwbuf_free(buffer);
+
+    ss_dassert(query_uses_ps_id("PREPARE s FROM 'SELECT 1'"));
+    ss_dassert(query_uses_ps_id("EXECUTE IMMEDIATE 'SELECT 1'"));
+    ss_dassert(query_uses_ps_id("CALL p()"));
+    ss_dassert(query_uses_ps_id("SELECT 1; PREPARE s FROM 'SELECT 1'"));
+    ss_dassert(query_uses_ps_id("INSERT INTO t1 VALUES (1); INSERT INTO t1 VALUES (2)"));
+
+    ss_dassert(!query_uses_ps_id("SELECT a FROM t1"));
+    ss_dassert(!query_uses_ps_id("INSERT INTO t1 VALUES (1)"));
+    ss_dassert(!query_uses_ps_id("SELECT 1; SELECT 2"));
+    ss_dassert(!query_uses_ps_id("EXECUTE s"));
+}
+
+static bool read_only_multi_stmt(const char* sql)
+{
+    ROUTER_CLIENT_SES rses;
+    memset(&rses, 0, sizeof(rses));
+    GWBUF* buffer = modutil_create_query((char*)sql);
+    ss_dassert(buffer);
+    bool rval = is_read_only_multi_stmt(&rses, buffer, QUERY_TYPE_READ);
+    gwbuf_free(buffer);
+
+    return rval;
+}
+
+/**
+ * A multi-statement query is only a read if every statement is classified
+ */
+static void test_read_only_multi_stmt()
+{
+    ss_dassert(read_only_multi_stmt("SELECT 1; SELECT a FROM t1"));
+    ss_dassert(!read_only_multi_stmt("SELECT 1; UPDATE t1 SET a = 1"));
+    ss_info_dassert(!read_only_multi_stmt("SELECT 1; FOO BAR"),
+                    "A statement that can't be parsed should be a write");
+    ss_info_dassert(!read_only_multi_stmt("FOO BAR; SELECT 1"),
+                    "A first statement that can't be parsed should be a write");
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        config_get_global_options()->n_threads = 1;
+
+        set_libdir(MXS_STRDUP_A("../../../../../query_classifier/qc_sqlite/"));
+
+        if (qc_setup("qc_sqlite", "") && qc_process_init(QC_INIT_BOTH))
+        {
+            test_query_type();
+            test_route_target();
+            test_ps_id_use();
+            test_read_only_multi_stmt();
+            rc = EXIT_SUCCESS;
+
+            qc_process_end(QC_INIT_BOTH);
+        }
+        else
+        {
+            MXS_ERROR("Could not initialize query classifier.");
+        }
+
+        mxs_log_finish();
+    }
+
+    return rc;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the selection of slaves by their response times with ADAPTIVE_ROUTING
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+#include "../readwritesplit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <maxscale/debug.h>
+#include <maxscale/random_jkiss.h>
+
+#include "../rwsplit_internal.h"
+
+#define N_SLAVES 2
+#define N_PICKS  10000
+
+static SERVER servers[N_SLAVES];
+static SERVER_REF refs[N_SLAVES];
+static backend_ref_t brefs[N_SLAVES];
+
+static void init_slaves()
+{
+    memset(servers, 0, sizeof(servers));
+    memset(refs, 0, sizeof(refs));
+    memset(brefs, 0, sizeof(brefs));
+
+    for (int i = 0; i < N_SLAVES; i++)
+    {
+        refs[i].server = &servers[i];
+        refs[i].weight = 1000;
+        brefs[i].ref = &refs[i];
+    }
+}
+
+/** Set the average response time of a slave as it was measured at @c when */
+static void set_response_time(int slave, uint64_t response_time, uint64_t when)
+{
+    servers[slave].stats.response_time = response_time;
+    servers[slave].stats.response_time_sampled = when;
+}
+
+/**
+ * Pick a slave N_PICKS times like rwsplit_get_dcb does
+ *
+ * @return How many times the first slave was picked
+ */
+static int pick_first(uint64_t now)
+{
+    int n = 0;
+
+    for (int i = 0; i < N_PICKS; i++)
+    {
+        backend_ref_t *cand = &brefs[0];
+        double total_weight = response_time_weight(cand, now);
+
+        for (int j = 1; j < N_SLAVES; j++)
+        {
+            cand = pick_by_response_time(cand, &brefs[j], &total_weight, now);
+        }
+
+        if (cand == &brefs[0])
+        {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * The average is halved for each half-life without samples
+ */
+static void test_decay()
+{
+    init_slaves();
+    uint64_t now = 100 * RWSPLIT_RESPONSE_TIME_HALF_LIFE;
+
+    set_response_time(0, 8000, now);
+    ss_dassert(rwsplit_response_time(&servers[0], now) == 8000);
+    ss_dassert(rwsplit_response_time(&servers[0], now + RWSPLIT_RESPONSE_TIME_HALF_LIFE) == 4000);
+    ss_dassert(rwsplit_response_time(&servers[0], now + 3 * RWSPLIT_RESPONSE_TIME_HALF_LIFE) == 1000);
+    ss_info_dassert(rwsplit_response_time(&servers[0], now - 1) == 8000,
+                    "A sample from the future should not decay");
+
+    set_response_time(1, 0, 0);
+    ss_info_dassert(rwsplit_response_time(&servers[1], now) == 0,
+                    "A server that has not been measured stays unmeasured");
+}
+
+/**
+ * The reads are shared in inverse proportion to the response times
+ */
+static void test_share()
+{
+    init_slaves();
+    uint64_t now = 100 * RWSPLIT_RESPONSE_TIME_HALF_LIFE;
+
+    set_response_time(0, 500, now);
+    set_response_time(1, 500, now);
+    int n = pick_first(now);
+    ss_info_dassert(n > N_PICKS * 4 / 10 && n < N_PICKS * 6 / 10,
+                    "Equally fast slaves should get equal shares");
+
+    set_response_time(1, 1500, now);
+    n = pick_first(now);
+    ss_info_dassert(n > N_PICKS * 65 / 100 && n < N_PICKS * 85 / 100,
+                    "A three times faster slave should get three quarters");
+
+    set_response_time(1, 0, 0);
+    n = pick_first(now);
+    ss_info_dassert(n < N_PICKS / 10, "A slave that has not been measured should be preferred");
+}
+
+/**
+ * A slave that was slow once gets its share back with time
+ */
+static void test_recovery()
+{
+    init_slaves();
+    uint64_t now = 100 * RWSPLIT_RESPONSE_TIME_HALF_LIFE;
+
+    set_response_time(0, 500, now);
+    set_response_time(1, 5000000, now);
+    int n = pick_first(now);
+    ss_info_dassert(n > N_PICKS * 99 / 100, "A slow slave should be drained");
+
+    /** The fast slave keeps getting samples, the slow one does not */
+    now += 14 * RWSPLIT_RESPONSE_TIME_HALF_LIFE;
+    set_response_time(0, 500, now);
+    n = pick_first(now);
+    ss_info_dassert(n < N_PICKS * 7 / 10, "A slow slave should not be starved for good");
+}
+
+int main(int argc, char **argv)
+{
+    random_jkiss_init();
+
+    test_decay();
+    test_share();
+    test_recovery();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2016 MariaDB Corporation Ab
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file and at www.mariadb.com/bsl11.
+ *
+ * Change Date: 2019-07-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2 or later of the General
+ * Public License.
+ */
+
+/**
+ * Test the compaction keys of session commands and the removal of overridden
+ * commands from the session command history
+ */
+
+// To ensure that ss_info_assert asserts also when builing in non-debug mode.
+#if !defined(SS_DEBUG)
+#define SS_DEBUG
+#endif
+#if defined(NDEBUG)
+#undef NDEBUG
+#endif
+// We want to test the static functions
+#include "../rwsplit_session_cmd.c"
+
+#include <maxscale/debug.h>
+#include <maxscale/log_manager.h>
+
+#define N_BACKENDS 2
+
+static ROUTER_INSTANCE router;
+static ROUTER_CLIENT_SES rses;
+static backend_ref_t brefs[N_BACKENDS];
+
+static void init_session()
+{
+    memset(&router, 0, sizeof(router));
+    memset(&rses, 0, sizeof(rses));
+    memset(brefs, 0, sizeof(brefs));
+
+#if defined(SS_DEBUG)
+    rses.rses_chk_top = CHK_NUM_ROUTER_SES;
+    rses.rses_chk_tail = CHK_NUM_ROUTER_SES;
+#endif
+    rses.rses_config.compact_sescmd_history = true;
+    rses.rses_backend_ref = brefs;
+    rses.rses_nbackends = N_BACKENDS;
+    rses.router = &router;
+}
+
+static void free_session()
+{
+    rses_property_t *prop = rses.rses_properties[RSES_PROP_TYPE_SESCMD];
+
+    while (prop)
+    {
+        rses_property_t *next = prop->rses_prop_next;
+        rses_property_done(prop);
+        prop = next;
+    }
+
+    rses.rses_properties[RSES_PROP_TYPE_SESCMD] = NULL;
+}
+
+/**
+ * Get the key of a COM_QUERY
+ *
+ * @return The key, an empty string if the statement has none
+ */
+static const char *query_key(const char *sql)
+{
+    static char result[RWSPLIT_SESCMD_KEY_MAXLEN];
+    GWBUF *buf = modutil_create_query((char*)sql);
+    ss_dassert(buf);
+    char *key = sescmd_get_key(buf, MYSQL_COM_QUERY);
+
+    snprintf(result, sizeof(result), "%s", key ? key : "");
+    MXS_FREE(key);
+    gwbuf_free(buf);
+
+    return result;
+}
+
+/**
+ * Add a session command to the history as if the master had replied to it
+ *
+ * @return The session command
+ */
+static mysql_sescmd_t *add_sescmd(const char *sql)
+{
+    rses_property_t *prop = rses_property_init(RSES_PROP_TYPE_SESCMD);
+    ss_dassert(prop);
+    mysql_sescmd_t *scmd = mysql_sescmd_init(prop, modutil_create_query((char*)sql),
+                                             MYSQL_COM_QUERY, &rses);
+    int rc = rses_property_add(&rses, prop);
+    ss_dassert(rc == 0);
+    scmd->my_sescmd_is_replied = true;
+    rses.rses_nsescmd++;
+    router.stats.n_sescmd_history++;
+
+    return scmd;
+}
+
+/** Get the SQL of the n:th command in the history, NULL if there is none */
+static const char *history_sql(int n)
+{
+    static char result[100];
+    rses_property_t *prop = rses.rses_properties[RSES_PROP_TYPE_SESCMD];
+
+    for (int i = 0; prop && i < n; i++)
+    {
+        prop = prop->rses_prop_next;
+    }
+
+    if (prop == NULL)
+    {
+        return NULL;
+    }
+
+    char *sql;
+    int len;
+    bool ok = modutil_extract_SQL(prop->rses_prop_data.sescmd.my_sescmd_buf, &sql, &len);
+    ss_dassert(ok);
+    snprintf(result, sizeof(result), "%.*s", len, sql);
+
+    return result;
+}
+
+/**
+ * Statements that replace all of the session state they modify have a key
+ */
+static void test_keys()
+{
+    ss_dassert(strcmp(query_key("SET autocommit=1"), "SET autocommit") == 0);
+    ss_dassert(strcmp(query_key("set SESSION sql_mode = 'ANSI'"), "SET sql_mode") == 0);
+    ss_dassert(strcmp(query_key("SET @@session.sql_mode='ANSI';"), "SET sql_mode") == 0);
+    ss_dassert(strcmp(query_key("SET @@autocommit = ON"), "SET autocommit") == 0);
+    ss_dassert(strcmp(query_key("SET @a := 1"), "SET @a") == 0);
+    ss_dassert(strcmp(query_key("SET NAMES utf8"), "SET NAMES") == 0);
+    ss_dassert(strcmp(query_key("SET NAMES 'utf8' COLLATE 'utf8_bin'"), "SET NAMES") == 0);
+    ss_dassert(strcmp(query_key("USE test"), "USE") == 0);
+    ss_dassert(strcmp(query_key(" use `my db` "), "USE") == 0);
+
+    ss_info_dassert(*query_key("SET a=1, b=2") == '\0',
+                    "A SET list should not have a key");
+    ss_info_dassert(*query_key("SET @@global.max_connections=100") == '\0',
+                    "A global variable should not have a key");
+    ss_info_dassert(*query_key("SET GLOBAL max_connections=100") == '\0',
+                    "A global variable should not have a key");
+    ss_info_dassert(*query_key("SET @a = @a + 1") == '\0',
+                    "A value that depends on the state should not have a key");
+    ss_info_dassert(*query_key("SET @a = 'it''s'") == '\0',
+                    "Escaped quotes are not supported");
+    ss_info_dassert(*query_key("PREPARE ps FROM 'SELECT 1'") == '\0',
+                    "PREPARE should not have a key");
+    ss_info_dassert(*query_key("USE test; SELECT 1") == '\0',
+                    "A multi-statement should not have a key");
+
+    char *key = sescmd_get_key(NULL, MYSQL_COM_INIT_DB);
+    ss_info_dassert(key && strcmp(key, "USE") == 0, "COM_INIT_DB should have the key of USE");
+    MXS_FREE(key);
+}
+
+/**
+ * A newer command with the same key removes the older ones up to a barrier
+ */
+static void test_compaction()
+{
+    init_session();
+
+    add_sescmd("SET @a=1");
+    add_sescmd("SET @b=1");
+    add_sescmd("SET @a=2");
+    mysql_sescmd_t *scmd = add_sescmd("SET @a=3");
+    ss_dassert(rses.rses_nsescmd == 4);
+
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(0), "SET @b=1") == 0 &&
+                    strcmp(history_sql(1), "SET @a=3") == 0 &&
+                    history_sql(2) == NULL, "The older values of @a should be removed");
+    ss_dassert(rses.rses_nsescmd == 2);
+    ss_dassert(router.stats.n_sescmd_history == 2 && router.stats.n_sescmd_compacted == 2);
+
+    /** The prepared statement may use the old value */
+    mysql_sescmd_t *prepare = add_sescmd("PREPARE ps FROM 'SELECT @b'");
+    ss_info_dassert(sescmd_is_barrier(prepare), "PREPARE should be a barrier");
+    scmd = add_sescmd("SET @b=2");
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(0), "SET @b=1") == 0 &&
+                    strcmp(history_sql(1), "SET @a=3") == 0 &&
+                    strcmp(history_sql(2), "PREPARE ps FROM 'SELECT @b'") == 0 &&
+                    strcmp(history_sql(3), "SET @b=2") == 0,
+                    "Nothing before a barrier should be removed");
+
+    scmd = add_sescmd("SET @b=3");
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(3), "SET @b=3") == 0 && history_sql(4) == NULL,
+                    "The commands after the barrier should be compacted");
+
+    /** A command that the master has not yet replied to is kept */
+    scmd = add_sescmd("SET @a=4");
+    scmd->my_sescmd_is_replied = false;
+    scmd = add_sescmd("SET @a=5");
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(4), "SET @a=4") == 0,
+                    "An unreplied command should not be removed");
+
+    free_session();
+}
+
+/**
+ * The cursors of the backends keep pointing to the same commands
+ */
+static void test_cursors()
+{
+    init_session();
+
+    add_sescmd("SET @a=1");
+    mysql_sescmd_t *next = add_sescmd("SET @b=1");
+    rses_property_t *first = rses.rses_properties[RSES_PROP_TYPE_SESCMD];
+
+    /** A backend that is executing the first command */
+    brefs[0].bref_state = BREF_IN_USE;
+    brefs[0].bref_sescmd_cur.scmd_cur_ptr_property = &rses.rses_properties[RSES_PROP_TYPE_SESCMD];
+    brefs[0].bref_sescmd_cur.scmd_cur_cmd = &first->rses_prop_data.sescmd;
+
+    mysql_sescmd_t *scmd = add_sescmd("SET @a=2");
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(0), "SET @a=1") == 0,
+                    "A command that a cursor points to should not be removed");
+
+    /** The backend moves on to the second command */
+    brefs[0].bref_sescmd_cur.scmd_cur_ptr_property = &first->rses_prop_next;
+    brefs[0].bref_sescmd_cur.scmd_cur_cmd = next;
+
+    scmd = add_sescmd("SET @a=3");
+    sescmd_compact_history(&rses, scmd);
+    ss_info_dassert(strcmp(history_sql(0), "SET @b=1") == 0 &&
+                    strcmp(history_sql(1), "SET @a=3") == 0 &&
+                    history_sql(2) == NULL, "The older values of @a should be removed");
+    ss_info_dassert(brefs[0].bref_sescmd_cur.scmd_cur_ptr_property ==
+                    &rses.rses_properties[RSES_PROP_TYPE_SESCMD] &&
+                    brefs[0].bref_sescmd_cur.scmd_cur_cmd == next,
+                    "The cursor should point to the same command through a new link");
+    ss_dassert(sescmd_cursor_get_command(&brefs[0].bref_sescmd_cur) == next);
+
+    free_session();
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE;
+
+    if (mxs_log_init(NULL, ".", MXS_LOG_TARGET_DEFAULT))
+    {
+        test_keys();
+        test_compaction();
+        test_cursors();
+        rc = EXIT_SUCCESS;
+
+        mxs_log_finish();
+    }
+
+    return rc;
+}